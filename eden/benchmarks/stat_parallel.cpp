@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) 2018-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Exception.h>
+#include <folly/Likely.h>
+#include <folly/init/Init.h>
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include "eden/fs/benchharness/Bench.h"
+
+DEFINE_uint64(threads, 1, "The number of concurrent stat threads");
+DEFINE_uint64(iterations, 100000, "Number of stat iterations per thread");
+
+using namespace facebook::eden;
+
+/**
+ * Measures lstat() latency when many threads look up inodes in the same mount
+ * at once.
+ *
+ * Each thread starts at a different offset into the list of files, so with
+ * enough files the threads mostly request different inodes.  That makes the
+ * result sensitive to contention on mount-wide state such as the InodeMap,
+ * rather than on any single inode.
+ */
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+
+  if (argc <= 1) {
+    fprintf(
+        stderr,
+        "Specify a list of filenames on the command line. They will be "
+        "stat'ed in sequence.\n");
+    return 1;
+  }
+
+  auto clock_overhead = measureClockOverhead();
+  printf(
+      "Clock overhead measured at %" PRIu64 " ns minimum, %" PRIu64
+      " ns average\n",
+      clock_overhead.getMinimum(),
+      clock_overhead.getAverage());
+
+  // Prefetch every specified file.
+  for (int i = 1; i < argc; ++i) {
+    auto filename = argv[i];
+    struct stat st;
+    if (UNLIKELY(-1 == ::lstat(filename, &st))) {
+      perror(folly::to<std::string>("Failed to stat '", filename, "'").c_str());
+      return 1;
+    }
+  }
+
+  StartingGate gate{FLAGS_threads};
+
+  std::mutex result_mutex;
+  StatAccumulator combined_stat;
+
+  auto thread = [&](uint64_t index) {
+    StatAccumulator stat_accum;
+    int file_index = 1 + index % (argc - 1);
+
+    gate.wait();
+
+    for (uint64_t i = 0; i < FLAGS_iterations; ++i) {
+      const char* filename = argv[file_index];
+
+      struct stat st;
+      uint64_t start_time = getTime();
+      int result = ::lstat(filename, &st);
+      uint64_t after_stat = getTime();
+      if (UNLIKELY(-1 == result)) {
+        folly::throwSystemError("Failed to stat '", filename, "'");
+      }
+
+      if (++file_index >= argc) {
+        file_index = 1;
+      }
+
+      stat_accum.add(after_stat - start_time);
+    }
+
+    std::lock_guard guard{result_mutex};
+    combined_stat.combine(stat_accum);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(FLAGS_threads);
+  for (uint64_t t = 0; t < FLAGS_threads; ++t) {
+    threads.emplace_back([t, &thread] { thread(t); });
+  }
+
+  gate.waitThenOpen();
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  printf(
+      "lstat()\n  minimum: %" PRIu64 " ns\n  average: %" PRIu64 " ns\n",
+      combined_stat.getMinimum(),
+      combined_stat.getAverage());
+}
@@ -576,6 +576,14 @@ class OverlayCmd(Subcmd):
                 return binascii.hexlify(binhash).decode("utf-8")
 
         print("Inode {}: {}".format(inode_number, path))
+        if tree_data.firstChildInodeNumber and tree_data.childCount:
+            first_child = tree_data.firstChildInodeNumber
+            child_count = tree_data.childCount
+            print(
+                "    Unmodified, child inode numbers {} to {}".format(
+                    first_child, first_child + child_count - 1
+                )
+            )
         if not tree_data.entries:
             return
         name_width = max(len(name) for name in tree_data.entries)
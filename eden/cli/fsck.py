@@ -514,15 +514,36 @@ class FilesystemChecker:
             error = ex
 
         dir_entries = None
+        first_child = None
+        child_count = 0
         children: List[ChildInfo] = []
         if dir_data is not None:
             try:
                 parsed_data = self.overlay.parse_dir_inode_data(dir_data)
                 dir_entries = parsed_data.entries
+                first_child = parsed_data.firstChildInodeNumber
+                child_count = parsed_data.childCount or 0
             except Exception as ex:
                 type = InodeType.DIR_ERROR
                 error = ex
 
+        if first_child is not None:
+            # An unmodified directory only saves the inode numbers of its
+            # children.  Their names are in its source control Tree, which fsck
+            # does not read, and any of them with overlay data is a directory
+            # saved the same way.
+            for index in range(child_count):
+                child_number = first_child + index
+                self._update_max_inode_number(child_number)
+                children.append(
+                    ChildInfo(
+                        inode_number=child_number,
+                        name=f"<child {index}>",
+                        mode=stat.S_IFDIR | 0o755,
+                        hash=b"",
+                    )
+                )
+
         if dir_entries is not None:
             for name, entry in dir_entries.items():
                 if entry.inodeNumber:
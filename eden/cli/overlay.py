@@ -351,6 +351,16 @@ class Overlay:
         overlay after they have been extracted.
         """
         data = self.read_dir_inode(inode_number)
+        if remove and data.firstChildInodeNumber is not None:
+            # An unmodified directory that only saved the inode numbers of its
+            # children.  Nothing beneath it is materialized, but any of its
+            # children that have overlay data are directories saved the same
+            # way, and must be removed too.
+            for index in range(data.childCount or 0):
+                child_number = data.firstChildInodeNumber + index
+                if Path(self.get_path(child_number)).exists():
+                    self.extract_dir(child_number, output_path, remove=remove)
+
         for name, entry in data.entries.items():
             overlay_path = Path(self.get_path(entry.inodeNumber))
             if not overlay_path.exists():
@@ -53,6 +53,15 @@ def do_stats_general(
         blob_cache_size = None
         blob_cache_entry_count = None
 
+    if stat_info.treeCacheStats is not None:
+        tree_cache_size = stats_print.format_size(
+            stat_info.treeCacheStats.totalSizeInBytes
+        )
+        tree_cache_entry_count = stat_info.treeCacheStats.entryCount
+    else:
+        tree_cache_size = None
+        tree_cache_entry_count = None
+
     out.write(
         textwrap.dedent(
             f"""\
@@ -65,6 +74,21 @@ def do_stats_general(
 
     if blob_cache_size is not None and blob_cache_entry_count is not None:
         out.write(f"blob cache: {blob_cache_size} in {blob_cache_entry_count} blobs\n")
+    if tree_cache_size is not None and tree_cache_entry_count is not None:
+        out.write(f"tree cache: {tree_cache_size} in {tree_cache_entry_count} trees\n")
+
+    gc_stats = stat_info.localStoreGCStats
+    if gc_stats is not None and gc_stats.keySpaces:
+        state = f"running ({gc_stats.currentKeySpace})" if gc_stats.running else "idle"
+        out.write(f"local store gc: {gc_stats.runCount} runs, {state}\n")
+        for name, ks in sorted(gc_stats.keySpaces.items()):
+            size = stats_print.format_size(ks.approximateSize)
+            limit = stats_print.format_size(ks.sizeLimit) if ks.sizeLimit else "none"
+            reclaimed = stats_print.format_size(ks.bytesReclaimed)
+            out.write(
+                f"- {name}: {size} (limit {limit}), {reclaimed} reclaimed "
+                f"from {ks.entriesEvicted} entries\n"
+            )
 
     out.write(
         textwrap.dedent(
@@ -44,6 +44,7 @@ constexpr folly::StringPiece kRepoTypeKey{"type"};
 const facebook::eden::RelativePathPiece kSnapshotFile{"SNAPSHOT"};
 const facebook::eden::RelativePathPiece kBindMountsDir{"bind-mounts"};
 const facebook::eden::RelativePathPiece kOverlayDir{"local"};
+const facebook::eden::RelativePathPiece kJournalLogFile{"journal"};
 
 // File holding mapping of client directories.
 const facebook::eden::RelativePathPiece kClientDirectoryMap{"config.json"};
@@ -173,6 +174,10 @@ AbsolutePath CheckoutConfig::getOverlayPath() const {
   return clientDirectory_ + kOverlayDir;
 }
 
+AbsolutePath CheckoutConfig::getJournalLogPath() const {
+  return clientDirectory_ + kJournalLogFile;
+}
+
 std::unique_ptr<CheckoutConfig> CheckoutConfig::loadFromClientDirectory(
     AbsolutePathPiece mountPath,
     AbsolutePathPiece clientDirectory) {
@@ -118,6 +118,9 @@ class CheckoutConfig {
   /** Path to the file where the current commit ID is stored */
   AbsolutePath getSnapshotPath() const;
 
+  /** Path to the file where the journal is recorded across restarts */
+  AbsolutePath getJournalLogPath() const;
+
   /** Path to the client directory */
   const AbsolutePath& getClientDirectory() const;
 
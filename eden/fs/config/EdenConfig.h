@@ -141,6 +141,69 @@ class EdenConfig : public ConfigSettingManager {
     return configReloadInterval_.getValue();
   }
 
+  /**
+   * Get the approximate amount of memory, in bytes, each mount may use to
+   * cache blob sizes and SHA-1s.
+   */
+  uint64_t getBlobMetadataCacheSize() const {
+    return blobMetadataCacheSize_.getValue();
+  }
+
+  /**
+   * Get how often the LocalStore is garbage collected.  0 disables garbage
+   * collection.
+   */
+  std::chrono::nanoseconds getLocalStoreGCInterval() const {
+    return localStoreGCInterval_.getValue();
+  }
+
+  /**
+   * Get the approximate number of bytes the LocalStore may use for each of
+   * its garbage collected key spaces.  0 means no limit.
+   */
+  uint64_t getLocalStoreBlobSizeLimit() const {
+    return localStoreBlobSizeLimit_.getValue();
+  }
+  uint64_t getLocalStoreBlobMetaSizeLimit() const {
+    return localStoreBlobMetaSizeLimit_.getValue();
+  }
+  uint64_t getLocalStoreHgCommitToTreeSizeLimit() const {
+    return localStoreHgCommitToTreeSizeLimit_.getValue();
+  }
+
+  /**
+   * Get the approximate amount of memory, in bytes, each mount's journal may
+   * use before its oldest entries are compacted or discarded.
+   */
+  uint64_t getJournalMemoryLimit() const {
+    return journalMemoryLimit_.getValue();
+  }
+
+  /**
+   * Get the approximate amount of disk space, in bytes, each mount's journal
+   * log may use to preserve the journal across restarts.  0 disables the
+   * journal log.
+   */
+  uint64_t getJournalDiskLimit() const {
+    return journalDiskLimit_.getValue();
+  }
+
+  /**
+   * Get how long a journal waits for further changes before notifying its
+   * subscribers, so that a burst of changes produces a single notification.
+   */
+  std::chrono::nanoseconds getJournalNotifyMinInterval() const {
+    return journalNotifyMinInterval_.getValue();
+  }
+
+  /**
+   * Get the longest a journal delays notifying its subscribers of a change
+   * while changes keep being made.
+   */
+  std::chrono::nanoseconds getJournalNotifyMaxLatency() const {
+    return journalNotifyMaxLatency_.getValue();
+  }
+
   void setUserConfigPath(AbsolutePath userConfigPath);
 
   void setSystemConfigDir(AbsolutePath systemConfigDir);
@@ -263,6 +326,46 @@ class EdenConfig : public ConfigSettingManager {
       std::chrono::minutes(5),
       this};
 
+  ConfigSetting<uint64_t> blobMetadataCacheSize_{
+      "store:blob-metadata-cache-size",
+      64 * 1024 * 1024,
+      this};
+
+  ConfigSetting<std::chrono::nanoseconds> localStoreGCInterval_{
+      "store:gc-interval",
+      std::chrono::hours(1),
+      this};
+  ConfigSetting<uint64_t> localStoreBlobSizeLimit_{
+      "store:blob-size-limit",
+      15ull * 1024 * 1024 * 1024,
+      this};
+  ConfigSetting<uint64_t> localStoreBlobMetaSizeLimit_{
+      "store:blobmeta-size-limit",
+      1024 * 1024 * 1024,
+      this};
+  ConfigSetting<uint64_t> localStoreHgCommitToTreeSizeLimit_{
+      "store:hgcommit2tree-size-limit",
+      20 * 1024 * 1024,
+      this};
+
+  ConfigSetting<uint64_t> journalMemoryLimit_{"journal:memory-limit",
+                                              1024 * 1024 * 1024,
+                                              this};
+
+  ConfigSetting<uint64_t> journalDiskLimit_{"journal:disk-limit",
+                                            64 * 1024 * 1024,
+                                            this};
+
+  ConfigSetting<std::chrono::nanoseconds> journalNotifyMinInterval_{
+      "journal:notify-min-interval",
+      std::chrono::milliseconds(10),
+      this};
+
+  ConfigSetting<std::chrono::nanoseconds> journalNotifyMaxLatency_{
+      "journal:notify-max-latency",
+      std::chrono::milliseconds(100),
+      this};
+
   struct stat systemConfigFileStat_ = {};
   struct stat userConfigFileStat_ = {};
 };
@@ -9,20 +9,81 @@
  */
 #include "eden/fs/fuse/BufVec.h"
 
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+
 namespace facebook {
 namespace eden {
 
 BufVec::Buf::Buf(std::unique_ptr<folly::IOBuf> buf) : buf(std::move(buf)) {}
 
+BufVec::Buf::Buf(std::shared_ptr<const folly::File> f, off_t pos, size_t size)
+    : file(std::move(f)), fd(file->fd()), fd_size(size), fd_pos(pos) {}
+
+void BufVec::Buf::loadFromFd() {
+  if (fd == -1) {
+    return;
+  }
+
+  auto data = folly::IOBuf::createCombined(fd_size);
+  auto res = folly::preadNoInt(fd, data->writableBuffer(), fd_size, fd_pos);
+  folly::checkUnixError(res, "pread failed while loading BufVec data");
+  data->append(res);
+
+  buf = std::move(data);
+  file.reset();
+  fd = -1;
+  fd_size = 0;
+  fd_pos = -1;
+}
+
+void BufVec::Buf::appendTo(std::string& out) const {
+  if (fd != -1) {
+    auto start = out.size();
+    out.resize(start + fd_size);
+    auto res = folly::preadNoInt(fd, &out[start], fd_size, fd_pos);
+    folly::checkUnixError(res, "pread failed while copying BufVec data");
+    out.resize(start + res);
+    return;
+  }
+
+  const auto* cur = buf.get();
+  do {
+    out.append(reinterpret_cast<const char*>(cur->data()), cur->length());
+    cur = cur->next();
+  } while (cur != buf.get());
+}
+
 BufVec::BufVec(std::unique_ptr<folly::IOBuf> buf) {
   items_.emplace_back(std::make_shared<Buf>(std::move(buf)));
 }
 
+BufVec::BufVec(
+    std::shared_ptr<const folly::File> file,
+    off_t pos,
+    size_t size) {
+  items_.emplace_back(std::make_shared<Buf>(std::move(file), pos, size));
+}
+
+std::optional<BufVec::FdRange> BufVec::getSpliceableFdRange() const {
+  if (items_.size() != 1 || items_[0]->fd == -1) {
+    return std::nullopt;
+  }
+  const auto& b = items_[0];
+  return FdRange{b->fd, b->fd_pos, b->fd_size};
+}
+
+void BufVec::load() {
+  for (auto& b : items_) {
+    b->loadFromFd();
+  }
+}
+
 folly::fbvector<struct iovec> BufVec::getIov() const {
   folly::fbvector<struct iovec> vec;
 
   for (const auto& b : items_) {
-    DCHECK(b->fd == -1) << "we don't support splicing yet";
+    DCHECK(b->fd == -1) << "BufVec::load() must be called before getIov()";
     b->buf->appendToIov(&vec);
   }
 
@@ -32,7 +93,11 @@ folly::fbvector<struct iovec> BufVec::getIov() const {
 size_t BufVec::size() const {
   size_t total = 0;
   for (const auto& b : items_) {
-    total += b->buf->computeChainDataLength();
+    if (b->fd != -1) {
+      total += b->fd_size;
+    } else {
+      total += b->buf->computeChainDataLength();
+    }
   }
   return total;
 }
@@ -41,12 +106,7 @@ std::string BufVec::copyData() const {
   std::string rv;
   rv.reserve(size());
   for (const auto& b : items_) {
-    DCHECK(b->fd == -1) << "we don't support splicing yet";
-    const auto* buf = b->buf.get();
-    do {
-      rv.append(reinterpret_cast<const char*>(buf->data()), buf->length());
-      buf = buf->next();
-    } while (buf != b->buf.get());
+    b->appendTo(rv);
   }
   return rv;
 }
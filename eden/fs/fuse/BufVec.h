@@ -9,7 +9,9 @@
  */
 #pragma once
 #include <folly/FBVector.h>
+#include <folly/File.h>
 #include <folly/io/IOBuf.h>
+#include <optional>
 
 namespace facebook {
 namespace eden {
@@ -17,13 +19,15 @@ namespace eden {
 /**
  * Represents data that may come from a buffer or a file descriptor.
  *
- * While we don't currently have a fuse client lib that supports this,
- * we want to make sure we're ready to use it, so this looks like
- * a dumb wrapper around IOBuf at the moment.
+ * A BufVec that refers to a range of a file descriptor can be spliced
+ * directly into the FUSE device by FuseChannel without ever copying the data
+ * into user space.  Such a BufVec must be load()ed before getIov() is called.
  */
 class BufVec {
   struct Buf {
     std::unique_ptr<folly::IOBuf> buf;
+    // The file keeps the descriptor alive until the data has been consumed.
+    std::shared_ptr<const folly::File> file;
     int fd{-1};
     size_t fd_size{0};
     off_t fd_pos{-1};
@@ -34,6 +38,16 @@ class BufVec {
     Buf& operator=(Buf&&) = default;
 
     explicit Buf(std::unique_ptr<folly::IOBuf> buf);
+    Buf(std::shared_ptr<const folly::File> file, off_t pos, size_t size);
+
+    /**
+     * If this Buf refers to a file descriptor, read its contents into memory
+     * so that buf can be used.
+     */
+    void loadFromFd();
+
+    /** Append the contents of this Buf to out. */
+    void appendTo(std::string& out) const;
   };
   folly::fbvector<std::shared_ptr<Buf>> items_;
 
@@ -45,8 +59,35 @@ class BufVec {
 
   explicit BufVec(std::unique_ptr<folly::IOBuf> buf);
 
+  /**
+   * Construct a BufVec referring to `size` bytes of `file` starting at offset
+   * `pos`.  The data is not read until it is needed.  If the file has been
+   * truncated by the time it is read the data stops at EOF.
+   */
+  BufVec(std::shared_ptr<const folly::File> file, off_t pos, size_t size);
+
+  struct FdRange {
+    int fd;
+    off_t pos;
+    size_t size;
+  };
+
+  /**
+   * If this BufVec consists of a single file descriptor range that has not
+   * yet been read into memory, return its fd, offset and size so that it can
+   * be passed to splice(2).  Otherwise returns std::nullopt.
+   */
+  std::optional<FdRange> getSpliceableFdRange() const;
+
+  /**
+   * Read any file descriptor ranges into memory.  Throws if the read fails.
+   */
+  void load();
+
   /**
    * Return an iovector suitable for e.g. writev()
+   * The data must be in memory: call load() first if the BufVec may refer to
+   * a file descriptor.
    *   auto iov = buf->getIov();
    *   auto xfer = writev(fd, iov.data(), iov.size());
    */
@@ -58,7 +99,8 @@ class BufVec {
   size_t size() const;
 
   /**
-   * Copies the buffer into a std::string.
+   * Copies the buffer into a std::string, reading any file descriptor ranges
+   * without loading them into the BufVec.
    */
   std::string copyData() const;
 };
@@ -65,5 +65,68 @@ std::vector<DirList::ExtractedEntry> DirList::extract() const {
   return result;
 }
 
+#ifdef __linux__
+DirPlusList::DirPlusList(size_t maxSize)
+    : buf_(new char[maxSize]), end_(buf_.get() + maxSize), cur_(buf_.get()) {}
+
+size_t DirPlusList::entrySize(StringPiece name) {
+  return FUSE_DIRENT_ALIGN(FUSE_NAME_OFFSET_DIRENTPLUS + name.size());
+}
+
+bool DirPlusList::add(
+    StringPiece name,
+    ino_t inode,
+    dtype_t type,
+    off_t off,
+    const fuse_entry_out& entry) {
+  const size_t avail = end_ - cur_;
+  const auto entLength = FUSE_NAME_OFFSET_DIRENTPLUS + name.size();
+  const auto fullSize = FUSE_DIRENT_ALIGN(entLength);
+  if (fullSize > avail) {
+    return false;
+  }
+
+  fuse_direntplus* const direntplus = reinterpret_cast<fuse_direntplus*>(cur_);
+  direntplus->entry_out = entry;
+  fuse_dirent* const dirent = &direntplus->dirent;
+  dirent->ino = inode;
+  dirent->off = off;
+  dirent->namelen = name.size();
+  dirent->type = static_cast<decltype(dirent->type)>(type);
+  memcpy(dirent->name, name.data(), name.size());
+  if (fullSize > entLength) {
+    // 0 out any padding
+    memset(cur_ + entLength, 0, fullSize - entLength);
+  }
+
+  cur_ += fullSize;
+  DCHECK_LE(cur_, end_);
+  return true;
+}
+
+StringPiece DirPlusList::getBuf() const {
+  return StringPiece(buf_.get(), cur_ - buf_.get());
+}
+
+std::vector<DirPlusList::ExtractedEntry> DirPlusList::extract() const {
+  std::vector<DirPlusList::ExtractedEntry> result;
+
+  char* p = buf_.get();
+  while (p != cur_) {
+    auto direntplus = reinterpret_cast<fuse_direntplus*>(p);
+    const auto& dirent = direntplus->dirent;
+    result.emplace_back(ExtractedEntry{
+        std::string{dirent.name, dirent.name + dirent.namelen},
+        dirent.ino,
+        static_cast<dtype_t>(dirent.type),
+        static_cast<off_t>(dirent.off),
+        direntplus->entry_out});
+
+    p += FUSE_DIRENTPLUS_SIZE(direntplus);
+  }
+  return result;
+}
+#endif
+
 } // namespace eden
 } // namespace facebook
@@ -11,6 +11,7 @@
 #include <folly/Range.h>
 #include <sys/stat.h>
 #include <memory>
+#include "eden/fs/fuse/FuseTypes.h"
 #include "eden/fs/utils/DirType.h"
 
 namespace facebook {
@@ -54,5 +55,68 @@ class DirList {
   std::vector<ExtractedEntry> extract() const;
 };
 
+#ifdef __linux__
+/**
+ * Helper for populating FUSE_READDIRPLUS listings.
+ *
+ * Each dirent is preceded by the fuse_entry_out that a FUSE_LOOKUP of the
+ * name would have returned.  The kernel takes a lookup reference on every
+ * entry with a non-zero nodeid, exactly as if it had been looked up.  An
+ * entry with a nodeid of 0 is treated as a plain dirent.
+ */
+class DirPlusList {
+  std::unique_ptr<char[]> buf_;
+  char* end_;
+  char* cur_;
+
+ public:
+  struct ExtractedEntry {
+    std::string name;
+    ino_t inode;
+    dtype_t type;
+    off_t offset;
+    fuse_entry_out entry;
+  };
+
+  explicit DirPlusList(size_t maxSize);
+
+  DirPlusList(const DirPlusList&) = delete;
+  DirPlusList& operator=(const DirPlusList&) = delete;
+  DirPlusList(DirPlusList&&) = default;
+  DirPlusList& operator=(DirPlusList&&) = default;
+
+  /**
+   * The number of bytes an entry with the given name occupies in the list.
+   */
+  static size_t entrySize(folly::StringPiece name);
+
+  /**
+   * The number of bytes still available in the list.
+   */
+  size_t remaining() const {
+    return end_ - cur_;
+  }
+
+  /**
+   * Add a new entry to the list.
+   * Returns true on success or false if the list is full.
+   */
+  bool add(
+      folly::StringPiece name,
+      ino_t inode,
+      dtype_t type,
+      off_t off,
+      const fuse_entry_out& entry);
+
+  folly::StringPiece getBuf() const;
+
+  /**
+   * Helper function that parses an accumulated buffer back into its constituent
+   * parts.
+   */
+  std::vector<ExtractedEntry> extract() const;
+};
+#endif
+
 } // namespace eden
 } // namespace facebook
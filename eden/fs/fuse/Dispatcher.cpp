@@ -58,6 +58,19 @@ fuse_attr_out Dispatcher::Attr::asFuseAttr() const {
   return result;
 }
 
+fuse_entry_out Dispatcher::Attr::asFuseEntry(InodeNumber number) const {
+  fuse_entry_out entry = {};
+  entry.nodeid = number.get();
+  entry.generation = 0;
+  auto fuse_attr = asFuseAttr();
+  entry.attr = fuse_attr.attr;
+  entry.attr_valid = fuse_attr.attr_valid;
+  entry.attr_valid_nsec = fuse_attr.attr_valid_nsec;
+  entry.entry_valid = fuse_attr.attr_valid;
+  entry.entry_valid_nsec = fuse_attr.attr_valid_nsec;
+  return entry;
+}
+
 Dispatcher::~Dispatcher() {}
 
 Dispatcher::Dispatcher(EdenStats* stats) : stats_(stats) {}
@@ -181,6 +194,34 @@ Dispatcher::readdir(InodeNumber, DirList&&, off_t, uint64_t) {
   FUSELL_NOT_IMPL();
 }
 
+#ifdef __linux__
+folly::Future<DirPlusList> Dispatcher::readdirplus(
+    InodeNumber ino,
+    DirPlusList&& dirList,
+    off_t offset,
+    uint64_t fh) {
+  // Dispatchers that do not implement readdirplus still need to answer it
+  // once the kernel has been told we support it.  Return the plain readdir
+  // results without entry information; entries that do not fit are picked up
+  // by the next call, which resumes from the last offset we return.
+  auto size = dirList.remaining();
+  return readdir(ino, DirList{size}, offset, fh)
+      .thenValue([dirList = std::move(dirList)](DirList&& list) mutable {
+        for (const auto& entry : list.extract()) {
+          if (!dirList.add(
+                  entry.name,
+                  entry.inode,
+                  entry.type,
+                  entry.offset,
+                  fuse_entry_out{})) {
+            break;
+          }
+        }
+        return std::move(dirList);
+      });
+}
+#endif
+
 folly::Future<struct fuse_kstatfs> Dispatcher::statfs(InodeNumber /*ino*/) {
   struct fuse_kstatfs info = {};
 
@@ -32,6 +32,7 @@ namespace eden {
   } while (0)
 
 class DirList;
+class DirPlusList;
 class Dispatcher;
 class EdenStats;
 class FileHandle;
@@ -107,6 +108,11 @@ class Dispatcher {
         uint64_t timeout = std::numeric_limits<uint64_t>::max());
 
     fuse_attr_out asFuseAttr() const;
+
+    /**
+     * The reply to a lookup of the given inode number with these attributes.
+     */
+    fuse_entry_out asFuseEntry(InodeNumber number) const;
   };
 
   /**
@@ -345,6 +351,27 @@ class Dispatcher {
   virtual folly::Future<DirList>
   readdir(InodeNumber ino, DirList&& dirList, off_t offset, uint64_t fh);
 
+#ifdef __linux__
+  /**
+   * Read directory, including the result of looking up each entry.
+   *
+   * Send a DirPlusList filled using DirPlusList::add().
+   * Send an empty DirPlusList on end of stream.
+   *
+   * The kernel takes a lookup reference on every entry with a non-zero
+   * nodeid, so the implementation must account for each of them as it would
+   * for lookup().  The default implementation returns the readdir() results
+   * with no entry information.
+   *
+   * The fh parameter contains opendir's result.
+   */
+  virtual folly::Future<DirPlusList> readdirplus(
+      InodeNumber ino,
+      DirPlusList&& dirList,
+      off_t offset,
+      uint64_t fh);
+#endif
+
   /**
    * Get file system statistics
    *
@@ -10,11 +10,14 @@
 #include "eden/fs/fuse/FuseChannel.h"
 
 #include <boost/cast.hpp>
+#include <fcntl.h>
+#include <folly/FileUtil.h>
 #include <folly/futures/Future.h>
 #include <folly/io/async/Request.h>
 #include <folly/logging/xlog.h>
 #include <folly/system/ThreadName.h>
 #include <signal.h>
+#include <sys/ioctl.h>
 #include <type_traits>
 #include "eden/fs/fuse/DirList.h"
 #include "eden/fs/fuse/Dispatcher.h"
@@ -171,6 +174,67 @@ void installSignalHandler() {
       sigaction(SIGUSR2, &action, &oldAction), "failed to set SIGUSR2 handler");
 }
 
+#ifdef __linux__
+/**
+ * A pipe used as the intermediate buffer when splicing file data into the
+ * FUSE device.  splice(2) requires one side of every transfer to be a pipe.
+ *
+ * Replies may be sent from any thread that completes a FUSE request, so each
+ * thread lazily allocates its own pipe.
+ */
+class SplicePipe {
+ public:
+  explicit SplicePipe(size_t minCapacity) {
+    int fds[2];
+    folly::checkUnixError(
+        pipe2(fds, O_CLOEXEC | O_NONBLOCK), "failed to create splice pipe");
+    readEnd_ = folly::File{fds[0], /*ownsFd=*/true};
+    writeEnd_ = folly::File{fds[1], /*ownsFd=*/true};
+
+    // The default pipe size is smaller than the largest FUSE reply, so try to
+    // grow it.  If this fails (e.g., because of /proc/sys/fs/pipe-max-size)
+    // we just splice fewer replies.
+    auto size = fcntl(writeEnd_.fd(), F_SETPIPE_SZ, minCapacity);
+    if (size < 0) {
+      size = fcntl(writeEnd_.fd(), F_GETPIPE_SZ);
+    }
+    capacity_ = size < 0 ? 0 : static_cast<size_t>(size);
+  }
+
+  int readFd() const {
+    return readEnd_.fd();
+  }
+  int writeFd() const {
+    return writeEnd_.fd();
+  }
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  /**
+   * Discard any data left in the pipe after a failed splice.
+   */
+  void drain() {
+    char buf[4096];
+    while (folly::readNoInt(readEnd_.fd(), buf, sizeof(buf)) > 0) {
+    }
+  }
+
+ private:
+  folly::File readEnd_;
+  folly::File writeEnd_;
+  size_t capacity_{0};
+};
+
+SplicePipe& getSplicePipe(size_t minCapacity) {
+  thread_local std::unique_ptr<SplicePipe> splicePipe;
+  if (!splicePipe) {
+    splicePipe = std::make_unique<SplicePipe>(minCapacity);
+  }
+  return *splicePipe;
+}
+#endif
+
 } // namespace
 
 struct FuseChannel::HandlerEntry {
@@ -206,6 +270,10 @@ const FuseChannel::HandlerMap FuseChannel::handlerMap_ = {
     {FUSE_FLUSH, {&FuseChannel::fuseFlush, &FuseThreadStats::flush}},
     {FUSE_OPENDIR, {&FuseChannel::fuseOpenDir, &FuseThreadStats::opendir}},
     {FUSE_READDIR, {&FuseChannel::fuseReadDir, &FuseThreadStats::readdir}},
+#ifdef __linux__
+    {FUSE_READDIRPLUS,
+     {&FuseChannel::fuseReadDirPlus, &FuseThreadStats::readdirplus}},
+#endif
     {FUSE_RELEASEDIR,
      {&FuseChannel::fuseReleaseDir, &FuseThreadStats::releasedir}},
     {FUSE_FSYNCDIR, {&FuseChannel::fuseFsyncDir, &FuseThreadStats::fsyncdir}},
@@ -365,14 +433,17 @@ std::ostream& operator<<(
             << ")";
 }
 
-void FuseChannel::replyError(const fuse_in_header& request, int errorCode) {
+void FuseChannel::replyError(
+    const fuse_in_header& request,
+    int errorCode,
+    size_t queue) {
   fuse_out_header err;
   err.len = sizeof(err);
   err.error = -errorCode;
   err.unique = request.unique;
   XLOG(DBG7) << "replyError unique=" << err.unique << " error=" << errorCode
              << " " << folly::errnoStr(errorCode);
-  auto res = write(fuseDevice_.fd(), &err, sizeof(err));
+  auto res = write(getQueueFd(queue), &err, sizeof(err));
   if (res != sizeof(err)) {
     if (res < 0) {
       throwSystemError("replyError: error writing to fuse device");
@@ -384,19 +455,21 @@ void FuseChannel::replyError(const fuse_in_header& request, int errorCode) {
 
 void FuseChannel::sendReply(
     const fuse_in_header& request,
-    folly::fbvector<iovec>&& vec) const {
+    folly::fbvector<iovec>&& vec,
+    size_t queue) const {
   fuse_out_header out;
   out.unique = request.unique;
   out.error = 0;
 
   vec.insert(vec.begin(), make_iovec(out));
 
-  sendRawReply(vec.data(), vec.size());
+  sendRawReply(vec.data(), vec.size(), queue);
 }
 
 void FuseChannel::sendReply(
     const fuse_in_header& request,
-    folly::ByteRange bytes) const {
+    folly::ByteRange bytes,
+    size_t queue) const {
   fuse_out_header out;
   out.unique = request.unique;
   out.error = 0;
@@ -407,10 +480,123 @@ void FuseChannel::sendReply(
   iov[1].iov_base = const_cast<uint8_t*>(bytes.data());
   iov[1].iov_len = bytes.size();
 
-  sendRawReply(iov.data(), iov.size());
+  sendRawReply(iov.data(), iov.size(), queue);
+}
+
+void FuseChannel::sendReply(
+    const fuse_in_header& request,
+    BufVec&& buf,
+    size_t queue) const {
+  if (shouldSpliceReplies()) {
+    if (auto range = buf.getSpliceableFdRange()) {
+      if (trySpliceReply(request, *range, queue)) {
+        return;
+      }
+    }
+  }
+
+  buf.load();
+  sendReply(request, buf.getIov(), queue);
+}
+
+bool FuseChannel::shouldSpliceReplies() const {
+#ifdef __linux__
+  return useSplice_ && connInfo_.has_value() &&
+      (connInfo_->flags & FUSE_SPLICE_WRITE);
+#else
+  return false;
+#endif
 }
 
-void FuseChannel::sendRawReply(const iovec iov[], size_t count) const {
+bool FuseChannel::trySpliceReply(
+    const fuse_in_header& request,
+    const BufVec::FdRange& range,
+    size_t queue) const {
+#ifdef __linux__
+  fuse_out_header out;
+  out.unique = request.unique;
+  out.error = 0;
+  out.len = sizeof(out) + range.size;
+
+  // The kernel requires the entire reply to be in the pipe when it is
+  // spliced into the FUSE device.
+  auto& pipe = getSplicePipe(bufferSize_);
+  if (out.len > pipe.capacity()) {
+    return false;
+  }
+
+  // The header is tiny, so just copy it into the pipe.
+  auto res = folly::writeNoInt(pipe.writeFd(), &out, sizeof(out));
+  if (res != sizeof(out)) {
+    pipe.drain();
+    return false;
+  }
+
+  loff_t offset = range.pos;
+  size_t remaining = range.size;
+  while (remaining > 0) {
+    auto spliced = splice(
+        range.fd,
+        &offset,
+        pipe.writeFd(),
+        nullptr,
+        remaining,
+        SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (spliced < 0 && errno == EINTR) {
+      continue;
+    }
+    if (spliced <= 0) {
+      // Either an error or EOF because the file was truncated after the read
+      // size was computed.  Nothing has been sent to the kernel yet, so let
+      // the caller fall back to a normal reply.
+      XLOG(DBG4) << "falling back to copied reply for unique="
+                 << request.unique << ": spliced " << range.size - remaining
+                 << " of " << range.size << " bytes";
+      pipe.drain();
+      return false;
+    }
+    remaining -= spliced;
+  }
+
+  auto written = splice(
+      pipe.readFd(),
+      nullptr,
+      getQueueFd(queue),
+      nullptr,
+      out.len,
+      SPLICE_F_MOVE);
+  const int err = errno;
+  XLOG(DBG7) << "trySpliceReply: unique=" << out.unique
+             << " header->len=" << out.len << " wrote=" << written;
+
+  if (written < 0) {
+    pipe.drain();
+    if (err == ENOENT) {
+      // Interrupted by a signal.  We don't need to log this,
+      // but will propagate it back to our caller.
+    } else if (!isFuseDeviceValid(state_.rlock()->stopReason)) {
+      XLOG(INFO) << "error splicing to fuse device: session closed";
+    } else {
+      XLOG(WARNING) << "error splicing to fuse device: "
+                    << folly::errnoStr(err);
+    }
+    throwSystemErrorExplicit(err, "error splicing to fuse device");
+  }
+  if (static_cast<size_t>(written) != out.len) {
+    pipe.drain();
+    throw std::runtime_error("unexpected short splice to FUSE device");
+  }
+  return true;
+#else
+  (void)request;
+  (void)range;
+  (void)queue;
+  return false;
+#endif
+}
+
+void FuseChannel::sendRawReply(const iovec iov[], size_t count, size_t queue)
+    const {
   // Ensure that the length is set correctly
   DCHECK_EQ(iov[0].iov_len, sizeof(fuse_out_header));
   const auto header = reinterpret_cast<fuse_out_header*>(iov[0].iov_base);
@@ -419,7 +605,7 @@ void FuseChannel::sendRawReply(const iovec iov[], size_t count) const {
     header->len += iov[i].iov_len;
   }
 
-  const auto res = writev(fuseDevice_.fd(), iov, count);
+  const auto res = writev(getQueueFd(queue), iov, count);
   const int err = errno;
   XLOG(DBG7) << "sendRawReply: unique=" << header->unique
              << " header->len=" << header->len << " wrote=" << res;
@@ -442,12 +628,19 @@ FuseChannel::FuseChannel(
     AbsolutePathPiece mountPath,
     size_t numThreads,
     Dispatcher* const dispatcher,
-    std::shared_ptr<ProcessNameCache> processNameCache)
+    std::shared_ptr<ProcessNameCache> processNameCache,
+    bool useSplice,
+    bool cloneDevicePerThread,
+    bool pinWorkerThreads)
     : bufferSize_(std::max(size_t(getpagesize()) + 0x1000, MIN_BUFSIZE)),
       numThreads_(numThreads),
+      useSplice_(useSplice),
+      cloneDevicePerThread_(cloneDevicePerThread),
+      pinWorkerThreads_(pinWorkerThreads),
       dispatcher_(dispatcher),
       mountPath_(mountPath),
       fuseDevice_(std::move(fuseDevice)),
+      queueDepths_(new std::atomic<uint64_t>[numThreads]()),
       processAccessLog_(std::move(processNameCache)) {
   CHECK_GE(numThreads_, 1);
   installSignalHandler();
@@ -468,11 +661,19 @@ Future<FuseChannel::StopFuture> FuseChannel::initialize() {
 }
 
 FuseChannel::StopFuture FuseChannel::initializeFromTakeover(
-    fuse_init_out connInfo) {
+    fuse_init_out connInfo,
+    std::vector<folly::File> clonedDevices) {
   connInfo_ = connInfo;
   XLOG(DBG1) << "Takeover using max_write=" << connInfo_->max_write
              << ", max_readahead=" << connInfo_->max_readahead
-             << ", want=" << flagsToLabel(capsLabels, connInfo_->flags);
+             << ", want=" << flagsToLabel(capsLabels, connInfo_->flags)
+             << ", cloned devices=" << clonedDevices.size();
+  if (cloneDevicePerThread_ && clonedDevices.size() + 1 == numThreads_) {
+    // The previous process has already waited for all outstanding requests
+    // to complete, so nothing is pending on these devices and we can simply
+    // continue reading from them.
+    clonedDevices_ = std::move(clonedDevices);
+  }
   startWorkerThreads();
   return sessionCompletePromise_.getFuture();
 }
@@ -492,9 +693,16 @@ void FuseChannel::startWorkerThreads() {
   }
 
   try {
+    if (cloneDevicePerThread_ && clonedDevices_.empty()) {
+      cloneDevices();
+    }
+
     state->workerThreads.reserve(numThreads_);
     while (state->workerThreads.size() < numThreads_) {
-      state->workerThreads.emplace_back([this] { fuseWorkerThread(); });
+      // Each worker thread services the queue with the same index.
+      auto queue = state->workerThreads.size();
+      state->workerThreads.emplace_back(
+          [this, queue] { fuseWorkerThread(queue); });
     }
 
     invalidationThread_ = std::thread([this] { invalidationThread(); });
@@ -507,6 +715,40 @@ void FuseChannel::startWorkerThreads() {
   }
 }
 
+void FuseChannel::cloneDevices() {
+#ifdef __linux__
+  std::vector<folly::File> clones;
+  clones.reserve(numThreads_ - 1);
+  try {
+    while (clones.size() + 1 < numThreads_) {
+      folly::File clone{"/dev/fuse", O_RDWR | O_CLOEXEC};
+      uint32_t sessionFd = fuseDevice_.fd();
+      folly::checkUnixError(
+          ioctl(clone.fd(), FUSE_DEV_IOC_CLONE, &sessionFd),
+          "FUSE_DEV_IOC_CLONE failed");
+      clones.push_back(std::move(clone));
+    }
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "unable to clone the FUSE device for \"" << mountPath_
+               << "\"; all worker threads will share one queue: "
+               << exceptionStr(ex);
+    return;
+  }
+  XLOG(DBG2) << "cloned the FUSE device for \"" << mountPath_ << "\" "
+             << clones.size() << " times";
+  clonedDevices_ = std::move(clones);
+#else
+  XLOG(WARN) << "cloning the FUSE device is not supported on this platform";
+#endif
+}
+
+int FuseChannel::getQueueFd(size_t queue) const {
+  if (queue == kMainQueue || clonedDevices_.empty()) {
+    return fuseDevice_.fd();
+  }
+  return clonedDevices_[queue - 1].fd();
+}
+
 void FuseChannel::destroy() {
   std::vector<std::thread> threads;
   {
@@ -649,7 +891,7 @@ void FuseChannel::sendInvalidateInode(
   iov[1].iov_len = sizeof(notify);
 
   try {
-    sendRawReply(iov.data(), iov.size());
+    sendRawReply(iov.data(), iov.size(), kMainQueue);
     XLOG(DBG7) << "sendInvalidateInode(ino=" << ino << ", off=" << off
                << ", len=" << len << ") OK!";
   } catch (const std::system_error& exc) {
@@ -708,7 +950,7 @@ void FuseChannel::sendInvalidateEntry(
   iov[3].iov_len = 1;
 
   try {
-    sendRawReply(iov.data(), iov.size());
+    sendRawReply(iov.data(), iov.size(), kMainQueue);
   } catch (const std::system_error& exc) {
     // Ignore ENOENT.  This can happen for inode numbers that we allocated on
     // our own and haven't actually told the kernel about yet.
@@ -821,15 +1063,18 @@ void FuseChannel::initWorkerThread() noexcept {
   initPromise_.setValue(sessionCompletePromise_.getSemiFuture());
 
   // Continue to run like a normal FUSE worker thread.
-  fuseWorkerThread();
+  fuseWorkerThread(kMainQueue);
 }
 
-void FuseChannel::fuseWorkerThread() noexcept {
+void FuseChannel::fuseWorkerThread(size_t queue) noexcept {
   setThreadName(to<std::string>("fuse", mountPath_.basename()));
   setThreadSigmask();
 
   try {
-    processSession();
+    if (pinWorkerThreads_) {
+      pinWorkerThread(queue);
+    }
+    processSession(queue);
   } catch (const std::exception& ex) {
     XLOG(ERR) << "unexpected error in FUSE worker thread: " << exceptionStr(ex);
     // Request that all other FUSE threads exit.
@@ -857,6 +1102,41 @@ void FuseChannel::fuseWorkerThread() noexcept {
   }
 }
 
+void FuseChannel::pinWorkerThread(size_t queue) {
+#ifdef __linux__
+  // Spread the workers across the CPUs this process is allowed to run on.
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  folly::checkUnixError(
+      sched_getaffinity(0, sizeof(allowed), &allowed),
+      "sched_getaffinity failed");
+  auto numAllowed = CPU_COUNT(&allowed);
+  if (numAllowed == 0) {
+    return;
+  }
+
+  auto target = static_cast<int>(queue % numAllowed);
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, &allowed) || target-- > 0) {
+      continue;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    auto err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (err != 0) {
+      XLOG(WARN) << "unable to pin FUSE worker " << queue << " to CPU " << cpu
+                 << ": " << folly::errnoStr(err);
+    } else {
+      XLOG(DBG3) << "pinned FUSE worker " << queue << " to CPU " << cpu;
+    }
+    return;
+  }
+#else
+  (void)queue;
+#endif
+}
+
 void FuseChannel::invalidationThread() noexcept {
   // We send all FUSE_NOTIFY_INVAL_ENTRY and FUSE_NOTIFY_INVAL_INODE requests
   // in a dedicated thread.  These requests will block in the kernel until it
@@ -970,7 +1250,7 @@ void FuseChannel::readInitPacket() {
   }
 
   if (init.header.opcode != FUSE_INIT) {
-    replyError(init.header, EPROTO);
+    replyError(init.header, EPROTO, kMainQueue);
     throw std::runtime_error(folly::to<std::string>(
         "expected to receive FUSE_INIT for \"",
         mountPath_,
@@ -991,10 +1271,6 @@ void FuseChannel::readInitPacket() {
   const auto capable = init.init.flags;
   auto& want = connInfo.flags;
 
-  // TODO: follow up and look at the new flags; particularly
-  // FUSE_DO_READDIRPLUS, FUSE_READDIRPLUS_AUTO. FUSE_SPLICE_XXX are interesting
-  // too, but may not directly benefit eden today.
-  //
   // FUSE_ATOMIC_O_TRUNC is a nice optimization when the kernel supports it
   // and the FUSE daemon requires handling open/release for stateful file
   // handles. But FUSE_NO_OPEN_SUPPORT is superior, so edenfs has no need for
@@ -1018,6 +1294,21 @@ void FuseChannel::readInitPacket() {
   // File handles are stateless so the kernel does not need to send
   // open() and release().
   want |= FUSE_NO_OPENDIR_SUPPORT;
+  // Answer directory listings with the lookup results for each entry, which
+  // saves a FUSE_LOOKUP per entry when walking a directory.  In adaptive mode
+  // the kernel only asks for them when the caller goes on to stat entries.
+  want |= FUSE_DO_READDIRPLUS | FUSE_READDIRPLUS_AUTO;
+  if (useSplice_) {
+    // We splice file data for replies directly into the FUSE device, and the
+    // kernel may steal the spliced pages rather than copying them.
+    //
+    // We do not ask for FUSE_SPLICE_READ: splicing requests out of the device
+    // would only avoid a copy if FUSE_WRITE payloads could be spliced onwards
+    // into the overlay, and the Dispatcher interface takes write data as a
+    // StringPiece.
+    want |= FUSE_SPLICE_WRITE;
+    want |= FUSE_SPLICE_MOVE;
+  }
 #endif
 
   // Only return the capabilities the kernel supports.
@@ -1032,7 +1323,7 @@ void FuseChannel::readInitPacket() {
              << ", want=" << flagsToLabel(capsLabels, want);
 
   if (init.init.major != FUSE_KERNEL_VERSION) {
-    replyError(init.header, EPROTO);
+    replyError(init.header, EPROTO, kMainQueue);
     throw std::runtime_error(folly::to<std::string>(
         "Unsupported FUSE kernel version ",
         init.init.major,
@@ -1057,7 +1348,7 @@ void FuseChannel::readInitPacket() {
       FUSE_KERNEL_MINOR_VERSION > 22,
       "Your kernel headers are too old to build Eden.");
   if (init.init.minor > 22) {
-    sendReply(init.header, connInfo);
+    sendReply(init.header, connInfo, kMainQueue);
   } else {
     // If the protocol version predates the expansion of fuse_init_out, only
     // send the start of the packet.
@@ -1065,29 +1356,31 @@ void FuseChannel::readInitPacket() {
     sendReply(
         init.header,
         ByteRange{reinterpret_cast<const uint8_t*>(&connInfo),
-                  FUSE_COMPAT_22_INIT_OUT_SIZE});
+                  FUSE_COMPAT_22_INIT_OUT_SIZE},
+        kMainQueue);
   }
 #elif defined(__APPLE__)
   static_assert(
       FUSE_KERNEL_MINOR_VERSION == 19,
       "osxfuse: API/ABI likely changed, may need something like the"
       " linux code above to send the correct response to the kernel");
-  sendReply(init.header, connInfo);
+  sendReply(init.header, connInfo, kMainQueue);
 #endif
 
   dispatcher_->initConnection(connInfo);
 }
 
-void FuseChannel::processSession() {
+void FuseChannel::processSession(size_t queue) {
   std::vector<char> buf(bufferSize_);
+  const int fuseFd = getQueueFd(queue);
   // Save this for the sanity check later in the loop to avoid
   // additional syscalls on each loop iteration.
   auto myPid = getpid();
 
   while (!stop_.load(std::memory_order_relaxed)) {
-    // TODO: FUSE_SPLICE_READ allows using splice(2) here if we enable it.
-    // We can look at turning this on once the main plumbing is complete.
-    auto res = read(fuseDevice_.fd(), buf.data(), buf.size());
+    // Requests are always read into our buffer; only replies are spliced.
+    // See the comment about FUSE_SPLICE_READ in readInitPacket().
+    auto res = read(fuseFd, buf.data(), buf.size());
     if (res < 0) {
       int error = errno;
       if (stop_.load(std::memory_order_relaxed)) {
@@ -1154,7 +1447,7 @@ void FuseChannel::processSession() {
     // to resolve this deadlock on kernel inode locks without rebooting the
     // system.
     if (UNLIKELY(static_cast<pid_t>(header->pid) == myPid)) {
-      replyError(*header, EIO);
+      replyError(*header, EIO, queue);
       XLOG(CRITICAL) << "Received FUSE request from our own pid: opcode="
                      << header->opcode << " nodeid=" << header->nodeid
                      << " pid=" << header->pid;
@@ -1165,7 +1458,7 @@ void FuseChannel::processSession() {
 
     switch (header->opcode) {
       case FUSE_INIT:
-        replyError(*header, EPROTO);
+        replyError(*header, EPROTO, queue);
         throw std::runtime_error(
             "received FUSE_INIT after we have been initialized!?");
 
@@ -1175,7 +1468,7 @@ void FuseChannel::processSession() {
         // Deliberately not handling locking; this causes
         // the kernel to do it for us
         XLOG(DBG7) << fuseOpcodeName(header->opcode);
-        replyError(*header, ENOSYS);
+        replyError(*header, ENOSYS, queue);
         break;
 
 #ifdef __linux__
@@ -1184,14 +1477,14 @@ void FuseChannel::processSession() {
         // for us.  Returning ENOSYS causes the kernel to implement it for us,
         // and will cause it to stop sending subsequent FUSE_LSEEK requests.
         XLOG(DBG7) << "FUSE_LSEEK";
-        replyError(*header, ENOSYS);
+        replyError(*header, ENOSYS, queue);
         break;
 #endif
 
       case FUSE_POLL:
         // We do not currently implement FUSE_POLL.
         XLOG(DBG7) << "FUSE_POLL";
-        replyError(*header, ENOSYS);
+        replyError(*header, ENOSYS, queue);
         break;
 
       case FUSE_INTERRUPT: {
@@ -1219,7 +1512,7 @@ void FuseChannel::processSession() {
       case FUSE_IOCTL:
         // Rather than the default ENOSYS, we need to return ENOTTY
         // to indicate that the requested ioctl is not supported
-        replyError(*header, ENOTTY);
+        replyError(*header, ENOTTY, queue);
         break;
 
       default: {
@@ -1231,7 +1524,8 @@ void FuseChannel::processSession() {
           // request.
           RequestContextScopeGuard requestContextGuard;
 
-          auto& request = RequestData::create(this, *header, dispatcher_);
+          auto& request =
+              RequestData::create(this, *header, dispatcher_, queue);
           uint64_t requestId;
           {
             // Save a weak reference to this new request context.
@@ -1249,12 +1543,22 @@ void FuseChannel::processSession() {
           }
           const auto& entry = handlerIter->second;
 
+          // Track how many requests from this queue are in flight.  Each
+          // queue is serviced by exactly one worker thread, so the current
+          // thread's stats describe this queue.
+          auto& queueStats =
+              dispatcher_->getStats()->getFuseStatsForCurrentThread();
+          auto depth = ++queueDepths_[queue];
+          queueStats.queueDepth.addValue(depth);
+
           request
               .catchErrors(folly::makeFutureWith([&] {
                 request.startRequest(dispatcher_->getStats(), entry.histogram);
                 return (this->*entry.handler)(&request.getReq(), arg);
               }))
-              .ensure([this, requestId] {
+              .ensure([this, requestId, queue] {
+                --queueDepths_[queue];
+
                 auto state = state_.wlock();
 
                 // Remove the request from the map
@@ -1287,7 +1591,7 @@ void FuseChannel::processSession() {
             });
 
         try {
-          replyError(*header, ENOSYS);
+          replyError(*header, ENOSYS, queue);
         } catch (const std::system_error& exc) {
           XLOG(ERR) << "Failed to write error response to fuse: " << exc.what();
           requestSessionExit(StopReason::FUSE_WRITE_ERROR);
@@ -1310,6 +1614,7 @@ void FuseChannel::sessionComplete(folly::Synchronized<State>::LockedPtr state) {
   if (isFuseDeviceValid(data.reason) && connInfo_.has_value()) {
     data.fuseDevice = std::move(fuseDevice_);
     data.fuseSettings = connInfo_.value();
+    data.clonedFuseDevices = std::move(clonedDevices_);
   }
 
   // Unlock the state before the remaining steps
@@ -1339,7 +1644,7 @@ folly::Future<folly::Unit> FuseChannel::fuseRead(
   auto ino = InodeNumber{header->nodeid};
   return dispatcher_->read(ino, read->size, read->offset)
       .thenValue(
-          [](BufVec&& buf) { RequestData::get().sendReply(buf.getIov()); });
+          [](BufVec&& buf) { RequestData::get().sendReply(std::move(buf)); });
 }
 
 folly::Future<folly::Unit> FuseChannel::fuseWrite(
@@ -1726,6 +2031,22 @@ folly::Future<folly::Unit> FuseChannel::fuseReadDir(
       });
 }
 
+#ifdef __linux__
+folly::Future<folly::Unit> FuseChannel::fuseReadDirPlus(
+    const fuse_in_header* header,
+    const uint8_t* arg) {
+  auto read = reinterpret_cast<const fuse_read_in*>(arg);
+  XLOG(DBG7) << "FUSE_READDIRPLUS";
+  auto ino = InodeNumber{header->nodeid};
+  return dispatcher_
+      ->readdirplus(ino, DirPlusList{read->size}, read->offset, read->fh)
+      .thenValue([](DirPlusList&& list) {
+        const auto buf = list.getBuf();
+        RequestData::get().sendReply(StringPiece{buf});
+      });
+}
+#endif
+
 folly::Future<folly::Unit> FuseChannel::fuseReleaseDir(
     const fuse_in_header* header,
     const uint8_t* arg) {
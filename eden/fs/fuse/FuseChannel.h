@@ -16,6 +16,7 @@
 #include <folly/synchronization/CallOnce.h>
 #include <stdlib.h>
 #include <sys/uio.h>
+#include <atomic>
 #include <condition_variable>
 #include <iosfwd>
 #include <memory>
@@ -25,6 +26,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "eden/fs/fuse/BufVec.h"
 #include "eden/fs/fuse/FuseTypes.h"
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -81,6 +83,15 @@ class FuseChannel {
      * FuseChannel object that uses this FuseDevice.
      */
     fuse_init_out fuseSettings = {};
+
+    /**
+     * FUSE devices cloned from fuseDevice, one per additional worker thread,
+     * if the FuseChannel was using per-thread queues.
+     *
+     * These are only populated when fuseDevice is valid, and can be passed to
+     * initializeFromTakeover() along with fuseDevice.
+     */
+    std::vector<folly::File> clonedFuseDevices;
   };
   using StopFuture = folly::SemiFuture<StopData>;
 
@@ -94,13 +105,28 @@ class FuseChannel {
    * The caller is expected to follow up with a call to the
    * initialize() method to perform the handshake with the
    * kernel and set up the thread pool.
+   *
+   * If useSplice is true, the channel asks the kernel for FUSE_SPLICE_WRITE
+   * and FUSE_SPLICE_MOVE during the INIT handshake, and replies whose data
+   * lives in a file (such as reads of materialized overlay files) are
+   * spliced directly from that file into the FUSE device.
+   *
+   * If cloneDevicePerThread is true, each worker thread reads requests from
+   * its own clone of the FUSE device (created with FUSE_DEV_IOC_CLONE) rather
+   * than all workers blocking in read() on the same descriptor.  The kernel
+   * tracks in-flight requests separately for each cloned device, so workers
+   * no longer contend on a single processing queue.  If pinWorkerThreads is
+   * also true, each worker thread is pinned to its own CPU.
    */
   FuseChannel(
       folly::File&& fuseDevice,
       AbsolutePathPiece mountPath,
       size_t numThreads,
       Dispatcher* const dispatcher,
-      std::shared_ptr<ProcessNameCache> processNameCache);
+      std::shared_ptr<ProcessNameCache> processNameCache,
+      bool useSplice = false,
+      bool cloneDevicePerThread = false,
+      bool pinWorkerThreads = false);
 
   /**
    * Destroy the FuseChannel.
@@ -152,6 +178,12 @@ class FuseChannel {
    * The connInfo parameter specifies the connection data that was already
    * negotiated by the previous owner of the FuseDevice.
    *
+   * clonedDevices holds the per-thread clones of the FUSE device that were
+   * used by the previous owner, if any.  They are reused if this FuseChannel
+   * was asked to clone the device for each thread and there is one for each
+   * additional worker thread; otherwise they are closed and new clones are
+   * created as needed.
+   *
    * This function will immediately set up the thread pool used to service
    * incoming fuse requests.
    *
@@ -159,7 +191,9 @@ class FuseChannel {
    * stopped.  This future can be used to detect if the FuseChannel has been
    * unmounted or stopped because of an error or any other reason.
    */
-  StopFuture initializeFromTakeover(fuse_init_out connInfo);
+  StopFuture initializeFromTakeover(
+      fuse_init_out connInfo,
+      std::vector<folly::File> clonedDevices = {});
 
   // Forbidden copy constructor and assignment operator
   FuseChannel(FuseChannel const&) = delete;
@@ -221,15 +255,22 @@ class FuseChannel {
    */
   FOLLY_NODISCARD folly::Future<folly::Unit> flushInvalidations();
 
+  /**
+   * The worker queue used for INIT and for kernel notifications.  Replies to
+   * requests must be sent on the queue that the request was read from.
+   */
+  static constexpr size_t kMainQueue = 0;
+
   /**
    * Sends a reply to a kernel request that consists only of the error
    * status (no additional payload).
    * `err` may be 0 (indicating success) or a positive errno value.
+   * `queue` is the worker queue that the request was read from.
    *
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void replyError(const fuse_in_header& request, int err);
+  void replyError(const fuse_in_header& request, int err, size_t queue);
 
   /**
    * Sends a raw data packet to the kernel.
@@ -242,7 +283,7 @@ class FuseChannel {
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void sendRawReply(const iovec iov[], size_t count) const;
+  void sendRawReply(const iovec iov[], size_t count, size_t queue) const;
 
   /**
    * Sends a range of contiguous bytes as a reply to the kernel.
@@ -253,7 +294,10 @@ class FuseChannel {
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void sendReply(const fuse_in_header& request, folly::ByteRange bytes) const;
+  void sendReply(
+      const fuse_in_header& request,
+      folly::ByteRange bytes,
+      size_t queue) const;
 
   /**
    * Sends a reply to a kernel request, consisting of multiple parts.
@@ -264,7 +308,23 @@ class FuseChannel {
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void sendReply(const fuse_in_header& request, folly::fbvector<iovec>&& vec)
+  void sendReply(
+      const fuse_in_header& request,
+      folly::fbvector<iovec>&& vec,
+      size_t queue) const;
+
+  /**
+   * Sends the contents of a BufVec as a reply to the kernel.
+   *
+   * If splicing was negotiated with the kernel and the BufVec refers to a
+   * range of a file descriptor, the data is moved from the file into the FUSE
+   * device with splice(2) without being copied through user space.
+   * Otherwise the data is read into memory and sent with writev().
+   *
+   * throws system_error if the write fails.  Writes can fail if the
+   * data we send to the kernel is invalid.
+   */
+  void sendReply(const fuse_in_header& request, BufVec&& buf, size_t queue)
       const;
 
   /**
@@ -276,11 +336,13 @@ class FuseChannel {
    * data we send to the kernel is invalid.
    */
   template <typename T>
-  void sendReply(const fuse_in_header& request, const T& payload) const {
+  void sendReply(const fuse_in_header& request, const T& payload, size_t queue)
+      const {
     sendReply(
         request,
         folly::ByteRange{reinterpret_cast<const uint8_t*>(&payload),
-                         sizeof(T)});
+                         sizeof(T)},
+        queue);
   }
 
   /**
@@ -453,6 +515,11 @@ class FuseChannel {
   folly::Future<folly::Unit> fuseReadDir(
       const fuse_in_header* header,
       const uint8_t* arg);
+#ifdef __linux__
+  folly::Future<folly::Unit> fuseReadDirPlus(
+      const fuse_in_header* header,
+      const uint8_t* arg);
+#endif
   folly::Future<folly::Unit> fuseReleaseDir(
       const fuse_in_header* header,
       const uint8_t* arg);
@@ -474,7 +541,8 @@ class FuseChannel {
 
   void setThreadSigmask();
   void initWorkerThread() noexcept;
-  void fuseWorkerThread() noexcept;
+  void fuseWorkerThread(size_t queue) noexcept;
+  void pinWorkerThread(size_t queue);
   void invalidationThread() noexcept;
   void stopInvalidationThread();
   void sendInvalidation(InvalidationEntry& entry);
@@ -483,6 +551,40 @@ class FuseChannel {
   void readInitPacket();
   void startWorkerThreads();
 
+  /**
+   * Create a clone of fuseDevice_ for each worker thread other than the
+   * first.  If cloning fails all worker threads share fuseDevice_.
+   */
+  void cloneDevices();
+
+  /**
+   * Returns the FUSE device descriptor that the given worker queue reads
+   * requests from and sends replies to.
+   */
+  int getQueueFd(size_t queue) const;
+
+  /**
+   * Returns true if replies containing file data should be spliced into the
+   * FUSE device rather than copied.
+   */
+  bool shouldSpliceReplies() const;
+
+  /**
+   * Attempt to send the given file range as the reply to a request using
+   * splice(2).
+   *
+   * Returns false if the data could not be spliced (for instance, because
+   * the file was truncated concurrently or the reply does not fit in the
+   * splice pipe) without having written anything to the FUSE device.  The
+   * caller should then fall back to sending a copied reply.
+   *
+   * throws system_error if writing to the FUSE device fails.
+   */
+  bool trySpliceReply(
+      const fuse_in_header& request,
+      const BufVec::FdRange& range,
+      size_t queue) const;
+
   /**
    * sessionComplete() will fulfill the sessionCompletePromise_.
    *
@@ -510,7 +612,7 @@ class FuseChannel {
    * The intent is that this is called from each of the
    * fuse worker threads provided by the MountPoint.
    */
-  void processSession();
+  void processSession(size_t queue);
 
   /**
    * Requests that the worker threads terminate their processing loop.
@@ -525,6 +627,9 @@ class FuseChannel {
    */
   const size_t bufferSize_{0};
   const size_t numThreads_;
+  const bool useSplice_{false};
+  const bool cloneDevicePerThread_{false};
+  const bool pinWorkerThreads_{false};
   Dispatcher* const dispatcher_{nullptr};
   const AbsolutePath mountPath_;
 
@@ -552,6 +657,22 @@ class FuseChannel {
    */
   folly::File fuseDevice_;
 
+  /*
+   * Clones of fuseDevice_ used by worker threads 1 through numThreads_ - 1
+   * when cloneDevicePerThread_ is set.  Worker 0 always uses fuseDevice_.
+   * This is empty if the workers all share fuseDevice_.
+   *
+   * This is set before the worker threads that use it are started, and has
+   * the same lifetime rules as fuseDevice_.
+   */
+  std::vector<folly::File> clonedDevices_;
+
+  /*
+   * The number of requests read from each worker queue that have not yet
+   * completed.
+   */
+  std::unique_ptr<std::atomic<uint64_t>[]> queueDepths_;
+
   /*
    * Mutable state that is accessed from the worker threads.
    * All of this state uses locking or other synchronization.
@@ -9,6 +9,7 @@
  */
 #pragma once
 #include <folly/File.h>
+#include <vector>
 #ifdef __linux__
 #include "eden/third-party/fuse_kernel_linux.h" // @manual=//eden/third-party:fuse_kernel
 #elif defined(__APPLE__)
@@ -28,6 +29,8 @@ using FuseOpcode = decltype(std::declval<fuse_in_header>().opcode);
 struct FuseChannelData {
   folly::File fd;
   fuse_init_out connInfo;
+  // Per-thread clones of fd, if the FuseChannel was cloning the device.
+  std::vector<folly::File> clonedFds;
 };
 
 } // namespace eden
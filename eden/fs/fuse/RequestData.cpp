@@ -25,8 +25,12 @@ const std::string RequestData::kKey("fuse");
 RequestData::RequestData(
     FuseChannel* channel,
     const fuse_in_header& fuseHeader,
-    Dispatcher* dispatcher)
-    : channel_(channel), fuseHeader_(fuseHeader), dispatcher_(dispatcher) {}
+    Dispatcher* dispatcher,
+    size_t queue)
+    : channel_(channel),
+      fuseHeader_(fuseHeader),
+      dispatcher_(dispatcher),
+      queue_(queue) {}
 
 bool RequestData::isFuseRequest() {
   return folly::RequestContext::get()->getContextData(kKey) != nullptr;
@@ -44,10 +48,11 @@ RequestData& RequestData::get() {
 RequestData& RequestData::create(
     FuseChannel* channel,
     const fuse_in_header& fuseHeader,
-    Dispatcher* dispatcher) {
+    Dispatcher* dispatcher,
+    size_t queue) {
   folly::RequestContext::get()->setContextData(
       RequestData::kKey,
-      std::make_unique<RequestData>(channel, fuseHeader, dispatcher));
+      std::make_unique<RequestData>(channel, fuseHeader, dispatcher, queue));
   return get();
 }
 
@@ -97,7 +102,7 @@ Dispatcher* RequestData::getDispatcher() const {
 }
 
 void RequestData::replyError(int err) {
-  channel_->replyError(stealReq(), err);
+  channel_->replyError(stealReq(), err, queue_);
 }
 
 void RequestData::replyNone() {
@@ -29,6 +29,9 @@ class RequestData : public folly::RequestData {
   FuseThreadStats::HistogramPtr latencyHistogram_{nullptr};
   EdenStats* stats_{nullptr};
   Dispatcher* dispatcher_{nullptr};
+  // The FuseChannel worker queue the request was read from; the reply must
+  // be written back to the same queue.
+  size_t queue_{FuseChannel::kMainQueue};
 
   fuse_in_header stealReq();
 
@@ -41,12 +44,14 @@ class RequestData : public folly::RequestData {
   explicit RequestData(
       FuseChannel* channel,
       const fuse_in_header& fuseHeader,
-      Dispatcher* dispatcher);
+      Dispatcher* dispatcher,
+      size_t queue = FuseChannel::kMainQueue);
   static RequestData& get();
   static RequestData& create(
       FuseChannel* channel,
       const fuse_in_header& fuseHeader,
-      Dispatcher* dispatcher);
+      Dispatcher* dispatcher,
+      size_t queue = FuseChannel::kMainQueue);
 
   bool hasCallback() override {
     return false;
@@ -87,19 +92,23 @@ class RequestData : public folly::RequestData {
 
   template <typename T>
   void sendReply(const T& payload) {
-    channel_->sendReply(stealReq(), payload);
+    channel_->sendReply(stealReq(), payload, queue_);
   }
 
   void sendReply(folly::ByteRange bytes) {
-    channel_->sendReply(stealReq(), bytes);
+    channel_->sendReply(stealReq(), bytes, queue_);
   }
 
   void sendReply(folly::fbvector<iovec>&& vec) {
-    channel_->sendReply(stealReq(), std::move(vec));
+    channel_->sendReply(stealReq(), std::move(vec), queue_);
+  }
+
+  void sendReply(BufVec&& buf) {
+    channel_->sendReply(stealReq(), std::move(buf), queue_);
   }
 
   void sendReply(folly::StringPiece piece) {
-    channel_->sendReply(stealReq(), folly::ByteRange(piece));
+    channel_->sendReply(stealReq(), folly::ByteRange(piece), queue_);
   }
 
   // Reply with a negative errno value or 0 for success
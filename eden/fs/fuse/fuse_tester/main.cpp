@@ -8,14 +8,18 @@
  *
  */
 #include <boost/filesystem.hpp>
+#include <fcntl.h>
 #include <folly/Exception.h>
+#include <folly/FileUtil.h>
 #include <folly/init/Init.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventBaseThread.h>
 #include <folly/logging/Init.h>
 #include <folly/logging/xlog.h>
 #include <signal.h>
+#include <sys/wait.h>
 #include <sysexits.h>
+#include <chrono>
 #include "eden/fs/fuse/Dispatcher.h"
 #include "eden/fs/fuse/FuseChannel.h"
 #include "eden/fs/fuse/privhelper/PrivHelper.h"
@@ -32,14 +36,51 @@ using folly::makeFuture;
 using std::string;
 
 DEFINE_int32(numFuseThreads, 4, "The number of FUSE worker threads");
+DEFINE_bool(splice, false, "Splice read replies into the FUSE device");
+DEFINE_bool(
+    benchmark,
+    false,
+    "Measure read throughput with and without splice, then exit");
+DEFINE_uint64(
+    benchmarkFileSizeMB,
+    256,
+    "The size of the file read by --benchmark, in megabytes");
+DEFINE_uint32(
+    benchmarkIterations,
+    4,
+    "How many times --benchmark reads the file in each mode");
 
 FOLLY_INIT_LOGGING_CONFIG("eden=DBG2,eden.fs.fuse=DBG7");
 
 namespace {
+constexpr InodeNumber kDataNodeId = 2_ino;
+const PathComponentPiece kDataName{"data"_pc};
+
+/**
+ * A Dispatcher serving a root directory that contains a single regular file,
+ * "data", whose contents come from dataFile.
+ */
 class TestDispatcher : public Dispatcher {
  public:
-  TestDispatcher(EdenStats* stats, const UserInfo& identity)
-      : Dispatcher(stats), identity_(identity) {}
+  TestDispatcher(
+      EdenStats* stats,
+      const UserInfo& identity,
+      std::shared_ptr<const folly::File> dataFile)
+      : Dispatcher(stats),
+        identity_(identity),
+        dataFile_(std::move(dataFile)) {}
+
+  folly::Future<fuse_entry_out> lookup(
+      InodeNumber parent,
+      PathComponentPiece name) override {
+    if (parent != kRootNodeId || name != kDataName) {
+      folly::throwSystemErrorExplicit(ENOENT);
+    }
+    fuse_entry_out entry = {};
+    entry.nodeid = kDataNodeId.get();
+    entry.attr = getDataAttr().asFuseAttr().attr;
+    return folly::makeFuture(entry);
+  }
 
   folly::Future<Attr> getattr(InodeNumber ino) override {
     if (ino == kRootNodeId) {
@@ -53,12 +94,121 @@ class TestDispatcher : public Dispatcher {
       st.st_blocks = 1;
       return folly::makeFuture(Attr(st, /* timeout */ 0));
     }
+    if (ino == kDataNodeId) {
+      return folly::makeFuture(getDataAttr());
+    }
     folly::throwSystemErrorExplicit(ENOENT);
   }
 
+  folly::Future<BufVec> read(InodeNumber ino, size_t size, off_t off)
+      override {
+    if (ino != kDataNodeId) {
+      folly::throwSystemErrorExplicit(EISDIR);
+    }
+    auto fileSize = getDataSize();
+    auto available = off < fileSize ? static_cast<size_t>(fileSize - off) : 0;
+    return folly::makeFuture(
+        BufVec{dataFile_, off, std::min(size, available)});
+  }
+
+ private:
+  off_t getDataSize() const {
+    struct stat st;
+    folly::checkUnixError(fstat(dataFile_->fd(), &st));
+    return st.st_size;
+  }
+
+  Attr getDataAttr() const {
+    struct stat st = {};
+    st.st_ino = kDataNodeId.get();
+    st.st_mode = S_IFREG | 0644;
+    st.st_nlink = 1;
+    st.st_uid = identity_.getUid();
+    st.st_gid = identity_.getGid();
+    st.st_size = getDataSize();
+    st.st_blksize = 4096;
+    st.st_blocks = (st.st_size + 511) / 512;
+    return Attr(st, /* timeout */ 0);
+  }
+
   UserInfo identity_;
+  std::shared_ptr<const folly::File> dataFile_;
 };
 
+std::shared_ptr<const folly::File> createDataFile(uint64_t size) {
+  char path[] = "/tmp/fuse_tester_data.XXXXXX";
+  folly::File file{mkstemp(path), /*ownsFd=*/true};
+  folly::checkUnixError(file.fd(), "failed to create data file");
+  folly::checkUnixError(unlink(path), "failed to unlink data file");
+
+  std::vector<char> chunk(1024 * 1024, 'x');
+  for (uint64_t written = 0; written < size; written += chunk.size()) {
+    auto len = std::min<uint64_t>(chunk.size(), size - written);
+    folly::checkUnixError(
+        folly::writeFull(file.fd(), chunk.data(), len),
+        "failed to write data file");
+  }
+  return std::make_shared<const folly::File>(std::move(file));
+}
+
+/**
+ * Read the data file through the mount point from a child process, since
+ * FuseChannel refuses requests that come from its own pid.
+ *
+ * Returns the number of seconds taken to read the file `iterations` times.
+ */
+double timeReads(AbsolutePathPiece path, uint32_t iterations) {
+  auto pathStr = path.stringPiece().str();
+  std::vector<char> buf(1024 * 1024);
+  int pipeFds[2];
+  folly::checkUnixError(pipe(pipeFds), "pipe failed");
+
+  auto pid = fork();
+  folly::checkUnixError(pid, "fork failed");
+  if (pid == 0) {
+    close(pipeFds[0]);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < iterations; ++n) {
+      int fd = open(pathStr.c_str(), O_RDONLY);
+      if (fd < 0) {
+        _exit(EX_NOINPUT);
+      }
+      // Drop any pages cached by the previous iteration so that every read
+      // goes through the FuseChannel.
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      while (true) {
+        auto res = read(fd, buf.data(), buf.size());
+        if (res < 0) {
+          _exit(EX_IOERR);
+        }
+        if (res == 0) {
+          break;
+        }
+      }
+      close(fd);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count();
+    if (write(pipeFds[1], &seconds, sizeof(seconds)) != sizeof(seconds)) {
+      _exit(EX_IOERR);
+    }
+    _exit(EX_OK);
+  }
+
+  close(pipeFds[1]);
+  folly::File readEnd{pipeFds[0], /*ownsFd=*/true};
+  double seconds = 0;
+  auto res = folly::readFull(readEnd.fd(), &seconds, sizeof(seconds));
+  int status;
+  folly::checkUnixError(waitpid(pid, &status, 0), "waitpid failed");
+  if (res != sizeof(seconds) || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != EX_OK) {
+    throw std::runtime_error("benchmark reader process failed");
+  }
+  return seconds;
+}
+
 void ensureEmptyDirectory(AbsolutePathPiece path) {
   boost::filesystem::path boostPath(
       path.stringPiece().begin(), path.stringPiece().end());
@@ -114,17 +264,44 @@ int main(int argc, char** argv) {
   folly::EventBaseThread evbt;
   evbt.getEventBase()->runInEventBaseThreadAndWait(
       [&] { privHelper->attachEventBase(evbt.getEventBase()); });
-  auto fuseDevice = privHelper->fuseMount(mountPath.value()).get(100ms);
 
   EdenStats stats;
-  TestDispatcher dispatcher(&stats, identity);
-
-  std::unique_ptr<FuseChannel, FuseChannelDeleter> channel(new FuseChannel(
-      std::move(fuseDevice),
-      mountPath,
-      FLAGS_numFuseThreads,
-      &dispatcher,
-      std::make_shared<ProcessNameCache>()));
+  auto dataFileSize = FLAGS_benchmarkFileSizeMB * 1024 * 1024;
+  TestDispatcher dispatcher(&stats, identity, createDataFile(dataFileSize));
+
+  auto startChannel = [&](bool useSplice) {
+    auto fuseDevice = privHelper->fuseMount(mountPath.value()).get(100ms);
+    return std::unique_ptr<FuseChannel, FuseChannelDeleter>(new FuseChannel(
+        std::move(fuseDevice),
+        mountPath,
+        FLAGS_numFuseThreads,
+        &dispatcher,
+        std::make_shared<ProcessNameCache>(),
+        useSplice));
+  };
+
+  if (FLAGS_benchmark) {
+    for (bool useSplice : {false, true}) {
+      auto channel = startChannel(useSplice);
+      auto completionFuture = channel->initialize().get();
+      auto seconds =
+          timeReads(mountPath + kDataName, FLAGS_benchmarkIterations);
+      privHelper->fuseUnmount(mountPath.value()).get(10s);
+      std::move(completionFuture).get();
+
+      auto totalMB = static_cast<double>(FLAGS_benchmarkFileSizeMB) *
+          FLAGS_benchmarkIterations;
+      printf(
+          "%-6s: read %.0f MB in %.3fs: %.1f MB/s\n",
+          useSplice ? "splice" : "copy",
+          totalMB,
+          seconds,
+          totalMB / seconds);
+    }
+    return EX_OK;
+  }
+
+  auto channel = startChannel(FLAGS_splice);
 
   XLOG(INFO) << "Starting FUSE...";
   auto completionFuture = channel->initialize().get();
@@ -9,6 +9,8 @@
  */
 #include "eden/fs/fuse/BufVec.h"
 
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
 #include <gtest/gtest.h>
 
 TEST(BufVecTest, BufVec) {
@@ -19,3 +21,52 @@ TEST(BufVecTest, BufVec) {
   EXPECT_EQ(10u, bufVec.copyData().size());
   EXPECT_EQ("helloworld", bufVec.copyData());
 }
+
+TEST(BufVecTest, BufVecFromFile) {
+  folly::test::TemporaryFile tmpFile;
+  folly::StringPiece contents{"0123456789abcdef"};
+  ASSERT_EQ(
+      static_cast<ssize_t>(contents.size()),
+      folly::writeFull(tmpFile.fd(), contents.data(), contents.size()));
+
+  auto file = std::make_shared<const folly::File>(tmpFile.fd());
+  const auto bufVec = facebook::eden::BufVec{file, 4, 8};
+  auto range = bufVec.getSpliceableFdRange();
+  ASSERT_TRUE(range.has_value());
+  EXPECT_EQ(tmpFile.fd(), range->fd);
+  EXPECT_EQ(4, range->pos);
+  EXPECT_EQ(8u, range->size);
+  EXPECT_EQ(8u, bufVec.size());
+
+  // Copying the data does not change the BufVec.
+  EXPECT_EQ("456789ab", bufVec.copyData());
+  EXPECT_TRUE(bufVec.getSpliceableFdRange().has_value());
+}
+
+TEST(BufVecTest, LoadedBufVecIsNotSpliceable) {
+  folly::test::TemporaryFile tmpFile;
+  folly::StringPiece contents{"0123456789abcdef"};
+  ASSERT_EQ(
+      static_cast<ssize_t>(contents.size()),
+      folly::writeFull(tmpFile.fd(), contents.data(), contents.size()));
+
+  auto file = std::make_shared<const folly::File>(tmpFile.fd());
+  auto bufVec = facebook::eden::BufVec{file, 4, 8};
+  bufVec.load();
+  EXPECT_FALSE(bufVec.getSpliceableFdRange().has_value());
+  EXPECT_EQ(8u, bufVec.size());
+  EXPECT_EQ(1u, bufVec.getIov().size());
+  EXPECT_EQ("456789ab", bufVec.copyData());
+}
+
+TEST(BufVecTest, BufVecFromTruncatedFile) {
+  folly::test::TemporaryFile tmpFile;
+  folly::StringPiece contents{"0123456789"};
+  ASSERT_EQ(
+      static_cast<ssize_t>(contents.size()),
+      folly::writeFull(tmpFile.fd(), contents.data(), contents.size()));
+
+  auto file = std::make_shared<const folly::File>(tmpFile.fd());
+  const auto bufVec = facebook::eden::BufVec{file, 6, 8};
+  EXPECT_EQ("6789", bufVec.copyData());
+}
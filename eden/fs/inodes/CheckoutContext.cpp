@@ -9,6 +9,7 @@
  */
 #include "eden/fs/inodes/CheckoutContext.h"
 
+#include <folly/Conv.h>
 #include <folly/logging/xlog.h>
 
 #include "eden/fs/inodes/EdenMount.h"
@@ -37,6 +38,25 @@ void CheckoutContext::start(RenameLock&& renameLock) {
 }
 
 Future<vector<CheckoutConflict>> CheckoutContext::finish(Hash newSnapshot) {
+  if (XLOG_IS_ON(DBG1)) {
+    auto progress = getPrefetchProgress();
+    std::string phases;
+    for (const auto& [phase, elapsed] : getPhaseTimes()) {
+      folly::toAppend(
+          " ",
+          phase,
+          "=",
+          std::chrono::duration_cast<std::chrono::milliseconds>(elapsed)
+              .count(),
+          "ms",
+          &phases);
+    }
+    XLOG(DBG1) << "checkout to " << newSnapshot << " prefetched "
+               << progress.treesFetched << " trees and "
+               << progress.blobsFetched << "/" << progress.blobsListed
+               << " blobs; phase times:" << phases;
+  }
+
   // Only update the parents if it is not a dry run.
   if (!isDryRun()) {
     // Update the in-memory snapshot ID
@@ -73,6 +93,43 @@ Future<vector<CheckoutConflict>> CheckoutContext::finish(Hash newSnapshot) {
   return std::move(*conflicts_.wlock());
 }
 
+void CheckoutContext::recordPhaseTime(
+    folly::StringPiece phase,
+    std::chrono::steady_clock::duration elapsed) {
+  XLOG(DBG3) << "checkout phase " << phase << " took "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed)
+                    .count()
+             << "ms";
+  phaseTimes_.wlock()->emplace_back(phase.str(), elapsed);
+}
+
+vector<std::pair<std::string, std::chrono::steady_clock::duration>>
+CheckoutContext::getPhaseTimes() const {
+  return *phaseTimes_.rlock();
+}
+
+void CheckoutContext::setPrefetchListed(size_t treeCount, size_t blobCount) {
+  prefetchTreesFetched_.store(treeCount, std::memory_order_relaxed);
+  prefetchBlobsListed_.store(blobCount, std::memory_order_relaxed);
+}
+
+void CheckoutContext::addPrefetchedBlobs(size_t blobCount) {
+  auto total = prefetchBlobsFetched_.fetch_add(
+                   blobCount, std::memory_order_relaxed) +
+      blobCount;
+  XLOG(DBG3) << "checkout prefetched " << total << "/"
+             << prefetchBlobsListed_.load(std::memory_order_relaxed)
+             << " blobs";
+}
+
+CheckoutContext::PrefetchProgress CheckoutContext::getPrefetchProgress() const {
+  PrefetchProgress progress;
+  progress.treesFetched = prefetchTreesFetched_.load(std::memory_order_relaxed);
+  progress.blobsListed = prefetchBlobsListed_.load(std::memory_order_relaxed);
+  progress.blobsFetched = prefetchBlobsFetched_.load(std::memory_order_relaxed);
+  return progress;
+}
+
 void CheckoutContext::addConflict(ConflictType type, RelativePathPiece path) {
   // Errors should be added using addError()
   CHECK(type != ConflictType::ERROR)
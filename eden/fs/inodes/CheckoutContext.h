@@ -9,7 +9,12 @@
  */
 #pragma once
 
+#include <folly/Range.h>
 #include <folly/Synchronized.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
 #include <vector>
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/InodePtrFwd.h"
@@ -99,6 +104,40 @@ class CheckoutContext {
     return renameLock_;
   }
 
+  /**
+   * Record how long one phase of the checkout took.
+   *
+   * The phase times are logged when the checkout finishes.
+   */
+  void recordPhaseTime(
+      folly::StringPiece phase,
+      std::chrono::steady_clock::duration elapsed);
+
+  std::vector<std::pair<std::string, std::chrono::steady_clock::duration>>
+  getPhaseTimes() const;
+
+  /**
+   * Progress of the prefetch pass that runs before the checkout is applied.
+   */
+  struct PrefetchProgress {
+    size_t treesFetched{0};
+    size_t blobsListed{0};
+    size_t blobsFetched{0};
+  };
+
+  /**
+   * Record that the prefetch pass fetched treeCount trees and found
+   * blobCount blobs that need to be fetched.
+   */
+  void setPrefetchListed(size_t treeCount, size_t blobCount);
+
+  /**
+   * Record that blobCount more blobs have been fetched by the prefetch pass.
+   */
+  void addPrefetchedBlobs(size_t blobCount);
+
+  PrefetchProgress getPrefetchProgress() const;
+
  private:
   CheckoutMode checkoutMode_;
   EdenMount* const mount_;
@@ -109,6 +148,14 @@ class CheckoutContext {
   // if some data load operations complete asynchronously on other threads.
   // Therefore access to the conflicts list must be synchronized.
   folly::Synchronized<std::vector<CheckoutConflict>> conflicts_;
+
+  folly::Synchronized<
+      std::vector<std::pair<std::string, std::chrono::steady_clock::duration>>>
+      phaseTimes_;
+
+  std::atomic<size_t> prefetchTreesFetched_{0};
+  std::atomic<size_t> prefetchBlobsListed_{0};
+  std::atomic<size_t> prefetchBlobsFetched_{0};
 };
 } // namespace eden
 } // namespace facebook
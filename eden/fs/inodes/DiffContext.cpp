@@ -31,5 +31,33 @@ const GitIgnoreStack* DiffContext::getToplevelIgnore() const {
   return topLevelIgnores_->getStack();
 }
 
+void DiffContext::setPathFilter(const std::vector<RelativePath>& paths) {
+  hasPathFilter_ = true;
+  for (const auto& path : paths) {
+    filterPaths_.insert(path.value());
+    for (auto parent : path.paths()) {
+      if (parent != path) {
+        filterParents_.insert(parent.stringPiece().str());
+      }
+    }
+    filterParents_.insert(std::string{});
+  }
+}
+
+bool DiffContext::isPathIncluded(RelativePathPiece path) const {
+  if (!hasPathFilter_) {
+    return true;
+  }
+  if (filterParents_.count(path.stringPiece())) {
+    return true;
+  }
+  for (auto parent : path.allPaths()) {
+    if (filterPaths_.count(parent.stringPiece())) {
+      return true;
+    }
+  }
+  return false;
+}
+
 } // namespace eden
 } // namespace facebook
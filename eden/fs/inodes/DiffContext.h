@@ -10,6 +10,10 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/container/F14Set.h>
+#include <string>
+#include <vector>
+#include "eden/fs/utils/PathFuncs.h"
 
 namespace facebook {
 namespace eden {
@@ -52,8 +56,32 @@ class DiffContext {
 
   const GitIgnoreStack* getToplevelIgnore() const;
 
+  /**
+   * Restrict this diff to the given paths and everything below them.
+   *
+   * Entries that are not one of these paths, not inside one of them, and not
+   * a parent directory of one of them are skipped as if they were unchanged.
+   * This is used to refresh a cached status for just the paths that have
+   * changed since it was computed.
+   */
+  void setPathFilter(const std::vector<RelativePath>& paths);
+
+  bool hasPathFilter() const {
+    return hasPathFilter_;
+  }
+
+  /**
+   * Returns true if the diff should examine the entry at the given path.
+   * This is always true when no path filter has been set.
+   */
+  bool isPathIncluded(RelativePathPiece path) const;
+
  private:
   std::unique_ptr<TopLevelIgnores> topLevelIgnores_;
+
+  bool hasPathFilter_{false};
+  folly::F14FastSet<std::string> filterPaths_;
+  folly::F14FastSet<std::string> filterParents_;
 };
 } // namespace eden
 } // namespace facebook
@@ -11,8 +11,12 @@
 #include <folly/Synchronized.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <atomic>
+#include <optional>
+#include <vector>
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/InodeDiffCallback.h"
+#include "eden/fs/inodes/ScmStatusCache.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/TreeEntry.h"
 #include "eden/fs/store/ObjectStore.h"
@@ -49,6 +53,15 @@ class ThriftStatusCallback : public InodeDiffCallback {
     // of the thrift result.
     XLOG(WARNING) << "error computing status data for " << path << ": "
                   << folly::exceptionStr(ew);
+    hadErrors_.store(true, std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns true if diffError() was called, meaning the status is
+   * incomplete.
+   */
+  bool hadErrors() const {
+    return hadErrors_.load(std::memory_order_relaxed);
   }
 
   /**
@@ -71,7 +84,67 @@ class ThriftStatusCallback : public InodeDiffCallback {
 
  private:
   folly::Synchronized<std::map<std::string, ScmFileStatus>> data_;
+  std::atomic<bool> hadErrors_{false};
 };
+
+/**
+ * Beyond this many changed paths, re-diffing them one by one is unlikely to
+ * be faster than a full diff.
+ */
+constexpr size_t kMaxStatusCacheRediffPaths = 10000;
+
+/**
+ * Return the paths that must be re-diffed to bring a status computed at
+ * sequence up to date with the journal, or std::nullopt if a full diff is
+ * needed.
+ */
+std::optional<std::vector<RelativePath>> getPathsToRediff(
+    const Journal& journal,
+    JournalDelta::SequenceNumber sequence) {
+  static const PathComponentPiece kIgnoreFilename{".gitignore"};
+
+  auto delta = journal.accumulateRange(sequence + 1);
+  if (!delta) {
+    return std::vector<RelativePath>{};
+  }
+  if (delta->fromSequence > sequence + 1) {
+    // The journal has discarded some of the changes since sequence.
+    return std::nullopt;
+  }
+  if (delta->fromHash != delta->toHash) {
+    // The parent commit changed.  The cache should already have been
+    // invalidated, but be safe.
+    return std::nullopt;
+  }
+  if (delta->changedFilesInOverlay.size() + delta->uncleanPaths.size() >
+      kMaxStatusCacheRediffPaths) {
+    return std::nullopt;
+  }
+
+  std::vector<RelativePath> paths;
+  auto addPath = [&](RelativePathPiece path) {
+    // A change to a .gitignore file can change the status of anything in its
+    // directory.
+    auto rediffPath =
+        path.basename() == kIgnoreFilename ? path.dirname() : path;
+    if (rediffPath.empty()) {
+      return false;
+    }
+    paths.emplace_back(rediffPath);
+    return true;
+  };
+  for (const auto& entry : delta->changedFilesInOverlay) {
+    if (!addPath(entry.first)) {
+      return std::nullopt;
+    }
+  }
+  for (const auto& path : delta->uncleanPaths) {
+    if (!addPath(path)) {
+      return std::nullopt;
+    }
+  }
+  return paths;
+}
 } // unnamed namespace
 
 char scmStatusCodeChar(ScmFileStatus code) {
@@ -100,12 +173,68 @@ std::ostream& operator<<(std::ostream& os, const ScmStatus& status) {
 }
 
 folly::Future<std::unique_ptr<ScmStatus>>
-diffMountForStatus(const EdenMount& mount, Hash commitHash, bool listIgnored) {
+diffMountForStatus(EdenMount& mount, Hash commitHash, bool listIgnored) {
+  auto& cache = mount.getScmStatusCache();
+
+  // Read the cache generation and the journal position before diffing, so
+  // that changes made while the diff runs are re-diffed on the next call.
+  auto generation = cache.getGeneration();
+  auto latest = mount.getJournal().getLatest();
+  auto sequence = latest ? latest->toSequence : 0;
+
+  auto cached = cache.get(commitHash, listIgnored);
+  std::optional<std::vector<RelativePath>> rediffPaths;
+  if (cached) {
+    if (cached->sequence == sequence) {
+      cache.recordHit();
+      return folly::makeFuture(std::make_unique<ScmStatus>(cached->status));
+    }
+    if (latest && cached->sequence < sequence) {
+      rediffPaths = getPathsToRediff(mount.getJournal(), cached->sequence);
+    }
+  }
+
   auto callback = std::make_unique<ThriftStatusCallback>();
   auto callbackPtr = callback.get();
-  return mount.diff(callbackPtr, commitHash, listIgnored)
-      .thenValue([callback = std::move(callback)](auto&&) {
-        return std::make_unique<ScmStatus>(callback->extractStatus());
+  auto diffFuture = folly::Future<folly::Unit>::makeEmpty();
+  if (rediffPaths) {
+    XLOG(DBG3) << "re-diffing " << rediffPaths->size()
+               << " paths changed since journal sequence " << cached->sequence;
+    cache.recordRediff(rediffPaths->size());
+    diffFuture =
+        mount.diffPaths(callbackPtr, commitHash, listIgnored, *rediffPaths);
+  } else {
+    cache.recordMiss();
+    cached.reset();
+    diffFuture = mount.diff(callbackPtr, commitHash, listIgnored);
+  }
+
+  return std::move(diffFuture)
+      .thenValue([&cache,
+                  generation,
+                  commitHash,
+                  listIgnored,
+                  sequence,
+                  cached = std::move(cached),
+                  rediffPaths = std::move(rediffPaths),
+                  callback = std::move(callback)](auto&&) mutable {
+        auto status = callback->extractStatus();
+        if (cached) {
+          ScmStatusCache::mergePaths(
+              cached->status, *rediffPaths, std::move(status));
+          status = std::move(cached->status);
+        }
+
+        // Don't cache a status that is missing entries due to errors.
+        if (!callback->hadErrors()) {
+          ScmStatusCache::Entry entry;
+          entry.commitHash = commitHash;
+          entry.listIgnored = listIgnored;
+          entry.sequence = sequence;
+          entry.status = status;
+          cache.insert(generation, std::move(entry));
+        }
+        return std::make_unique<ScmStatus>(std::move(status));
       });
 }
 
@@ -47,22 +47,6 @@ EdenDispatcher::EdenDispatcher(EdenMount* mount)
 
 namespace {
 
-/** Compute a fuse_entry_out */
-fuse_entry_out computeEntryParam(
-    InodeNumber number,
-    const Dispatcher::Attr& attr) {
-  fuse_entry_out entry = {};
-  entry.nodeid = number.get();
-  entry.generation = 0;
-  auto fuse_attr = attr.asFuseAttr();
-  entry.attr = fuse_attr.attr;
-  entry.attr_valid = fuse_attr.attr_valid;
-  entry.attr_valid_nsec = fuse_attr.attr_valid_nsec;
-  entry.entry_valid = fuse_attr.attr_valid;
-  entry.entry_valid_nsec = fuse_attr.attr_valid_nsec;
-  return entry;
-}
-
 Dispatcher::Attr attrForInodeWithCorruptOverlay() noexcept {
   struct stat st;
   std::memset(&st, 0, sizeof(st));
@@ -112,7 +96,7 @@ folly::Future<fuse_entry_out> EdenDispatcher::lookup(
             .thenTry([inode](folly::Try<Dispatcher::Attr> maybeAttr) {
               if (maybeAttr.hasValue()) {
                 inode->incFuseRefcount();
-                return computeEntryParam(inode->getNodeId(), maybeAttr.value());
+                return maybeAttr.value().asFuseEntry(inode->getNodeId());
               } else {
                 // The most common case for getattr() failing is if this file is
                 // materialized but the data for it in the overlay is missing
@@ -132,8 +116,8 @@ folly::Future<fuse_entry_out> EdenDispatcher::lookup(
                            << inode->getNodeId() << " (" << inode->getLogPath()
                            << "): " << maybeAttr.exception().what();
                 inode->incFuseRefcount();
-                return computeEntryParam(
-                    inode->getNodeId(), attrForInodeWithCorruptOverlay());
+                return attrForInodeWithCorruptOverlay().asFuseEntry(
+                    inode->getNodeId());
               }
             });
       })
@@ -200,7 +184,7 @@ folly::Future<fuse_entry_out> EdenDispatcher::create(
       })
       .thenValue([=](TreeInode::CreateResult created) {
         created.inode->incFuseRefcount();
-        return computeEntryParam(created.inode->getNodeId(), created.attr);
+        return created.attr.asFuseEntry(created.inode->getNodeId());
       });
 }
 
@@ -285,6 +269,20 @@ folly::Future<DirList> EdenDispatcher::readdir(
       });
 }
 
+#ifdef __linux__
+folly::Future<DirPlusList> EdenDispatcher::readdirplus(
+    InodeNumber ino,
+    DirPlusList&& dirList,
+    off_t offset,
+    uint64_t /*fh*/) {
+  FB_LOGF(mount_->getStraceLogger(), DBG7, "readdirplus({}, {})", ino, offset);
+  return inodeMap_->lookupTreeInode(ino).thenValue(
+      [dirList = std::move(dirList), offset](TreeInodePtr inode) mutable {
+        return inode->readdirplus(std::move(dirList), offset);
+      });
+}
+#endif
+
 folly::Future<fuse_entry_out> EdenDispatcher::mknod(
     InodeNumber parent,
     PathComponentPiece name,
@@ -303,7 +301,7 @@ folly::Future<fuse_entry_out> EdenDispatcher::mknod(
         auto child = inode->mknod(childName, mode, rdev);
         return child->getattr().thenValue([child](Dispatcher::Attr attr) {
           child->incFuseRefcount();
-          return computeEntryParam(child->getNodeId(), attr);
+          return attr.asFuseEntry(child->getNodeId());
         });
       });
 }
@@ -324,7 +322,7 @@ folly::Future<fuse_entry_out> EdenDispatcher::mkdir(
         auto child = inode->mkdir(childName, mode);
         return child->getattr().thenValue([child](Dispatcher::Attr attr) {
           child->incFuseRefcount();
-          return computeEntryParam(child->getNodeId(), attr);
+          return attr.asFuseEntry(child->getNodeId());
         });
       });
 }
@@ -361,7 +359,7 @@ folly::Future<fuse_entry_out> EdenDispatcher::symlink(
         auto symlinkInode = inode->symlink(childName, linkContents);
         symlinkInode->incFuseRefcount();
         return symlinkInode->getattr().thenValue([symlinkInode](Attr&& attr) {
-          return computeEntryParam(symlinkInode->getNodeId(), attr);
+          return attr.asFuseEntry(symlinkInode->getNodeId());
         });
       });
 }
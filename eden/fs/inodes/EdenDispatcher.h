@@ -91,6 +91,13 @@ class EdenDispatcher : public Dispatcher {
       DirList&& dirList,
       off_t offset,
       uint64_t fh) override;
+#ifdef __linux__
+  folly::Future<DirPlusList> readdirplus(
+      InodeNumber ino,
+      DirPlusList&& dirList,
+      off_t offset,
+      uint64_t fh) override;
+#endif
 
   folly::Future<std::string> getxattr(InodeNumber ino, folly::StringPiece name)
       override;
@@ -25,6 +25,7 @@
 #endif
 
 #include "eden/fs/config/CheckoutConfig.h"
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/fuse/FuseChannel.h"
 #include "eden/fs/fuse/privhelper/PrivHelper.h"
 #include "eden/fs/inodes/CheckoutContext.h"
@@ -45,6 +46,8 @@
 #include "eden/fs/model/git/GitIgnoreStack.h"
 #include "eden/fs/service/PrettyPrinters.h"
 #include "eden/fs/store/BlobAccess.h"
+#include "eden/fs/store/Diff.h"
+#include "eden/fs/store/ImportPriority.h"
 #include "eden/fs/store/ObjectStore.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/Clock.h"
@@ -63,9 +66,37 @@ using std::make_unique;
 using std::shared_ptr;
 using std::unique_ptr;
 using std::vector;
+using std::chrono::steady_clock;
 using std::chrono::system_clock;
 
 DEFINE_int32(fuseNumThreads, 16, "how many fuse dispatcher threads to spawn");
+DEFINE_bool(
+    fuseSplice,
+    false,
+    "splice file data for FUSE replies directly into the FUSE device");
+DEFINE_bool(
+    fuseCloneDevicePerThread,
+    false,
+    "give each fuse dispatcher thread its own clone of the FUSE device");
+DEFINE_bool(
+    fusePinWorkerThreads,
+    false,
+    "pin each fuse dispatcher thread to a single CPU");
+DEFINE_bool(
+    checkoutPrefetch,
+    true,
+    "fetch the trees and blobs a checkout will apply before applying it, in "
+    "large batches");
+DEFINE_uint64(
+    checkoutPrefetchBatchSize,
+    1000,
+    "number of blobs, or of directories' trees, requested together by the "
+    "checkout prefetch");
+DEFINE_uint64(
+    checkoutPrefetchConcurrency,
+    8,
+    "number of tree batches or blob batches the checkout prefetch keeps "
+    "outstanding at once");
 
 namespace facebook {
 namespace eden {
@@ -156,10 +187,10 @@ constexpr int EdenMount::kMaxSymlinkChainDepth;
 static constexpr folly::StringPiece kEdenStracePrefix = "eden.strace.";
 
 // We compute this when the process is initialized, but stash a copy
-// in each EdenMount.  We may in the future manage to propagate enough
-// state across upgrades or restarts that we can preserve this, but
-// as implemented today, a process restart will invalidate any cached
-// mountGeneration that a client may be holding on to.
+// in each EdenMount.  A mount whose journal is restored from its log after
+// a restart keeps the generation recorded in the log, so that clients can
+// keep using their journal positions; otherwise a process restart will
+// invalidate any cached mountGeneration that a client may be holding on to.
 // We take the bottom 16-bits of the pid and 32-bits of the current
 // time and shift them up, leaving 16 bits for a mount point generation
 // number.
@@ -196,31 +227,48 @@ EdenMount::EdenMount(
       blobCache_{std::move(blobCache)},
       blobAccess_{objectStore_, blobCache_},
       overlay_{std::make_unique<Overlay>(config_->getOverlayPath())},
-      overlayFileAccess_{overlay_.get()},
+      overlayFileAccess_{overlay_.get(), FLAGS_fuseSplice},
       bindMounts_{config_->getBindMounts()},
+      journal_{serverState_->getEdenConfig()->getJournalMemoryLimit()},
       mountGeneration_{globalProcessGeneration | ++mountGeneration},
       straceLogger_{kEdenStracePrefix.str() + config_->getMountPath().value()},
       lastCheckoutTime_{serverState_->getClock()->getRealtime()},
       owner_{Owner{getuid(), getgid()}},
-      clock_{serverState_->getClock()} {}
+      clock_{serverState_->getClock()} {
+  auto edenConfig = serverState_->getEdenConfig();
+  journal_.setSubscriberExecutor(
+      serverState_->getThreadPool(),
+      edenConfig->getJournalNotifyMinInterval(),
+      edenConfig->getJournalNotifyMaxLatency());
+}
 
 folly::Future<folly::Unit> EdenMount::initialize(
-    const std::optional<SerializedInodeMap>& takeover) {
+    const std::optional<SerializedInodeMap>& takeover,
+    std::optional<Journal::SequenceNumber> takeoverJournalSequence) {
   transitionState(State::UNINITIALIZED, State::INITIALIZING);
 
   return serverState_->getFaultInjector()
       .checkAsync("mount", getPath().stringPiece())
       .via(serverState_->getThreadPool().get())
-      .thenValue([this](auto&&) {
+      .thenValue([this, takeoverJournalSequence](auto&&) {
         auto parents = config_->getParentCommits();
         parentInfo_.wlock()->parents.setParents(parents);
 
-        // Record the transition from no snapshot to the current snapshot in
-        // the journal.  This also sets things up so that we can carry the
-        // snapshot id forward through subsequent journal entries.
-        auto delta = std::make_unique<JournalDelta>();
-        delta->toHash = parents.parent1();
-        journal_.addDelta(std::move(delta));
+        openJournalLog(takeoverJournalSequence);
+
+        // Record the transition from the last snapshot in the journal, if
+        // any, to the current snapshot.  This also sets things up so that we
+        // can carry the snapshot id forward through subsequent journal
+        // entries.
+        auto latest = journal_.getLatest();
+        if (!latest || latest->toHash != parents.parent1()) {
+          auto delta = std::make_unique<JournalDelta>();
+          if (latest) {
+            delta->fromHash = latest->toHash;
+          }
+          delta->toHash = parents.parent1();
+          journal_.addDelta(std::move(delta));
+        }
 
         // Initialize the overlay.
         // This must be performed before we do any operations that may allocate
@@ -247,6 +295,39 @@ folly::Future<folly::Unit> EdenMount::initialize(
       });
 }
 
+void EdenMount::openJournalLog(
+    std::optional<Journal::SequenceNumber> takeoverJournalSequence) {
+  auto diskLimit = serverState_->getEdenConfig()->getJournalDiskLimit();
+  if (diskLimit == 0) {
+    return;
+  }
+
+  auto path = config_->getJournalLogPath();
+  try {
+    auto log = JournalLog::open(path, diskLimit);
+    if (log && takeoverJournalSequence &&
+        log->getLastSequence() != *takeoverJournalSequence) {
+      XLOG(WARN) << "journal log " << path << " ends at sequence number "
+                 << log->getLastSequence() << " instead of "
+                 << *takeoverJournalSequence << "; not restoring it";
+      log.reset();
+    }
+
+    if (!log) {
+      log = JournalLog::create(path, diskLimit, getMountGeneration());
+    }
+    // Only adopt the log's generation once its deltas have been restored.
+    auto generation = log->getGeneration();
+    journal_.setLog(std::move(log), serverState_->getThreadPool());
+    mountGeneration_.store(generation, std::memory_order_release);
+  } catch (const std::exception& ex) {
+    // The journal still works without its log; it just won't survive a
+    // restart.
+    XLOG(ERR) << "unable to record the journal for " << getPath()
+              << " in " << path << ": " << ex.what();
+  }
+}
+
 folly::Future<TreeInodePtr> EdenMount::createRootInode(
     const ParentCommits& parentCommits) {
   // Load the overlay, if present.
@@ -477,11 +558,12 @@ folly::SemiFuture<SerializedInodeMap> EdenMount::shutdownImpl(bool doTakeover) {
   return inodeMap_->shutdown(doTakeover)
       .thenValue([this](SerializedInodeMap inodeMap) {
         XLOG(DBG1) << "shutdown complete for EdenMount " << getPath();
-        // Close the Overlay object to make sure we have released its lock.
-        // This is important during graceful restart to ensure that we have
-        // released the lock before the new edenfs process begins to take over
-        // the mount point.
+        // Close the Overlay object and the journal's log to make sure we have
+        // released their locks.  This is important during graceful restart
+        // to ensure that we have released the locks before the new edenfs
+        // process begins to take over the mount point.
         overlay_->close();
+        journal_.closeLog();
         auto oldState =
             state_.exchange(State::SHUT_DOWN, std::memory_order_acq_rel);
         if (oldState == State::DESTROYING) {
@@ -670,16 +752,41 @@ folly::Future<std::vector<CheckoutConflict>> EdenMount::checkout(
         if (ctx->isDryRun()) {
           journalDiffFuture = makeFuture();
         } else {
+          auto diffStart = steady_clock::now();
           journalDiffFuture =
-              journalDiffCallback->performDiff(this, getRootInode(), fromTree);
+              journalDiffCallback->performDiff(this, getRootInode(), fromTree)
+                  .thenValue([ctx, diffStart](auto&&) {
+                    ctx->recordPhaseTime(
+                        "diff", steady_clock::now() - diffStart);
+                  });
+        }
+
+        // While the working copy is being diffed, fetch everything the
+        // checkout will need from the backing store in large batches, rather
+        // than one object at a time as each CheckoutAction runs.  A dry run
+        // only looks for conflicts, so it skips this.
+        auto prefetchFuture = makeFuture();
+        if (!ctx->isDryRun() && FLAGS_checkoutPrefetch) {
+          prefetchFuture = prefetchForCheckout(ctx, fromTree, toTree);
         }
 
         // Perform the requested checkout operation after the journal diff
-        // completes.
-        return std::move(journalDiffFuture)
-            .thenValue([this, ctx, fromTree, toTree](auto&&) {
+        // and the prefetch complete.  Wait for both even if the diff fails,
+        // since the prefetch refers to this mount.
+        return folly::collectAll(journalDiffFuture, prefetchFuture)
+            .thenValue([this, ctx, fromTree, toTree](
+                           std::tuple<folly::Try<Unit>, folly::Try<Unit>>&&
+                               results) {
+              std::get<0>(results).throwIfFailed();
+              std::get<1>(results).throwIfFailed();
               ctx->start(this->acquireRenameLock());
 
+              // The working directory is about to change without individual
+              // journal entries, so any cached status is no longer valid.
+              if (!ctx->isDryRun()) {
+                scmStatusCache_.invalidate();
+              }
+
               /**
                * If a significant number of tree inodes are loaded or referenced
                * by FUSE, then checkout is slow, because Eden must precisely
@@ -699,8 +806,13 @@ folly::Future<std::vector<CheckoutConflict>> EdenMount::checkout(
                */
               this->getRootInode()->unloadChildrenUnreferencedByFuse();
 
-              return this->getRootInode()->checkout(
-                  ctx.get(), fromTree, toTree);
+              auto applyStart = steady_clock::now();
+              return this->getRootInode()
+                  ->checkout(ctx.get(), fromTree, toTree)
+                  .thenValue([ctx, applyStart](auto&&) {
+                    ctx->recordPhaseTime(
+                        "apply", steady_clock::now() - applyStart);
+                  });
             });
       })
       .thenValue([ctx, snapshotHash](auto&&) {
@@ -716,6 +828,9 @@ folly::Future<std::vector<CheckoutConflict>> EdenMount::checkout(
           return std::move(conflicts);
         }
 
+        // Drop any status computed while the checkout was in progress.
+        scmStatusCache_.invalidate();
+
         // Save the new snapshot hash to the config
         // TODO: This should probably be done by CheckoutConflict::finish()
         // while still holding the parents lock.
@@ -743,6 +858,100 @@ folly::Future<std::vector<CheckoutConflict>> EdenMount::checkout(
       });
 }
 
+namespace {
+/**
+ * Returns whether TreeInode::checkout() will process the directory at path,
+ * rather than only replacing its hash in its parent: whether it, and each of
+ * its parents, is loaded, materialized, or remembered by the InodeMap.
+ *
+ * The checkout unloads inodes that FUSE does not reference before applying,
+ * so this may include some directories that it will not process after all.
+ */
+bool willCheckoutProcessDirectory(
+    InodeMap* inodeMap,
+    TreeInodePtr dir,
+    RelativePathPiece path) {
+  for (auto component : path.dirname().components()) {
+    auto contents = dir->getContentsMaybeUnbuilt().rlock();
+    auto* entry = folly::get_ptr(contents->entries, component);
+    auto child = entry ? entry->asTreePtrOrNull() : TreeInodePtr{};
+    if (!child) {
+      // None of the children of an unloaded directory are loaded.
+      return false;
+    }
+    contents.unlock();
+    dir = std::move(child);
+  }
+
+  auto contents = dir->getContentsMaybeUnbuilt().rlock();
+  auto* entry = folly::get_ptr(contents->entries, path.basename());
+  if (!entry) {
+    // An unbuilt directory only has entries for its loaded children.
+    if (!contents->isUnbuilt()) {
+      return false;
+    }
+    auto number = contents->getUnbuiltInodeNumber(path.basename());
+    return number && inodeMap->isInodeRemembered(*number);
+  }
+  return entry->getInode() || entry->isMaterialized() ||
+      inodeMap->isInodeRemembered(entry->getInodeNumber());
+}
+} // namespace
+
+Future<Unit> EdenMount::prefetchForCheckout(
+    shared_ptr<CheckoutContext> ctx,
+    shared_ptr<const Tree> fromTree,
+    shared_ptr<const Tree> toTree) {
+  auto start = steady_clock::now();
+  ImportPriorityScope importPriority{ImportPriorityClass::Prefetch};
+  auto concurrency = std::max<uint64_t>(FLAGS_checkoutPrefetchConcurrency, 1);
+  auto batchSize = std::max<uint64_t>(FLAGS_checkoutPrefetchBatchSize, 1);
+
+  // Checkout replaces the hash of an unloaded, unmodified directory without
+  // reading it, so only walk the directories it will actually process.
+  auto shouldWalk = [inodeMap = getInodeMap(),
+                     rootInode = getRootInode()](RelativePathPiece path) {
+    return willCheckoutProcessDirectory(inodeMap, rootInode, path);
+  };
+  return listChangedObjects(
+             objectStore_.get(),
+             std::move(fromTree),
+             std::move(toTree),
+             concurrency,
+             batchSize,
+             std::move(shouldWalk))
+      .thenValue([this, ctx, concurrency, batchSize](ChangedObjects&& objects) {
+        ctx->setPrefetchListed(objects.trees.size(), objects.blobs.size());
+
+        vector<vector<Hash>> batches;
+        for (size_t n = 0; n < objects.blobs.size(); n += batchSize) {
+          auto begin = objects.blobs.begin() + n;
+          auto end = objects.blobs.begin() +
+              std::min<size_t>(objects.blobs.size(), n + batchSize);
+          batches.emplace_back(begin, end);
+        }
+
+        auto fetches = folly::window(
+            std::move(batches),
+            [this, ctx](vector<Hash> batch) {
+              auto count = batch.size();
+              return objectStore_->prefetchBlobs(batch).thenValue(
+                  [ctx, count](auto&&) { ctx->addPrefetchedBlobs(count); });
+            },
+            concurrency);
+        return folly::collect(fetches).unit();
+      })
+      .thenTry([ctx, start](folly::Try<Unit>&& result) {
+        // The prefetch is only an optimization.  If it fails, the checkout
+        // fetches whatever it still needs on demand.
+        if (result.hasException()) {
+          XLOG(WARN) << "checkout prefetch failed: "
+                     << result.exception().what();
+        }
+        ctx->recordPhaseTime("prefetch", steady_clock::now() - start);
+      });
+}
+
 folly::Future<folly::Unit> EdenMount::chown(uid_t uid, gid_t gid) {
   // 1) Ensure that all future opens will by default provide this owner
   setOwner(uid, gid);
@@ -807,6 +1016,19 @@ Future<Unit> EdenMount::diff(
   return diff(ctxPtr, commitHash).ensure(std::move(stateHolder));
 }
 
+Future<Unit> EdenMount::diffPaths(
+    InodeDiffCallback* callback,
+    Hash commitHash,
+    bool listIgnored,
+    const std::vector<RelativePath>& paths) const {
+  auto context = createDiffContext(callback, listIgnored);
+  context->setPathFilter(paths);
+  const DiffContext* ctxPtr = context.get();
+
+  auto stateHolder = [ctx = std::move(context)]() {};
+  return diff(ctxPtr, commitHash).ensure(std::move(stateHolder));
+}
+
 void EdenMount::resetParents(const ParentCommits& parents) {
   // Hold the snapshot lock around the entire operation.
   auto parentsLock = parentInfo_.wlock();
@@ -819,6 +1041,7 @@ void EdenMount::resetParents(const ParentCommits& parents) {
 
   config_->setParentCommits(parents);
   parentsLock->parents.setParents(parents);
+  scmStatusCache_.invalidate();
 
   auto journalDelta = make_unique<JournalDelta>();
   journalDelta->fromHash = oldParents.parent1();
@@ -858,6 +1081,22 @@ std::string EdenMount::getCounterName(CounterName name) {
       return "journal." + base + ".memory";
     case CounterName::JOURNAL_ENTRIES:
       return "journal." + base + ".count";
+    case CounterName::JOURNAL_COMPACTIONS:
+      return "journal." + base + ".compactions";
+    case CounterName::JOURNAL_TRUNCATIONS:
+      return "journal." + base + ".truncations";
+    case CounterName::STATUS_CACHE_HITS:
+      return "status_cache." + base + ".hits";
+    case CounterName::STATUS_CACHE_INCREMENTAL_HITS:
+      return "status_cache." + base + ".incremental_hits";
+    case CounterName::STATUS_CACHE_MISSES:
+      return "status_cache." + base + ".misses";
+    case CounterName::STATUS_CACHE_REDIFF_PATHS:
+      return "status_cache." + base + ".rediff_paths";
+    case CounterName::OBJECT_STORE_COALESCED_TREES:
+      return "object_store." + base + ".coalesced_trees";
+    case CounterName::OBJECT_STORE_COALESCED_BLOBS:
+      return "object_store." + base + ".coalesced_blobs";
   }
   EDEN_BUG() << "unknown counter name " << static_cast<int>(name);
   folly::assume_unreachable();
@@ -900,7 +1139,8 @@ void EdenMount::takeoverFuse(FuseChannelData takeoverData) {
 
     createFuseChannel(std::move(takeoverData.fd));
     auto fuseCompleteFuture =
-        channel_->initializeFromTakeover(takeoverData.connInfo);
+        channel_->initializeFromTakeover(
+            takeoverData.connInfo, std::move(takeoverData.clonedFds));
     fuseInitSuccessful(std::move(fuseCompleteFuture));
   } catch (const std::exception& ex) {
     transitionToFuseInitializationErrorState();
@@ -979,7 +1219,10 @@ void EdenMount::createFuseChannel(folly::File fuseDevice) {
       getPath(),
       FLAGS_fuseNumThreads,
       dispatcher_.get(),
-      serverState_->getProcessNameCache()));
+      serverState_->getProcessNameCache(),
+      FLAGS_fuseSplice,
+      FLAGS_fuseCloneDevicePerThread,
+      FLAGS_fusePinWorkerThreads));
 }
 
 void EdenMount::fuseInitSuccessful(
@@ -1003,14 +1246,16 @@ void EdenMount::fuseInitSuccessful(
           bindMounts.push_back(entry.pathInMountDir);
         }
 
-        fuseCompletionPromise_.setValue(TakeoverData::MountInfo(
+        TakeoverData::MountInfo mountInfo(
             getPath(),
             config_->getClientDirectory(),
             bindMounts,
             std::move(stopData.fuseDevice),
             stopData.fuseSettings,
             SerializedInodeMap{} // placeholder
-            ));
+        );
+        mountInfo.clonedFuseFDs = std::move(stopData.clonedFuseDevices);
+        fuseCompletionPromise_.setValue(std::move(mountInfo));
       })
       .thenError([this](folly::exception_wrapper&& ew) {
         XLOG(ERR) << "session complete with err: " << ew.what();
@@ -17,6 +17,7 @@
 #include <folly/futures/Promise.h>
 #include <folly/futures/SharedPromise.h>
 #include <folly/logging/Logger.h>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <mutex>
@@ -27,6 +28,7 @@
 #include "eden/fs/fuse/FuseChannel.h"
 #include "eden/fs/inodes/InodePtrFwd.h"
 #include "eden/fs/inodes/OverlayFileAccess.h"
+#include "eden/fs/inodes/ScmStatusCache.h"
 #include "eden/fs/journal/Journal.h"
 #include "eden/fs/model/ParentCommits.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
@@ -49,6 +51,7 @@ class BindMount;
 class BlobCache;
 class CheckoutConfig;
 class CheckoutConflict;
+class CheckoutContext;
 class Clock;
 class DiffContext;
 class EdenDispatcher;
@@ -90,7 +93,44 @@ enum class CounterName {
   /**
    * Represents the number of entries in the change log
    */
-  JOURNAL_ENTRIES
+  JOURNAL_ENTRIES,
+  /**
+   * Represents the number of times old change log entries were merged to stay
+   * within the memory limit
+   */
+  JOURNAL_COMPACTIONS,
+  /**
+   * Represents the number of times old change log entries were discarded to
+   * stay within the memory limit
+   */
+  JOURNAL_TRUNCATIONS,
+  /**
+   * Represents the number of status requests answered from the status cache
+   */
+  STATUS_CACHE_HITS,
+  /**
+   * Represents the number of status requests answered by re-diffing only the
+   * paths changed since the cached status
+   */
+  STATUS_CACHE_INCREMENTAL_HITS,
+  /**
+   * Represents the number of status requests that needed a full diff
+   */
+  STATUS_CACHE_MISSES,
+  /**
+   * Represents the total number of paths re-diffed for incremental hits
+   */
+  STATUS_CACHE_REDIFF_PATHS,
+  /**
+   * Represents the number of tree requests that joined an identical request
+   * already in progress in the ObjectStore
+   */
+  OBJECT_STORE_COALESCED_TREES,
+  /**
+   * Represents the number of blob requests that joined an identical request
+   * already in progress in the ObjectStore
+   */
+  OBJECT_STORE_COALESCED_BLOBS
 };
 
 /**
@@ -131,9 +171,13 @@ class EdenMount {
    * Asynchronous EdenMount initialization - post instantiation.
    *
    * If takeover data is specified, it is used to initialize the inode map.
+   * If takeoverJournalSequence is specified, the journal is only restored
+   * from its log if the log ends with that sequence number.
    */
   FOLLY_NODISCARD folly::Future<folly::Unit> initialize(
-      const std::optional<SerializedInodeMap>& takeover = std::nullopt);
+      const std::optional<SerializedInodeMap>& takeover = std::nullopt,
+      std::optional<Journal::SequenceNumber> takeoverJournalSequence =
+          std::nullopt);
 
   /**
    * Destroy the EdenMount.
@@ -305,7 +349,7 @@ class EdenMount {
   }
 
   uint64_t getMountGeneration() const {
-    return mountGeneration_;
+    return mountGeneration_.load(std::memory_order_acquire);
   }
 
   const CheckoutConfig* getConfig() const {
@@ -408,6 +452,25 @@ class EdenMount {
       Hash commitHash,
       bool listIgnored = false) const;
 
+  /**
+   * Compute differences like diff() above, but only for the given paths,
+   * everything below them, and the directories leading to them.  See
+   * DiffContext::setPathFilter().
+   */
+  FOLLY_NODISCARD folly::Future<folly::Unit> diffPaths(
+      InodeDiffCallback* callback,
+      Hash commitHash,
+      bool listIgnored,
+      const std::vector<RelativePath>& paths) const;
+
+  /**
+   * Returns the cache of the most recent getScmStatus() result for this
+   * mount.
+   */
+  ScmStatusCache& getScmStatusCache() {
+    return scmStatusCache_;
+  }
+
   /**
    * Reset the state to point to the specified parent commit(s), without
    * modifying the working directory contents at all.
@@ -604,6 +667,13 @@ class EdenMount {
   EdenMount(EdenMount const&) = delete;
   EdenMount& operator=(EdenMount const&) = delete;
 
+  /**
+   * Restore the journal from its log, if it has one we can trust, and start
+   * recording the journal in the log.
+   */
+  void openJournalLog(
+      std::optional<Journal::SequenceNumber> takeoverJournalSequence);
+
   folly::Future<TreeInodePtr> createRootInode(
       const ParentCommits& parentCommits);
   FOLLY_NODISCARD folly::Future<folly::Unit> setupDotEden(TreeInodePtr root);
@@ -613,6 +683,29 @@ class EdenMount {
       InodeDiffCallback* callback,
       bool listIgnored) const;
 
+  /**
+   * Fetch the trees and blobs that differ between fromTree and toTree, so
+   * that applying a checkout between them does not wait on individual
+   * backing store requests.
+   *
+   * Only the directories that the checkout will process are walked: those
+   * whose inodes are loaded, materialized, or remembered.  Changes under any
+   * other directory are applied by replacing the directory's hash, and are
+   * fetched on demand if they are ever read.
+   *
+   * Blobs are requested in batches of --checkoutPrefetchBatchSize, with at
+   * most --checkoutPrefetchConcurrency tree fetches or blob batches
+   * outstanding at once.  Progress is reported through ctx.
+   *
+   * It can be turned off with --checkoutPrefetch=false.  The checkout waits
+   * for it to finish before applying or failing, so it never outlives the
+   * mount.
+   */
+  FOLLY_NODISCARD folly::Future<folly::Unit> prefetchForCheckout(
+      std::shared_ptr<CheckoutContext> ctx,
+      std::shared_ptr<const Tree> fromTree,
+      std::shared_ptr<const Tree> toTree);
+
   /**
    * Open the FUSE device and mount it using the mount(2) syscall.
    */
@@ -712,10 +805,18 @@ class EdenMount {
   Journal journal_;
 
   /**
-   * A number to uniquely identify this particular incarnation of this mount.
-   * We use bits from the process id and the time at which we were mounted.
+   * The most recent status computed for this mount.  This is invalidated
+   * whenever the parent commits change.
+   */
+  ScmStatusCache scmStatusCache_;
+
+  /**
+   * A number to uniquely identify this particular incarnation of this mount's
+   * journal.  We use bits from the process id and the time at which we were
+   * mounted.  If initialize() restores the journal from its log, it also
+   * restores the generation the journal was created with.
    */
-  const uint64_t mountGeneration_;
+  std::atomic<uint64_t> mountGeneration_;
 
   /**
    * The path to the unix socket that can be used to address us via thrift
@@ -696,8 +696,16 @@ Future<string> FileInode::readAll(CacheHint cacheHint) {
 
 Future<BufVec> FileInode::read(size_t size, off_t off) {
   DCHECK_GE(off, 0);
+  LockedState state{this};
+  if (auto chunkedRead = tryReadChunks(state, size, off)) {
+    return std::move(*chunkedRead);
+  }
+  return readBlob(std::move(state), size, off);
+}
+
+Future<BufVec> FileInode::readBlob(LockedState state, size_t size, off_t off) {
   return runWhileDataLoaded<Future<BufVec>>(
-      LockedState{this},
+      std::move(state),
       BlobCache::Interest::WantHandle,
       nullptr,
       [size, off, self = inodePtrFromThis()](
@@ -743,6 +751,99 @@ Future<BufVec> FileInode::read(size_t size, off_t off) {
       });
 }
 
+std::optional<Future<BufVec>>
+FileInode::tryReadChunks(LockedState& state, size_t size, off_t off) {
+  if (state->tag != State::BLOB_NOT_LOADING) {
+    return std::nullopt;
+  }
+  auto hash = state->hash.value();
+  if (state->interestHandle.getBlob() ||
+      getMount()->getBlobCache()->contains(hash)) {
+    return std::nullopt;
+  }
+
+  // The kernel looks up a file's attributes before reading it, so the size
+  // is usually cached by now.
+  if (auto metadata = getObjectStore()->getCachedBlobMetadata(hash)) {
+    if (metadata->size < kChunkedBlobThreshold) {
+      return std::nullopt;
+    }
+    state.unlock();
+    return readChunks(hash, metadata->size, size, off);
+  }
+
+  // Otherwise it is usually in the LocalStore.  If the blob has to be fetched
+  // to find its size, its chunks are saved too, so they are not fetched again.
+  state.unlock();
+  return getObjectStore()->getBlobMetadata(hash).thenValue(
+      [self = inodePtrFromThis(), hash, size, off](
+          const BlobMetadata& metadata) {
+        if (metadata.size < kChunkedBlobThreshold) {
+          return self->readBlob(LockedState{self}, size, off);
+        }
+        return self->readChunks(hash, metadata.size, size, off);
+      });
+}
+
+Future<BufVec> FileInode::readChunks(
+    const Hash& hash,
+    uint64_t blobSize,
+    size_t size,
+    off_t off) {
+  uint64_t start = std::min<uint64_t>(off, blobSize);
+  uint64_t end = std::min<uint64_t>(start + size, blobSize);
+  auto firstChunk = start / kBlobChunkSize;
+  std::vector<Future<BlobCache::GetResult>> chunkFutures;
+  for (auto index = firstChunk; index * kBlobChunkSize < end; ++index) {
+    chunkFutures.push_back(
+        getMount()->getBlobAccess()->getBlobChunk(hash, index));
+  }
+
+  return folly::collectAllSemiFuture(std::move(chunkFutures))
+      .toUnsafeFuture()
+      .thenValue([self = inodePtrFromThis(),
+                  size,
+                  off,
+                  start,
+                  end,
+                  firstChunk](
+                     std::vector<folly::Try<BlobCache::GetResult>>&& chunks) {
+        LockedState state{self};
+        SCOPE_SUCCESS {
+          self->updateAtimeLocked(*state);
+        };
+
+        // The file may have been written to while the chunks were loading.
+        if (state->tag == State::MATERIALIZED_IN_OVERLAY) {
+          return self->getOverlayFileAccess(state)->read(
+              self->getNodeId(), size, off);
+        }
+
+        std::unique_ptr<folly::IOBuf> result;
+        for (size_t n = 0; n < chunks.size(); ++n) {
+          const auto& chunk = chunks[n].value().blob;
+          auto chunkStart = (firstChunk + n) * kBlobChunkSize;
+          auto pieceStart = std::max(start, chunkStart);
+          auto pieceEnd = std::min(end, chunkStart + kBlobChunkSize);
+
+          folly::io::Cursor cursor(&chunk->getContents());
+          cursor.skip(pieceStart - chunkStart);
+          std::unique_ptr<folly::IOBuf> piece;
+          cursor.clone(piece, pieceEnd - pieceStart);
+          if (result) {
+            result->prependChain(std::move(piece));
+          } else {
+            result = std::move(piece);
+          }
+        }
+        if (!result) {
+          // Read beyond EOF.
+          result = folly::IOBuf::wrapBuffer("", 0);
+        }
+        return BufVec{std::move(result)};
+      });
+}
+
 size_t FileInode::writeImpl(
     LockedState& state,
     const struct iovec* iov,
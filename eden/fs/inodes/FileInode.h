@@ -278,6 +278,31 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
       LockedState state,
       Fn&& fn);
 
+  /**
+   * Read part of the file by loading its whole blob, or from the overlay if
+   * it is materialized.
+   */
+  folly::Future<BufVec> readBlob(LockedState state, size_t size, off_t off);
+
+  /**
+   * Read part of a large unmaterialized file a chunk at a time, without
+   * loading the whole blob.
+   *
+   * Returns std::nullopt if the file should instead be read by loading its
+   * blob: if it is not in the BLOB_NOT_LOADING state, or the whole blob is
+   * already in memory.  Otherwise, this releases the lock, looks up the size
+   * of the blob if it is not cached, and reads the blob with readBlob() if it
+   * is smaller than kChunkedBlobThreshold.
+   */
+  std::optional<folly::Future<BufVec>>
+  tryReadChunks(LockedState& state, size_t size, off_t off);
+
+  /**
+   * Read part of a blob of the given size a chunk at a time.
+   */
+  folly::Future<BufVec>
+  readChunks(const Hash& hash, uint64_t blobSize, size_t size, off_t off);
+
   /**
    * Start loading the file data.
    *
@@ -316,8 +316,9 @@ ParentInodeInfo InodeBase::getParentInfo() const {
           false,
           ParentContentsPtr{}};
     }
-    // Now grab our parent's contents lock.
-    auto parentContents = parent->getContents().wlock();
+    // Now grab our parent's contents lock.  Our parent's entries need not be
+    // built: an unbuilt directory keeps the entries of its loaded children.
+    auto parentContents = parent->getContentsMaybeUnbuilt().wlock();
 
     // After acquiring our parent's contents lock we have to make sure it is
     // actually still our parent.  If it is we are done and can break out of
@@ -108,26 +108,27 @@ InodeMap::~InodeMap() {
 }
 
 void InodeMap::initialize(TreeInodePtr root) {
-  auto data = data_.wlock();
+  auto shard = getShard(kRootNodeId).wlock();
   CHECK(!root_);
   root_ = std::move(root);
-  auto ret = data->loadedInodes_.emplace(kRootNodeId, root_.get());
+  auto ret = shard->loadedInodes_.emplace(kRootNodeId, root_.get());
   CHECK(ret.second);
 }
 
 void InodeMap::initializeFromTakeover(
     TreeInodePtr root,
     const SerializedInodeMap& takeover) {
-  auto data = data_.wlock();
+  auto lock = lockAllShards();
 
-  CHECK_EQ(data->loadedInodes_.size(), 0)
+  CHECK_EQ(lock.getLoadedInodeCount(), 0)
       << "cannot load InodeMap data over a populated instance";
-  CHECK_EQ(data->unloadedInodes_.size(), 0)
+  CHECK_EQ(lock.getUnloadedInodeCount(), 0)
       << "cannot load InodeMap data over a populated instance";
 
   CHECK(!root_);
   root_ = std::move(root);
-  auto ret = data->loadedInodes_.emplace(kRootNodeId, root_.get());
+  auto ret =
+      lock.getShard(kRootNodeId).loadedInodes_.emplace(kRootNodeId, root_.get());
   CHECK(ret.second);
   for (const auto& entry : takeover.unloadedInodes) {
     if (entry.numFuseReferences < 0) {
@@ -149,8 +150,9 @@ void InodeMap::initializeFromTakeover(
                            : std::optional<Hash>{hashFromThrift(entry.hash)},
         entry.numFuseReferences);
 
-    auto result = data->unloadedInodes_.emplace(
-        InodeNumber::fromThrift(entry.inodeNumber), std::move(unloadedEntry));
+    auto number = InodeNumber::fromThrift(entry.inodeNumber);
+    auto result = lock.getShard(number).unloadedInodes_.emplace(
+        number, std::move(unloadedEntry));
     if (!result.second) {
       auto message = folly::to<std::string>(
           "failed to emplace inode number ",
@@ -162,32 +164,32 @@ void InodeMap::initializeFromTakeover(
   }
 
   XLOG(DBG2) << "InodeMap initialized mount " << mount_->getPath()
-             << " from takeover, " << data->unloadedInodes_.size()
+             << " from takeover, " << lock.getUnloadedInodeCount()
              << " inodes registered";
 }
 
 Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
-  // Lock the data.
+  // Lock the shard containing this inode.
   // We hold it while doing most of our work below, but explicitly unlock it
   // before triggering inode loading or before fulfilling any Promises.
-  auto data = data_.wlock();
+  auto shard = getShard(number).wlock();
 
   // Check to see if this Inode is already loaded
-  auto loadedIter = data->loadedInodes_.find(number);
-  if (loadedIter != data->loadedInodes_.end()) {
+  auto loadedIter = shard->loadedInodes_.find(number);
+  if (loadedIter != shard->loadedInodes_.end()) {
     // Make a copy of the InodePtr with the lock held, then release the lock
     // before calling makeFuture().
     //
     // This code path should be quite common, so it's better to perform
     // makeFuture()'s memory allocation without the lock held.
     auto result = loadedIter->second.getPtr();
-    data.unlock();
+    shard.unlock();
     return folly::makeFuture<InodePtr>(std::move(result));
   }
 
   // Look up the data in the unloadedInodes_ map.
-  auto unloadedIter = data->unloadedInodes_.find(number);
-  if (UNLIKELY(unloadedIter == data->unloadedInodes_.end())) {
+  auto unloadedIter = shard->unloadedInodes_.find(number);
+  if (UNLIKELY(unloadedIter == shard->unloadedInodes_.end())) {
     // This generally shouldn't happen.  If a InodeNumber has been allocated we
     // should always know about it.  It's a bug if our caller calls us with an
     // invalid InodeNumber number.
@@ -218,28 +220,32 @@ Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
   // For parents we don't find, add a promise that will trigger the lookup on
   // its necessary child.
   //
-  // (It might have been simpler to recursively call lookupInode() to get the
-  // parent, but that would require releasing and re-acquiring the lock more
-  // than necessary.)
+  // A parent may live in a different shard than its child, and we never hold
+  // two shard locks at once.  Copy out everything needed to load the child
+  // before releasing its shard and locking the parent's.  The promise we added
+  // above marks the child as loading, so nobody else will start loading it in
+  // the meantime.
   auto childInodeNumber = number;
+  auto parentNumber = unloadedData->parent;
+  PathComponent childName = unloadedData->name;
+  bool isUnlinked = unloadedData->isUnlinked;
+  auto optionalHash = unloadedData->hash;
+  auto mode = unloadedData->mode;
+  shard.unlock();
+
   while (true) {
     // Check to see if this parent is loaded
-    loadedIter = data->loadedInodes_.find(unloadedData->parent);
-    if (loadedIter != data->loadedInodes_.end()) {
+    shard = getShard(parentNumber).wlock();
+    loadedIter = shard->loadedInodes_.find(parentNumber);
+    if (loadedIter != shard->loadedInodes_.end()) {
       // We found a loaded parent.
-      // Grab copies of the arguments we need for startChildLookup(),
-      // with the lock still held.
       InodePtr firstLoadedParent = loadedIter->second.getPtr();
-      PathComponent requiredChildName = unloadedData->name;
-      bool isUnlinked = unloadedData->isUnlinked;
-      auto optionalHash = unloadedData->hash;
-      auto mode = unloadedData->mode;
-      // Unlock the data before starting the child lookup
-      data.unlock();
+      // Unlock the shard before starting the child lookup
+      shard.unlock();
       // Trigger the lookup, then return to our caller.
       startChildLookup(
           firstLoadedParent,
-          requiredChildName,
+          childName,
           isUnlinked,
           childInodeNumber,
           optionalHash,
@@ -248,14 +254,14 @@ Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
     }
 
     // Look up the parent in unloadedInodes_
-    unloadedIter = data->unloadedInodes_.find(unloadedData->parent);
-    if (UNLIKELY(unloadedIter == data->unloadedInodes_.end())) {
+    unloadedIter = shard->unloadedInodes_.find(parentNumber);
+    if (UNLIKELY(unloadedIter == shard->unloadedInodes_.end())) {
       // This shouldn't happen.  We must know about the parent inode number if
       // we knew about the child.
-      auto bug = EDEN_BUG() << "unknown parent inode " << unloadedData->parent
-                            << " (of " << unloadedData->name << ")";
-      // Unlock our data before calling inodeLoadFailed()
-      data.unlock();
+      auto bug = EDEN_BUG() << "unknown parent inode " << parentNumber
+                            << " (of " << childName << ")";
+      // Unlock the shard before calling inodeLoadFailed()
+      shard.unlock();
       inodeLoadFailed(childInodeNumber, bug.toException());
       return result;
     }
@@ -269,11 +275,11 @@ Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
     parentData->promises.emplace_back();
     setupParentLookupPromise(
         parentData->promises.back(),
-        unloadedData->name,
-        unloadedData->isUnlinked,
+        childName,
+        isUnlinked,
         childInodeNumber,
-        unloadedData->hash,
-        unloadedData->mode);
+        optionalHash,
+        mode);
 
     if (alreadyLoading) {
       // This parent is already being loaded.
@@ -282,8 +288,13 @@ Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
     }
 
     // Continue around the loop to look up our parent's parent
-    childInodeNumber = unloadedData->parent;
-    unloadedData = parentData;
+    childInodeNumber = parentNumber;
+    parentNumber = parentData->parent;
+    childName = parentData->name;
+    isUnlinked = parentData->isUnlinked;
+    optionalHash = parentData->hash;
+    mode = parentData->mode;
+    shard.unlock();
   }
 }
 
@@ -344,9 +355,9 @@ InodeMap::PromiseVector InodeMap::inodeLoadComplete(InodeBase* inode) {
 
   PromiseVector promises;
   try {
-    auto data = data_.wlock();
-    auto it = data->unloadedInodes_.find(number);
-    CHECK(it != data->unloadedInodes_.end())
+    auto shard = getShard(number).wlock();
+    auto it = shard->unloadedInodes_.find(number);
+    CHECK(it != shard->unloadedInodes_.end())
         << "failed to find unloaded inode data when finishing load of inode "
         << number;
     swap(promises, it->second.promises);
@@ -354,8 +365,8 @@ InodeMap::PromiseVector InodeMap::inodeLoadComplete(InodeBase* inode) {
     inode->setFuseRefcount(it->second.numFuseReferences);
 
     // Insert the entry into loadedInodes_, and remove it from unloadedInodes_
-    data->loadedInodes_.emplace(number, inode);
-    data->unloadedInodes_.erase(it);
+    shard->loadedInodes_.emplace(number, inode);
+    shard->unloadedInodes_.erase(it);
     return promises;
   } catch (const std::exception& ex) {
     XLOG(ERR) << "error marking inode " << number
@@ -382,9 +393,9 @@ void InodeMap::inodeLoadFailed(
 InodeMap::PromiseVector InodeMap::extractPendingPromises(InodeNumber number) {
   PromiseVector promises;
   {
-    auto data = data_.wlock();
-    auto it = data->unloadedInodes_.find(number);
-    CHECK(it != data->unloadedInodes_.end())
+    auto shard = getShard(number).wlock();
+    auto it = shard->unloadedInodes_.find(number);
+    CHECK(it != shard->unloadedInodes_.end())
         << "failed to find unloaded inode data when finishing load of inode "
         << number;
     swap(promises, it->second.promises);
@@ -403,9 +414,9 @@ Future<FileInodePtr> InodeMap::lookupFileInode(InodeNumber number) {
 }
 
 InodePtr InodeMap::lookupLoadedInode(InodeNumber number) {
-  auto data = data_.rlock();
-  auto it = data->loadedInodes_.find(number);
-  if (it == data->loadedInodes_.end()) {
+  auto shard = getShard(number).rlock();
+  auto it = shard->loadedInodes_.find(number);
+  if (it == shard->loadedInodes_.end()) {
     return nullptr;
   }
   return it->second.getPtr();
@@ -428,36 +439,34 @@ FileInodePtr InodeMap::lookupLoadedFile(InodeNumber number) {
 }
 
 std::optional<RelativePath> InodeMap::getPathForInode(InodeNumber inodeNumber) {
-  auto data = data_.rlock();
-  return getPathForInodeHelper(inodeNumber, data);
-}
-
-std::optional<RelativePath> InodeMap::getPathForInodeHelper(
-    InodeNumber inodeNumber,
-    const folly::Synchronized<Members>::ConstLockedPtr& data) {
-  auto loadedIt = data->loadedInodes_.find(inodeNumber);
-  if (loadedIt != data->loadedInodes_.cend()) {
+  auto shard = getShard(inodeNumber).rlock();
+  auto loadedIt = shard->loadedInodes_.find(inodeNumber);
+  if (loadedIt != shard->loadedInodes_.cend()) {
     // If the inode is loaded, return its RelativePath
     return loadedIt->second->getPath();
   } else {
-    auto unloadedIt = data->unloadedInodes_.find(inodeNumber);
-    if (unloadedIt != data->unloadedInodes_.cend()) {
+    auto unloadedIt = shard->unloadedInodes_.find(inodeNumber);
+    if (unloadedIt != shard->unloadedInodes_.cend()) {
       if (unloadedIt->second.isUnlinked) {
         return std::nullopt;
       }
       // If the inode is not loaded, return its parent's path as long as it's
       // parent isn't the root
       auto parent = unloadedIt->second.parent;
+      PathComponent name = unloadedIt->second.name;
+      // The parent may be in a different shard, so release this shard's lock
+      // before recursing.
+      shard.unlock();
       if (parent == kRootNodeId) {
         // The parent is the Eden mount root, just return its name (base case)
-        return RelativePath(unloadedIt->second.name);
+        return RelativePath(name);
       }
-      auto dir = getPathForInodeHelper(parent, data);
+      auto dir = getPathForInode(parent);
       if (!dir) {
         EDEN_BUG() << "unlinked parent inode " << parent
                    << "appears to contain non-unlinked child " << inodeNumber;
       }
-      return *dir + unloadedIt->second.name;
+      return *dir + name;
     } else {
       throwSystemErrorExplicit(EINVAL, "unknown inode number ", inodeNumber);
     }
@@ -465,11 +474,11 @@ std::optional<RelativePath> InodeMap::getPathForInodeHelper(
 }
 
 void InodeMap::decFuseRefcount(InodeNumber number, uint32_t count) {
-  auto data = data_.wlock();
+  auto shard = getShard(number).wlock();
 
   // First check in the loaded inode map
-  auto loadedIter = data->loadedInodes_.find(number);
-  if (loadedIter != data->loadedInodes_.end()) {
+  auto loadedIter = shard->loadedInodes_.find(number);
+  if (loadedIter != shard->loadedInodes_.end()) {
     // Acquire an InodePtr, so that we are always holding a pointer reference
     // on the inode when we decrement the fuse refcount.
     //
@@ -479,14 +488,14 @@ void InodeMap::decFuseRefcount(InodeNumber number, uint32_t count) {
     auto inode = loadedIter->second.getPtr();
     // Now release our lock before decrementing the inode's FUSE reference
     // count and immediately releasing our pointer reference.
-    data.unlock();
+    shard.unlock();
     inode->decFuseRefcount(count);
     return;
   }
 
   // If it wasn't loaded, it should be in the unloaded map
-  auto unloadedIter = data->unloadedInodes_.find(number);
-  if (UNLIKELY(unloadedIter == data->unloadedInodes_.end())) {
+  auto unloadedIter = shard->unloadedInodes_.find(number);
+  if (UNLIKELY(unloadedIter == shard->unloadedInodes_.end())) {
     EDEN_BUG() << "InodeMap::decFuseRefcount() called on unknown inode number "
                << number;
   }
@@ -499,30 +508,30 @@ void InodeMap::decFuseRefcount(InodeNumber number, uint32_t count) {
     // We can completely forget about this unloaded inode now.
     XLOG(DBG5) << "forgetting unloaded inode " << number << ": "
                << unloadedEntry.parent << ":" << unloadedEntry.name;
-    data->unloadedInodes_.erase(unloadedIter);
+    shard->unloadedInodes_.erase(unloadedIter);
   }
 }
 
 void InodeMap::setUnmounted() {
-  auto data = data_.wlock();
-  DCHECK(!data->isUnmounted_);
-  data->isUnmounted_ = true;
+  auto lock = lockAllShards();
+  DCHECK(!isUnmounted_);
+  isUnmounted_ = true;
 }
 
 Future<SerializedInodeMap> InodeMap::shutdown(bool doTakeover) {
   // Record that we are in the process of shutting down.
   auto future = Future<folly::Unit>::makeEmpty();
   {
-    auto data = data_.wlock();
-    CHECK(!data->shutdownPromise.has_value())
+    auto lock = lockAllShards();
+    CHECK(!shutdownPromise_.has_value())
         << "shutdown() invoked more than once on InodeMap for "
         << mount_->getPath();
-    data->shutdownPromise.emplace(Promise<Unit>{});
-    future = data->shutdownPromise->getFuture();
+    shutdownPromise_.emplace(Promise<Unit>{});
+    future = shutdownPromise_->getFuture();
 
     XLOG(DBG3) << "starting InodeMap::shutdown: loadedCount="
-               << data->loadedInodes_.size()
-               << " unloadedCount=" << data->unloadedInodes_.size();
+               << lock.getLoadedInodeCount()
+               << " unloadedCount=" << lock.getUnloadedInodeCount();
   }
 
   // If an error occurs during mount point initialization, shutdown() can be
@@ -559,19 +568,21 @@ Future<SerializedInodeMap> InodeMap::shutdown(bool doTakeover) {
     // to them, then let the normal pointer release process be responsible for
     // unloading them.
     std::vector<InodePtr> inodesToUnload;
-    auto data = data_.wlock();
-    for (const auto& entry : data->loadedInodes_) {
-      if (!entry.second->isPtrAcquireCountZero()) {
-        continue;
-      }
-      if (!entry.second->isUnlinked()) {
-        continue;
+    auto lock = lockAllShards();
+    for (auto& shard : lock.shards_) {
+      for (const auto& entry : shard->loadedInodes_) {
+        if (!entry.second->isPtrAcquireCountZero()) {
+          continue;
+        }
+        if (!entry.second->isUnlinked()) {
+          continue;
+        }
+        inodesToUnload.push_back(entry.second.getPtr());
       }
-      inodesToUnload.push_back(entry.second.getPtr());
     }
-    // Release the lock, then release all of our InodePtrs to unload
+    // Release the locks, then release all of our InodePtrs to unload
     // the inodes.
-    data.unlock();
+    lock.unlock();
     inodesToUnload.clear();
   }
 
@@ -587,45 +598,47 @@ Future<SerializedInodeMap> InodeMap::shutdown(bool doTakeover) {
     if (!doTakeover) {
       return SerializedInodeMap{};
     }
-    auto data = data_.wlock();
+    auto lock = lockAllShards();
+    auto loadedCount = lock.getLoadedInodeCount();
+    auto unloadedCount = lock.getUnloadedInodeCount();
     XLOG(DBG3)
         << "InodeMap::shutdown after releasing inodesToClear: loadedCount="
-        << data->loadedInodes_.size()
-        << " unloadedCount=" << data->unloadedInodes_.size();
+        << loadedCount << " unloadedCount=" << unloadedCount;
 
-    if (data->loadedInodes_.size() != 1) {
-      EDEN_BUG() << "After InodeMap::shutdown() finished, "
-                 << data->loadedInodes_.size()
+    if (loadedCount != 1) {
+      EDEN_BUG() << "After InodeMap::shutdown() finished, " << loadedCount
                  << " inodes still loaded; they must all (except the root) "
                  << "have been unloaded for this to succeed!";
     }
 
     SerializedInodeMap result;
-    result.unloadedInodes.reserve(data->unloadedInodes_.size());
-    for (const auto& it : data->unloadedInodes_) {
-      const auto& entry = it.second;
-      SerializedInodeMapEntry serializedEntry;
-
-      XLOG(DBG5) << "  serializing unloaded inode " << entry.number.get()
-                 << " parent=" << entry.parent.get() << " name=" << entry.name;
-
-      serializedEntry.inodeNumber = entry.number.get();
-      serializedEntry.parentInode = entry.parent.get();
-      serializedEntry.name = entry.name.stringPiece().str();
-      serializedEntry.isUnlinked = entry.isUnlinked;
-      serializedEntry.numFuseReferences = entry.numFuseReferences;
-      serializedEntry.hash = thriftHash(entry.hash);
-      serializedEntry.mode = entry.mode;
-
-      result.unloadedInodes.emplace_back(std::move(serializedEntry));
+    result.unloadedInodes.reserve(unloadedCount);
+    for (const auto& shard : lock.shards_) {
+      for (const auto& it : shard->unloadedInodes_) {
+        const auto& entry = it.second;
+        SerializedInodeMapEntry serializedEntry;
+
+        XLOG(DBG5) << "  serializing unloaded inode " << entry.number.get()
+                   << " parent=" << entry.parent.get()
+                   << " name=" << entry.name;
+
+        serializedEntry.inodeNumber = entry.number.get();
+        serializedEntry.parentInode = entry.parent.get();
+        serializedEntry.name = entry.name.stringPiece().str();
+        serializedEntry.isUnlinked = entry.isUnlinked;
+        serializedEntry.numFuseReferences = entry.numFuseReferences;
+        serializedEntry.hash = thriftHash(entry.hash);
+        serializedEntry.mode = entry.mode;
+
+        result.unloadedInodes.emplace_back(std::move(serializedEntry));
+      }
     }
 
     return result;
   });
 }
 
-void InodeMap::shutdownComplete(
-    folly::Synchronized<Members>::LockedPtr&& data) {
+void InodeMap::shutdownComplete(InodeMapLock&& lock) {
   // We manually dropped our reference count to the root inode in
   // beginShutdown().  Destroy it now, and call resetNoDecRef() on our pointer
   // to make sure it doesn't try to decrement the reference count again when
@@ -633,16 +646,16 @@ void InodeMap::shutdownComplete(
   delete root_.get();
   root_.resetNoDecRef();
 
-  // Unlock data_ before fulfilling the shutdown promise, just in case the
+  // Unlock the shards before fulfilling the shutdown promise, just in case the
   // promise invokes a callback that calls some of our other methods that
-  // may need to acquire this lock.
-  auto* shutdownPromise = &data->shutdownPromise.value();
-  data.unlock();
+  // may need to acquire these locks.
+  auto* shutdownPromise = &shutdownPromise_.value();
+  lock.unlock();
   shutdownPromise->setValue();
 }
 
 bool InodeMap::isInodeRemembered(InodeNumber ino) const {
-  return data_.rlock()->unloadedInodes_.count(ino) > 0;
+  return getShard(ino).rlock()->unloadedInodes_.count(ino) > 0;
 }
 
 void InodeMap::onInodeUnreferenced(
@@ -651,7 +664,19 @@ void InodeMap::onInodeUnreferenced(
   XLOG(DBG5) << "inode " << inode->getNodeId()
              << " unreferenced: " << inode->getLogPath();
   // Acquire our lock.
-  auto data = data_.wlock();
+  //
+  // Unloading an inode requires every shard lock, but most of the time we
+  // only need to decrement the acquire count, which just requires the lock on
+  // this inode's shard.  We may unload the inode here only if it is unlinked
+  // or we are shutting down.  isUnlinked() cannot change while we hold the
+  // ParentInodeInfo, and shutdownPromise_ cannot change while we hold any
+  // shard lock, so once we have a lock we know whether it is sufficient.
+  auto lock = parentInfo.isUnlinked() ? lockAllShards()
+                                      : lockShard(inode->getNodeId());
+  if (!lock.holdsAllShards() && shutdownPromise_.has_value()) {
+    lock.unlock();
+    lock = lockAllShards();
+  }
 
   // Decrement the Inode's acquire count
   auto acquireCount = inode->decPtrAcquireCount();
@@ -663,13 +688,13 @@ void InodeMap::onInodeUnreferenced(
 
   // Decide if we should unload the inode now, or wait until later.
   bool unloadNow = false;
-  bool shuttingDown = data->shutdownPromise.has_value();
+  bool shuttingDown = shutdownPromise_.has_value();
   DCHECK(shuttingDown || inode != root_.get());
   if (shuttingDown) {
     // Check to see if this was the root inode that got unloaded.
     // This indicates that the shutdown is complete.
     if (inode == root_.get()) {
-      shutdownComplete(std::move(data));
+      shutdownComplete(std::move(lock));
       return;
     }
 
@@ -693,7 +718,7 @@ void InodeMap::onInodeUnreferenced(
         parentInfo.getParent().get(),
         parentInfo.getName(),
         parentInfo.isUnlinked(),
-        data);
+        lock);
     if (!parentInfo.isUnlinked()) {
       const auto& parentContents = parentInfo.getParentContents();
       auto it = parentContents->entries.find(parentInfo.getName());
@@ -707,7 +732,7 @@ void InodeMap::onInodeUnreferenced(
   // Deleting it may cause its parent TreeInode to become unreferenced, causing
   // another recursive call to onInodeUnreferenced(), which will need to
   // reacquire the lock.
-  data.unlock();
+  lock.unlock();
   parentInfo.reset();
   if (unloadNow) {
     delete inode;
@@ -715,16 +740,22 @@ void InodeMap::onInodeUnreferenced(
 }
 
 InodeMapLock InodeMap::lockForUnload() {
-  return InodeMapLock{data_.wlock()};
+  return lockAllShards();
 }
 
-void InodeMap::unloadInode(
-    InodeBase* inode,
-    TreeInode* parent,
-    PathComponentPiece name,
-    bool isUnlinked,
-    const InodeMapLock& lock) {
-  return unloadInode(inode, parent, name, isUnlinked, lock.data_);
+InodeMapLock InodeMap::lockAllShards() {
+  InodeMapLock lock;
+  for (size_t n = 0; n < kShardCount; ++n) {
+    lock.shards_[n] = shards_[n]->wlock();
+  }
+  lock.holdsAllShards_ = true;
+  return lock;
+}
+
+InodeMapLock InodeMap::lockShard(InodeNumber number) {
+  InodeMapLock lock;
+  lock.shards_[getShardIndex(number)] = getShard(number).wlock();
+  return lock;
 }
 
 void InodeMap::unloadInode(
@@ -732,21 +763,24 @@ void InodeMap::unloadInode(
     TreeInode* parent,
     PathComponentPiece name,
     bool isUnlinked,
-    const folly::Synchronized<Members>::LockedPtr& data) {
+    const InodeMapLock& lock) {
+  DCHECK(lock.holdsAllShards());
+  auto& shard = lock.getShard(inode->getNodeId());
+
   // Call updateOverlayForUnload() to update the overlay and compute
   // if we need to remember an UnloadedInode entry.
   auto unloadedEntry =
-      updateOverlayForUnload(inode, parent, name, isUnlinked, data);
+      updateOverlayForUnload(inode, parent, name, isUnlinked, lock);
   if (unloadedEntry) {
     // Insert the unloaded entry
     XLOG(DBG7) << "inserting unloaded map entry for inode "
                << inode->getNodeId();
-    auto ret = data->unloadedInodes_.emplace(
+    auto ret = shard.unloadedInodes_.emplace(
         inode->getNodeId(), std::move(unloadedEntry.value()));
     CHECK(ret.second);
   }
 
-  auto numErased = data->loadedInodes_.erase(inode->getNodeId());
+  auto numErased = shard.loadedInodes_.erase(inode->getNodeId());
   CHECK_EQ(numErased, 1) << "inconsistent loaded inodes data: "
                          << inode->getLogPath();
 }
@@ -756,9 +790,9 @@ optional<InodeMap::UnloadedInode> InodeMap::updateOverlayForUnload(
     TreeInode* parent,
     PathComponentPiece name,
     bool isUnlinked,
-    const folly::Synchronized<Members>::LockedPtr& data) {
+    const InodeMapLock& lock) {
   auto fuseCount = inode->getFuseRefcount();
-  if (isUnlinked && (data->isUnmounted_ || fuseCount == 0)) {
+  if (isUnlinked && (isUnmounted_ || fuseCount == 0)) {
     try {
       mount_->getOverlay()->removeOverlayData(inode->getNodeId());
     } catch (const std::exception& ex) {
@@ -781,7 +815,7 @@ optional<InodeMap::UnloadedInode> InodeMap::updateOverlayForUnload(
   // refcounts on inodes that still existed before it was unmounted.
   // Everything is unreferenced by FUSE after an unmount operation, and we no
   // longer need to remember anything in the unloadedInodes_ map.
-  if (data->isUnmounted_) {
+  if (isUnmounted_) {
     XLOG(DBG5) << "forgetting unreferenced inode " << inode->getNodeId()
                << " after unmount: " << inode->getLogPath();
     return std::nullopt;
@@ -797,15 +831,15 @@ optional<InodeMap::UnloadedInode> InodeMap::updateOverlayForUnload(
 
   auto* asTree = dynamic_cast<TreeInode*>(inode);
   if (asTree) {
-    // Normally, acquiring the tree's contents lock while the InodeMap members
-    // lock is held violates our lock hierarchy.  However, since this TreeInode
+    // Normally, acquiring the tree's contents lock while the InodeMap shard
+    // locks are held violates our lock hierarchy.  However, since this TreeInode
     // is being unloaded, nobody else can reference it right now, so the lock is
     // guaranteed not held.  Another option is to acquire the TreeInode's lock
     // prior to calling unloadInode and pass an optional TreeInode::Dir into
     // this function.  We could even add an unsafe "I'm in the ctor or dtor so
     // there cannot be any contention" accessor to folly::Synchronized to avoid
     // needing to acquire the lock.
-    auto treeContentsLock = asTree->getContents().wlock(0s);
+    auto treeContentsLock = asTree->getContentsMaybeUnbuilt().wlock(0s);
     CHECK(treeContentsLock)
         << "TreeInode::Dir lock was held prior to unloadInode!";
 
@@ -824,11 +858,13 @@ optional<InodeMap::UnloadedInode> InodeMap::updateOverlayForUnload(
     }
 
     // If any of this inode's childrens are in unloadedInodes_, then this
-    // inode, as its parent, must not be forgotten.
+    // inode, as its parent, must not be forgotten.  The children may be in
+    // any shard, which is why unloading requires every shard lock.
     for (const auto& pair : treeContentsLock->entries) {
       const auto& childName = pair.first;
       const auto& entry = pair.second;
-      if (data->unloadedInodes_.count(entry.getInodeNumber())) {
+      auto childNumber = entry.getInodeNumber();
+      if (lock.getShard(childNumber).unloadedInodes_.count(childNumber)) {
         XLOG(DBG5) << "remembering inode " << asTree->getNodeId() << " ("
                    << asTree->getLogPath() << ") because its child "
                    << childName << " was remembered";
@@ -863,14 +899,14 @@ bool InodeMap::shouldLoadChild(
     PathComponentPiece name,
     InodeNumber childInode,
     folly::Promise<InodePtr> promise) {
-  auto data = data_.wlock();
-  auto iter = data->unloadedInodes_.find(childInode);
+  auto shard = getShard(childInode).wlock();
+  auto iter = shard->unloadedInodes_.find(childInode);
   UnloadedInode* unloadedData{nullptr};
-  if (iter == data->unloadedInodes_.end()) {
+  if (iter == shard->unloadedInodes_.end()) {
     InodeNumber parentNumber = parent->getNodeId();
     auto newUnloadedData = UnloadedInode(childInode, parentNumber, name);
     auto ret =
-        data->unloadedInodes_.emplace(childInode, std::move(newUnloadedData));
+        shard->unloadedInodes_.emplace(childInode, std::move(newUnloadedData));
     DCHECK(ret.second);
     unloadedData = &ret.first->second;
   } else {
@@ -892,27 +928,45 @@ bool InodeMap::shouldLoadChild(
 void InodeMap::inodeCreated(const InodePtr& inode) {
   XLOG(DBG4) << "created new inode " << inode->getNodeId() << ": "
              << inode->getLogPath();
-  auto data = data_.wlock();
-  data->loadedInodes_.emplace(inode->getNodeId(), inode.get());
+  auto shard = getShard(inode->getNodeId()).wlock();
+  shard->loadedInodes_.emplace(inode->getNodeId(), inode.get());
 }
 
 InodeMap::LoadedInodeCounts InodeMap::getLoadedInodeCounts() const {
   LoadedInodeCounts counts;
-  auto data = data_.rlock();
-  for (const auto& entry : data->loadedInodes_) {
-    if (entry.second->getType() == dtype_t::Dir) {
-      ++counts.treeCount;
-    } else {
-      ++counts.fileCount;
+  for (const auto& shard : shards_) {
+    auto data = shard->rlock();
+    for (const auto& entry : data->loadedInodes_) {
+      if (entry.second->getType() == dtype_t::Dir) {
+        ++counts.treeCount;
+      } else {
+        ++counts.fileCount;
+      }
     }
   }
   return counts;
 }
 
+size_t InodeMap::getLoadedInodeCount() const {
+  size_t count = 0;
+  for (const auto& shard : shards_) {
+    count += shard->rlock()->loadedInodes_.size();
+  }
+  return count;
+}
+
+size_t InodeMap::getUnloadedInodeCount() const {
+  size_t count = 0;
+  for (const auto& shard : shards_) {
+    count += shard->rlock()->unloadedInodes_.size();
+  }
+  return count;
+}
+
 std::vector<InodeNumber> InodeMap::getReferencedInodes() const {
   std::vector<InodeNumber> inodes;
-  {
-    auto data = data_.rlock();
+  for (const auto& shard : shards_) {
+    auto data = shard->rlock();
 
     for (auto& kv : data->loadedInodes_) {
       auto& loadedInode = kv.second;
@@ -931,5 +985,23 @@ std::vector<InodeNumber> InodeMap::getReferencedInodes() const {
 
   return inodes;
 }
+
+size_t InodeMapLock::getLoadedInodeCount() const {
+  DCHECK(holdsAllShards_);
+  size_t count = 0;
+  for (const auto& shard : shards_) {
+    count += shard->loadedInodes_.size();
+  }
+  return count;
+}
+
+size_t InodeMapLock::getUnloadedInodeCount() const {
+  DCHECK(holdsAllShards_);
+  size_t count = 0;
+  for (const auto& shard : shards_) {
+    count += shard->unloadedInodes_.size();
+  }
+  return count;
+}
 } // namespace eden
 } // namespace facebook
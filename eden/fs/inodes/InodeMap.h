@@ -9,12 +9,14 @@
  */
 #pragma once
 
+#include <folly/CachelinePadded.h>
 #include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
 #include <folly/futures/Future.h>
+#include <array>
 #include <list>
 #include <memory>
 #include <optional>
-#include <unordered_map>
 
 #include "eden/fs/fuse/FuseChannel.h"
 #include "eden/fs/inodes/InodePtr.h"
@@ -98,6 +100,18 @@ class InodeMapLock;
  *
  *   We currently always allocate a InodeNumber value for any new Inode object
  *   even if it is not needed yet by the FUSE APIs.
+ *
+ * Locking:
+ * - Both maps are split into kShardCount shards keyed by inode number, and
+ *   each shard has its own lock.  Most operations touch a single inode and
+ *   only lock the shard that owns it, so FUSE requests for unrelated inodes do
+ *   not contend with each other.
+ * - At most one shard lock is held at a time, except when all shards are
+ *   locked together through lockAllShards().  That always acquires the shard
+ *   locks in index order.
+ * - Unloading an inode may need to inspect the entries of its children, which
+ *   can live in any shard, so unloading is always done with every shard
+ *   locked.
  */
 class InodeMap {
  public:
@@ -375,12 +389,14 @@ class InodeMap {
    */
   LoadedInodeCounts getLoadedInodeCounts() const;
 
-  size_t getLoadedInodeCount() const {
-    return data_.rlock()->loadedInodes_.size();
-  }
-  size_t getUnloadedInodeCount() const {
-    return data_.rlock()->unloadedInodes_.size();
-  }
+  /**
+   * Return the number of loaded and unloaded inodes.
+   *
+   * The shards are counted one at a time, so the result is not an atomic
+   * snapshot if the InodeMap is being modified concurrently.
+   */
+  size_t getLoadedInodeCount() const;
+  size_t getUnloadedInodeCount() const;
 
   /*
    * Return all referenced inodes (loaded and unloaded inodes whose
@@ -453,7 +469,7 @@ class InodeMap {
      *
      * (We could use folly::SharedPromise here instead, but it has extra
      * overhead that we don't really need.  It performs its own locking, but we
-     * are already protected by the data_ lock.)
+     * are already protected by the shard lock.)
      */
     PromiseVector promises;
     /**
@@ -478,7 +494,7 @@ class InodeMap {
 
     InodePtr getPtr() const {
       // Calling InodePtr::newPtrLocked is safe because interacting with
-      // LoadedInode implies the data_ lock is held.
+      // LoadedInode implies the lock on the shard containing it is held.
       return InodePtr::newPtrLocked(inode_);
     }
 
@@ -497,48 +513,56 @@ class InodeMap {
     InodeBase* inode_{nullptr};
   };
 
-  struct Members {
+  struct Shard {
     /**
-     * The map of loaded inodes
+     * The map of loaded inodes in this shard
      *
      * This map stores raw pointers rather than InodePtr objects.  The InodeMap
      * itself does not hold a reference to the Inode objects.  When an Inode is
      * looked up the InodeMap will wrap the Inode in an InodePtr so that the
      * caller acquires a reference.
      */
-    std::unordered_map<InodeNumber, LoadedInode> loadedInodes_;
+    folly::F14FastMap<InodeNumber, LoadedInode> loadedInodes_;
 
     /**
-     * The map of currently unloaded inodes
+     * The map of currently unloaded inodes in this shard
      */
-    std::unordered_map<InodeNumber, UnloadedInode> unloadedInodes_;
+    folly::F14NodeMap<InodeNumber, UnloadedInode> unloadedInodes_;
+  };
 
-    /**
-     * Indicates if the FUSE mount point has been unmounted.
-     *
-     * If this is true then the FUSE refcount on all inodes should be treated
-     * as 0, and we can forget all inodes while shutting down.
-     */
-    bool isUnmounted_{false};
+  /**
+   * The number of independently locked shards.
+   *
+   * Inode numbers are allocated sequentially, so taking the number modulo the
+   * shard count spreads inodes evenly across the shards.
+   */
+  static constexpr size_t kShardCount = 32;
 
-    /**
-     * A promise to fulfill once shutdown() completes.
-     *
-     * This is only initialized when shutdown() is called, and will be
-     * std::nullopt until we are shutting down.
-     *
-     * In the future we could update this to just use an empty promise to
-     * indicate that we are not shutting down yet.  However, currently
-     * folly::Promise does not have a simple API to check if it is empty or not,
-     * so we have to wrap it in a std::optional.
-     */
-    std::optional<folly::Promise<folly::Unit>> shutdownPromise;
-  };
+  static size_t getShardIndex(InodeNumber number) {
+    return number.get() % kShardCount;
+  }
+
+  folly::Synchronized<Shard>& getShard(InodeNumber number) {
+    return *shards_[getShardIndex(number)];
+  }
+  const folly::Synchronized<Shard>& getShard(InodeNumber number) const {
+    return *shards_[getShardIndex(number)];
+  }
+
+  /**
+   * Lock every shard, in index order.
+   */
+  InodeMapLock lockAllShards();
+
+  /**
+   * Lock only the shard containing the specified inode number.
+   */
+  InodeMapLock lockShard(InodeNumber number);
 
   InodeMap(InodeMap const&) = delete;
   InodeMap& operator=(InodeMap const&) = delete;
 
-  void shutdownComplete(folly::Synchronized<Members>::LockedPtr&& data);
+  void shutdownComplete(InodeMapLock&& lock);
 
   void setupParentLookupPromise(
       folly::Promise<InodePtr>& promise,
@@ -559,31 +583,11 @@ class InodeMap {
    * Extract the list of promises waiting on the specified inode number to be
    * loaded.
    *
-   * This method acquires the data_ lock internally.
-   * It should never be called while already holding the lock.
+   * This method acquires the shard lock internally.
+   * It should never be called while already holding any shard lock.
    */
   PromiseVector extractPendingPromises(InodeNumber number);
 
-  std::optional<RelativePath> getPathForInodeHelper(
-      InodeNumber inodeNumber,
-      const folly::Synchronized<Members>::ConstLockedPtr& data);
-
-  /**
-   * Unload an inode
-   *
-   * This simply removes it from the loadedInodes_ map and, if it is still
-   * referenced by FUSE, adds it to the unloadedInodes_ map.
-   *
-   * The caller is responsible for actually deleting the Inode object after
-   * releasing the InodeMap lock.
-   */
-  void unloadInode(
-      InodeBase* inode,
-      TreeInode* parent,
-      PathComponentPiece name,
-      bool isUnlinked,
-      const folly::Synchronized<Members>::LockedPtr& lock);
-
   /**
    * Update the overlay data for an inode before unloading it.
    * This is called as the first step of unloadInode().
@@ -596,7 +600,7 @@ class InodeMap {
       TreeInode* parent,
       PathComponentPiece name,
       bool isUnlinked,
-      const folly::Synchronized<Members>::LockedPtr& lock);
+      const InodeMapLock& lock);
 
   /**
    * The EdenMount that owns this InodeMap.
@@ -612,16 +616,43 @@ class InodeMap {
   TreeInodePtr root_;
 
   /**
-   * The locked data.
+   * The locked data, split into shards by inode number.
    *
-   * Note: be very careful to hold this lock only when necessary.  No other
-   * locks should be acquired when holding this lock.  In particular this means
-   * that we should never access any InodeBase objects while holding the lock,
-   * since we should not hold our lock while an InodeBase acquires its own
+   * Note: be very careful to hold these locks only when necessary.  No other
+   * locks should be acquired when holding a shard lock.  In particular this
+   * means that we should never access any InodeBase objects while holding the
+   * lock, since we should not hold our lock while an InodeBase acquires its own
    * internal lock.  (This makes it safe for InodeBase to perform operations on
    * the InodeMap while holding their own lock.)
    */
-  folly::Synchronized<Members> data_;
+  std::array<folly::CachelinePadded<folly::Synchronized<Shard>>, kShardCount>
+      shards_;
+
+  /**
+   * Indicates if the FUSE mount point has been unmounted.
+   *
+   * If this is true then the FUSE refcount on all inodes should be treated
+   * as 0, and we can forget all inodes while shutting down.
+   *
+   * This is only modified while holding every shard lock, so it may be read
+   * while holding any one of them.
+   */
+  bool isUnmounted_{false};
+
+  /**
+   * A promise to fulfill once shutdown() completes.
+   *
+   * This is only initialized when shutdown() is called, and will be
+   * std::nullopt until we are shutting down.
+   *
+   * In the future we could update this to just use an empty promise to
+   * indicate that we are not shutting down yet.  However, currently
+   * folly::Promise does not have a simple API to check if it is empty or not,
+   * so we have to wrap it in a std::optional.
+   *
+   * Like isUnmounted_, this is only modified while holding every shard lock.
+   */
+  std::optional<folly::Promise<folly::Unit>> shutdownPromise_;
 };
 
 /**
@@ -629,21 +660,46 @@ class InodeMap {
  * in order to make multiple calls to unloadInode() without releasing and
  * re-acquiring the lock.
  *
+ * This holds either every shard lock, or just the lock for a single shard.
+ * The locks returned by lockForUnload() always cover every shard.
+ *
  * This mostly exists to make forward declarations simpler.
  */
 class InodeMapLock {
  public:
-  explicit InodeMapLock(
-      folly::Synchronized<InodeMap::Members>::LockedPtr&& data)
-      : data_(std::move(data)) {}
+  InodeMapLock(InodeMapLock&&) = default;
+  InodeMapLock& operator=(InodeMapLock&&) = default;
 
   void unlock() {
-    data_.unlock();
+    for (auto& shard : shards_) {
+      if (!shard.isNull()) {
+        shard.unlock();
+      }
+    }
+    holdsAllShards_ = false;
   }
 
  private:
   friend class InodeMap;
-  folly::Synchronized<InodeMap::Members>::LockedPtr data_;
+  using ShardLock = folly::Synchronized<InodeMap::Shard>::LockedPtr;
+
+  InodeMapLock() = default;
+
+  bool holdsAllShards() const {
+    return holdsAllShards_;
+  }
+
+  InodeMap::Shard& getShard(InodeNumber number) const {
+    const auto& shard = shards_[InodeMap::getShardIndex(number)];
+    DCHECK(!shard.isNull()) << "shard for inode " << number << " is not locked";
+    return *shard;
+  }
+
+  size_t getLoadedInodeCount() const;
+  size_t getUnloadedInodeCount() const;
+
+  std::array<ShardLock, InodeMap::kShardCount> shards_;
+  bool holdsAllShards_{false};
 };
 } // namespace eden
 } // namespace facebook
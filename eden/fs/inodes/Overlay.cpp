@@ -143,13 +143,38 @@ InodeNumber Overlay::allocateInodeNumber() {
   return InodeNumber{previous};
 }
 
+InodeNumber Overlay::allocateInodeNumbers(size_t count) {
+  DCHECK_GT(count, 0);
+  auto previous = nextInodeNumber_.fetch_add(count);
+  DCHECK_NE(0, previous) << "allocateInodeNumbers called before initialize";
+  return InodeNumber{previous};
+}
+
 optional<DirContents> Overlay::loadOverlayDir(InodeNumber inodeNumber) {
   auto dirData = fsOverlay_.loadOverlayDir(inodeNumber);
   if (!dirData.has_value()) {
     return std::nullopt;
   }
+  return parseOverlayDir(inodeNumber, dirData.value());
+}
+
+optional<Overlay::UnmaterializedDir> Overlay::loadUnmaterializedDir(
+    InodeNumber inodeNumber) {
+  auto dirData = fsOverlay_.loadOverlayDir(inodeNumber);
+  if (!dirData.has_value()) {
+    return std::nullopt;
+  }
   const auto& dir = dirData.value();
+  if (dir.__isset.firstChildInodeNumber) {
+    return UnmaterializedDir{InodeNumber::fromThrift(
+        dir.firstChildInodeNumber_ref().value_unchecked())};
+  }
+  return UnmaterializedDir{parseOverlayDir(inodeNumber, dir)};
+}
 
+DirContents Overlay::parseOverlayDir(
+    InodeNumber inodeNumber,
+    const overlay::OverlayDir& dir) {
   bool shouldMigrateToNewFormat = false;
 
   DirContents result;
@@ -180,7 +205,7 @@ optional<DirContents> Overlay::loadOverlayDir(InodeNumber inodeNumber) {
     saveOverlayDir(inodeNumber, result);
   }
 
-  return std::move(result);
+  return result;
 }
 
 void Overlay::saveOverlayDir(InodeNumber inodeNumber, const DirContents& dir) {
@@ -223,6 +248,22 @@ void Overlay::saveOverlayDir(InodeNumber inodeNumber, const DirContents& dir) {
   fsOverlay_.saveOverlayDir(inodeNumber, odir);
 }
 
+void Overlay::saveChildInodeNumbers(
+    InodeNumber inodeNumber,
+    InodeNumber firstChild,
+    size_t count) {
+  auto nextInodeNumber = nextInodeNumber_.load(std::memory_order_relaxed);
+  CHECK_LT(inodeNumber.get(), nextInodeNumber)
+      << "saveChildInodeNumbers called with unallocated inode number";
+  CHECK(count == 0 || firstChild.get() + count <= nextInodeNumber)
+      << "saveChildInodeNumbers called with unallocated child inode numbers";
+
+  overlay::OverlayDir odir;
+  odir.set_firstChildInodeNumber(firstChild.get());
+  odir.set_childCount(count);
+  fsOverlay_.saveOverlayDir(inodeNumber, odir);
+}
+
 void Overlay::removeOverlayData(InodeNumber inodeNumber) {
   // TODO: batch request during GC
   getInodeMetadataTable()->freeInode(inodeNumber);
@@ -341,6 +382,23 @@ void Overlay::handleGCRequest(GCRequest& request) {
   };
 
   auto processDir = [&](const overlay::OverlayDir& dir) {
+    if (dir.__isset.firstChildInodeNumber) {
+      // An unmodified directory saved with saveChildInodeNumbers().  Its
+      // children can only be unmodified too, so the only overlay data among
+      // them are the directories that were saved the same way.
+      auto firstChild = dir.firstChildInodeNumber_ref().value_unchecked();
+      auto count = dir.childCount_ref().value_unchecked();
+      for (int64_t index = 0; index < count; ++index) {
+        auto ino = InodeNumber::fromThrift(firstChild + index);
+        if (fsOverlay_.hasOverlayData(ino)) {
+          queue.push(ino);
+        } else {
+          safeRemoveOverlayData(ino);
+        }
+      }
+      return;
+    }
+
     for (const auto& entry : dir.entries) {
       const auto& value = entry.second;
       if (!value.inodeNumber) {
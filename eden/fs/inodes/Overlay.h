@@ -16,6 +16,7 @@
 #include <condition_variable>
 #include <optional>
 #include <thread>
+#include <variant>
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/inodes/overlay/FsOverlay.h"
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
@@ -117,12 +118,18 @@ class Overlay {
    *   TreeInode::create() or TreeInode::mkdir().  In this case
    *   inodeCreated() should be called immediately afterwards to register the
    *   new child Inode object.
-   *
-   * TODO: It would be easy to extend this function to allocate a range of
-   * inode values in one atomic operation.
    */
   InodeNumber allocateInodeNumber();
 
+  /**
+   * Allocate count consecutive inode numbers in one atomic operation, and
+   * return the first of them.
+   *
+   * This is used by TreeInode to reserve inode numbers for all of the entries
+   * of a source control Tree at once, without building the entries yet.
+   */
+  InodeNumber allocateInodeNumbers(size_t count);
+
   /**
    * Returns an InodeMetadataTable for accessing and storing inode metadata.
    * Owned by the Overlay so records can be removed when the Overlay discovers
@@ -134,8 +141,35 @@ class Overlay {
 
   void saveOverlayDir(InodeNumber inodeNumber, const DirContents& dir);
 
+  /**
+   * Save an unmodified source control directory as just the inode numbers
+   * reserved for its Tree's entries: firstChild through
+   * firstChild + count - 1, in Tree order.  The entries themselves are read
+   * from the Tree again when the directory is loaded.
+   */
+  void saveChildInodeNumbers(
+      InodeNumber inodeNumber,
+      InodeNumber firstChild,
+      size_t count);
+
+  /**
+   * Load a directory's entries.
+   *
+   * A directory saved with saveChildInodeNumbers() has no entries here; use
+   * loadUnmaterializedDir() for directories that may have been saved that
+   * way.
+   */
   std::optional<DirContents> loadOverlayDir(InodeNumber inodeNumber);
 
+  /**
+   * The overlay data of an unmaterialized directory: either its full entries,
+   * or the first of the child inode numbers saved by saveChildInodeNumbers().
+   */
+  using UnmaterializedDir = std::variant<DirContents, InodeNumber>;
+
+  std::optional<UnmaterializedDir> loadUnmaterializedDir(
+      InodeNumber inodeNumber);
+
   void removeOverlayData(InodeNumber inodeNumber);
 
   /**
@@ -208,6 +242,15 @@ class Overlay {
   };
 
   void initOverlay();
+
+  /**
+   * Translate the entries of an OverlayDir into DirContents, allocating inode
+   * numbers for legacy entries that do not have one yet.
+   */
+  DirContents parseOverlayDir(
+      InodeNumber inodeNumber,
+      const overlay::OverlayDir& dir);
+
   void gcThread() noexcept;
   void handleGCRequest(GCRequest& request);
 
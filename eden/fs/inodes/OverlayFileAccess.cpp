@@ -44,8 +44,10 @@ OverlayFileAccess::State::State(size_t cacheSize) : entries{cacheSize} {
   }
 }
 
-OverlayFileAccess::OverlayFileAccess(Overlay* overlay)
-    : overlay_{overlay}, state_{folly::in_place, FLAGS_overlayFileCacheSize} {}
+OverlayFileAccess::OverlayFileAccess(Overlay* overlay, bool spliceReads)
+    : overlay_{overlay},
+      spliceReads_{spliceReads},
+      state_{folly::in_place, FLAGS_overlayFileCacheSize} {}
 
 OverlayFileAccess::~OverlayFileAccess() = default;
 
@@ -72,9 +74,21 @@ void OverlayFileAccess::createFile(
 
 off_t OverlayFileAccess::getFileSize(InodeNumber ino, FileInode& inode) {
   auto entry = getEntryForInode(ino);
+  auto size = getCachedFileSize(*entry);
+  if (!size.has_value()) {
+    // Truncated overlay files can sometimes occur after a hard reboot
+    // where the overlay file data was not flushed to disk before the
+    // system powered off.
+    XLOG(ERR) << "overlay file for " << ino << " is too short for header";
+    throw InodeError(EIO, inode.inodePtrFromThis(), "corrupt overlay file");
+  }
+  return *size;
+}
+
+std::optional<off_t> OverlayFileAccess::getCachedFileSize(Entry& entry) {
   uint64_t version;
   {
-    auto info = entry->info.rlock();
+    auto info = entry.info.rlock();
     if (info->size.has_value()) {
       return *info->size;
     }
@@ -84,20 +98,15 @@ off_t OverlayFileAccess::getFileSize(InodeNumber ino, FileInode& inode) {
   // Size is not known, so fstat the file. Do so while the lock is not held to
   // improve concurrency.
   struct stat st;
-  folly::checkUnixError(fstat(entry->file.fd(), &st));
+  folly::checkUnixError(fstat(entry.file.fd(), &st));
   if (st.st_size < static_cast<off_t>(FsOverlay::kHeaderLength)) {
-    // Truncated overlay files can sometimes occur after a hard reboot
-    // where the overlay file data was not flushed to disk before the
-    // system powered off.
-    XLOG(ERR) << "overlay file for " << ino
-              << " is too short for header: size=" << st.st_size;
-    throw InodeError(EIO, inode.inodePtrFromThis(), "corrupt overlay file");
+    return std::nullopt;
   }
 
   auto size = st.st_size - static_cast<off_t>(FsOverlay::kHeaderLength);
 
   // Update the cache if the version still matches.
-  auto info = entry->info.wlock();
+  auto info = entry.info.wlock();
   if (version == info->version) {
     info->size = size;
   }
@@ -177,6 +186,25 @@ std::string OverlayFileAccess::readAllContents(InodeNumber ino) {
 BufVec OverlayFileAccess::read(InodeNumber ino, size_t size, off_t off) {
   auto entry = getEntryForInode(ino);
 
+  // When FuseChannel splices replies, return a BufVec that refers to the
+  // overlay file rather than copying its data, so that it can be spliced
+  // straight into the FUSE device.  This requires knowing up front how many
+  // bytes are available.
+  if (spliceReads_) {
+    if (auto fileSize = getCachedFileSize(*entry)) {
+      auto available =
+          off < *fileSize ? static_cast<size_t>(*fileSize - off) : size_t{0};
+
+      // The aliasing constructor keeps the Entry, and therefore the file
+      // descriptor, alive even if it is evicted from the cache before the
+      // data is consumed.
+      std::shared_ptr<const folly::File> file{entry, &entry->file};
+      return BufVec{std::move(file),
+                    off + static_cast<off_t>(FsOverlay::kHeaderLength),
+                    std::min(size, available)};
+    }
+  }
+
   auto buf = folly::IOBuf::createCombined(size);
   auto res = folly::preadNoInt(
       entry->file.fd(),
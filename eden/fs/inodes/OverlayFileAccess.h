@@ -31,7 +31,11 @@ class Overlay;
  */
 class OverlayFileAccess {
  public:
-  explicit OverlayFileAccess(Overlay* overlay);
+  /**
+   * If spliceReads is true, read() returns BufVecs that refer to the overlay
+   * files, for FuseChannel to splice into the FUSE device.
+   */
+  explicit OverlayFileAccess(Overlay* overlay, bool spliceReads = false);
   ~OverlayFileAccess();
 
   /**
@@ -78,6 +82,11 @@ class OverlayFileAccess {
   /**
    * Reads a range from the file. At EOF, may return a BufVec smaller than the
    * requested size.
+   *
+   * If spliceReads was set, the returned BufVec refers to the overlay file
+   * rather than holding a copy of its contents, so that FuseChannel can
+   * splice it into the FUSE device.  Its data is then read when the reply is
+   * sent, and may include writes made after read() returned.
    */
   BufVec read(InodeNumber ino, size_t size, off_t off);
 
@@ -154,7 +163,14 @@ class OverlayFileAccess {
    */
   EntryPtr getEntryForInode(InodeNumber);
 
+  /**
+   * Returns the size of the entry's file, from the cache if possible.
+   * Returns std::nullopt if the file is too short to hold the overlay header.
+   */
+  std::optional<off_t> getCachedFileSize(Entry& entry);
+
   Overlay* overlay_ = nullptr;
+  const bool spliceReads_{false};
   folly::Synchronized<State> state_;
 };
 
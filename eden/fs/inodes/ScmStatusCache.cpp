@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/inodes/ScmStatusCache.h"
+
+namespace facebook {
+namespace eden {
+
+std::optional<ScmStatusCache::Entry> ScmStatusCache::get(
+    const Hash& commitHash,
+    bool listIgnored) const {
+  auto state = state_.rlock();
+  if (!state->entry || state->entry->commitHash != commitHash ||
+      state->entry->listIgnored != listIgnored) {
+    return std::nullopt;
+  }
+  return state->entry;
+}
+
+uint64_t ScmStatusCache::getGeneration() const {
+  return state_.rlock()->generation;
+}
+
+void ScmStatusCache::insert(uint64_t generation, Entry entry) {
+  auto state = state_.wlock();
+  if (state->generation != generation) {
+    return;
+  }
+  // Never replace a status with an older one computed concurrently.
+  if (state->entry && state->entry->commitHash == entry.commitHash &&
+      state->entry->listIgnored == entry.listIgnored &&
+      state->entry->sequence > entry.sequence) {
+    return;
+  }
+  state->entry = std::move(entry);
+}
+
+void ScmStatusCache::invalidate() {
+  auto state = state_.wlock();
+  ++state->generation;
+  state->entry.reset();
+}
+
+void ScmStatusCache::mergePaths(
+    ScmStatus& status,
+    const std::vector<RelativePath>& paths,
+    ScmStatus&& update) {
+  auto& entries = status.entries;
+  for (const auto& path : paths) {
+    const auto& name = path.value();
+    entries.erase(name);
+
+    // Entries are sorted, so everything below this path is contiguous and
+    // starts after "<path>/".
+    std::string prefix = name;
+    prefix.push_back(kDirSeparator);
+    auto it = entries.lower_bound(prefix);
+    while (it != entries.end() &&
+           folly::StringPiece{it->first}.startsWith(prefix)) {
+      it = entries.erase(it);
+    }
+  }
+
+  for (auto& [name, fileStatus] : update.entries) {
+    entries[name] = fileStatus;
+  }
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,143 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/service/gen-cpp2/eden_types.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * ScmStatusCache remembers the most recent ScmStatus computed for a mount,
+ * along with the Journal sequence number it was computed at.
+ *
+ * A later status request against the same commit only needs to re-diff the
+ * paths recorded in the Journal since that sequence number.  The cache must
+ * be invalidated whenever the mount's parent commits change.
+ *
+ * This class is thread-safe.
+ */
+class ScmStatusCache {
+ public:
+  struct Entry {
+    Hash commitHash;
+    bool listIgnored{false};
+    /**
+     * Every Journal delta up to and including this sequence number is
+     * reflected in status.
+     */
+    JournalDelta::SequenceNumber sequence{0};
+    ScmStatus status;
+  };
+
+  /**
+   * Get the cached status, if there is one for this commit and listIgnored
+   * setting.
+   */
+  std::optional<Entry> get(const Hash& commitHash, bool listIgnored) const;
+
+  /**
+   * Get a token to pass to insert() once a new status has been computed.
+   *
+   * This must be called before starting the diff, so that insert() can tell
+   * whether the cache was invalidated while the diff was running.
+   */
+  uint64_t getGeneration() const;
+
+  /**
+   * Store a newly computed status, replacing any previous entry.
+   *
+   * The status is discarded if invalidate() has been called since
+   * getGeneration() returned generation.
+   */
+  void insert(uint64_t generation, Entry entry);
+
+  /**
+   * Forget the cached status.  Called when the parent commits change.
+   */
+  void invalidate();
+
+  /**
+   * Update status with the result of re-diffing only the given paths.
+   *
+   * Entries in status at or below any of the paths are replaced by the
+   * entries from update.
+   */
+  static void mergePaths(
+      ScmStatus& status,
+      const std::vector<RelativePath>& paths,
+      ScmStatus&& update);
+
+  /**
+   * Record the outcome of a status request, for the per-mount counters.
+   */
+  void recordHit() {
+    hits_.fetch_add(1, std::memory_order_relaxed);
+  }
+  void recordMiss() {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+  }
+  void recordRediff(size_t pathCount) {
+    incrementalHits_.fetch_add(1, std::memory_order_relaxed);
+    rediffPaths_.fetch_add(pathCount, std::memory_order_relaxed);
+  }
+
+  /**
+   * Requests answered straight from the cache, with no diff at all.
+   */
+  uint64_t getHitCount() const {
+    return hits_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Requests answered by re-diffing only the paths changed since the cached
+   * status was computed.
+   */
+  uint64_t getIncrementalHitCount() const {
+    return incrementalHits_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Requests that required a full diff.
+   */
+  uint64_t getMissCount() const {
+    return misses_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * The total number of paths re-diffed by incremental hits.
+   */
+  uint64_t getRediffPathCount() const {
+    return rediffPaths_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct State {
+    uint64_t generation{0};
+    std::optional<Entry> entry;
+  };
+  folly::Synchronized<State> state_;
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> incrementalHits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> rediffPaths_{0};
+};
+
+} // namespace eden
+} // namespace facebook
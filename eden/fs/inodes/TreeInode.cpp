@@ -11,10 +11,13 @@
 
 #include <boost/polymorphic_cast.hpp>
 #include <folly/FileUtil.h>
+#include <folly/Likely.h>
+#include <folly/MapUtil.h>
 #include <folly/chrono/Conv.h>
 #include <folly/futures/Future.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/logging/xlog.h>
+#include <variant>
 #include <vector>
 
 #include "eden/fs/fuse/DirList.h"
@@ -39,6 +42,7 @@
 #include "eden/fs/model/git/GitIgnoreStack.h"
 #include "eden/fs/service/ThriftUtil.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
+#include "eden/fs/store/ImportPriority.h"
 #include "eden/fs/store/ObjectStore.h"
 #include "eden/fs/tracing/Tracing.h"
 #include "eden/fs/utils/Bug.h"
@@ -127,20 +131,62 @@ class TreeInode::IncompleteInodeLoad {
   Future<unique_ptr<InodeBase>> future_;
 };
 
+TreeInodeState::TreeInodeState(
+    std::shared_ptr<const Tree>&& tree,
+    InodeNumber firstChild)
+    : treeHash{tree->getHash()},
+      unbuiltTree{std::move(tree)},
+      firstChildNumber{firstChild} {}
+
+size_t TreeInodeState::getEntryCount() const {
+  return isUnbuilt() ? unbuiltTree->getTreeEntries().size() : entries.size();
+}
+
+std::optional<InodeNumber> TreeInodeState::getUnbuiltInodeNumber(
+    PathComponentPiece name) const {
+  DCHECK(isUnbuilt());
+  auto* treeEntry = unbuiltTree->getEntryPtr(name);
+  if (!treeEntry) {
+    return std::nullopt;
+  }
+  auto index = treeEntry - unbuiltTree->getTreeEntries().data();
+  return InodeNumber{firstChildNumber.get() + index};
+}
+
+DirEntry* TreeInodeState::findOrAddEntry(PathComponentPiece name) {
+  auto iter = entries.find(name);
+  if (iter != entries.end()) {
+    return &iter->second;
+  }
+  if (!isUnbuilt()) {
+    return nullptr;
+  }
+
+  auto* treeEntry = unbuiltTree->getEntryPtr(name);
+  if (!treeEntry) {
+    return nullptr;
+  }
+  auto index = treeEntry - unbuiltTree->getTreeEntries().data();
+  auto result = entries.emplace(
+      treeEntry->getName(),
+      modeFromTreeEntryType(treeEntry->getType()),
+      InodeNumber{firstChildNumber.get() + index},
+      treeEntry->getHash());
+  return &result.first->second;
+}
+
 TreeInode::TreeInode(
     InodeNumber ino,
     TreeInodePtr parent,
     PathComponentPiece name,
     mode_t initialMode,
-    std::shared_ptr<const Tree>&& tree)
-    : TreeInode(
-          ino,
-          parent,
-          name,
-          initialMode,
-          std::nullopt,
-          saveDirFromTree(ino, tree.get(), parent->getMount()),
-          tree->getHash()) {}
+    std::shared_ptr<const Tree>&& tree,
+    InodeNumber firstChild)
+    : Base(ino, initialMode, std::nullopt, parent, name),
+      contents_(folly::in_place, std::move(tree), firstChild),
+      entriesBuilt_{false} {
+  DCHECK_NE(ino, kRootNodeId);
+}
 
 TreeInode::TreeInode(
     InodeNumber ino,
@@ -170,18 +216,18 @@ TreeInode::TreeInode(
 TreeInode::~TreeInode() {}
 
 folly::Future<Dispatcher::Attr> TreeInode::getattr() {
-  return getAttrLocked(contents_.rlock()->entries);
+  return getAttrLocked(*contents_.rlock());
 }
 
-Dispatcher::Attr TreeInode::getAttrLocked(const DirContents& contents) {
+Dispatcher::Attr TreeInode::getAttrLocked(const TreeInodeState& contents) {
   Dispatcher::Attr attr(getMount()->initStatData());
 
   attr.st.st_ino = getNodeId().get();
-  getMetadataLocked(contents).applyToStat(attr.st);
+  getMetadataLocked(contents.entries).applyToStat(attr.st);
 
   // For directories, nlink is the number of entries including the
   // "." and ".." links.
-  attr.st.st_nlink = contents.size() + 2;
+  attr.st.st_nlink = contents.getEntryCount() + 2;
   return attr;
 }
 
@@ -209,6 +255,11 @@ Future<InodePtr> TreeInode::getOrLoadChild(PathComponentPiece name) {
                // Check if the child is already loaded and return it if so
                auto iter = contents.entries.find(name);
                if (iter == contents.entries.end()) {
+                 if (contents.isUnbuilt() &&
+                     contents.getUnbuiltInodeNumber(name)) {
+                   // The child exists but has not been loaded yet.
+                   return folly::none;
+                 }
                  XLOG(DBG7) << "attempted to load non-existent entry \"" << name
                             << "\" in " << getLogPath();
                  return folly::make_optional(makeFuture<InodePtr>(
@@ -234,8 +285,7 @@ Future<InodePtr> TreeInode::getOrLoadChild(PathComponentPiece name) {
                // entry. The InodeMap will tell us if this inode is already in
                // the process of being loaded, or if we need to start loading it
                // now.
-               auto iter = contents->entries.find(name);
-               auto& entry = iter->second;
+               auto& entry = *contents->findOrAddEntry(name);
                folly::Promise<InodePtr> promise;
                returnFuture = promise.getFuture();
                childNumber = entry.getInodeNumber();
@@ -334,9 +384,14 @@ Future<InodePtr> TreeInode::getChildRecursive(RelativePathPiece path) {
 }
 
 InodeNumber TreeInode::getChildInodeNumber(PathComponentPiece name) {
-  auto contents = contents_.wlock();
+  auto contents = contents_.rlock();
   auto iter = contents->entries.find(name);
   if (iter == contents->entries.end()) {
+    if (contents->isUnbuilt()) {
+      if (auto number = contents->getUnbuiltInodeNumber(name)) {
+        return *number;
+      }
+    }
     throw InodeError(ENOENT, inodePtrFromThis(), name);
   }
 
@@ -409,9 +464,11 @@ void TreeInode::loadUnlinkedChildInode(
 void TreeInode::loadChildInode(PathComponentPiece name, InodeNumber number) {
   auto future = Future<unique_ptr<InodeBase>>::makeEmpty();
   {
-    auto contents = contents_.rlock();
-    auto iter = contents->entries.find(name);
-    if (iter == contents->entries.end()) {
+    // This takes the write lock since an unbuilt directory adds the entry
+    // for the child it is about to load.
+    auto contents = contents_.wlock();
+    auto* entryPtr = contents->findOrAddEntry(name);
+    if (!entryPtr) {
       auto bug = EDEN_BUG() << "InodeMap requested to load inode " << number
                             << ", but there is no entry named \"" << name
                             << "\" in " << getNodeId();
@@ -419,7 +476,7 @@ void TreeInode::loadChildInode(PathComponentPiece name, InodeNumber number) {
       return;
     }
 
-    auto& entry = iter->second;
+    auto& entry = *entryPtr;
     // InodeMap makes sure to only try loading each inode once, so this entry
     // should not already be loaded.
     if (entry.getInode() != nullptr) {
@@ -598,39 +655,65 @@ Future<unique_ptr<InodeBase>> TreeInode::startLoadingInode(
             -> unique_ptr<InodeBase> {
               // Even if the inode is not materialized, it may have inode
               // numbers stored in the overlay.
-              auto overlayDir = self->loadOverlayDir(number);
-              if (overlayDir) {
-                // Compare the Tree and the Dir from the overlay.  If they
-                // differ, something is wrong, so log the difference.
-                if (auto differences =
-                        findEntryDifferences(*overlayDir, *tree)) {
-                  std::string diffString;
-                  for (const auto& diff : *differences) {
-                    diffString += diff;
-                    diffString += '\n';
-                  }
-                  XLOG(ERR)
-                      << "loaded entry " << self->getLogPath() << " / "
-                      << childName << " (inode number " << number
-                      << ") from overlay but the entries don't correspond with "
-                         "the tree.  Something is wrong!\n"
-                      << diffString;
-                }
+              auto* overlay = self->getOverlay();
+              auto overlayDir = overlay->loadUnmaterializedDir(number);
+              if (!overlayDir) {
+                // This is the first time this directory has been loaded.
+                // Reserve inode numbers for its entries and save them so that
+                // it keeps them when it is unloaded and loaded again.
+                auto count = tree->getTreeEntries().size();
+                auto firstChild = count == 0
+                    ? InodeNumber{}
+                    : overlay->allocateInodeNumbers(count);
+                overlay->saveChildInodeNumbers(number, firstChild, count);
+                return make_unique<TreeInode>(
+                    number,
+                    self,
+                    childName,
+                    entryMode,
+                    std::move(tree),
+                    firstChild);
+              }
 
-                XLOG(DBG6) << "found entry " << childName
-                           << " with inode number " << number << " in overlay";
+              if (auto* firstChild = std::get_if<InodeNumber>(&*overlayDir)) {
+                XLOG(DBG6) << "found child inode numbers for " << childName
+                           << " (inode number " << number << ") in overlay";
                 return make_unique<TreeInode>(
                     number,
-                    std::move(self),
+                    self,
                     childName,
                     entryMode,
-                    std::nullopt,
-                    std::move(*overlayDir),
-                    treeHash);
+                    std::move(tree),
+                    *firstChild);
+              }
+
+              // Compare the Tree and the Dir from the overlay.  If they
+              // differ, something is wrong, so log the difference.
+              auto& dir = std::get<DirContents>(*overlayDir);
+              if (auto differences = findEntryDifferences(dir, *tree)) {
+                std::string diffString;
+                for (const auto& diff : *differences) {
+                  diffString += diff;
+                  diffString += '\n';
+                }
+                XLOG(ERR)
+                    << "loaded entry " << self->getLogPath() << " / "
+                    << childName << " (inode number " << number
+                    << ") from overlay but the entries don't correspond with "
+                       "the tree.  Something is wrong!\n"
+                    << diffString;
               }
 
+              XLOG(DBG6) << "found entry " << childName
+                         << " with inode number " << number << " in overlay";
               return make_unique<TreeInode>(
-                  number, self, childName, entryMode, std::move(tree));
+                  number,
+                  std::move(self),
+                  childName,
+                  entryMode,
+                  std::nullopt,
+                  std::move(dir),
+                  treeHash);
             });
   }
 
@@ -692,6 +775,7 @@ void TreeInode::materialize(const RenameLock* renameLock) {
     // contents are from.
     {
       auto contents = contents_.wlock();
+      buildEntries(*contents);
       // Double check that we still need to be materialized
       if (contents->isMaterialized()) {
         return;
@@ -716,6 +800,7 @@ void TreeInode::childMaterialized(
     PathComponentPiece childName) {
   {
     auto contents = contents_.wlock();
+    buildEntries(*contents);
     auto iter = contents->entries.find(childName);
     if (iter == contents->entries.end()) {
       // This should never happen.
@@ -749,6 +834,7 @@ void TreeInode::childDematerialized(
     Hash childScmHash) {
   {
     auto contents = contents_.wlock();
+    buildEntries(*contents);
     auto iter = contents->entries.find(childName);
     if (iter == contents->entries.end()) {
       // This should never happen.
@@ -817,6 +903,44 @@ DirContents TreeInode::saveDirFromTree(
   return dir;
 }
 
+void TreeInode::ensureEntriesBuilt() {
+  if (LIKELY(entriesBuilt_.load(std::memory_order_acquire))) {
+    return;
+  }
+  buildEntries(*contents_.wlock());
+}
+
+void TreeInode::buildEntries(TreeInodeState& contents) {
+  if (!contents.isUnbuilt()) {
+    return;
+  }
+
+  const auto& treeEntries = contents.unbuiltTree->getTreeEntries();
+  DirContents dir;
+  dir.reserve(treeEntries.size());
+  for (size_t index = 0; index < treeEntries.size(); ++index) {
+    const auto& treeEntry = treeEntries[index];
+    // Keep the entries of loaded children, which point to their inodes.
+    auto iter = contents.entries.find(treeEntry.getName());
+    if (iter != contents.entries.end()) {
+      dir.emplace(treeEntry.getName(), std::move(iter->second));
+      continue;
+    }
+    dir.emplace(
+        treeEntry.getName(),
+        modeFromTreeEntryType(treeEntry.getType()),
+        InodeNumber{contents.firstChildNumber.get() + index},
+        treeEntry.getHash());
+  }
+  // The overlay already holds these inode numbers: they were reserved when
+  // this inode was first loaded.
+
+  XLOG(DBG6) << "built " << dir.size() << " entries for " << getLogPath();
+  contents.entries = std::move(dir);
+  contents.unbuiltTree.reset();
+  entriesBuilt_.store(true, std::memory_order_release);
+}
+
 DirContents TreeInode::buildDirFromTree(const Tree* tree, Overlay* overlay) {
   CHECK(tree);
 
@@ -937,6 +1061,7 @@ TreeInode::create(PathComponentPiece name, mode_t mode, int /*flags*/) {
   {
     // Acquire our contents lock
     auto contents = contents_.wlock();
+    buildEntries(*contents);
 
     // The mode passed in by the caller may not have the file type bits set.
     // Ensure that we mark this as a regular file.
@@ -971,6 +1096,7 @@ FileInodePtr TreeInode::symlink(
   {
     // Acquire our contents lock
     auto contents = contents_.wlock();
+    buildEntries(*contents);
     const mode_t mode = S_IFLNK | 0770;
     return createImpl(
         std::move(contents), name, mode, ByteRange{symlinkTarget});
@@ -1003,6 +1129,7 @@ FileInodePtr TreeInode::mknod(PathComponentPiece name, mode_t mode, dev_t dev) {
   {
     // Acquire our contents lock
     auto contents = contents_.wlock();
+    buildEntries(*contents);
     return createImpl(std::move(contents), name, mode, ByteRange{});
   }
 }
@@ -1021,6 +1148,7 @@ TreeInodePtr TreeInode::mkdir(PathComponentPiece name, mode_t mode) {
   {
     // Acquire our contents lock
     auto contents = contents_.wlock();
+    buildEntries(*contents);
 
     auto myPath = getPath();
     // Make sure this directory has not been unlinked.
@@ -1205,6 +1333,7 @@ int TreeInode::tryRemoveChild(
   std::unique_ptr<InodeBase> deletedInode;
   {
     auto contents = contents_.wlock();
+    buildEntries(*contents);
 
     // Make sure that this name still corresponds to the child inode we just
     // looked up.
@@ -1263,7 +1392,7 @@ int TreeInode::tryRemoveChild(
 int TreeInode::checkPreRemove(const TreeInodePtr& child) {
   // Lock the child contents, and make sure they are empty
   auto childContents = child->contents_.rlock();
-  if (!childContents->entries.empty()) {
+  if (childContents->getEntryCount() != 0) {
     return ENOTEMPTY;
   }
   return 0;
@@ -1652,6 +1781,7 @@ void TreeInode::TreeRenameLocks::acquireLocks(
     // If the source and destination directories are the same,
     // then there is really only one parent directory to lock.
     srcContentsLock_ = srcTree->contents_.wlock();
+    srcTree->buildEntries(*srcContentsLock_);
     srcContents_ = &srcContentsLock_->entries;
     destContents_ = &srcContentsLock_->entries;
     // Look up the destination child entry, and lock it if is is a directory
@@ -1660,8 +1790,10 @@ void TreeInode::TreeRenameLocks::acquireLocks(
     // If srcTree is an ancestor of destTree, we must acquire the lock on
     // srcTree first.
     srcContentsLock_ = srcTree->contents_.wlock();
+    srcTree->buildEntries(*srcContentsLock_);
     srcContents_ = &srcContentsLock_->entries;
     destContentsLock_ = destTree->contents_.wlock();
+    destTree->buildEntries(*destContentsLock_);
     destContents_ = &destContentsLock_->entries;
     lockDestChild(destName);
   } else {
@@ -1672,6 +1804,7 @@ void TreeInode::TreeRenameLocks::acquireLocks(
     // since we have confirmed that srcTree is not destTree nor an ancestor of
     // destTree.
     destContentsLock_ = destTree->contents_.wlock();
+    destTree->buildEntries(*destContentsLock_);
     destContents_ = &destContentsLock_->entries;
     lockDestChild(destName);
 
@@ -1687,6 +1820,7 @@ void TreeInode::TreeRenameLocks::acquireLocks(
       srcContents_ = destChildContents_;
     } else {
       srcContentsLock_ = srcTree->contents_.wlock();
+      srcTree->buildEntries(*srcContentsLock_);
       srcContents_ = &srcContentsLock_->entries;
     }
   }
@@ -1698,6 +1832,7 @@ void TreeInode::TreeRenameLocks::lockDestChild(PathComponentPiece destName) {
   if (destChildExists() && destChildIsDirectory() && destChild() != nullptr) {
     auto* childTree = boost::polymorphic_downcast<TreeInode*>(destChild());
     destChildContentsLock_ = childTree->contents_.wlock();
+    childTree->buildEntries(*destChildContentsLock_);
     destChildContents_ = &destChildContentsLock_->entries;
   }
 }
@@ -1778,6 +1913,30 @@ DirList TreeInode::readdir(DirList&& list, off_t off) {
   }
 
   auto dir = contents_.rlock();
+  if (dir->isUnbuilt()) {
+    // The entries of an unbuilt directory are numbered consecutively in Tree
+    // order, so they are already sorted by offset.  Entry N has offset
+    // firstChildNumber + N + 2.
+    const auto& treeEntries = dir->unbuiltTree->getTreeEntries();
+    if (treeEntries.empty()) {
+      return std::move(list);
+    }
+    auto firstChild = dir->firstChildNumber.get();
+    auto skip = off - static_cast<off_t>(firstChild) - 1;
+    for (size_t index = skip > 0 ? skip : 0; index < treeEntries.size();
+         ++index) {
+      const auto& treeEntry = treeEntries[index];
+      auto inodeNumber = firstChild + index;
+      if (!list.add(
+              treeEntry.getName().stringPiece(),
+              inodeNumber,
+              treeEntry.getDType(),
+              inodeNumber + 2)) {
+        break;
+      }
+    }
+    return std::move(list);
+  }
   auto& entries = dir->entries;
 
   // Compute an index into the PathMap by InodeNumber, only including the
@@ -1812,6 +1971,136 @@ DirList TreeInode::readdir(DirList&& list, off_t off) {
   return std::move(list);
 }
 
+#ifdef __linux__
+folly::Future<DirPlusList> TreeInode::readdirplus(
+    DirPlusList&& list,
+    off_t off) {
+  // See readdir() for the meaning of the offsets; readdirplus uses the same
+  // ones so the kernel can switch between the two within a directory stream.
+  if (off < 0) {
+    XLOG(ERR) << "Negative readdirplus offsets are illegal, off = " << off;
+    folly::throwSystemErrorExplicit(EINVAL);
+  }
+  updateAtime();
+  prefetch();
+
+  // The kernel never takes lookup references for . and .., so they are sent
+  // without entry information.
+  if (off <= 0) {
+    if (!list.add(
+            ".", getNodeId().get(), dtype_t::Dir, 1, fuse_entry_out{})) {
+      return std::move(list);
+    }
+  }
+  if (off <= 1) {
+    auto parent = getParentRacy();
+    auto parentNodeId = parent ? parent->getNodeId() : getNodeId();
+    if (!list.add(
+            "..", parentNodeId.get(), dtype_t::Dir, 2, fuse_entry_out{})) {
+      return std::move(list);
+    }
+  }
+
+  struct Child {
+    PathComponent name;
+    InodeNumber number;
+    dtype_t type;
+  };
+  std::vector<Child> children;
+  {
+    auto dir = contents_.rlock();
+    auto available = list.remaining();
+    if (dir->isUnbuilt()) {
+      // As in readdir(), entry N of an unbuilt directory has offset
+      // firstChildNumber + N + 2.
+      const auto& treeEntries = dir->unbuiltTree->getTreeEntries();
+      auto firstChild = dir->firstChildNumber.get();
+      auto skip = off - static_cast<off_t>(firstChild) - 1;
+      for (size_t index = skip > 0 ? skip : 0; index < treeEntries.size();
+           ++index) {
+        const auto& treeEntry = treeEntries[index];
+        auto size = DirPlusList::entrySize(treeEntry.getName().stringPiece());
+        if (size > available) {
+          break;
+        }
+        available -= size;
+        children.push_back(Child{treeEntry.getName(),
+                                 InodeNumber{firstChild + index},
+                                 treeEntry.getDType()});
+      }
+    } else {
+      auto& entries = dir->entries;
+
+      // Pick the entries that fit in the list, in the same order as
+      // readdir().
+      std::vector<std::pair<InodeNumber, size_t>> indices;
+      indices.reserve(entries.size());
+      size_t index = 0;
+      for (auto& entry : entries) {
+        auto inodeNumber = entry.second.getInodeNumber();
+        if (static_cast<off_t>(inodeNumber.get() + 2) > off) {
+          indices.emplace_back(inodeNumber, index);
+        }
+        ++index;
+      }
+      std::make_heap(indices.begin(), indices.end(), std::greater<>{});
+
+      while (indices.size()) {
+        std::pop_heap(indices.begin(), indices.end(), std::greater<>{});
+        auto& [name, entry] = entries.begin()[indices.back().second];
+        indices.pop_back();
+
+        auto size = DirPlusList::entrySize(name.stringPiece());
+        if (size > available) {
+          break;
+        }
+        available -= size;
+        children.push_back(
+            Child{name, entry.getInodeNumber(), entry.getDtype()});
+      }
+    }
+  }
+
+  // Look up the children without holding our contents lock.  A child that
+  // was removed or renamed in the meantime, or whose attributes cannot be
+  // computed, is sent as a plain dirent.
+  std::vector<Future<fuse_entry_out>> lookups;
+  lookups.reserve(children.size());
+  for (const auto& child : children) {
+    lookups.push_back(
+        getOrLoadChild(child.name).thenValue([](InodePtr inode) {
+          return inode->getattr().thenValue(
+              [inode = std::move(inode)](Dispatcher::Attr attr) {
+                inode->incFuseRefcount();
+                return attr.asFuseEntry(inode->getNodeId());
+              });
+        }));
+  }
+
+  return folly::collectAllSemiFuture(lookups).toUnsafeFuture().thenValue(
+      [list = std::move(list), children = std::move(children)](
+          std::vector<folly::Try<fuse_entry_out>> results) mutable {
+        for (size_t n = 0; n < children.size(); ++n) {
+          const auto& child = children[n];
+          auto& result = results[n];
+          if (result.hasException()) {
+            XLOG(DBG3) << "readdirplus: unable to look up " << child.name
+                       << ": " << result.exception().what();
+          }
+          auto added = list.add(
+              child.name.stringPiece(),
+              child.number.get(),
+              child.type,
+              child.number.get() + 2,
+              result.hasValue() ? result.value() : fuse_entry_out{});
+          // Space for every child was reserved above.
+          DCHECK(added);
+        }
+        return std::move(list);
+      });
+}
+#endif
+
 InodeMap* TreeInode::getInodeMap() const {
   return getMount()->getInodeMap();
 }
@@ -1850,6 +2139,10 @@ Future<Unit> TreeInode::diff(
       return makeFuture();
     }
 
+    // An unbuilt directory is unmodified, but it differs from the Tree it is
+    // being compared to, so the comparison needs all of its entries.
+    buildEntries(*contents);
+
     // If this directory is already ignored, we don't need to bother loading its
     // .gitignore file.  Everything inside this directory must also be ignored,
     // unless it is explicitly tracked in source control.
@@ -2021,6 +2314,7 @@ Future<Unit> TreeInode::computeDiff(
     bool isIgnored) {
   DCHECK(isIgnored || ignore != nullptr)
       << "the ignore stack is required if this directory is not ignored";
+  buildEntries(*contentsLock);
 
   // A list of entries that have been removed
   std::vector<const TreeEntry*> removedEntries;
@@ -2226,6 +2520,13 @@ Future<Unit> TreeInode::computeDiff(
       }
     };
 
+    // When the diff is restricted to a set of paths, entries outside of it
+    // are treated as unchanged.
+    auto isIncluded = [&](PathComponentPiece name) {
+      return !context->hasPathFilter() ||
+          context->isPathIncluded(currentPath + name);
+    };
+
     // Walk through the source control tree entries and our inode entries to
     // look for differences.
     //
@@ -2244,24 +2545,34 @@ Future<Unit> TreeInode::computeDiff(
         }
 
         // This entry is present locally but not in the source control tree.
-        processUntracked(inodeIter->first, &inodeIter->second);
+        if (isIncluded(inodeIter->first)) {
+          processUntracked(inodeIter->first, &inodeIter->second);
+        }
         ++inodeIter;
       } else if (inodeIter == inodeEntries.end()) {
         // This entry is present in the old tree but not the old one.
-        processRemoved(scEntries[scIdx]);
+        if (isIncluded(scEntries[scIdx].getName())) {
+          processRemoved(scEntries[scIdx]);
+        }
         ++scIdx;
       } else if (scEntries[scIdx].getName() < inodeIter->first) {
-        processRemoved(scEntries[scIdx]);
+        if (isIncluded(scEntries[scIdx].getName())) {
+          processRemoved(scEntries[scIdx]);
+        }
         ++scIdx;
       } else if (scEntries[scIdx].getName() > inodeIter->first) {
-        processUntracked(inodeIter->first, &inodeIter->second);
+        if (isIncluded(inodeIter->first)) {
+          processUntracked(inodeIter->first, &inodeIter->second);
+        }
         ++inodeIter;
       } else {
         const auto& scmEntry = scEntries[scIdx];
         auto* inodeEntry = &inodeIter->second;
         ++scIdx;
         ++inodeIter;
-        processBothPresent(scmEntry, inodeEntry);
+        if (isIncluded(scmEntry.getName())) {
+          processBothPresent(scmEntry, inodeEntry);
+        }
       }
     }
   }
@@ -2439,6 +2750,7 @@ void TreeInode::computeCheckoutActions(
           ctx, contents->treeHash.value(), fromTree, toTree)) {
     return;
   }
+  buildEntries(*contents);
 
   // Walk through fromTree and toTree, and call the above helper functions as
   // appropriate.
@@ -2722,6 +3034,7 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
     {
       std::unique_ptr<InodeBase> deletedInode;
       auto contents = contents_.wlock();
+      buildEntries(*contents);
 
       // The CheckoutContext should be holding the rename lock, so the entry
       // at this name should still be the specified inode.
@@ -2814,6 +3127,7 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
             bool inserted;
             {
               auto contents = parentInode->contents_.wlock();
+              parentInode->buildEntries(*contents);
               DCHECK(!newScmEntry->isTree());
               auto ret = contents->entries.emplace(
                   name,
@@ -2895,6 +3209,13 @@ void TreeInode::saveOverlayPostCheckout(
   bool deleteSelf;
   {
     auto contents = contents_.wlock();
+    if (contents->isUnbuilt() && tree &&
+        contents->treeHash.value() == tree->getHash()) {
+      // The checkout left this directory untouched.  It is still identical
+      // to the same Tree, and the overlay already holds its inode numbers.
+      return;
+    }
+    buildEntries(*contents);
 
     // Check to see if we need to be materialized or not.
     //
@@ -3072,7 +3393,7 @@ size_t unloadChildrenIf(
   // Unload children whose reference count is zero.
   std::vector<unique_ptr<InodeBase>> toDelete;
   {
-    auto contents = self->getContents().wlock();
+    auto contents = self->getContentsMaybeUnbuilt().wlock();
     auto inodeMapLock = inodeMap->lockForUnload();
 
     for (auto& entry : contents->entries) {
@@ -3113,7 +3434,7 @@ size_t unloadChildrenIf(
 std::vector<TreeInodePtr> getTreeChildren(TreeInode* self) {
   std::vector<TreeInodePtr> treeChildren;
   {
-    auto contents = self->getContents().rlock();
+    auto contents = self->getContentsMaybeUnbuilt().rlock();
     for (auto& entry : contents->entries) {
       if (!entry.second.getInode()) {
         continue;
@@ -3258,6 +3579,26 @@ void TreeInode::getDebugStatus(vector<TreeInodeDebugInfo>& results) const {
     info.materialized = contents->isMaterialized();
     info.treeHash = thriftHash(contents->treeHash);
 
+    if (contents->isUnbuilt()) {
+      // Report the children that are not in entries straight from the Tree.
+      // The loop below reports the rest.
+      const auto& treeEntries = contents->unbuiltTree->getTreeEntries();
+      for (size_t index = 0; index < treeEntries.size(); ++index) {
+        const auto& treeEntry = treeEntries[index];
+        if (contents->entries.count(treeEntry.getName())) {
+          continue;
+        }
+        info.entries.emplace_back();
+        auto& infoEntry = info.entries.back();
+        infoEntry.name = treeEntry.getName().stringPiece().str();
+        infoEntry.inodeNumber = contents->firstChildNumber.get() + index;
+        infoEntry.mode = modeFromTreeEntryType(treeEntry.getType());
+        infoEntry.loaded = false;
+        infoEntry.materialized = false;
+        infoEntry.hash = thriftHash(treeEntry.getHash());
+      }
+    }
+
     for (const auto& entry : contents->entries) {
       if (entry.second.getInode()) {
         // A child inode exists, so just grab an InodePtr and add it to the
@@ -3345,40 +3686,93 @@ void TreeInode::prefetch() {
     return;
   }
 
+  // Nobody is waiting on this, so it must not delay imports that someone is.
+  ImportPriorityScope importPriority{ImportPriorityClass::Background};
   folly::via(getMount()->getThreadPool().get(), [self = inodePtrFromThis()] {
-    std::vector<IncompleteInodeLoad> pendingLoads;
-    std::vector<Future<Unit>> inodeFutures;
-
+    // Fetch the children's trees and blob metadata in batches first, so
+    // that loading the children below, and later stat() calls, find them
+    // in memory rather than each doing their own LocalStore read.
+    std::vector<Hash> treeHashes;
+    std::vector<Hash> blobHashes;
     {
-      auto contents = self->contents_.wlock();
-
-      for (auto& [name, entry] : contents->entries) {
-        if (entry.getInode()) {
-          // Already loaded
-          continue;
+      auto contents = self->contents_.rlock();
+      if (contents->isUnbuilt()) {
+        // Every entry of an unbuilt directory is unmodified, and only the
+        // loaded ones are in entries.
+        const auto& entries = contents->entries;
+        for (const auto& treeEntry : contents->unbuiltTree->getTreeEntries()) {
+          auto* dirEntry = folly::get_ptr(entries, treeEntry.getName());
+          if (dirEntry && dirEntry->getInode()) {
+            continue;
+          }
+          if (treeEntry.isTree()) {
+            treeHashes.push_back(treeEntry.getHash());
+          } else {
+            blobHashes.push_back(treeEntry.getHash());
+          }
+        }
+      } else {
+        for (auto& entry : contents->entries) {
+          const auto& dirEntry = entry.second;
+          if (dirEntry.getInode() || dirEntry.isMaterialized()) {
+            continue;
+          }
+          if (dirEntry.isDirectory()) {
+            treeHashes.push_back(dirEntry.getHash());
+          } else {
+            blobHashes.push_back(dirEntry.getHash());
+          }
         }
-
-        // TODO: It's probably excessive to actually load the inodes during
-        // prefetch. Ideally, all that's required here is to fetch the blob's
-        // metadata (if the entry is a file) or the tree's metadata (if the
-        // entry is a directory) so that future lookup() and stat() calls don't
-        // block on network or disk fetches. But, for now, Eden does not have
-        // tree metadata, so just load all of the children so that lookup()
-        // returns cheaply.
-        inodeFutures.emplace_back(
-            self->loadChildLocked(contents->entries, name, entry, pendingLoads)
-                .unit());
       }
     }
 
-    // Hook up the pending load futures to properly complete the loading
-    // process then the futures are ready.  We can only do this after
-    // releasing the contents_ lock.
-    for (auto& load : pendingLoads) {
-      load.finish();
-    }
+    auto* objectStore = self->getStore();
+    return folly::collectAllSemiFuture(
+               objectStore->getTrees(treeHashes).unit(),
+               objectStore->getBlobMetadataBatch(blobHashes).unit())
+        .toUnsafeFuture()
+        .thenValue([self](auto&&) {
+          std::vector<IncompleteInodeLoad> pendingLoads;
+          std::vector<Future<Unit>> inodeFutures;
+
+          {
+            auto contents = self->contents_.wlock();
+            if (contents->isUnbuilt()) {
+              // Add the entries of the children about to be loaded, without
+              // building the rest of the directory.
+              for (const auto& treeEntry :
+                   contents->unbuiltTree->getTreeEntries()) {
+                contents->findOrAddEntry(treeEntry.getName());
+              }
+            }
+            for (auto& [name, entry] : contents->entries) {
+              if (entry.getInode()) {
+                // Already loaded
+                continue;
+              }
+
+              // TODO: It's probably excessive to actually load the inodes
+              // during prefetch. Ideally, fetching the blob metadata and trees
+              // above is all that's required so that future lookup() and
+              // stat() calls don't block on network or disk fetches. But, for
+              // now, Eden does not have tree metadata, so just load all of the
+              // children so that lookup() returns cheaply.
+              inodeFutures.emplace_back(
+                  self->loadChildLocked(
+                          contents->entries, name, entry, pendingLoads)
+                      .unit());
+            }
+          }
+
+          // Hook up the pending load futures to properly complete the loading
+          // process then the futures are ready.  We can only do this after
+          // releasing the contents_ lock.
+          for (auto& load : pendingLoads) {
+            load.finish();
+          }
 
-    return folly::collectAll(inodeFutures).unit();
+          return folly::collectAll(inodeFutures).unit();
+        });
   });
 }
 
@@ -22,6 +22,7 @@ class CheckoutAction;
 class CheckoutContext;
 class DiffContext;
 class DirList;
+class DirPlusList;
 class EdenMount;
 class GitIgnoreStack;
 class InodeDiffCallback;
@@ -43,6 +44,12 @@ struct TreeInodeState {
   explicit TreeInodeState(DirContents&& dir, std::optional<Hash> hash)
       : entries{std::forward<DirContents>(dir)}, treeHash{hash} {}
 
+  /**
+   * Construct the state of an unmodified directory without building its
+   * entries.  See unbuiltTree.
+   */
+  TreeInodeState(std::shared_ptr<const Tree>&& tree, InodeNumber firstChild);
+
   bool isMaterialized() const {
     return !treeHash.has_value();
   }
@@ -50,6 +57,43 @@ struct TreeInodeState {
     treeHash = std::nullopt;
   }
 
+  bool isUnbuilt() const {
+    return unbuiltTree != nullptr;
+  }
+
+  /**
+   * The number of entries in this directory, whether or not they have been
+   * built.
+   */
+  size_t getEntryCount() const;
+
+  /**
+   * Return the inode number reserved for the entry with the given name in
+   * unbuiltTree, or std::nullopt if the Tree has no such entry.
+   *
+   * Must only be called while the directory is unbuilt.
+   */
+  std::optional<InodeNumber> getUnbuiltInodeNumber(
+      PathComponentPiece name) const;
+
+  /**
+   * Return the entry with the given name, or nullptr if there is none.
+   *
+   * While the directory is unbuilt this first adds the entry from
+   * unbuiltTree to entries, so that the child can be loaded without
+   * building the rest of the directory.  The returned pointer is invalidated
+   * by any later change to entries.
+   */
+  DirEntry* findOrAddEntry(PathComponentPiece name);
+
+  /**
+   * The entries of this directory.
+   *
+   * While the directory is unbuilt this only holds the entries of the
+   * children that have been loaded, or are being loaded, since it was loaded
+   * itself.  Use TreeInode::ensureEntriesBuilt() or TreeInode::buildEntries()
+   * before accessing it unless the code also handles the unbuilt state.
+   */
   DirContents entries;
 
   /**
@@ -62,6 +106,21 @@ struct TreeInodeState {
    * treeHash will be none.
    */
   std::optional<Hash> treeHash;
+
+  /**
+   * Unmodified directories loaded from source control do not copy their Tree
+   * into DirEntry objects until they are first modified.  Until then this
+   * points to the shared source control Tree, and entries only holds the
+   * loaded children.
+   *
+   * Inode numbers for all of the Tree's entries are reserved when the
+   * directory is first loaded, and only the range is saved in the overlay:
+   * the entry at index N of the Tree gets inode number firstChildNumber + N.
+   * This lets readdir() report the same inode numbers before and after the
+   * entries are built, and after the directory is unloaded and loaded again.
+   */
+  std::shared_ptr<const Tree> unbuiltTree;
+  InodeNumber firstChildNumber;
 };
 
 /**
@@ -85,13 +144,18 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
 
   /**
    * Construct a TreeInode from a source control tree.
+   *
+   * The directory starts out unbuilt: the Tree is shared rather than copied
+   * into DirEntry objects until the directory is first modified.  Its
+   * entries use the inode numbers reserved starting at firstChild.
    */
   TreeInode(
       InodeNumber ino,
       TreeInodePtr parent,
       PathComponentPiece name,
       mode_t initialMode,
-      std::shared_ptr<const Tree>&& tree);
+      std::shared_ptr<const Tree>&& tree,
+      InodeNumber firstChild);
 
   /**
    * Construct an inode that only has backing in the Overlay area.
@@ -123,7 +187,7 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   folly::Future<std::vector<std::string>> listxattr() override;
   folly::Future<std::string> getxattr(folly::StringPiece name) override;
 
-  Dispatcher::Attr getAttrLocked(const DirContents& contents);
+  Dispatcher::Attr getAttrLocked(const TreeInodeState& contents);
 
   /** Implements the InodeBase method used by the Dispatcher
    * to create the Inode instance for a given name */
@@ -154,13 +218,51 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
 
   DirList readdir(DirList&& list, off_t off);
 
-  const folly::Synchronized<TreeInodeState>& getContents() const {
+#ifdef __linux__
+  /**
+   * Like readdir(), but also returns the lookup result for each child.
+   *
+   * Each child that is returned is loaded (but not materialized) and has its
+   * FUSE reference count incremented, since the kernel takes a lookup
+   * reference on it.  File attributes come from the cached blob metadata when
+   * it is available, just as for getattr().  Children whose attributes cannot
+   * be computed are returned as plain dirents, and the kernel will look them
+   * up separately.
+   */
+  folly::Future<DirPlusList> readdirplus(DirPlusList&& list, off_t off);
+#endif
+
+  /**
+   * Return the locked contents of this directory.
+   *
+   * This builds the entries of an unbuilt directory first, so callers can
+   * always use TreeInodeState::entries.
+   */
+  folly::Synchronized<TreeInodeState>& getContents() {
+    ensureEntriesBuilt();
     return contents_;
   }
-  folly::Synchronized<TreeInodeState>& getContents() {
+
+  /**
+   * Return the locked contents without building the entries of an unbuilt
+   * directory.
+   *
+   * This is intended for code that only cares about loaded children, such as
+   * the InodeMap when unloading inodes.  An unbuilt directory keeps the
+   * entries of its loaded children in TreeInodeState::entries.
+   */
+  folly::Synchronized<TreeInodeState>& getContentsMaybeUnbuilt() {
     return contents_;
   }
 
+  /**
+   * If this directory is unbuilt, build its entries from the source control
+   * Tree now.
+   *
+   * The caller must not be holding the contents_ lock.
+   */
+  void ensureEntriesBuilt();
+
   FOLLY_NODISCARD folly::Future<CreateResult>
   create(PathComponentPiece name, mode_t mode, int flags);
   FileInodePtr symlink(PathComponentPiece name, folly::StringPiece contents);
@@ -458,6 +560,15 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    * used to track the directory in the inode */
   static DirContents buildDirFromTree(const Tree* tree, Overlay* overlay);
 
+  /**
+   * Build the entries of an unbuilt directory while holding its contents_
+   * lock for writing.  Their inode numbers are already in the overlay, so
+   * this does no I/O.
+   *
+   * Does nothing if the entries have already been built.
+   */
+  void buildEntries(TreeInodeState& contents);
+
   void updateAtime();
 
   void prefetch();
@@ -678,6 +789,14 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
 
   folly::Synchronized<TreeInodeState> contents_;
 
+  /**
+   * False while contents_ is unbuilt.
+   *
+   * This mirrors TreeInodeState::isUnbuilt() so that ensureEntriesBuilt() does
+   * not need to acquire the contents_ lock once the entries have been built.
+   */
+  std::atomic<bool> entriesBuilt_{true};
+
   /**
    * Only prefetch blob metadata on the first readdir() of a loaded inode.
    */
@@ -221,6 +221,22 @@ InodeNumber FsOverlay::scanForNextInodeNumber() {
       continue;
     }
 
+    if (dir->__isset.firstChildInodeNumber) {
+      // An unmodified directory that only saved the inode numbers of its
+      // children.  Any of them that has overlay data is a directory saved the
+      // same way.
+      auto firstChild = dir->firstChildInodeNumber_ref().value_unchecked();
+      auto count = dir->childCount_ref().value_unchecked();
+      for (int64_t index = 0; index < count; ++index) {
+        auto childInode = InodeNumber::fromThrift(firstChild + index);
+        maxInode = std::max(maxInode, childInode);
+        if (hasOverlayData(childInode)) {
+          toProcess.push_back(childInode);
+        }
+      }
+      continue;
+    }
+
     for (const auto& entry : dir.value().entries) {
       if (entry.second.inodeNumber == 0) {
         continue;
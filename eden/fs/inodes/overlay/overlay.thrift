@@ -42,4 +42,10 @@ struct OverlayEntry {
 struct OverlayDir {
   // The contents of this dir.
   1: map<PathComponent, OverlayEntry> entries
+  // Set instead of entries for an unmodified source control directory.  Its
+  // children have consecutive inode numbers in the order of the source
+  // control Tree's entries, starting at firstChildInodeNumber, and the
+  // entries themselves are read from the Tree when the directory is loaded.
+  2: optional i64 firstChildInodeNumber
+  3: optional i64 childCount
 }
@@ -14,6 +14,7 @@
 #include <gtest/gtest.h>
 
 #include "eden/fs/inodes/DiffContext.h"
+#include "eden/fs/inodes/Differ.h"
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/InodeDiffCallback.h"
 #include "eden/fs/inodes/TopLevelIgnores.h"
@@ -29,6 +30,7 @@ using namespace facebook::eden;
 using folly::StringPiece;
 using namespace std::chrono_literals;
 using std::string;
+using ::testing::Pair;
 using ::testing::UnorderedElementsAre;
 
 class DiffResults {
@@ -1231,3 +1233,50 @@ TEST(DiffTest, fileNotReady) {
           RelativePath{"doc/c.txt"},
           RelativePath{"doc/d.txt"}));
 }
+
+TEST(DiffTest, statusCacheRediffsChangedPaths) {
+  FakeTreeBuilder builder;
+  builder.setFiles({
+      {"src/main.c", "main"},
+      {"src/lib.c", "lib"},
+      {"doc/readme.txt", "readme"},
+  });
+  TestMount mount{builder};
+  auto edenMount = mount.getEdenMount();
+  auto commitHash = edenMount->getParentCommits().parent1();
+  const auto& cache = edenMount->getScmStatusCache();
+
+  auto getStatus = [&] {
+    auto future = diffMountForStatus(*edenMount, commitHash, false);
+    return EXPECT_FUTURE_RESULT(future)->entries;
+  };
+
+  mount.addFile("src/new.c", "new");
+  EXPECT_THAT(
+      getStatus(),
+      UnorderedElementsAre(Pair("src/new.c", ScmFileStatus::ADDED)));
+  EXPECT_EQ(1, cache.getMissCount());
+
+  // Nothing changed, so the cached status is returned as is.
+  EXPECT_THAT(
+      getStatus(),
+      UnorderedElementsAre(Pair("src/new.c", ScmFileStatus::ADDED)));
+  EXPECT_EQ(1, cache.getHitCount());
+
+  // Only the paths recorded in the journal are diffed again.
+  mount.overwriteFile("doc/readme.txt", "changed");
+  mount.deleteFile("src/new.c");
+  EXPECT_THAT(
+      getStatus(),
+      UnorderedElementsAre(Pair("doc/readme.txt", ScmFileStatus::MODIFIED)));
+  EXPECT_EQ(1, cache.getIncrementalHitCount());
+  EXPECT_EQ(2, cache.getRediffPathCount());
+  EXPECT_EQ(1, cache.getMissCount());
+
+  // Changing the parent commit invalidates the cache.
+  edenMount->resetParent(commitHash);
+  EXPECT_THAT(
+      getStatus(),
+      UnorderedElementsAre(Pair("doc/readme.txt", ScmFileStatus::MODIFIED)));
+  EXPECT_EQ(2, cache.getMissCount());
+}
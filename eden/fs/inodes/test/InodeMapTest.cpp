@@ -13,6 +13,7 @@
 #include <folly/String.h>
 #include <folly/test/TestUtils.h>
 #include <gtest/gtest.h>
+#include <thread>
 
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/FileInode.h"
@@ -349,6 +350,54 @@ TEST(InodeMap, unloadedFileMetadataIsForgotten) {
   EXPECT_FALSE(mount.hasMetadata(file2ino));
 }
 
+TEST(InodeMap, concurrentLookupsOfUnloadedInodes) {
+  // Create enough inodes that parents and children land in different shards.
+  FakeTreeBuilder builder;
+  std::vector<RelativePath> paths;
+  for (int dir = 0; dir < 8; ++dir) {
+    for (int file = 0; file < 8; ++file) {
+      paths.emplace_back(folly::sformat("dir{}/sub/file{}.txt", dir, file));
+      builder.setFile(paths.back().stringPiece(), "contents");
+    }
+  }
+  TestMount testMount{builder};
+  auto edenMount = testMount.getEdenMount();
+  auto* inodeMap = edenMount->getInodeMap();
+
+  std::vector<InodeNumber> inodeNumbers;
+  for (const auto& path : paths) {
+    auto inode = edenMount->getInode(path).get();
+    inode->incFuseRefcount();
+    inodeNumbers.push_back(inode->getNodeId());
+  }
+
+  // Unload everything so that each lookup has to walk up through unloaded
+  // parents.
+  edenMount->getRootInode()->unloadChildrenNow();
+  // 64 files + 8 "dirN" trees + 8 "dirN/sub" trees
+  EXPECT_EQ(80, inodeMap->getUnloadedInodeCount());
+
+  constexpr size_t kThreadCount = 4;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreadCount; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t n = 0; n < inodeNumbers.size(); ++n) {
+        auto index = (n + t * 16) % inodeNumbers.size();
+        auto inode = inodeMap->lookupInode(inodeNumbers[index]).get(10s);
+        EXPECT_EQ(paths[index], inode->getPath().value());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(0, inodeMap->getUnloadedInodeCount());
+  for (const auto& number : inodeNumbers) {
+    inodeMap->decFuseRefcount(number);
+  }
+}
+
 struct InodePersistenceTreeTest : ::testing::Test {
   InodePersistenceTreeTest() {
     builder.setFile("dir/file1.txt", "contents1");
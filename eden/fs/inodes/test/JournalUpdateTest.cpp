@@ -39,7 +39,7 @@ TEST_F(JournalUpdateTest, moveFileRename) {
   mount_.addFile("new_file.txt", "");
   mount_.move("new_file.txt", "new_file2.txt");
 
-  auto mergedDelta = journal.getLatest()->merge(testStart);
+  auto mergedDelta = journal.accumulateRange(testStart);
 
   auto oldPath = RelativePath{"new_file.txt"};
   auto newPath = RelativePath{"new_file2.txt"};
@@ -63,7 +63,7 @@ TEST_F(JournalUpdateTest, moveFileReplace) {
   mount_.move("new_file.txt", "existing_file.txt");
   mount_.deleteFile("existing_file.txt");
 
-  auto mergedDelta = journal.getLatest()->merge(testStart);
+  auto mergedDelta = journal.accumulateRange(testStart);
 
   auto oldPath = RelativePath{"existing_file.txt"};
   auto newPath = RelativePath{"new_file.txt"};
@@ -78,3 +78,20 @@ TEST_F(JournalUpdateTest, moveFileReplace) {
 
   EXPECT_EQ(mergedDelta->uncleanPaths, std::unordered_set<RelativePath>{});
 }
+
+TEST_F(JournalUpdateTest, journalIsRestoredAfterRemount) {
+  auto generation = mount_.getEdenMount()->getMountGeneration();
+  auto testStart = mount_.getEdenMount()->getJournal().getLatest()->toSequence;
+
+  mount_.addFile("new_file.txt", "");
+  mount_.remount();
+
+  // Clients can keep using the journal positions they had.
+  EXPECT_EQ(generation, mount_.getEdenMount()->getMountGeneration());
+  auto mergedDelta =
+      mount_.getEdenMount()->getJournal().accumulateRange(testStart + 1);
+  ASSERT_TRUE(mergedDelta);
+  EXPECT_EQ(testStart + 1, mergedDelta->fromSequence);
+  auto newPath = RelativePath{"new_file.txt"};
+  EXPECT_EQ(1, mergedDelta->changedFilesInOverlay.count(newPath));
+}
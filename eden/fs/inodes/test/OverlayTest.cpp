@@ -367,6 +367,42 @@ TEST_P(RawOverlayTest, remembers_max_inode_number_of_tree_entries) {
   EXPECT_EQ(4_ino, overlay->getMaxInodeNumber());
 }
 
+TEST_P(RawOverlayTest, remembers_max_inode_number_of_saved_child_numbers) {
+  auto ino2 = overlay->allocateInodeNumber();
+  EXPECT_EQ(2_ino, ino2);
+
+  DirContents root;
+  root.emplace("dir"_pc, S_IFDIR | 0755, ino2);
+  overlay->saveOverlayDir(kRootNodeId, root);
+
+  // dir is unmodified and has three children, the second of which is an
+  // unmodified directory with two children of its own.
+  auto firstChild = overlay->allocateInodeNumbers(3);
+  EXPECT_EQ(3_ino, firstChild);
+  overlay->saveChildInodeNumbers(ino2, firstChild, 3);
+  auto firstGrandchild = overlay->allocateInodeNumbers(2);
+  EXPECT_EQ(6_ino, firstGrandchild);
+  overlay->saveChildInodeNumbers(4_ino, firstGrandchild, 2);
+
+  recreate();
+
+  EXPECT_EQ(7_ino, overlay->getMaxInodeNumber());
+}
+
+TEST_P(RawOverlayTest, recursive_removal_collects_saved_child_numbers) {
+  auto ino2 = overlay->allocateInodeNumber();
+  auto firstChild = overlay->allocateInodeNumbers(2);
+  overlay->saveChildInodeNumbers(ino2, firstChild, 2);
+  auto subdirIno = InodeNumber{firstChild.get() + 1};
+  overlay->saveChildInodeNumbers(subdirIno, InodeNumber{}, 0);
+
+  overlay->recursivelyRemoveOverlayData(ino2);
+  overlay->flushPendingAsync().get();
+
+  EXPECT_FALSE(overlay->hasOverlayData(ino2));
+  EXPECT_FALSE(overlay->hasOverlayData(subdirIno));
+}
+
 TEST_P(RawOverlayTest, remembers_max_inode_number_of_file) {
   auto ino2 = overlay->allocateInodeNumber();
   EXPECT_EQ(2_ino, ino2);
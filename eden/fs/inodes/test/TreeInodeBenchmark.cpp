@@ -0,0 +1,130 @@
+/*
+ *  Copyright (c) 2018-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/init/Init.h>
+#include <folly/stop_watch.h>
+#include <gflags/gflags.h>
+#include <unistd.h>
+#include "eden/fs/fuse/DirList.h"
+#include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+using namespace facebook::eden;
+
+DEFINE_uint64(dirs, 10000, "Number of directories to load");
+DEFINE_uint64(files, 50, "Number of files in each directory");
+
+namespace {
+
+/**
+ * Returns the resident set size of this process in bytes.
+ */
+uint64_t getResidentBytes() {
+  std::string statm;
+  if (!folly::readFile("/proc/self/statm", statm)) {
+    return 0;
+  }
+  std::vector<folly::StringPiece> fields;
+  folly::split(' ', statm, fields);
+  if (fields.size() < 2) {
+    return 0;
+  }
+  return folly::to<uint64_t>(fields[1]) * sysconf(_SC_PAGESIZE);
+}
+
+double toMicros(std::chrono::nanoseconds duration) {
+  return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(
+             duration)
+      .count();
+}
+
+void benchmarkTreeInodeLoad() {
+  // Loading a directory that is never modified should cost little more than
+  // the source control Tree it shares.  This measures the memory retained per
+  // TreeInode loaded from a Tree, how long the first readdir() of each of
+  // these unbuilt directories takes, and, for comparison, the memory they
+  // retain once their entries are built.
+  FakeTreeBuilder builder;
+  for (uint64_t d = 0; d < FLAGS_dirs; ++d) {
+    for (uint64_t f = 0; f < FLAGS_files; ++f) {
+      builder.setFile(folly::to<std::string>("dir", d, "/file", f), "");
+    }
+  }
+  TestMount mount{builder};
+
+  // Fetch every Tree first, and keep them alive, so that the measurements
+  // below include neither the ObjectStore fetches nor the Trees themselves.
+  auto* objectStore = mount.getEdenMount()->getObjectStore();
+  std::vector<std::shared_ptr<const Tree>> trees;
+  trees.reserve(FLAGS_dirs);
+  for (uint64_t d = 0; d < FLAGS_dirs; ++d) {
+    auto path = RelativePath{folly::to<std::string>("dir", d)};
+    auto hash = builder.getStoredTree(path)->get().getHash();
+    trees.push_back(objectStore->getTree(hash).get());
+  }
+
+  std::vector<TreeInodePtr> dirs;
+  dirs.reserve(FLAGS_dirs);
+  auto rssBefore = getResidentBytes();
+  folly::stop_watch<> loadTimer;
+  for (uint64_t d = 0; d < FLAGS_dirs; ++d) {
+    dirs.push_back(mount.getTreeInode(folly::to<std::string>("dir", d)));
+  }
+  auto loadElapsed = loadTimer.elapsed();
+  auto rssLoaded = getResidentBytes();
+
+  folly::stop_watch<> readdirTimer;
+  for (auto& dir : dirs) {
+    dir->readdir(DirList{4096}, 0);
+  }
+  auto readdirElapsed = readdirTimer.elapsed();
+
+  auto rssBeforeBuild = getResidentBytes();
+  for (auto& dir : dirs) {
+    dir->ensureEntriesBuilt();
+  }
+  auto rssBuilt = getResidentBytes();
+
+  printf(
+      "Loaded %" PRIu64 " directories of %" PRIu64 " files\n",
+      FLAGS_dirs,
+      FLAGS_files);
+  printf(
+      "Average load time: %.2f us\n",
+      toMicros(loadElapsed / FLAGS_dirs));
+  printf(
+      "Average resident memory per loaded directory: %.0f bytes\n",
+      static_cast<double>(rssLoaded - rssBefore) / FLAGS_dirs);
+  printf(
+      "Average time to first readdir: %.2f us\n",
+      toMicros(readdirElapsed / FLAGS_dirs));
+  printf(
+      "Average additional resident memory once built: %.0f bytes\n",
+      static_cast<double>(rssBuilt - rssBeforeBuild) / FLAGS_dirs);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+
+  if (FLAGS_dirs == 0) {
+    fprintf(stderr, "error: dirs must be nonzero\n");
+    return 1;
+  }
+
+  benchmarkTreeInodeLoad();
+
+  return 0;
+}
@@ -15,8 +15,10 @@
 #include <folly/portability/GTest.h>
 #include <folly/test/TestUtils.h>
 #include <gflags/gflags.h>
+#include <variant>
 #include "eden/fs/fuse/DirList.h"
 #include "eden/fs/inodes/FileInode.h"
+#include "eden/fs/inodes/Overlay.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/TreeEntry.h"
 #include "eden/fs/testharness/FakeTreeBuilder.h"
@@ -158,6 +160,177 @@ TEST(TreeInode, readdirIgnoresWildOffsets) {
   EXPECT_EQ(0, result.size());
 }
 
+TEST(TreeInode, readdirBeforeLookupReturnsStableInodeNumbers) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/a", ""}, {"dir/b", ""}, {"dir/sub/c", ""}});
+  TestMount mount{builder};
+
+  // A directory that has only been read and stat'ed is served directly from
+  // its source control Tree.  The inode numbers it reports must match the
+  // ones its children get when they are looked up later.
+  auto dir = mount.getTreeInode("dir");
+  EXPECT_EQ(5, dir->getattr().get(10ms).st.st_nlink);
+
+  auto result = dir->readdir(DirList{4096}, 0).extract();
+  ASSERT_EQ(5, result.size());
+  EXPECT_EQ("a", result[2].name);
+  EXPECT_EQ("b", result[3].name);
+  EXPECT_EQ("sub", result[4].name);
+  EXPECT_EQ(dtype_t::Dir, result[4].type);
+
+  auto resumed = dir->readdir(DirList{4096}, result[2].offset).extract();
+  ASSERT_EQ(2, resumed.size());
+  EXPECT_EQ("b", resumed[0].name);
+
+  EXPECT_EQ(result[2].inode, mount.getInode("dir/a")->getNodeId().get());
+  EXPECT_EQ(result[3].inode, mount.getInode("dir/b")->getNodeId().get());
+  EXPECT_EQ(result[4].inode, mount.getInode("dir/sub")->getNodeId().get());
+
+  // Building the directory's entries must not change readdir either.
+  dir->ensureEntriesBuilt();
+  auto built = dir->readdir(DirList{4096}, 0).extract();
+  ASSERT_EQ(result.size(), built.size());
+  for (size_t n = 0; n < result.size(); ++n) {
+    EXPECT_EQ(result[n].name, built[n].name);
+    EXPECT_EQ(result[n].inode, built[n].inode);
+    EXPECT_EQ(result[n].offset, built[n].offset);
+  }
+  EXPECT_EQ(5, dir->getattr().get(10ms).st.st_nlink);
+}
+
+TEST(TreeInode, unbuiltDirectoryKeepsInodeNumbersWhenReloaded) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/a", ""}, {"dir/b", ""}});
+  TestMount mount{builder};
+
+  auto dir = mount.getTreeInode("dir");
+  auto before = dir->readdir(DirList{4096}, 0).extract();
+  ASSERT_EQ(4, before.size());
+  auto maxInodeNumber = mount.getEdenMount()->getOverlay()->getMaxInodeNumber();
+
+  // Unload the directory without ever building its entries, then load it
+  // again.
+  dir.reset();
+  mount.getEdenMount()->getRootInode()->unloadChildrenNow();
+  dir = mount.getTreeInode("dir");
+
+  auto after = dir->readdir(DirList{4096}, 0).extract();
+  ASSERT_EQ(before.size(), after.size());
+  for (size_t n = 2; n < before.size(); ++n) {
+    EXPECT_EQ(before[n].name, after[n].name);
+    EXPECT_EQ(before[n].inode, after[n].inode);
+  }
+  EXPECT_EQ(
+      maxInodeNumber, mount.getEdenMount()->getOverlay()->getMaxInodeNumber());
+}
+
+TEST(TreeInode, lookupsKeepDirectoryUnbuiltUntilModified) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/a", ""}, {"dir/b", ""}, {"dir/sub/c", ""}});
+  TestMount mount{builder};
+
+  auto dir = mount.getTreeInode("dir");
+  auto a = mount.getInode("dir/a");
+  auto sub = mount.getTreeInode("dir/sub");
+  {
+    // Only the loaded children have entries.
+    auto contents = dir->getContentsMaybeUnbuilt().rlock();
+    EXPECT_TRUE(contents->isUnbuilt());
+    EXPECT_EQ(2, contents->entries.size());
+    EXPECT_EQ(3, contents->getEntryCount());
+  }
+
+  // The overlay holds only the inode numbers of the unmodified directories.
+  auto* overlay = mount.getEdenMount()->getOverlay();
+  for (auto number : {dir->getNodeId(), sub->getNodeId()}) {
+    auto saved = overlay->loadUnmaterializedDir(number);
+    ASSERT_TRUE(saved.has_value());
+    EXPECT_TRUE(std::holds_alternative<InodeNumber>(*saved));
+  }
+
+  // The first modification builds the entries, keeping the loaded children.
+  dir->mkdir("new"_pc, S_IFDIR | 0755);
+  {
+    auto contents = dir->getContentsMaybeUnbuilt().rlock();
+    EXPECT_FALSE(contents->isUnbuilt());
+    EXPECT_EQ(4, contents->entries.size());
+    EXPECT_EQ(a.get(), contents->entries.find("a"_pc)->second.getInode());
+    EXPECT_EQ(sub.get(), contents->entries.find("sub"_pc)->second.getInode());
+  }
+  EXPECT_EQ(4, overlay->loadOverlayDir(dir->getNodeId())->size());
+}
+
+#ifdef __linux__
+TEST(TreeInode, readdirplusReturnsLookupResults) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"file", "contents"}, {"dir/sub", ""}});
+  TestMount mount{builder};
+
+  auto root = mount.getEdenMount()->getRootInode();
+  auto result = root->readdirplus(DirPlusList{4096}, 0).get(10ms).extract();
+
+  ASSERT_EQ(5, result.size());
+  EXPECT_EQ(".", result[0].name);
+  EXPECT_EQ("..", result[1].name);
+  // The kernel does not take references on . and .., so no lookup results
+  // should be returned for them.
+  EXPECT_EQ(0, result[0].entry.nodeid);
+  EXPECT_EQ(0, result[1].entry.nodeid);
+
+  for (const auto& entry : result) {
+    if (entry.name == "file") {
+      EXPECT_EQ(entry.inode, entry.entry.nodeid);
+      EXPECT_TRUE(S_ISREG(entry.entry.attr.mode));
+      EXPECT_EQ(8, entry.entry.attr.size);
+    } else if (entry.name == "dir") {
+      EXPECT_EQ(entry.inode, entry.entry.nodeid);
+      EXPECT_TRUE(S_ISDIR(entry.entry.attr.mode));
+    }
+  }
+
+  // Each returned child now holds one FUSE reference, as after a lookup.
+  EXPECT_EQ(1, mount.getFileInode("file")->debugGetFuseRefcount());
+  EXPECT_EQ(1, mount.getTreeInode("dir")->debugGetFuseRefcount());
+}
+
+TEST(TreeInode, readdirplusMatchesReaddirOffsets) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"a", ""}, {"b", ""}, {"c/d", ""}});
+  TestMount mount{builder};
+
+  auto root = mount.getEdenMount()->getRootInode();
+  auto plain = root->readdir(DirList{4096}, 0).extract();
+  auto plus = root->readdirplus(DirPlusList{4096}, 0).get(10ms).extract();
+
+  ASSERT_EQ(plain.size(), plus.size());
+  for (size_t n = 0; n < plain.size(); ++n) {
+    EXPECT_EQ(plain[n].name, plus[n].name);
+    EXPECT_EQ(plain[n].inode, plus[n].inode);
+    EXPECT_EQ(plain[n].type, plus[n].type);
+    EXPECT_EQ(plain[n].offset, plus[n].offset);
+  }
+
+  // Resuming from any offset continues with the next entry.
+  auto rest =
+      root->readdirplus(DirPlusList{4096}, plus[2].offset).get(10ms).extract();
+  ASSERT_EQ(plus.size() - 3, rest.size());
+  EXPECT_EQ(plus[3].name, rest[0].name);
+}
+
+TEST(TreeInode, readdirplusOnlyReferencesEntriesThatFit) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"file", ""}});
+  TestMount mount{builder};
+
+  auto root = mount.getEdenMount()->getRootInode();
+  auto size = DirPlusList::entrySize(".") + DirPlusList::entrySize("..");
+  auto result = root->readdirplus(DirPlusList{size}, 0).get(10ms).extract();
+
+  ASSERT_EQ(2, result.size());
+  EXPECT_EQ(0, mount.getFileInode("file")->debugGetFuseRefcount());
+}
+#endif
+
 namespace {
 
 // 500 is big enough for ~9 entries
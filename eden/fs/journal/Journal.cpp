@@ -8,68 +8,512 @@
  *
  */
 #include "Journal.h"
+#include <folly/Memory.h>
+#include <folly/futures/Future.h>
+#include <folly/logging/xlog.h>
+#include <glog/logging.h>
+#include <iterator>
+#include <unordered_set>
 
 namespace facebook {
 namespace eden {
 
+namespace {
+folly::StringPiece eventCharacterizationFor(const PathChangeInfo& ci) {
+  if (ci.existedBefore && !ci.existedAfter) {
+    return "Removed";
+  } else if (!ci.existedBefore && ci.existedAfter) {
+    return "Created";
+  } else if (ci.existedBefore && ci.existedAfter) {
+    return "Changed";
+  } else {
+    return "Ghost";
+  }
+}
+
+template <typename T>
+size_t estimateVectorMemoryUsage(const std::vector<T>& vector) {
+  return vector.capacity() == 0
+      ? 0
+      : folly::goodMallocSize(vector.capacity() * sizeof(T));
+}
+} // namespace
+
+class Journal::Accumulator {
+ public:
+  void mergeOlder(const StoredDelta& older) {
+    range_.mergeOlder(older);
+
+    // Merge the unclean status list
+    for (const auto& path : older.uncleanPaths) {
+      uncleanPaths_.insert(path);
+    }
+
+    for (const auto& [path, olderInfo] : older.changedFilesInOverlay) {
+      auto it = changedFilesInOverlay_.find(path);
+      if (it == changedFilesInOverlay_.end()) {
+        changedFilesInOverlay_.emplace(path, olderInfo);
+        continue;
+      }
+
+      auto& info = it->second;
+      if (info.existedBefore != olderInfo.existedAfter) {
+        auto event1 = eventCharacterizationFor(olderInfo);
+        auto event2 = eventCharacterizationFor(info);
+        XLOG(ERR) << "Journal for " << path.toRelativePath()
+                  << " holds invalid " << event1 << ", " << event2
+                  << " sequence";
+      }
+      info.existedBefore = olderInfo.existedBefore;
+    }
+  }
+
+  StoredDeltaPtr toStoredDelta() const {
+    auto result = std::make_shared<StoredDelta>();
+    static_cast<JournalDeltaRange&>(*result) = range_;
+    result->changedFilesInOverlay.assign(
+        changedFilesInOverlay_.begin(), changedFilesInOverlay_.end());
+    result->uncleanPaths.assign(uncleanPaths_.begin(), uncleanPaths_.end());
+    return result;
+  }
+
+  std::unique_ptr<JournalDelta> toJournalDelta() const {
+    auto result = std::make_unique<JournalDelta>();
+    static_cast<JournalDeltaRange&>(*result) = range_;
+    for (const auto& [path, info] : changedFilesInOverlay_) {
+      result->changedFilesInOverlay.emplace(path.toRelativePath(), info);
+    }
+    for (const auto& path : uncleanPaths_) {
+      result->uncleanPaths.insert(path.toRelativePath());
+    }
+    return result;
+  }
+
+ private:
+  JournalDeltaRange range_;
+  std::unordered_map<InternedPath, PathChangeInfo> changedFilesInOverlay_;
+  std::unordered_set<InternedPath> uncleanPaths_;
+};
+
+JournalDelta Journal::StoredDelta::materialize() const {
+  JournalDelta result;
+  static_cast<JournalDeltaRange&>(result) = *this;
+  for (const auto& [path, info] : changedFilesInOverlay) {
+    result.changedFilesInOverlay.emplace(path.toRelativePath(), info);
+  }
+  for (const auto& path : uncleanPaths) {
+    result.uncleanPaths.insert(path.toRelativePath());
+  }
+  return result;
+}
+
+size_t Journal::StoredDelta::estimateMemoryUsage() const {
+  return folly::goodMallocSize(sizeof(StoredDelta)) +
+      estimateVectorMemoryUsage(changedFilesInOverlay) +
+      estimateVectorMemoryUsage(uncleanPaths);
+}
+
+std::shared_ptr<Journal::StoredDelta> Journal::intern(
+    const JournalDelta& delta) {
+  auto stored = std::make_shared<StoredDelta>();
+  static_cast<JournalDeltaRange&>(*stored) = delta;
+  stored->changedFilesInOverlay.reserve(delta.changedFilesInOverlay.size());
+  for (const auto& [path, info] : delta.changedFilesInOverlay) {
+    stored->changedFilesInOverlay.emplace_back(paths_.intern(path), info);
+  }
+  stored->uncleanPaths.reserve(delta.uncleanPaths.size());
+  for (const auto& path : delta.uncleanPaths) {
+    stored->uncleanPaths.push_back(paths_.intern(path));
+  }
+  return stored;
+}
+
 void Journal::addDelta(std::unique_ptr<JournalDelta>&& delta) {
+  // Intern the paths before taking the lock.
+  auto stored = intern(*delta);
+
+  // Segments dropped by compact() are destroyed after releasing the lock.
+  std::deque<Segment> discarded;
+  bool flushNeeded = false;
+  std::shared_ptr<folly::Executor> logExecutor;
   {
     auto deltaState = deltaState_.wlock();
+    auto& segments = deltaState->segments;
 
-    delta->toSequence = deltaState->nextSequence++;
-    delta->fromSequence = delta->toSequence;
-
-    delta->toTime = std::chrono::steady_clock::now();
-    delta->fromTime = delta->toTime;
+    stored->toSequence = deltaState->nextSequence++;
+    stored->fromSequence = stored->toSequence;
 
-    delta->previous = deltaState->latest;
+    stored->toTime = std::chrono::steady_clock::now();
+    stored->fromTime = stored->toTime;
 
     // If the hashes were not set to anything, default to copying
     // the value from the prior journal entry
-    if (delta->previous && delta->fromHash == kZeroHash &&
-        delta->toHash == kZeroHash) {
-      delta->fromHash = delta->previous->toHash;
-      delta->toHash = delta->fromHash;
+    if (!segments.empty() && stored->fromHash == kZeroHash &&
+        stored->toHash == kZeroHash) {
+      stored->fromHash = segments.back().deltas.back()->toHash;
+      stored->toHash = stored->fromHash;
+    }
+
+    if (deltaState->recording) {
+      // Queue the delta while holding the lock, so that the log receives the
+      // deltas in sequence order, but encode and write it later.
+      static_cast<JournalDeltaRange&>(*delta) = *stored;
+      auto unlogged = logState_->unlogged.wlock();
+      unlogged->deltas.push_back(std::move(delta));
+      if (!unlogged->flushScheduled) {
+        unlogged->flushScheduled = true;
+        flushNeeded = true;
+        logExecutor = unlogged->executor;
+      }
     }
 
-    if (deltaState->stats) {
-      ++(deltaState->stats->entryCount);
-      deltaState->stats->memoryUsage += delta->estimateMemoryUsage();
-      deltaState->stats->earliestTimestamp =
-          std::min(deltaState->stats->earliestTimestamp, delta->fromTime);
-      deltaState->stats->latestTimestamp =
-          std::max(deltaState->stats->latestTimestamp, delta->toTime);
+    discarded = insert(*deltaState, std::move(stored));
+  }
+
+  if (flushNeeded) {
+    if (logExecutor) {
+      logExecutor->add([state = logState_] { flushLog(*state); });
     } else {
-      deltaState->stats = JournalStats();
-      deltaState->stats->entryCount = 1;
-      deltaState->stats->memoryUsage = delta->estimateMemoryUsage();
-      deltaState->stats->earliestTimestamp = delta->fromTime;
-      deltaState->stats->latestTimestamp = delta->toTime;
+      flushLog(*logState_);
     }
+  }
 
-    deltaState->latest = JournalDeltaPtr{std::move(delta)};
+  auto subscriberState = subscriberState_->wlock();
+  if (subscriberState->executor) {
+    auto now = std::chrono::steady_clock::now();
+    subscriberState->lastPendingChange = now;
+    if (!subscriberState->notificationPending) {
+      // The subscribers will be called for this delta, and any others added
+      // before the notification runs.
+      subscriberState->notificationPending = true;
+      subscriberState->firstPendingChange = now;
+      auto delay = std::min(
+          subscriberState->minInterval, subscriberState->maxLatency);
+      subscriberState.unlock();
+      scheduleNotification(subscriberState_, delay);
+    }
+    return;
   }
 
   // Careful to call the subscribers with no locks held.
-  auto subscribers = subscriberState_.rlock()->subscribers;
+  auto subscribers = subscriberState->subscribers;
+  subscriberState.unlock();
   for (auto& sub : subscribers) {
     sub.second();
   }
 }
 
-JournalDeltaPtr Journal::getLatest() const {
-  return deltaState_.rlock()->latest;
+void Journal::scheduleNotification(
+    std::shared_ptr<SharedSubscriberState> state,
+    std::chrono::nanoseconds delay) {
+  auto executor = state->rlock()->executor;
+  if (delay <= std::chrono::nanoseconds::zero()) {
+    executor->add([state = std::move(state)]() mutable {
+      runNotification(std::move(state));
+    });
+    return;
+  }
+
+  // Round up, so that runNotification() does not find that it is still
+  // too early and reschedule itself for a fraction of a millisecond.
+  folly::futures::sleep(std::chrono::ceil<folly::Duration>(delay))
+      .via(executor.get())
+      .thenTry([state = std::move(state)](auto&&) mutable {
+        runNotification(std::move(state));
+      });
+}
+
+void Journal::runNotification(std::shared_ptr<SharedSubscriberState> state) {
+  auto subscriberState = state->wlock();
+  auto deadline = std::min(
+      subscriberState->lastPendingChange + subscriberState->minInterval,
+      subscriberState->firstPendingChange + subscriberState->maxLatency);
+  auto now = std::chrono::steady_clock::now();
+  if (now < deadline) {
+    subscriberState.unlock();
+    scheduleNotification(std::move(state), deadline - now);
+    return;
+  }
+
+  // Deltas added from now on schedule another notification, since the
+  // subscribers may look at the journal before those deltas are added.
+  subscriberState->notificationPending = false;
+  auto subscribers = subscriberState->subscribers;
+  subscriberState.unlock();
+  for (auto& sub : subscribers) {
+    sub.second();
+  }
+}
+
+Journal::~Journal() {
+  closeLog();
+}
+
+void Journal::setLog(
+    std::unique_ptr<JournalLog> log,
+    std::shared_ptr<folly::Executor> executor) {
+  log->replay([this](std::unique_ptr<JournalDelta> delta) {
+    auto stored = intern(*delta);
+    delta.reset();
+
+    std::deque<Segment> discarded;
+    auto deltaState = deltaState_.wlock();
+    DCHECK_GE(stored->fromSequence, deltaState->nextSequence);
+    deltaState->nextSequence = stored->toSequence + 1;
+    discarded = insert(*deltaState, std::move(stored));
+  });
+
+  log->startRecording();
+  *logState_->log.wlock() = std::move(log);
+  logState_->unlogged.wlock()->executor = std::move(executor);
+  deltaState_.wlock()->recording = true;
+}
+
+void Journal::closeLog() {
+  // Every delta queued before recording stops is written by flushLog().
+  deltaState_.wlock()->recording = false;
+  flushLog(*logState_);
+  // Destroying the log closes it.
+  logState_->log.wlock()->reset();
+}
+
+void Journal::flushLog(LogState& state) {
+  // Take the deltas while holding the log's lock, so that concurrent flushes
+  // write them in order.
+  auto log = state.log.wlock();
+  std::vector<std::unique_ptr<JournalDelta>> deltas;
+  {
+    auto unlogged = state.unlogged.wlock();
+    deltas.swap(unlogged->deltas);
+    unlogged->flushScheduled = false;
+  }
+  if (!*log) {
+    return;
+  }
+  for (const auto& delta : deltas) {
+    (*log)->append(*delta);
+  }
+  (*log)->flush();
+}
+
+std::deque<Journal::Segment> Journal::insert(
+    DeltaState& deltaState,
+    std::shared_ptr<StoredDelta> stored) const {
+  auto& segments = deltaState.segments;
+
+  auto memoryUsage = stored->estimateMemoryUsage();
+  if (deltaState.stats) {
+    ++(deltaState.stats->entryCount);
+    deltaState.stats->memoryUsage += memoryUsage;
+    deltaState.stats->earliestTimestamp =
+        std::min(deltaState.stats->earliestTimestamp, stored->fromTime);
+    deltaState.stats->latestTimestamp =
+        std::max(deltaState.stats->latestTimestamp, stored->toTime);
+  } else {
+    deltaState.stats = JournalStats();
+    deltaState.stats->entryCount = 1;
+    deltaState.stats->memoryUsage = memoryUsage;
+    deltaState.stats->earliestTimestamp = stored->fromTime;
+    deltaState.stats->latestTimestamp = stored->toTime;
+  }
+
+  if (segments.empty() || segments.back().summary) {
+    segments.emplace_back();
+  }
+  auto& segment = segments.back();
+  segment.deltas.push_back(std::move(stored));
+  segment.memoryUsage += memoryUsage;
+
+  if (segment.deltas.size() == kSegmentSize) {
+    Accumulator summary;
+    for (auto it = segment.deltas.rbegin(); it != segment.deltas.rend();
+         ++it) {
+      summary.mergeOlder(**it);
+    }
+    segment.summary = summary.toStoredDelta();
+    auto summaryMemoryUsage = segment.summary->estimateMemoryUsage();
+    segment.memoryUsage += summaryMemoryUsage;
+    deltaState.stats->memoryUsage += summaryMemoryUsage;
+  }
+
+  if (deltaState.stats->memoryUsage + paths_.estimateMemoryUsage() >
+      memoryLimit_) {
+    return compact(deltaState);
+  }
+  return {};
+}
+
+std::deque<Journal::Segment> Journal::compact(DeltaState& deltaState) const {
+  auto& segments = deltaState.segments;
+  auto& stats = deltaState.stats.value();
+
+  // Keep the newest segments that fit in half of the limit, so that the
+  // amortized cost of compaction stays proportional to the size of the deltas
+  // added.  The interned paths are shared by all of the segments, so count
+  // each segment as using them in proportion to its own memory usage.  Always
+  // keep the last segment, however large it is.
+  auto deltaMemory = static_cast<double>(stats.memoryUsage);
+  auto totalMemory = deltaMemory + paths_.estimateMemoryUsage();
+  auto keptBudget = static_cast<size_t>(
+      static_cast<double>(memoryLimit_ / 2) * deltaMemory / totalMemory);
+  size_t keptMemory = 0;
+  auto firstKept = segments.end();
+  while (firstKept != segments.begin()) {
+    auto memory = std::prev(firstKept)->memoryUsage;
+    if (firstKept != segments.end() && keptMemory + memory > keptBudget) {
+      break;
+    }
+    keptMemory += memory;
+    --firstKept;
+  }
+
+  std::deque<Segment> removed;
+  if (firstKept == segments.begin()) {
+    return removed;
+  }
+
+  // Merge everything older into one summary delta.  Queries from positions
+  // inside its range will report a superset of the actual changes.
+  Accumulator accumulator;
+  for (auto it = firstKept; it != segments.begin();) {
+    --it;
+    if (it->summary) {
+      accumulator.mergeOlder(*it->summary);
+    } else {
+      for (auto delta = it->deltas.rbegin(); delta != it->deltas.rend();
+           ++delta) {
+        accumulator.mergeOlder(**delta);
+      }
+    }
+  }
+  removed.insert(
+      removed.end(),
+      std::make_move_iterator(segments.begin()),
+      std::make_move_iterator(firstKept));
+  segments.erase(segments.begin(), firstKept);
+
+  // The interned paths still include those referred to only by the removed
+  // segments, so this overestimates the memory used by keeping the summary.
+  auto summary = accumulator.toStoredDelta();
+  auto summaryMemoryUsage = summary->estimateMemoryUsage();
+  if (keptMemory + summaryMemoryUsage + paths_.estimateMemoryUsage() <=
+      memoryLimit_) {
+    ++stats.compactionCount;
+    Segment segment;
+    segment.deltas.push_back(summary);
+    segment.summary = std::move(summary);
+    segment.memoryUsage = summaryMemoryUsage;
+    segments.push_front(std::move(segment));
+    keptMemory += summaryMemoryUsage;
+  } else {
+    ++stats.truncationCount;
+    XLOG(DBG2) << "journal truncated: discarded deltas "
+               << summary->fromSequence << " to " << summary->toSequence;
+  }
+
+  stats.entryCount = 0;
+  for (const auto& segment : segments) {
+    stats.entryCount += segment.deltas.size();
+  }
+  stats.memoryUsage = keptMemory;
+  stats.earliestTimestamp = segments.front().deltas.front()->fromTime;
+
+  return removed;
+}
+
+std::optional<JournalDeltaRange> Journal::getLatest() const {
+  auto deltaState = deltaState_.rlock();
+  if (deltaState->segments.empty()) {
+    return std::nullopt;
+  }
+  const JournalDeltaRange& latest = *deltaState->segments.back().deltas.back();
+  return latest;
+}
+
+std::unique_ptr<JournalDelta> Journal::accumulateRange(
+    SequenceNumber limitSequence) const {
+  // Merging a long range can take a while, so only collect the deltas to
+  // merge while holding the lock.  They are listed newest first.
+  std::vector<StoredDeltaPtr> toMerge;
+  {
+    auto deltaState = deltaState_.rlock();
+    const auto& segments = deltaState->segments;
+    if (segments.empty() ||
+        segments.back().deltas.back()->toSequence < limitSequence) {
+      return nullptr;
+    }
+
+    auto first = std::partition_point(
+        segments.begin(), segments.end(), [&](const Segment& segment) {
+          return segment.deltas.back()->toSequence < limitSequence;
+        });
+    for (auto it = segments.end(); it != first;) {
+      --it;
+      const auto& deltas = it->deltas;
+      if (it->summary && deltas.front()->toSequence >= limitSequence) {
+        toMerge.push_back(it->summary);
+        continue;
+      }
+      auto begin = std::partition_point(
+          deltas.begin(), deltas.end(), [&](const StoredDeltaPtr& delta) {
+            return delta->toSequence < limitSequence;
+          });
+      toMerge.insert(
+          toMerge.end(),
+          std::make_reverse_iterator(deltas.end()),
+          std::make_reverse_iterator(begin));
+    }
+  }
+
+  Accumulator accumulator;
+  for (const auto& delta : toMerge) {
+    accumulator.mergeOlder(*delta);
+  }
+  return accumulator.toJournalDelta();
+}
+
+std::vector<JournalDelta> Journal::getDeltas(
+    SequenceNumber from,
+    SequenceNumber to) const {
+  std::vector<StoredDeltaPtr> stored;
+  {
+    auto deltaState = deltaState_.rlock();
+    const auto& segments = deltaState->segments;
+    auto first = std::partition_point(
+        segments.begin(), segments.end(), [&](const Segment& segment) {
+          return segment.deltas.back()->toSequence < from;
+        });
+    for (auto it = first;
+         it != segments.end() && it->deltas.front()->fromSequence <= to;
+         ++it) {
+      for (const auto& delta : it->deltas) {
+        if (delta->fromSequence > to) {
+          break;
+        }
+        if (delta->toSequence >= from) {
+          stored.push_back(delta);
+        }
+      }
+    }
+  }
+
+  std::vector<JournalDelta> result;
+  result.reserve(stored.size());
+  for (auto it = stored.rbegin(); it != stored.rend(); ++it) {
+    result.push_back((*it)->materialize());
+  }
+  return result;
 }
 
 uint64_t Journal::registerSubscriber(SubscriberCallback&& callback) {
-  auto subscriberState = subscriberState_.wlock();
+  auto subscriberState = subscriberState_->wlock();
   auto id = subscriberState->nextSubscriberId++;
   subscriberState->subscribers[id] = std::move(callback);
   return id;
 }
 
 void Journal::cancelSubscriber(uint64_t id) {
-  auto subscriberState = subscriberState_.wlock();
+  auto subscriberState = subscriberState_->wlock();
   auto it = subscriberState->subscribers.find(id);
   if (it == subscriberState->subscribers.end()) {
     return;
@@ -87,18 +531,32 @@ void Journal::cancelAllSubscribers() {
   // as part of their tear down, so we need to make sure that we aren't
   // holding the lock when we trigger that.
   std::unordered_map<SubscriberId, SubscriberCallback> subscribers;
-  subscriberState_.wlock()->subscribers.swap(subscribers);
+  subscriberState_->wlock()->subscribers.swap(subscribers);
   subscribers.clear();
 }
 
+void Journal::setSubscriberExecutor(
+    std::shared_ptr<folly::Executor> executor,
+    std::chrono::nanoseconds minInterval,
+    std::chrono::nanoseconds maxLatency) {
+  auto subscriberState = subscriberState_->wlock();
+  subscriberState->executor = std::move(executor);
+  subscriberState->minInterval = minInterval;
+  subscriberState->maxLatency = maxLatency;
+}
+
 bool Journal::isSubscriberValid(uint64_t id) const {
-  auto subscriberState = subscriberState_.rlock();
+  auto subscriberState = subscriberState_->rlock();
   auto& subscribers = subscriberState->subscribers;
   return subscribers.find(id) != subscribers.end();
 }
 
 std::optional<JournalStats> Journal::getStats() {
-  return deltaState_.rlock()->stats;
+  auto stats = deltaState_.rlock()->stats;
+  if (stats) {
+    stats->memoryUsage += paths_.estimateMemoryUsage();
+  }
+  return stats;
 }
 } // namespace eden
 } // namespace facebook
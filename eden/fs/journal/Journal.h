@@ -9,24 +9,38 @@
  */
 #pragma once
 
+#include <folly/Executor.h>
 #include <folly/Function.h>
 #include <folly/Synchronized.h>
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 #include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/journal/JournalLog.h"
+#include "eden/fs/journal/PathInterner.h"
 
 namespace facebook {
 namespace eden {
 
+/** The default limit on the memory used by a Journal's deltas, in bytes */
+constexpr size_t kDefaultJournalMemoryLimit = 1024 * 1024 * 1024;
+
 /** Contains statistics about the current state of the journal */
 struct JournalStats {
   size_t entryCount = 0;
+  /** The memory used by the deltas, including their interned paths */
   size_t memoryUsage = 0;
   std::chrono::steady_clock::time_point earliestTimestamp;
   std::chrono::steady_clock::time_point latestTimestamp;
+  /** The number of times old deltas were merged into a summary delta */
+  size_t compactionCount = 0;
+  /** The number of times old deltas were discarded */
+  size_t truncationCount = 0;
 };
 
 /** The Journal exists to answer questions about how files are changing
@@ -42,18 +56,43 @@ struct JournalStats {
  * revisions (the prior and new revision hash) from which we can derive
  * the larger list of files.
  *
+ * Each distinct path is stored once, in a PathInterner, and the stored deltas
+ * refer to paths by InternedPath.  Path strings are only built for the
+ * results of accumulateRange() and getDeltas().
+ *
+ * The deltas are stored oldest first in segments of kSegmentSize deltas.
+ * Each full segment also holds a summary of its deltas merged together, so
+ * accumulateRange() can find its starting point by binary search and merge
+ * long ranges a segment at a time.
+ *
+ * The memory used by the deltas is bounded.  When it exceeds the limit, the
+ * oldest segments are merged into a single summary delta, so that the newest
+ * segments use at most half of the limit.  If the summary would not fit
+ * either, the oldest segments are discarded instead.  Callers can detect
+ * this: if accumulateRange(sequence + 1) returns a delta whose fromSequence
+ * is greater than sequence + 1, the changes since sequence can no longer be
+ * computed.
+ *
+ * A Journal can record its deltas in a JournalLog, so that it can be
+ * restored when edenfs restarts.  Deltas are queued for the log while
+ * holding the Journal's lock, and written in batches after releasing it.
+ *
  * The Journal class is thread-safe.  Subscribers are called on the thread
- * that called addDelta.
+ * that called addDelta, unless setSubscriberExecutor() has been called.
  */
 class Journal {
  public:
-  Journal() = default;
+  explicit Journal(size_t memoryLimit = kDefaultJournalMemoryLimit)
+      : memoryLimit_{memoryLimit} {}
+
+  /** Closes the log, if any. */
+  ~Journal();
 
   /// It is almost always a mistake to copy a Journal.
   Journal(const Journal&) = delete;
   Journal& operator=(const Journal&) = delete;
 
-  using SequenceNumber = JournalDelta::SequenceNumber;
+  using SequenceNumber = JournalDeltaRange::SequenceNumber;
   using SubscriberId = uint64_t;
   using SubscriberCallback = std::function<void()>;
 
@@ -62,9 +101,38 @@ class Journal {
    * applied. */
   void addDelta(std::unique_ptr<JournalDelta>&& delta);
 
-  /** Get a shared, immutable reference to the tip of the journal.
-   * May return nullptr if there have been no changes */
-  JournalDeltaPtr getLatest() const;
+  /**
+   * Restore the deltas recorded in log, then record every delta added from
+   * now on in it, until closeLog() is called.
+   *
+   * Deltas are written to the log on executor, or from addDelta() after it
+   * releases the lock if executor is null.
+   *
+   * This must be called before any deltas are added.
+   */
+  void setLog(
+      std::unique_ptr<JournalLog> log,
+      std::shared_ptr<folly::Executor> executor = nullptr);
+
+  /** Write any queued deltas to the log, mark it as closed cleanly and stop
+   * recording deltas in it. */
+  void closeLog();
+
+  /** Get the range covered by the tip of the journal.
+   * Returns std::nullopt if there have been no changes */
+  std::optional<JournalDeltaRange> getLatest() const;
+
+  /** Merge all the deltas whose toSequence is >= limitSequence into a single
+   * delta.
+   * A limitSequence of 0, which the Journal never assigns, merges all of
+   * the deltas.
+   * If no deltas match, returns nullptr. */
+  std::unique_ptr<JournalDelta> accumulateRange(
+      SequenceNumber limitSequence = 0) const;
+
+  /** Get the deltas whose ranges overlap [from, to], newest first. */
+  std::vector<JournalDelta> getDeltas(SequenceNumber from, SequenceNumber to)
+      const;
 
   /** Register a subscriber.
    * A subscriber is just a callback that is called whenever the
@@ -80,6 +148,22 @@ class Journal {
   SubscriberId registerSubscriber(SubscriberCallback&& callback);
   void cancelSubscriber(SubscriberId id);
 
+  /**
+   * Call the subscribers on executor rather than on the thread that called
+   * addDelta, so that adding a delta does not wait for them.
+   *
+   * Deltas added in quick succession are coalesced into a single call to
+   * each subscriber: the subscribers are called once no delta has been added
+   * for minInterval, or maxLatency after the first delta they have not been
+   * called for, whichever comes first.
+   *
+   * This must be called before any deltas are added.
+   */
+  void setSubscriberExecutor(
+      std::shared_ptr<folly::Executor> executor,
+      std::chrono::nanoseconds minInterval,
+      std::chrono::nanoseconds maxLatency);
+
   void cancelAllSubscribers();
   bool isSubscriberValid(SubscriberId id) const;
 
@@ -88,23 +172,122 @@ class Journal {
   std::optional<JournalStats> getStats();
 
  private:
+  static constexpr size_t kSegmentSize = 128;
+
+  /** A delta as stored in the journal, with its paths interned */
+  struct StoredDelta : JournalDeltaRange {
+    std::vector<std::pair<InternedPath, PathChangeInfo>> changedFilesInOverlay;
+    std::vector<InternedPath> uncleanPaths;
+
+    /** Build a copy of this delta with the path strings filled in. */
+    JournalDelta materialize() const;
+
+    /** Get memory used (in bytes) by this delta, not counting the interned
+     * paths it refers to. */
+    size_t estimateMemoryUsage() const;
+  };
+  using StoredDeltaPtr = std::shared_ptr<const StoredDelta>;
+
+  /** Merges stored deltas, newest first, without building path strings */
+  class Accumulator;
+
+  struct Segment {
+    /** The deltas in this segment, oldest first */
+    std::vector<StoredDeltaPtr> deltas;
+    /** All of the deltas merged together, once the segment is full */
+    StoredDeltaPtr summary;
+    /** The memory used by deltas and summary */
+    size_t memoryUsage{0};
+  };
+
   struct DeltaState {
     /** The sequence number that we'll use for the next entry
-     * that we link into the chain */
+     * that we add to the journal */
     SequenceNumber nextSequence{1};
-    /** The most recently recorded entry */
-    JournalDeltaPtr latest;
+    /** The recorded deltas, oldest first.  Only the last segment may be
+     * partially filled; a summary left by compact() is a segment of its
+     * own. */
+    std::deque<Segment> segments;
     /** The stats about this Journal up to the latest delta */
     std::optional<JournalStats> stats;
+    /** Whether new deltas are queued for the log */
+    bool recording{false};
   };
+  /** Must outlive the deltas, which refer to it */
+  PathInterner paths_;
   folly::Synchronized<DeltaState> deltaState_;
 
+  /** Build the StoredDelta for delta, interning its paths. */
+  std::shared_ptr<StoredDelta> intern(const JournalDelta& delta);
+
+  /** Add a delta whose sequence numbers have been assigned.  Returns the
+   * segments removed by compact(), so that the caller can destroy them after
+   * releasing the lock. */
+  std::deque<Segment> insert(
+      DeltaState& deltaState,
+      std::shared_ptr<StoredDelta> stored) const;
+
+  /** Merge or discard the oldest segments so that the journal fits within
+   * memoryLimit_.  Returns the removed segments, so that the caller can
+   * destroy them after releasing the lock. */
+  std::deque<Segment> compact(DeltaState& deltaState) const;
+
+  const size_t memoryLimit_;
+
   struct SubscriberState {
     SubscriberId nextSubscriberId{1};
     std::unordered_map<SubscriberId, SubscriberCallback> subscribers;
+
+    /** Where the subscribers are called, or nullptr to call them from
+     * addDelta */
+    std::shared_ptr<folly::Executor> executor;
+    std::chrono::nanoseconds minInterval{0};
+    std::chrono::nanoseconds maxLatency{0};
+    /** Whether a call to the subscribers is scheduled and has not started */
+    bool notificationPending{false};
+    /** When the first and last deltas the subscribers have not been called
+     * for were added */
+    std::chrono::steady_clock::time_point firstPendingChange;
+    std::chrono::steady_clock::time_point lastPendingChange;
   };
+  using SharedSubscriberState = folly::Synchronized<SubscriberState>;
+
+  /** Call runNotification() on the executor once delay has passed. */
+  static void scheduleNotification(
+      std::shared_ptr<SharedSubscriberState> state,
+      std::chrono::nanoseconds delay);
+
+  /** Call the subscribers, unless deltas are still being added and
+   * maxLatency has not passed yet, in which case wait some more. */
+  static void runNotification(std::shared_ptr<SharedSubscriberState> state);
+
+  /** Shared with the scheduled notifications, which may outlive the
+   * Journal */
+  const std::shared_ptr<SharedSubscriberState> subscriberState_{
+      std::make_shared<SharedSubscriberState>()};
+
+  struct UnloggedDeltas {
+    /** Deltas added since the last flushLog(), oldest first */
+    std::vector<std::unique_ptr<JournalDelta>> deltas;
+    /** Whether a flushLog() is due that has not taken the deltas yet */
+    bool flushScheduled{false};
+    /** Where flushLog() runs, or nullptr to run it from addDelta */
+    std::shared_ptr<folly::Executor> executor;
+  };
+
+  /** Where the deltas are recorded.  To avoid deadlock, flushLog() acquires
+   * the log's lock before the unlogged deltas' lock, and addDelta() only
+   * acquires the latter while holding deltaState_'s lock. */
+  struct LogState {
+    folly::Synchronized<std::unique_ptr<JournalLog>> log;
+    folly::Synchronized<UnloggedDeltas> unlogged;
+  };
+
+  /** Write the unlogged deltas to the log, if it is still open. */
+  static void flushLog(LogState& state);
 
-  folly::Synchronized<SubscriberState> subscriberState_;
+  /** Shared with the scheduled flushes, which may outlive the Journal */
+  const std::shared_ptr<LogState> logState_{std::make_shared<LogState>()};
 };
 } // namespace eden
 } // namespace facebook
@@ -10,8 +10,9 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <unordered_map>
 #include <unordered_set>
-#include "eden/fs/journal/JournalDeltaPtr.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -43,10 +44,37 @@ struct PathChangeInfo {
   // delta.
 };
 
-class JournalDelta {
- public:
+/**
+ * The range of sequence numbers, times, and snapshot hashes covered by a
+ * journal delta.
+ */
+struct JournalDeltaRange {
   using SequenceNumber = uint64_t;
 
+  /** The current sequence range.
+   * This is a range to accommodate merging a range into a single entry. */
+  SequenceNumber fromSequence{0};
+  SequenceNumber toSequence{0};
+  /** The time at which the change was recorded.
+   * This is a range to accommodate merging a range into a single entry. */
+  std::chrono::steady_clock::time_point fromTime;
+  std::chrono::steady_clock::time_point toTime;
+
+  /** The snapshot hash that we started and ended up on.
+   * This will often be the same unless we perform a checkout or make
+   * a new snapshot from the snapshotable files in the overlay. */
+  Hash fromHash;
+  Hash toHash;
+
+  /** Extend this range back in time to also cover `older`, which must
+   * immediately precede it.
+   * A default-constructed range is empty: its toSequence of 0 is never
+   * assigned by the Journal, and it takes its upper bound from `older`. */
+  void mergeOlder(const JournalDeltaRange& older);
+};
+
+class JournalDelta : public JournalDeltaRange {
+ public:
   enum Created { CREATED };
   enum Removed { REMOVED };
   enum Changed { CHANGED };
@@ -72,25 +100,6 @@ class JournalDelta {
    */
   JournalDelta(RelativePathPiece oldName, RelativePathPiece newName, Replaced);
 
-  ~JournalDelta();
-
-  /** the prior delta and its chain */
-  JournalDeltaPtr previous;
-  /** The current sequence range.
-   * This is a range to accommodate merging a range into a single entry. */
-  SequenceNumber fromSequence;
-  SequenceNumber toSequence;
-  /** The time at which the change was recorded.
-   * This is a range to accommodate merging a range into a single entry. */
-  std::chrono::steady_clock::time_point fromTime;
-  std::chrono::steady_clock::time_point toTime;
-
-  /** The snapshot hash that we started and ended up on.
-   * This will often be the same unless we perform a checkout or make
-   * a new snapshot from the snapshotable files in the overlay. */
-  Hash fromHash;
-  Hash toHash;
-
   /**
    * The set of files that changed in the overlay in this update, including
    * some information about the changes.
@@ -99,32 +108,6 @@ class JournalDelta {
   /** The set of files that had differing status across a checkout or
    * some other operation that changes the snapshot hash */
   std::unordered_set<RelativePath> uncleanPaths;
-
-  /** Merge the deltas running back from this delta for all deltas
-   * whose toSequence is >= limitSequence.
-   * The default limit value is 0 which is never assigned by the Journal
-   * and thus indicates that all deltas should be merged.
-   * if pruneAfterLimit is true and we stop due to hitting limitSequence,
-   * then the returned delta will have previous=nullptr rather than
-   * maintaining the chain.
-   * If the limitSequence means that no deltas will match, returns nullptr.
-   * */
-  std::unique_ptr<JournalDelta> merge(
-      SequenceNumber limitSequence = 0,
-      bool pruneAfterLimit = false) const;
-
-  /** Get memory used (in bytes) by this Delta */
-  size_t estimateMemoryUsage() const;
-
- private:
-  void incRef() const noexcept;
-  void decRef() const noexcept;
-  bool isUnique() const noexcept;
-
-  mutable std::atomic<size_t> refCount_{0};
-
-  // For reference counting.
-  friend class JournalDeltaPtr;
 };
 
 } // namespace eden
@@ -0,0 +1,514 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/journal/JournalLog.h"
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/hash/Checksum.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/logging/xlog.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/SysMman.h>
+#include <folly/portability/SysStat.h>
+#include <folly/portability/Unistd.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <optional>
+
+using folly::ByteRange;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr std::array<char, 4> kLogMagic{{'E', 'D', 'J', 'L'}};
+constexpr uint32_t kLogVersion = 1;
+
+enum : uint32_t {
+  kStateOpen = 1,
+  kStateClosed = 2,
+};
+
+struct LogHeader {
+  std::array<char, 4> magic;
+  uint32_t version;
+  uint64_t generation;
+  uint32_t state;
+  uint32_t reserved;
+};
+static_assert(sizeof(LogHeader) == 24, "LogHeader must not contain padding");
+
+struct RecordHeader {
+  uint32_t length;
+  uint32_t checksum;
+};
+
+enum : uint8_t {
+  kExistedBefore = 0x01,
+  kExistedAfter = 0x02,
+};
+
+/** A read-only mapping of a whole file. */
+class MappedFile {
+ public:
+  MappedFile(const folly::File& file, AbsolutePathPiece path) {
+    struct stat st;
+    folly::checkUnixError(
+        fstat(file.fd(), &st), "fstat failed on journal log ", path);
+    size_ = st.st_size;
+    if (size_ > 0) {
+      data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file.fd(), 0);
+      if (data_ == MAP_FAILED) {
+        folly::throwSystemError("failed to mmap journal log ", path);
+      }
+    }
+  }
+
+  ~MappedFile() {
+    if (size_ > 0) {
+      munmap(data_, size_);
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ByteRange bytes() const {
+    return ByteRange{static_cast<const uint8_t*>(data_), size_};
+  }
+
+ private:
+  void* data_{nullptr};
+  size_t size_{0};
+};
+
+/*
+ * Journal times come from the steady clock, which restarts from an arbitrary
+ * point when the machine boots, so the log stores wall clock times instead.
+ */
+int64_t toSystemNanos(steady_clock::time_point time) {
+  auto systemTime = system_clock::now() +
+      duration_cast<system_clock::duration>(time - steady_clock::now());
+  return duration_cast<nanoseconds>(systemTime.time_since_epoch()).count();
+}
+
+steady_clock::time_point fromSystemNanos(int64_t nanos) {
+  auto systemTime = system_clock::time_point{
+      duration_cast<system_clock::duration>(nanoseconds{nanos})};
+  return steady_clock::now() +
+      duration_cast<steady_clock::duration>(systemTime - system_clock::now());
+}
+
+std::optional<LogHeader> readHeader(
+    const folly::File& file,
+    AbsolutePathPiece path) {
+  LogHeader header;
+  auto bytesRead = folly::preadFull(file.fd(), &header, sizeof(header), 0);
+  if (bytesRead < 0) {
+    folly::throwSystemError("error reading journal log header from ", path);
+  }
+  if (bytesRead != sizeof(header) || header.magic != kLogMagic) {
+    XLOG(WARN) << "ignoring journal log " << path << " with an invalid header";
+    return std::nullopt;
+  }
+  if (header.version != kLogVersion) {
+    XLOG(WARN) << "ignoring journal log " << path
+               << " with unsupported version " << header.version;
+    return std::nullopt;
+  }
+  return header;
+}
+
+/**
+ * Call fn with the payload of each record in data, which holds a whole log
+ * file, until fn returns false or a record was not completely written.
+ * Returns the offset just past the last record accepted by fn.
+ */
+template <typename Fn>
+size_t forEachRecord(ByteRange data, Fn&& fn) {
+  size_t offset = sizeof(LogHeader);
+  while (offset + sizeof(RecordHeader) <= data.size()) {
+    RecordHeader header;
+    memcpy(&header, data.data() + offset, sizeof(header));
+    auto payloadOffset = offset + sizeof(header);
+    if (header.length > data.size() - payloadOffset) {
+      break;
+    }
+    auto payload = data.subpiece(payloadOffset, header.length);
+    if (folly::crc32c(payload.data(), payload.size()) != header.checksum ||
+        !fn(payload)) {
+      break;
+    }
+    offset = payloadOffset + header.length;
+  }
+  return offset;
+}
+
+struct ScanResult {
+  /** The offset just past the last valid record */
+  size_t end{0};
+  JournalLog::SequenceNumber firstSequence{0};
+  JournalLog::SequenceNumber lastSequence{0};
+};
+
+/** Find the valid records in a log file, without decoding their paths. */
+ScanResult scan(ByteRange data) {
+  ScanResult result;
+  result.end = forEachRecord(data, [&](ByteRange payload) {
+    // Every payload starts with its fromSequence and toSequence.
+    JournalLog::SequenceNumber sequences[2];
+    if (payload.size() < sizeof(sequences)) {
+      return false;
+    }
+    memcpy(sequences, payload.data(), sizeof(sequences));
+    if (sequences[0] <= result.lastSequence || sequences[1] < sequences[0]) {
+      return false;
+    }
+    if (result.firstSequence == 0) {
+      result.firstSequence = sequences[0];
+    }
+    result.lastSequence = sequences[1];
+    return true;
+  });
+  return result;
+}
+
+void writePath(folly::io::QueueAppender& appender, RelativePathPiece path) {
+  auto bytes = path.stringPiece();
+  appender.write<uint32_t>(bytes.size());
+  appender.push(ByteRange{bytes});
+}
+
+RelativePath readPath(folly::io::Cursor& cursor) {
+  auto length = cursor.read<uint32_t>();
+  return RelativePath{cursor.readFixedString(length)};
+}
+
+Hash readHash(folly::io::Cursor& cursor) {
+  Hash::Storage bytes;
+  cursor.pull(bytes.data(), bytes.size());
+  return Hash{bytes};
+}
+
+/** Encode delta as a record: a RecordHeader followed by the payload. */
+std::unique_ptr<folly::IOBuf> encodeRecord(const JournalDelta& delta) {
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  folly::io::QueueAppender appender{&queue, 256};
+
+  // Leave room for the RecordHeader, which is filled in below.
+  appender.write<uint32_t>(0);
+  appender.write<uint32_t>(0);
+
+  appender.write<uint64_t>(delta.fromSequence);
+  appender.write<uint64_t>(delta.toSequence);
+  appender.write<int64_t>(toSystemNanos(delta.fromTime));
+  appender.write<int64_t>(toSystemNanos(delta.toTime));
+  appender.push(delta.fromHash.getBytes());
+  appender.push(delta.toHash.getBytes());
+
+  appender.write<uint32_t>(delta.changedFilesInOverlay.size());
+  for (const auto& [path, info] : delta.changedFilesInOverlay) {
+    appender.write<uint8_t>(
+        (info.existedBefore ? kExistedBefore : 0) |
+        (info.existedAfter ? kExistedAfter : 0));
+    writePath(appender, path);
+  }
+
+  appender.write<uint32_t>(delta.uncleanPaths.size());
+  for (const auto& path : delta.uncleanPaths) {
+    writePath(appender, path);
+  }
+
+  auto record = queue.move();
+  record->coalesce();
+  RecordHeader header;
+  header.length = record->length() - sizeof(header);
+  header.checksum =
+      folly::crc32c(record->data() + sizeof(header), header.length);
+  memcpy(record->writableData(), &header, sizeof(header));
+  return record;
+}
+
+std::unique_ptr<JournalDelta> decodeDelta(ByteRange payload) {
+  auto buf = folly::IOBuf::wrapBufferAsValue(payload);
+  folly::io::Cursor cursor{&buf};
+
+  auto delta = std::make_unique<JournalDelta>();
+  delta->fromSequence = cursor.read<uint64_t>();
+  delta->toSequence = cursor.read<uint64_t>();
+  delta->fromTime = fromSystemNanos(cursor.read<int64_t>());
+  delta->toTime = fromSystemNanos(cursor.read<int64_t>());
+  delta->fromHash = readHash(cursor);
+  delta->toHash = readHash(cursor);
+
+  auto changedCount = cursor.read<uint32_t>();
+  for (uint32_t i = 0; i < changedCount; ++i) {
+    auto flags = cursor.read<uint8_t>();
+    auto path = readPath(cursor);
+    delta->changedFilesInOverlay.emplace(
+        std::move(path),
+        PathChangeInfo{(flags & kExistedBefore) != 0,
+                       (flags & kExistedAfter) != 0});
+  }
+
+  auto uncleanCount = cursor.read<uint32_t>();
+  for (uint32_t i = 0; i < uncleanCount; ++i) {
+    delta->uncleanPaths.insert(readPath(cursor));
+  }
+  return delta;
+}
+
+void replayFile(
+    const folly::File& file,
+    AbsolutePathPiece path,
+    size_t size,
+    folly::FunctionRef<void(std::unique_ptr<JournalDelta>)> restore) {
+  MappedFile mapped{file, path};
+  forEachRecord(mapped.bytes().subpiece(0, size), [&](ByteRange payload) {
+    restore(decodeDelta(payload));
+    return true;
+  });
+}
+} // namespace
+
+JournalLog::JournalLog(
+    AbsolutePathPiece path,
+    size_t maxSize,
+    uint64_t generation,
+    folly::File file)
+    : path_{path},
+      oldPath_{folly::to<std::string>(path.stringPiece(), ".old")},
+      maxSize_{maxSize},
+      generation_{generation},
+      file_{std::move(file)} {}
+
+JournalLog::~JournalLog() {
+  try {
+    close();
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "error closing journal log " << path_ << ": " << ex.what();
+  }
+}
+
+std::unique_ptr<JournalLog> JournalLog::open(
+    AbsolutePathPiece path,
+    size_t maxSize) {
+  int fd = folly::openNoInt(path.value().c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return nullptr;
+    }
+    folly::throwSystemError("error opening journal log ", path);
+  }
+  folly::File file{fd, /* ownsFd */ true};
+  if (!file.try_lock()) {
+    folly::throwSystemError("failed to acquire lock on journal log ", path);
+  }
+
+  auto header = readHeader(file, path);
+  if (!header) {
+    return nullptr;
+  }
+  if (header->state != kStateClosed) {
+    XLOG(WARN) << "ignoring journal log " << path
+               << " that was not closed cleanly";
+    return nullptr;
+  }
+
+  std::unique_ptr<JournalLog> log{
+      new JournalLog{path, maxSize, header->generation, std::move(file)}};
+
+  ScanResult current;
+  {
+    MappedFile mapped{log->file_, path};
+    current = scan(mapped.bytes());
+    if (current.end < mapped.bytes().size()) {
+      XLOG(WARN) << "dropping " << (mapped.bytes().size() - current.end)
+                 << " bytes of incomplete records from journal log " << path;
+    }
+  }
+  log->size_ = current.end;
+  log->lastSequence_ = current.lastSequence;
+
+  // The older records are only useful if they lead up to the current ones
+  // without a gap.
+  fd = folly::openNoInt(log->oldPath_.value().c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno != ENOENT) {
+      folly::throwSystemError("error opening journal log ", log->oldPath_);
+    }
+    return log;
+  }
+  folly::File oldFile{fd, /* ownsFd */ true};
+  auto oldHeader = readHeader(oldFile, log->oldPath_);
+  if (!oldHeader || oldHeader->generation != header->generation) {
+    return log;
+  }
+  MappedFile mapped{oldFile, log->oldPath_};
+  auto old = scan(mapped.bytes());
+  if (old.lastSequence != 0 &&
+      (current.firstSequence == 0 ||
+       old.lastSequence + 1 == current.firstSequence)) {
+    log->oldFile_ = std::move(oldFile);
+    log->oldSize_ = old.end;
+    if (log->lastSequence_ == 0) {
+      log->lastSequence_ = old.lastSequence;
+    }
+  }
+  return log;
+}
+
+std::unique_ptr<JournalLog> JournalLog::create(
+    AbsolutePathPiece path,
+    size_t maxSize,
+    uint64_t generation) {
+  std::unique_ptr<JournalLog> log{
+      new JournalLog{path, maxSize, generation, folly::File{}}};
+  if (unlink(log->oldPath_.c_str()) != 0 && errno != ENOENT) {
+    folly::throwSystemError("error removing journal log ", log->oldPath_);
+  }
+  log->startFile();
+  return log;
+}
+
+void JournalLog::replay(
+    folly::FunctionRef<void(std::unique_ptr<JournalDelta>)> restore) const {
+  DCHECK(!recording_);
+  if (oldFile_) {
+    replayFile(oldFile_, oldPath_, oldSize_, restore);
+  }
+  replayFile(file_, path_, size_, restore);
+}
+
+void JournalLog::startRecording() {
+  // Drop any incomplete record, so the next one is appended after the last
+  // valid record.
+  folly::checkUnixError(
+      ftruncate(file_.fd(), size_), "error truncating journal log ", path_);
+  writeState(kStateOpen);
+  oldFile_.close();
+  recording_ = true;
+}
+
+void JournalLog::append(const JournalDelta& delta) {
+  if (!recording_) {
+    return;
+  }
+
+  auto record = encodeRecord(delta);
+  auto end = size_ + pending_.chainLength();
+  if (end > sizeof(LogHeader) && end + record->length() > maxSize_ / 2) {
+    flush();
+    if (!recording_) {
+      return;
+    }
+    try {
+      folly::checkUnixError(
+          rename(path_.c_str(), oldPath_.c_str()),
+          "error rotating journal log ",
+          path_);
+      startFile();
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "no longer recording the journal for restarts: "
+                << ex.what();
+      abandon();
+      return;
+    }
+  }
+  pending_.append(std::move(record));
+  lastSequence_ = delta.toSequence;
+}
+
+void JournalLog::flush() {
+  if (!recording_ || pending_.empty()) {
+    return;
+  }
+
+  auto records = pending_.move();
+  auto iov = records->getIov();
+  try {
+    folly::checkUnixError(
+        folly::pwritevFull(file_.fd(), iov.data(), iov.size(), size_),
+        "error writing to journal log ",
+        path_);
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "no longer recording the journal for restarts: "
+              << ex.what();
+    abandon();
+    return;
+  }
+  size_ += records->computeChainDataLength();
+}
+
+void JournalLog::close() {
+  flush();
+  if (!recording_) {
+    return;
+  }
+  recording_ = false;
+  writeState(kStateClosed);
+  file_.close();
+}
+
+void JournalLog::startFile() {
+  folly::File file{path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600};
+  if (!file.try_lock()) {
+    folly::throwSystemError("failed to acquire lock on journal log ", path_);
+  }
+
+  LogHeader header;
+  header.magic = kLogMagic;
+  header.version = kLogVersion;
+  header.generation = generation_;
+  header.state = kStateOpen;
+  header.reserved = 0;
+  folly::checkUnixError(
+      folly::pwriteFull(file.fd(), &header, sizeof(header), 0),
+      "error writing journal log header to ",
+      path_);
+
+  file_ = std::move(file);
+  size_ = sizeof(header);
+}
+
+void JournalLog::writeState(uint32_t state) {
+  folly::checkUnixError(
+      folly::pwriteFull(
+          file_.fd(), &state, sizeof(state), offsetof(LogHeader, state)),
+      "error updating journal log header in ",
+      path_);
+}
+
+void JournalLog::abandon() noexcept {
+  recording_ = false;
+  pending_.move();
+  file_.closeNoThrow();
+  // A log that was never marked closed is not loaded again, but remove it
+  // to free the space.
+  for (const auto& path : {path_.c_str(), oldPath_.c_str()}) {
+    if (unlink(path) != 0 && errno != ENOENT) {
+      XLOG(ERR) << "error removing journal log " << path << ": "
+                << folly::errnoStr(errno);
+    }
+  }
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,157 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Function.h>
+#include <folly/io/IOBufQueue.h>
+#include <cstdint>
+#include <memory>
+#include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * An append-only file recording the deltas added to a Journal, so that the
+ * journal can be restored when edenfs restarts.
+ *
+ * The log is made of two files: path, which deltas are appended to, and
+ * path.old, which holds the deltas recorded before path was last started.
+ * When appending a delta would make path larger than half of maxSize, path
+ * is renamed over path.old and a new file is started.  The log therefore
+ * holds the most recent deltas in about maxSize bytes.
+ *
+ * Each file starts with a header holding the journal's generation and
+ * whether the log was closed cleanly, followed by one record per delta.
+ * Each record is a payload length, a CRC-32C of the payload, and the
+ * payload.  The data is stored in host byte order: the log is only read on
+ * the machine that wrote it.
+ *
+ * A log that was not closed cleanly, because edenfs crashed, may be missing
+ * changes that were made but not yet recorded, so open() refuses to load it.
+ * Since records only need to survive a clean close, append() buffers them in
+ * memory, and they are written in batches by flush() and close().
+ *
+ * This class is not thread-safe.  The Journal serializes access to its log.
+ */
+class JournalLog {
+ public:
+  using SequenceNumber = JournalDeltaRange::SequenceNumber;
+
+  /**
+   * Open the existing log at path.
+   *
+   * Returns nullptr if there is no log, or it was not closed cleanly, or
+   * its header is not one we understand.  Records that were cut short
+   * when the log was written are dropped.
+   */
+  static std::unique_ptr<JournalLog> open(
+      AbsolutePathPiece path,
+      size_t maxSize);
+
+  /**
+   * Start a new, empty log at path for the journal with the given
+   * generation, replacing any existing log.
+   */
+  static std::unique_ptr<JournalLog>
+  create(AbsolutePathPiece path, size_t maxSize, uint64_t generation);
+
+  JournalLog(const JournalLog&) = delete;
+  JournalLog& operator=(const JournalLog&) = delete;
+
+  /** Closes the log if startRecording() was called. */
+  ~JournalLog();
+
+  uint64_t getGeneration() const {
+    return generation_;
+  }
+
+  /** Get the toSequence of the last recorded delta, or 0 if there is none. */
+  SequenceNumber getLastSequence() const {
+    return lastSequence_;
+  }
+
+  /**
+   * Call restore with each recorded delta, oldest first, with the sequence
+   * numbers, times and hashes it was recorded with.
+   *
+   * This must be called before startRecording().
+   */
+  void replay(
+      folly::FunctionRef<void(std::unique_ptr<JournalDelta>)> restore) const;
+
+  /**
+   * Mark the log as open, so that it is not loaded again unless close() is
+   * called.  Must be called before append().
+   */
+  void startRecording();
+
+  /**
+   * Record delta, which has its sequence numbers, times and hashes set.
+   *
+   * The record is buffered until the next flush().  If the log has to be
+   * rotated to make room for it, the records buffered before it are written
+   * first.
+   */
+  void append(const JournalDelta& delta);
+
+  /**
+   * Write the records buffered by append().
+   *
+   * If the write fails the error is logged, the log is removed and nothing
+   * more is recorded: the journal remains usable, but will not be restored.
+   */
+  void flush();
+
+  /**
+   * Write any buffered records, mark the log as closed cleanly and release
+   * it.  Nothing more is recorded.
+   */
+  void close();
+
+ private:
+  JournalLog(
+      AbsolutePathPiece path,
+      size_t maxSize,
+      uint64_t generation,
+      folly::File file);
+
+  /** Create the file at path_ and write a header marking it open. */
+  void startFile();
+
+  void writeState(uint32_t state);
+
+  /** Stop recording after a failure, removing the log. */
+  void abandon() noexcept;
+
+  const AbsolutePath path_;
+  const AbsolutePath oldPath_;
+  const size_t maxSize_;
+  const uint64_t generation_;
+
+  folly::File file_;
+  /** The length of the valid records in file_, including the header */
+  size_t size_{0};
+
+  /** Records appended to file_ since the last flush() */
+  folly::IOBufQueue pending_{folly::IOBufQueue::cacheChainLength()};
+
+  /** path.old, if open() found its records to precede those in file_ */
+  folly::File oldFile_;
+  size_t oldSize_{0};
+
+  SequenceNumber lastSequence_{0};
+  bool recording_{false};
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/journal/PathInterner.h"
+
+#include <folly/Memory.h>
+#include <folly/hash/Hash.h>
+#include <glog/logging.h>
+#include <string>
+#include <vector>
+#include "eden/fs/utils/Memory.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+/**
+ * Add a reference to a node found in the PathInterner, unless its last
+ * reference has already been dropped and it is about to be released.
+ */
+bool tryIncRef(std::atomic<uint32_t>& refCount) {
+  auto count = refCount.load(std::memory_order_relaxed);
+  while (count != 0) {
+    if (refCount.compare_exchange_weak(
+            count, count + 1, std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+InternedPath::InternedPath(const InternedPath& other) noexcept
+    : node_{other.node_} {
+  if (node_) {
+    node_->refCount.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+InternedPath& InternedPath::operator=(const InternedPath& other) noexcept {
+  InternedPath copy{other};
+  std::swap(node_, copy.node_);
+  return *this;
+}
+
+InternedPath& InternedPath::operator=(InternedPath&& other) noexcept {
+  if (this != &other) {
+    decRef();
+    node_ = std::exchange(other.node_, nullptr);
+  }
+  return *this;
+}
+
+InternedPath::~InternedPath() {
+  decRef();
+}
+
+void InternedPath::decRef() noexcept {
+  if (node_ && node_->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    node_->interner->release(node_);
+  }
+}
+
+RelativePath InternedPath::toRelativePath() const {
+  std::vector<const Node*> nodes;
+  size_t length = 0;
+  for (auto node = node_; node; node = node->parent.node_) {
+    nodes.push_back(node);
+    length += node->name.stringPiece().size() + 1;
+  }
+
+  std::string path;
+  path.reserve(length);
+  for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+    if (!path.empty()) {
+      path.push_back('/');
+    }
+    auto name = (*it)->name.stringPiece();
+    path.append(name.data(), name.size());
+  }
+  return RelativePath{std::move(path), detail::SkipPathSanityCheck{}};
+}
+
+size_t PathInterner::KeyHasher::operator()(const Key& key) const {
+  return folly::hash::hash_combine(key.first, key.second);
+}
+
+PathInterner::~PathInterner() {
+  DCHECK(state_.rlock()->nodes.empty())
+      << "PathInterner destroyed while paths are still referenced";
+}
+
+InternedPath PathInterner::intern(RelativePathPiece path) {
+  InternedPath result;
+  auto state = state_.wlock();
+  for (auto name : path.components()) {
+    auto it = state->nodes.find(Key{result.node_, name});
+    if (it != state->nodes.end()) {
+      if (tryIncRef(it->second->refCount)) {
+        // The child holds a reference to result, so this does not release
+        // the last reference to it while we hold the lock.
+        result = InternedPath{it->second};
+        continue;
+      }
+      // The node's last reference was dropped, and release() is waiting for
+      // the lock.  Replace it: release() only forgets the node if it is
+      // still the one stored.
+      state->indirectMemoryUsage -=
+          estimateIndirectMemoryUsage(it->second->name.value());
+      state->nodes.erase(it);
+    }
+
+    auto node = new InternedPath::Node{this, std::move(result), name};
+    state->nodes.emplace(Key{node->parent.node_, node->name.piece()}, node);
+    state->indirectMemoryUsage +=
+        estimateIndirectMemoryUsage(node->name.value());
+    result = InternedPath{node};
+  }
+  return result;
+}
+
+void PathInterner::release(InternedPath::Node* node) noexcept {
+  {
+    auto state = state_.wlock();
+    auto it = state->nodes.find(Key{node->parent.node_, node->name.piece()});
+    if (it != state->nodes.end() && it->second == node) {
+      state->indirectMemoryUsage -=
+          estimateIndirectMemoryUsage(node->name.value());
+      state->nodes.erase(it);
+    }
+  }
+  // Deleting the node releases its parent, which needs the lock.
+  delete node;
+}
+
+size_t PathInterner::getComponentCount() const {
+  return state_.rlock()->nodes.size();
+}
+
+size_t PathInterner::estimateMemoryUsage() const {
+  auto state = state_.rlock();
+  const auto& nodes = state->nodes;
+  // Each node is allocated separately, and is referred to by a hash table
+  // entry holding its key, its address, a next pointer, and a stored hash.
+  size_t entrySize = folly::goodMallocSize(
+      sizeof(void*) + sizeof(decltype(state->nodes)::value_type) +
+      sizeof(size_t));
+  return nodes.size() *
+      (folly::goodMallocSize(sizeof(InternedPath::Node)) + entrySize) +
+      folly::goodMallocSize(sizeof(void*) * nodes.bucket_count()) +
+      state->indirectMemoryUsage;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,141 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+class PathInterner;
+
+/**
+ * A reference-counted handle to a path stored in a PathInterner.
+ *
+ * An InternedPath is the size of a pointer.  Two InternedPaths from the same
+ * PathInterner are equal if and only if they refer to the same path, so they
+ * can be compared and hashed without looking at the path itself.
+ *
+ * The default-constructed InternedPath refers to the empty path.
+ */
+class InternedPath {
+ public:
+  InternedPath() = default;
+  InternedPath(const InternedPath& other) noexcept;
+  InternedPath(InternedPath&& other) noexcept
+      : node_{std::exchange(other.node_, nullptr)} {}
+  InternedPath& operator=(const InternedPath& other) noexcept;
+  InternedPath& operator=(InternedPath&& other) noexcept;
+  ~InternedPath();
+
+  /** Build a copy of the path this refers to. */
+  RelativePath toRelativePath() const;
+
+  bool operator==(const InternedPath& other) const {
+    return node_ == other.node_;
+  }
+  bool operator!=(const InternedPath& other) const {
+    return node_ != other.node_;
+  }
+
+  size_t hash() const {
+    return std::hash<const void*>{}(node_);
+  }
+
+ private:
+  friend class PathInterner;
+  struct Node;
+
+  /** Takes ownership of a reference to node. */
+  explicit InternedPath(Node* node) noexcept : node_{node} {}
+
+  void decRef() noexcept;
+
+  Node* node_{nullptr};
+};
+
+/**
+ * Stores each distinct path once, so that structures that refer to the same
+ * paths many times, like the Journal, only store a pointer per reference.
+ *
+ * Paths are stored as a tree of path components: a path shares the storage
+ * of its parent directory with every other path in that directory.  A path
+ * is freed when the last InternedPath that refers to it, directly or through
+ * a child, is destroyed.
+ *
+ * The PathInterner must outlive all of the InternedPaths it returns.
+ *
+ * This class is thread-safe.
+ */
+class PathInterner {
+ public:
+  PathInterner() = default;
+  ~PathInterner();
+
+  PathInterner(const PathInterner&) = delete;
+  PathInterner& operator=(const PathInterner&) = delete;
+
+  /** Get the InternedPath for path, storing it if necessary. */
+  InternedPath intern(RelativePathPiece path);
+
+  /** Get the number of path components currently stored. */
+  size_t getComponentCount() const;
+
+  /** Get memory used (in bytes) by the stored paths. */
+  size_t estimateMemoryUsage() const;
+
+ private:
+  friend class InternedPath;
+
+  /** A node is identified by its parent and its name within the parent. */
+  using Key = std::pair<const InternedPath::Node*, PathComponentPiece>;
+  struct KeyHasher {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct State {
+    std::unordered_map<Key, InternedPath::Node*, KeyHasher> nodes;
+    /** Memory used by the names of the nodes, outside of the nodes */
+    size_t indirectMemoryUsage{0};
+  };
+
+  /** Forget node, whose reference count has dropped to zero. */
+  void release(InternedPath::Node* node) noexcept;
+
+  folly::Synchronized<State> state_;
+};
+
+struct InternedPath::Node {
+  Node(PathInterner* owner, InternedPath parentPath, PathComponentPiece base)
+      : interner{owner}, parent{std::move(parentPath)}, name{base.copy()} {}
+
+  PathInterner* const interner;
+  const InternedPath parent;
+  const PathComponent name;
+  std::atomic<uint32_t> refCount{1};
+};
+
+} // namespace eden
+} // namespace facebook
+
+namespace std {
+template <>
+struct hash<facebook::eden::InternedPath> {
+  size_t operator()(const facebook::eden::InternedPath& path) const {
+    return path.hash();
+  }
+};
+} // namespace std
@@ -0,0 +1,79 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/journal/Journal.h"
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/init/Init.h>
+#include <memory>
+
+using namespace facebook::eden;
+
+// Each benchmark fills a journal with the given number of deltas, then
+// reports one iteration per accumulateRange() call.  Recent queries ask for
+// the last few deltas, the way a client polling for changes does; full
+// queries ask for the whole journal.
+
+namespace {
+constexpr Journal::SequenceNumber kRecentDeltaCount = 10;
+
+std::unique_ptr<Journal> makeJournal(size_t length) {
+  auto journal = std::make_unique<Journal>();
+  for (size_t i = 0; i < length; ++i) {
+    // Cycle through a fixed set of paths, like a build rewriting its outputs.
+    journal->addDelta(std::make_unique<JournalDelta>(
+        RelativePath{folly::to<std::string>("dir/file", i % 1000)},
+        JournalDelta::CHANGED));
+  }
+  return journal;
+}
+
+void accumulateRecent(size_t iters, size_t length) {
+  std::unique_ptr<Journal> journal;
+  BENCHMARK_SUSPEND {
+    journal = makeJournal(length);
+  }
+  auto from = journal->getLatest()->toSequence - kRecentDeltaCount + 1;
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(journal->accumulateRange(from));
+  }
+  BENCHMARK_SUSPEND {
+    journal.reset();
+  }
+}
+
+void accumulateAll(size_t iters, size_t length) {
+  std::unique_ptr<Journal> journal;
+  BENCHMARK_SUSPEND {
+    journal = makeJournal(length);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(journal->accumulateRange(1));
+  }
+  BENCHMARK_SUSPEND {
+    journal.reset();
+  }
+}
+} // namespace
+
+BENCHMARK_PARAM(accumulateRecent, 1000)
+BENCHMARK_PARAM(accumulateRecent, 10000)
+BENCHMARK_PARAM(accumulateRecent, 100000)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_PARAM(accumulateAll, 1000)
+BENCHMARK_PARAM(accumulateAll, 10000)
+BENCHMARK_PARAM(accumulateAll, 100000)
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+}
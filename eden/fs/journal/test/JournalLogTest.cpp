@@ -0,0 +1,250 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/journal/JournalLog.h"
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/experimental/TestUtil.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "eden/fs/journal/Journal.h"
+
+using namespace facebook::eden;
+using folly::test::TemporaryDirectory;
+using ::testing::UnorderedElementsAre;
+
+namespace {
+constexpr size_t kMaxSize = 1024 * 1024;
+
+std::unique_ptr<JournalDelta> makeDelta(
+    JournalLog::SequenceNumber sequence,
+    RelativePathPiece path) {
+  auto delta = std::make_unique<JournalDelta>(path, JournalDelta::CREATED);
+  delta->fromSequence = sequence;
+  delta->toSequence = sequence;
+  delta->fromTime = std::chrono::steady_clock::now();
+  delta->toTime = delta->fromTime;
+  return delta;
+}
+
+std::vector<std::unique_ptr<JournalDelta>> replayAll(const JournalLog& log) {
+  std::vector<std::unique_ptr<JournalDelta>> deltas;
+  log.replay([&](std::unique_ptr<JournalDelta> delta) {
+    deltas.push_back(std::move(delta));
+  });
+  return deltas;
+}
+
+class JournalLogTest : public ::testing::Test {
+ protected:
+  AbsolutePath getLogPath() const {
+    return AbsolutePath{tmpDir_.path().string()} + "journal"_pc;
+  }
+
+  TemporaryDirectory tmpDir_{"eden_journal_log_test"};
+};
+} // namespace
+
+TEST_F(JournalLogTest, replays_deltas_after_close) {
+  {
+    auto log = JournalLog::create(getLogPath(), kMaxSize, 1234);
+    log->startRecording();
+    auto delta = makeDelta(1, "foo/bar"_relpath);
+    delta->toHash = Hash{"0123456789abcdef0123456789abcdef01234567"};
+    delta->uncleanPaths.insert(RelativePath{"foo"});
+    log->append(*delta);
+    log->append(
+        JournalDelta{"foo/bar"_relpath, "baz"_relpath, JournalDelta::RENAME});
+    log->close();
+  }
+
+  auto log = JournalLog::open(getLogPath(), kMaxSize);
+  ASSERT_TRUE(log);
+  EXPECT_EQ(1234, log->getGeneration());
+  auto deltas = replayAll(*log);
+  ASSERT_EQ(2, deltas.size());
+
+  EXPECT_EQ(1, deltas[0]->fromSequence);
+  EXPECT_EQ(1, deltas[0]->toSequence);
+  EXPECT_EQ(
+      Hash{"0123456789abcdef0123456789abcdef01234567"}, deltas[0]->toHash);
+  EXPECT_EQ(1, deltas[0]->changedFilesInOverlay.size());
+  EXPECT_TRUE(deltas[0]->changedFilesInOverlay["foo/bar"_relpath].isNew());
+  EXPECT_THAT(deltas[0]->uncleanPaths, UnorderedElementsAre("foo"_relpath));
+
+  auto& renamed = deltas[1]->changedFilesInOverlay;
+  EXPECT_EQ(2, renamed.size());
+  EXPECT_TRUE(renamed["foo/bar"_relpath].existedBefore);
+  EXPECT_FALSE(renamed["foo/bar"_relpath].existedAfter);
+  EXPECT_FALSE(renamed["baz"_relpath].existedBefore);
+  EXPECT_TRUE(renamed["baz"_relpath].existedAfter);
+}
+
+TEST_F(JournalLogTest, missing_log_is_not_opened) {
+  EXPECT_FALSE(JournalLog::open(getLogPath(), kMaxSize));
+}
+
+TEST_F(JournalLogTest, log_that_was_not_closed_is_not_opened) {
+  auto log = JournalLog::create(getLogPath(), kMaxSize, 1);
+  log->startRecording();
+  log->append(*makeDelta(1, "foo"_relpath));
+
+  // Take a copy of the log as it would be left by a crash.
+  std::string contents;
+  ASSERT_TRUE(folly::readFile(getLogPath().c_str(), contents));
+  auto copyPath = AbsolutePath{tmpDir_.path().string()} + "copy"_pc;
+  ASSERT_TRUE(folly::writeFile(contents, copyPath.c_str()));
+
+  EXPECT_FALSE(JournalLog::open(copyPath, kMaxSize));
+}
+
+TEST_F(JournalLogTest, appended_records_are_written_by_flush) {
+  auto log = JournalLog::create(getLogPath(), kMaxSize, 1);
+  log->startRecording();
+  std::string header;
+  ASSERT_TRUE(folly::readFile(getLogPath().c_str(), header));
+
+  log->append(*makeDelta(1, "foo"_relpath));
+  log->append(*makeDelta(2, "bar"_relpath));
+  std::string contents;
+  ASSERT_TRUE(folly::readFile(getLogPath().c_str(), contents));
+  EXPECT_EQ(header.size(), contents.size());
+
+  log->flush();
+  ASSERT_TRUE(folly::readFile(getLogPath().c_str(), contents));
+  EXPECT_GT(contents.size(), header.size());
+}
+
+TEST_F(JournalLogTest, incomplete_records_are_dropped) {
+  {
+    auto log = JournalLog::create(getLogPath(), kMaxSize, 1);
+    log->startRecording();
+    log->append(*makeDelta(1, "foo"_relpath));
+    log->append(*makeDelta(2, "bar"_relpath));
+    log->close();
+  }
+  {
+    folly::File file{getLogPath().c_str(), O_WRONLY | O_APPEND};
+    ASSERT_EQ(5, folly::writeFull(file.fd(), "torn!", 5));
+  }
+
+  {
+    auto log = JournalLog::open(getLogPath(), kMaxSize);
+    ASSERT_TRUE(log);
+    EXPECT_EQ(2, log->getLastSequence());
+    EXPECT_EQ(2, replayAll(*log).size());
+
+    // New records follow the last complete one.
+    log->startRecording();
+    log->append(*makeDelta(3, "baz"_relpath));
+  }
+
+  auto log = JournalLog::open(getLogPath(), kMaxSize);
+  ASSERT_TRUE(log);
+  EXPECT_EQ(3, log->getLastSequence());
+  auto deltas = replayAll(*log);
+  ASSERT_EQ(3, deltas.size());
+  EXPECT_EQ(1, deltas[2]->changedFilesInOverlay.count("baz"_relpath));
+}
+
+TEST_F(JournalLogTest, rotation_keeps_the_newest_deltas) {
+  constexpr size_t kSmallMaxSize = 4096;
+  constexpr JournalLog::SequenceNumber kDeltaCount = 1000;
+  {
+    auto log = JournalLog::create(getLogPath(), kSmallMaxSize, 1);
+    log->startRecording();
+    for (JournalLog::SequenceNumber i = 1; i <= kDeltaCount; ++i) {
+      log->append(*makeDelta(
+          i, RelativePath{folly::to<std::string>("dir/file", i)}));
+    }
+  }
+
+  std::string contents;
+  ASSERT_TRUE(folly::readFile(getLogPath().c_str(), contents));
+  EXPECT_LE(contents.size(), kSmallMaxSize / 2);
+
+  auto log = JournalLog::open(getLogPath(), kSmallMaxSize);
+  ASSERT_TRUE(log);
+  EXPECT_EQ(kDeltaCount, log->getLastSequence());
+  auto deltas = replayAll(*log);
+  ASSERT_FALSE(deltas.empty());
+  EXPECT_GT(deltas.front()->fromSequence, 1);
+  EXPECT_LT(deltas.size(), kDeltaCount);
+  for (size_t i = 1; i < deltas.size(); ++i) {
+    EXPECT_EQ(deltas[i - 1]->toSequence + 1, deltas[i]->fromSequence);
+  }
+  EXPECT_EQ(kDeltaCount, deltas.back()->toSequence);
+}
+
+TEST_F(JournalLogTest, journal_is_restored_from_its_log) {
+  Hash hash{"0123456789abcdef0123456789abcdef01234567"};
+  {
+    Journal journal;
+    journal.setLog(JournalLog::create(getLogPath(), kMaxSize, 1));
+    auto delta = std::make_unique<JournalDelta>();
+    delta->toHash = hash;
+    journal.addDelta(std::move(delta));
+    journal.addDelta(
+        std::make_unique<JournalDelta>("foo"_relpath, JournalDelta::CREATED));
+    journal.addDelta(
+        std::make_unique<JournalDelta>("bar"_relpath, JournalDelta::CREATED));
+    journal.closeLog();
+  }
+
+  Journal journal;
+  journal.setLog(JournalLog::open(getLogPath(), kMaxSize));
+  auto latest = journal.getLatest();
+  ASSERT_TRUE(latest);
+  EXPECT_EQ(3, latest->toSequence);
+  EXPECT_EQ(hash, latest->toHash);
+
+  auto merged = journal.accumulateRange(2);
+  ASSERT_TRUE(merged);
+  EXPECT_EQ(2, merged->fromSequence);
+  EXPECT_THAT(
+      merged->changedFilesInOverlay,
+      UnorderedElementsAre(
+          ::testing::Key("foo"_relpath), ::testing::Key("bar"_relpath)));
+
+  // New deltas continue the sequence, and are recorded in the log too.
+  journal.addDelta(
+      std::make_unique<JournalDelta>("baz"_relpath, JournalDelta::CREATED));
+  EXPECT_EQ(4, journal.getLatest()->toSequence);
+  journal.closeLog();
+  EXPECT_EQ(4, JournalLog::open(getLogPath(), kMaxSize)->getLastSequence());
+}
+
+TEST_F(JournalLogTest, journal_writes_its_log_on_the_executor) {
+  auto executor = std::make_shared<folly::ManualExecutor>();
+  Journal journal;
+  journal.setLog(JournalLog::create(getLogPath(), kMaxSize, 1), executor);
+  std::string header;
+  ASSERT_TRUE(folly::readFile(getLogPath().c_str(), header));
+
+  journal.addDelta(
+      std::make_unique<JournalDelta>("foo"_relpath, JournalDelta::CREATED));
+  journal.addDelta(
+      std::make_unique<JournalDelta>("bar"_relpath, JournalDelta::CREATED));
+  std::string contents;
+  ASSERT_TRUE(folly::readFile(getLogPath().c_str(), contents));
+  EXPECT_EQ(header.size(), contents.size());
+
+  // Both deltas are written by a single flush.
+  EXPECT_EQ(1, executor->drain());
+  ASSERT_TRUE(folly::readFile(getLogPath().c_str(), contents));
+  EXPECT_GT(contents.size(), header.size());
+
+  // Closing the log writes the deltas whose flush has not run yet.
+  journal.addDelta(
+      std::make_unique<JournalDelta>("baz"_relpath, JournalDelta::CREATED));
+  journal.closeLog();
+  EXPECT_EQ(3, JournalLog::open(getLogPath(), kMaxSize)->getLastSequence());
+  executor->drain();
+}
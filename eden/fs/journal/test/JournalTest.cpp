@@ -8,13 +8,15 @@
  *
  */
 #include "eden/fs/journal/Journal.h"
+#include <folly/Conv.h>
+#include <folly/executors/ManualExecutor.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 using namespace facebook::eden;
 using ::testing::UnorderedElementsAre;
 
-TEST(Journal, merges_chained_deltas) {
+TEST(Journal, accumulates_deltas) {
   Journal journal;
 
   // Make an initial entry.
@@ -26,7 +28,6 @@ TEST(Journal, merges_chained_deltas) {
   auto latest = journal.getLatest();
   EXPECT_EQ(1, latest->toSequence);
   EXPECT_EQ(1, latest->fromSequence);
-  EXPECT_EQ(nullptr, latest->previous);
 
   // Add a second entry.
   delta = std::make_unique<JournalDelta>("baz"_relpath, JournalDelta::CHANGED);
@@ -36,41 +37,29 @@ TEST(Journal, merges_chained_deltas) {
   latest = journal.getLatest();
   EXPECT_EQ(2, latest->toSequence);
   EXPECT_EQ(2, latest->fromSequence);
-  EXPECT_EQ(1, latest->previous->toSequence);
 
   // Check basic merge implementation.
-  auto merged = latest->merge();
+  auto merged = journal.accumulateRange();
   ASSERT_NE(nullptr, merged);
   EXPECT_EQ(1, merged->fromSequence);
   EXPECT_EQ(2, merged->toSequence);
   EXPECT_EQ(2, merged->changedFilesInOverlay.size());
-  EXPECT_EQ(nullptr, merged->previous);
 
   // Let's try with some limits.
 
   // First just report the most recent item.
-  merged = latest->merge(2);
+  merged = journal.accumulateRange(2);
   ASSERT_NE(nullptr, merged);
   EXPECT_EQ(2, merged->fromSequence);
   EXPECT_EQ(2, merged->toSequence);
   EXPECT_EQ(1, merged->changedFilesInOverlay.size());
-  EXPECT_NE(nullptr, merged->previous);
-
-  // Prune off sequence==1
-  merged = latest->merge(2, true);
-  ASSERT_NE(nullptr, merged);
-  EXPECT_EQ(2, merged->fromSequence);
-  EXPECT_EQ(2, merged->toSequence);
-  EXPECT_EQ(1, merged->changedFilesInOverlay.size());
-  EXPECT_EQ(nullptr, merged->previous);
 
   // Merge the first two entries.
-  merged = latest->merge(1);
+  merged = journal.accumulateRange(1);
   ASSERT_NE(nullptr, merged);
   EXPECT_EQ(1, merged->fromSequence);
   EXPECT_EQ(2, merged->toSequence);
   EXPECT_EQ(2, merged->changedFilesInOverlay.size());
-  EXPECT_EQ(nullptr, merged->previous);
 }
 
 TEST(Journal, mergeRemoveCreateUpdate) {
@@ -95,7 +84,7 @@ TEST(Journal, mergeRemoveCreateUpdate) {
   EXPECT_EQ(3, latest->fromSequence);
 
   // The merged data should report test.txt as changed
-  auto merged = latest->merge();
+  auto merged = journal.accumulateRange();
   ASSERT_NE(nullptr, merged);
   EXPECT_EQ(1, merged->fromSequence);
   EXPECT_EQ(3, merged->toSequence);
@@ -109,7 +98,7 @@ TEST(Journal, mergeRemoveCreateUpdate) {
       merged->changedFilesInOverlay[RelativePath{"test.txt"}].existedAfter);
 
   // Test merging only partway back
-  merged = latest->merge(3);
+  merged = journal.accumulateRange(3);
   ASSERT_NE(nullptr, merged);
   EXPECT_EQ(3, merged->fromSequence);
   EXPECT_EQ(3, merged->toSequence);
@@ -122,7 +111,7 @@ TEST(Journal, mergeRemoveCreateUpdate) {
       true,
       merged->changedFilesInOverlay[RelativePath{"test.txt"}].existedAfter);
 
-  merged = latest->merge(2);
+  merged = journal.accumulateRange(2);
   ASSERT_NE(nullptr, merged);
   EXPECT_EQ(2, merged->fromSequence);
   EXPECT_EQ(3, merged->toSequence);
@@ -135,7 +124,7 @@ TEST(Journal, mergeRemoveCreateUpdate) {
       true,
       merged->changedFilesInOverlay[RelativePath{"test.txt"}].existedAfter);
 
-  merged = latest->merge(1);
+  merged = journal.accumulateRange(1);
   ASSERT_NE(nullptr, merged);
   EXPECT_EQ(1, merged->fromSequence);
   EXPECT_EQ(3, merged->toSequence);
@@ -214,3 +203,172 @@ TEST(Journal, memory_usage) {
     prevMem = newMem;
   }
 }
+
+namespace {
+size_t getDeltaMemoryUsage() {
+  Journal journal;
+  journal.addDelta(
+      std::make_unique<JournalDelta>("file0"_relpath, JournalDelta::CHANGED));
+  return journal.getStats()->memoryUsage;
+}
+} // namespace
+
+TEST(Journal, stores_each_changed_path_once) {
+  auto longPath = RelativePath{std::string(1000, 'a')};
+  Journal journal;
+  journal.addDelta(
+      std::make_unique<JournalDelta>(longPath, JournalDelta::CHANGED));
+  auto firstMem = journal.getStats()->memoryUsage;
+  ASSERT_GT(firstMem, 1000);
+
+  for (int i = 0; i < 10; ++i) {
+    journal.addDelta(
+        std::make_unique<JournalDelta>(longPath, JournalDelta::CHANGED));
+  }
+  EXPECT_LT(journal.getStats()->memoryUsage, firstMem + 1000);
+
+  auto merged = journal.accumulateRange(1);
+  EXPECT_THAT(
+      merged->changedFilesInOverlay,
+      ::testing::ElementsAre(::testing::Key(longPath)));
+}
+
+TEST(Journal, accumulates_ranges_that_span_segments) {
+  Journal journal;
+  for (int i = 1; i <= 1000; ++i) {
+    journal.addDelta(std::make_unique<JournalDelta>(
+        RelativePath{folly::to<std::string>("file", i)},
+        JournalDelta::CHANGED));
+  }
+
+  for (Journal::SequenceNumber from : {1, 2, 127, 128, 129, 500, 999, 1000}) {
+    auto merged = journal.accumulateRange(from);
+    ASSERT_NE(nullptr, merged);
+    EXPECT_EQ(from, merged->fromSequence);
+    EXPECT_EQ(1000, merged->toSequence);
+    EXPECT_EQ(1000 - from + 1, merged->changedFilesInOverlay.size());
+    EXPECT_EQ(
+        1,
+        merged->changedFilesInOverlay.count(
+            RelativePath{folly::to<std::string>("file", from)}));
+  }
+  EXPECT_EQ(nullptr, journal.accumulateRange(1001));
+
+  auto deltas = journal.getDeltas(127, 129);
+  ASSERT_EQ(3, deltas.size());
+  EXPECT_EQ(129, deltas[0].toSequence);
+  EXPECT_EQ(128, deltas[1].toSequence);
+  EXPECT_EQ(127, deltas[2].toSequence);
+}
+
+TEST(Journal, compacts_old_deltas_when_over_memory_limit) {
+  auto limit = 1000 * getDeltaMemoryUsage();
+  Journal journal{limit};
+  for (int i = 0; i < 2000; ++i) {
+    journal.addDelta(
+        std::make_unique<JournalDelta>("file0"_relpath, JournalDelta::CHANGED));
+  }
+
+  auto stats = journal.getStats();
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_LE(stats->memoryUsage, limit);
+  EXPECT_LT(stats->entryCount, 2000);
+  EXPECT_GT(stats->compactionCount, 0);
+  EXPECT_EQ(0, stats->truncationCount);
+
+  // The summary delta still reaches back to the first sequence number.
+  auto latest = journal.getLatest();
+  EXPECT_EQ(2000, latest->toSequence);
+  auto merged = journal.accumulateRange(1);
+  EXPECT_EQ(1, merged->fromSequence);
+  EXPECT_THAT(
+      merged->changedFilesInOverlay,
+      ::testing::ElementsAre(::testing::Key(RelativePath{"file0"})));
+}
+
+TEST(Journal, truncates_old_deltas_that_do_not_fit_in_a_summary) {
+  auto limit = 1000 * getDeltaMemoryUsage();
+  Journal journal{limit};
+  for (int i = 1; i <= 10000; ++i) {
+    journal.addDelta(std::make_unique<JournalDelta>(
+        RelativePath{folly::to<std::string>("file", i)},
+        JournalDelta::CHANGED));
+  }
+
+  auto stats = journal.getStats();
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_LE(stats->memoryUsage, limit);
+  EXPECT_GT(stats->truncationCount, 0);
+
+  // Callers detect the truncation by the gap before the merged range.
+  auto latest = journal.getLatest();
+  EXPECT_EQ(10000, latest->toSequence);
+  EXPECT_GT(journal.accumulateRange(1)->fromSequence, 1);
+  auto merged = journal.accumulateRange(10000);
+  EXPECT_EQ(10000, merged->fromSequence);
+  EXPECT_THAT(
+      merged->changedFilesInOverlay,
+      ::testing::ElementsAre(::testing::Key(RelativePath{"file10000"})));
+}
+
+TEST(Journal, compaction_counts_interned_paths_against_the_limit) {
+  auto limit = 1000 * getDeltaMemoryUsage();
+  Journal journal{limit};
+  // Long, distinct paths use more memory in the interner than in the deltas.
+  for (int i = 1; i <= 5000; ++i) {
+    journal.addDelta(std::make_unique<JournalDelta>(
+        RelativePath{folly::to<std::string>(std::string(200, 'a'), i)},
+        JournalDelta::CHANGED));
+  }
+
+  auto stats = journal.getStats();
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_LE(stats->memoryUsage, limit);
+  EXPECT_EQ(5000, journal.getLatest()->toSequence);
+}
+
+TEST(Journal, subscribers_are_called_once_for_coalesced_deltas) {
+  Journal journal;
+  auto executor = std::make_shared<folly::ManualExecutor>();
+  journal.setSubscriberExecutor(
+      executor, std::chrono::nanoseconds{0}, std::chrono::nanoseconds{0});
+
+  size_t calls = 0;
+  journal.registerSubscriber([&] {
+    ++calls;
+    EXPECT_EQ(3, journal.getLatest()->toSequence);
+  });
+
+  for (auto path : {"foo"_relpath, "bar"_relpath, "baz"_relpath}) {
+    journal.addDelta(
+        std::make_unique<JournalDelta>(path, JournalDelta::CREATED));
+  }
+  // The subscriber is not called on the thread that added the deltas.
+  EXPECT_EQ(0, calls);
+
+  executor->drain();
+  EXPECT_EQ(1, calls);
+  executor->drain();
+  EXPECT_EQ(1, calls);
+}
+
+TEST(Journal, subscribers_are_called_again_for_later_deltas) {
+  Journal journal;
+  auto executor = std::make_shared<folly::ManualExecutor>();
+  journal.setSubscriberExecutor(
+      executor, std::chrono::hours{1}, std::chrono::nanoseconds{0});
+
+  size_t calls = 0;
+  journal.registerSubscriber([&] { ++calls; });
+
+  journal.addDelta(
+      std::make_unique<JournalDelta>("foo"_relpath, JournalDelta::CREATED));
+  // maxLatency bounds the wait for the changes to settle.
+  executor->drain();
+  EXPECT_EQ(1, calls);
+
+  journal.addDelta(
+      std::make_unique<JournalDelta>("bar"_relpath, JournalDelta::CREATED));
+  executor->drain();
+  EXPECT_EQ(2, calls);
+}
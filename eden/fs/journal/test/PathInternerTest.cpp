@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/journal/PathInterner.h"
+#include <gtest/gtest.h>
+#include <optional>
+
+using namespace facebook::eden;
+
+TEST(PathInterner, same_path_is_interned_once) {
+  PathInterner interner;
+  auto first = interner.intern("foo/bar"_relpath);
+  auto second = interner.intern("foo/bar"_relpath);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(first.hash(), second.hash());
+  EXPECT_NE(first, interner.intern("foo/baz"_relpath));
+  EXPECT_NE(first, interner.intern("bar"_relpath));
+}
+
+TEST(PathInterner, paths_share_their_parent_directories) {
+  PathInterner interner;
+  auto bar = interner.intern("foo/bar"_relpath);
+  EXPECT_EQ(2, interner.getComponentCount());
+  auto baz = interner.intern("foo/baz"_relpath);
+  EXPECT_EQ(3, interner.getComponentCount());
+  auto foo = interner.intern("foo"_relpath);
+  EXPECT_EQ(3, interner.getComponentCount());
+}
+
+TEST(PathInterner, to_relative_path) {
+  PathInterner interner;
+  EXPECT_EQ(
+      "foo/bar/baz"_relpath,
+      interner.intern("foo/bar/baz"_relpath).toRelativePath());
+  EXPECT_EQ("foo"_relpath, interner.intern("foo"_relpath).toRelativePath());
+  EXPECT_EQ(RelativePath{}, interner.intern(RelativePath{}).toRelativePath());
+  EXPECT_EQ(RelativePath{}, InternedPath{}.toRelativePath());
+}
+
+TEST(PathInterner, paths_are_released_with_their_last_reference) {
+  PathInterner interner;
+  std::optional<InternedPath> bar{interner.intern("foo/bar"_relpath)};
+  auto copy = *bar;
+  auto baz = interner.intern("foo/baz"_relpath);
+  auto usage = interner.estimateMemoryUsage();
+
+  bar.reset();
+  EXPECT_EQ(3, interner.getComponentCount());
+  copy = baz;
+  EXPECT_EQ(2, interner.getComponentCount());
+  EXPECT_LT(interner.estimateMemoryUsage(), usage);
+
+  baz = InternedPath{};
+  copy = InternedPath{};
+  EXPECT_EQ(0, interner.getComponentCount());
+
+  // The path can be interned again once it has been released.
+  auto again = interner.intern("foo/bar"_relpath);
+  EXPECT_EQ("foo/bar"_relpath, again.toRelativePath());
+  EXPECT_EQ(2, interner.getComponentCount());
+}
+
+TEST(PathInterner, long_names_are_counted_in_memory_usage) {
+  PathInterner interner;
+  auto empty = interner.estimateMemoryUsage();
+  auto shortName = interner.intern("a"_relpath);
+  auto shortUsage = interner.estimateMemoryUsage();
+  EXPECT_GT(shortUsage, empty);
+
+  auto longName = interner.intern(RelativePathPiece{std::string(1000, 'b')});
+  EXPECT_GT(interner.estimateMemoryUsage(), shortUsage + 1000);
+}
@@ -14,18 +14,153 @@
 #include <folly/String.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
-#include <folly/ssl/OpenSSLHash.h>
+#include <folly/portability/OpenSSL.h>
+#include <array>
+#include <memory>
+#include <stdexcept>
 #include <string>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EDEN_HASH_HEX_SSE2 1
+#endif
+
 using folly::ByteRange;
-using folly::range;
 using folly::StringPiece;
-using folly::ssl::OpenSSLHash;
 using std::string;
 
 namespace facebook {
 namespace eden {
 
+namespace {
+constexpr size_t kHexSize = Hash::RAW_SIZE * 2;
+#ifdef EDEN_HASH_HEX_SSE2
+/**
+ * Write the lowercase hex of the 16 bytes at in to the 32 chars at out.
+ */
+void hexEncode16(const uint8_t* in, char* out) {
+  auto toHexDigits = [](__m128i nibbles) {
+    // '0' + nibble, plus the distance from '9' + 1 to 'a' for nibbles above 9.
+    auto letters = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+    return _mm_add_epi8(
+        _mm_add_epi8(nibbles, _mm_set1_epi8('0')),
+        _mm_and_si128(letters, _mm_set1_epi8('a' - '0' - 10)));
+  };
+  auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+  auto mask = _mm_set1_epi8(0x0f);
+  auto high = toHexDigits(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+  auto low = toHexDigits(_mm_and_si128(bytes, mask));
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(high, low));
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(high, low));
+}
+
+/**
+ * Convert 16 hex digits to their values, clearing the matching bytes of
+ * valid for any character that is not a hex digit.
+ */
+__m128i hexDigitValues(__m128i chars, __m128i& valid) {
+  auto inRange = [](__m128i c, char first, char last) {
+    // Bytes of 0x80 and above are negative, so they are never in range.
+    return _mm_and_si128(
+        _mm_cmpgt_epi8(c, _mm_set1_epi8(first - 1)),
+        _mm_cmplt_epi8(c, _mm_set1_epi8(last + 1)));
+  };
+  auto isDigit = inRange(chars, '0', '9');
+  auto lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+  auto isLetter = inRange(lower, 'a', 'f');
+  valid = _mm_and_si128(valid, _mm_or_si128(isDigit, isLetter));
+  return _mm_or_si128(
+      _mm_and_si128(isDigit, _mm_sub_epi8(chars, _mm_set1_epi8('0'))),
+      _mm_and_si128(isLetter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+}
+
+/**
+ * Combine pairs of hex digit values into bytes, leaving one byte in each
+ * 16-bit lane.
+ */
+__m128i combineHexDigits(__m128i values) {
+  auto high = _mm_and_si128(values, _mm_set1_epi16(0x00ff));
+  auto low = _mm_srli_epi16(values, 8);
+  return _mm_or_si128(_mm_slli_epi16(high, 4), low);
+}
+
+/**
+ * Parse the 32 hex digits at in into the 16 bytes at out.  Returns false if
+ * any of them is not a hex digit.
+ */
+bool hexDecode16(const char* in, uint8_t* out) {
+  auto valid = _mm_set1_epi8(-1);
+  auto first = hexDigitValues(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), valid);
+  auto second = hexDigitValues(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16)), valid);
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(out),
+      _mm_packus_epi16(combineHexDigits(first), combineHexDigits(second)));
+  return _mm_movemask_epi8(valid) == 0xffff;
+}
+#else
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+constexpr std::array<int8_t, 256> makeHexDigitValues() {
+  std::array<int8_t, 256> values{};
+  for (size_t c = 0; c < values.size(); ++c) {
+    values[c] = -1;
+  }
+  for (int8_t n = 0; n < 10; ++n) {
+    values['0' + n] = n;
+  }
+  for (int8_t n = 0; n < 6; ++n) {
+    values['a' + n] = 10 + n;
+    values['A' + n] = 10 + n;
+  }
+  return values;
+}
+
+constexpr std::array<int8_t, 256> kHexDigitValues = makeHexDigitValues();
+#endif
+
+/**
+ * Write the 40 character lowercase hex representation of bytes to out.
+ */
+void hexEncode(ByteRange bytes, char* out) {
+#ifdef EDEN_HASH_HEX_SSE2
+  // The two halves overlap by 12 bytes, which is cheaper than handling the
+  // 4 byte tail separately.
+  hexEncode16(bytes.data(), out);
+  hexEncode16(bytes.data() + Hash::RAW_SIZE - 16, out + kHexSize - 32);
+#else
+  for (auto byte : bytes) {
+    *out++ = kHexDigits[byte >> 4];
+    *out++ = kHexDigits[byte & 0x0f];
+  }
+#endif
+}
+
+/**
+ * Parse 40 hex characters into bytes.  Returns false if any of them is not a
+ * hex digit.
+ */
+bool hexDecode(const char* in, Hash::Storage& bytes) {
+#ifdef EDEN_HASH_HEX_SSE2
+  return hexDecode16(in, bytes.data()) &&
+      hexDecode16(in + kHexSize - 32, bytes.data() + Hash::RAW_SIZE - 16);
+#else
+  for (auto& byte : bytes) {
+    auto high = kHexDigitValues[static_cast<uint8_t>(*in++)];
+    auto low = kHexDigitValues[static_cast<uint8_t>(*in++)];
+    if ((high | low) < 0) {
+      return false;
+    }
+    byte = static_cast<uint8_t>((high << 4) | low);
+  }
+  return true;
+#endif
+}
+} // namespace
+
 const Hash kZeroHash;
 
 const Hash kEmptySha1{Hash::Storage{0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b,
@@ -37,11 +172,24 @@ folly::MutableByteRange Hash::mutableBytes() {
 }
 
 std::string Hash::toString() const {
-  std::string result;
-  folly::hexlify(bytes_, result);
+  std::string result(kHexSize, '\0');
+  hexEncode(getBytes(), &result[0]);
   return result;
 }
 
+Hash Hash::fromHex(StringPiece hex) {
+  if (hex.size() != kHexSize) {
+    throw std::invalid_argument(
+        "incorrect data size for Hash constructor from string");
+  }
+  Hash hash;
+  if (!hexDecode(hex.data(), hash.bytes_)) {
+    throw std::invalid_argument(
+        "invalid hex digit supplied to Hash constructor from string");
+  }
+  return hash;
+}
+
 size_t Hash::getHashCode() const noexcept {
   static_assert(sizeof(size_t) <= RAW_SIZE, "crazy size_t type");
   size_t result;
@@ -57,16 +205,53 @@ bool Hash::operator<(const Hash& otherHash) const {
   return bytes_ < otherHash.bytes_;
 }
 
+namespace {
+/**
+ * Returns this thread's SHA-1 context, ready for a new digest.
+ *
+ * Reusing one context per thread avoids allocating one for every hash.
+ * OpenSSL picks the fastest implementation the CPU supports (SHA extensions,
+ * AVX2, ...) at runtime.
+ */
+EVP_MD_CTX* beginSha1() {
+  static thread_local std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX*)> ctx{
+      EVP_MD_CTX_new(), EVP_MD_CTX_free};
+  if (!ctx || EVP_DigestInit_ex(ctx.get(), EVP_sha1(), nullptr) != 1) {
+    throw std::runtime_error("error initializing SHA-1 digest");
+  }
+  return ctx.get();
+}
+
+void updateSha1(EVP_MD_CTX* ctx, ByteRange data) {
+  if (EVP_DigestUpdate(ctx, data.data(), data.size()) != 1) {
+    throw std::runtime_error("error computing SHA-1 digest");
+  }
+}
+
+void finishSha1(EVP_MD_CTX* ctx, uint8_t* out) {
+  unsigned int size = 0;
+  if (EVP_DigestFinal_ex(ctx, out, &size) != 1 || size != Hash::RAW_SIZE) {
+    throw std::runtime_error("error computing SHA-1 digest");
+  }
+}
+} // namespace
+
 Hash Hash::sha1(const folly::IOBuf& buf) {
-  Storage hashBytes;
-  OpenSSLHash::sha1(range(hashBytes), buf);
-  return Hash{hashBytes};
+  auto* ctx = beginSha1();
+  for (auto range : buf) {
+    updateSha1(ctx, range);
+  }
+  Hash hash;
+  finishSha1(ctx, hash.bytes_.data());
+  return hash;
 }
 
 Hash Hash::sha1(ByteRange data) {
-  Storage hashBytes;
-  OpenSSLHash::sha1(range(hashBytes), data);
-  return Hash{hashBytes};
+  auto* ctx = beginSha1();
+  updateSha1(ctx, data);
+  Hash hash;
+  finishSha1(ctx, hash.bytes_.data());
+  return hash;
 }
 
 std::ostream& operator<<(std::ostream& os, const Hash& hash) {
@@ -75,7 +260,9 @@ std::ostream& operator<<(std::ostream& os, const Hash& hash) {
 }
 
 void toAppend(const Hash& hash, std::string* result) {
-  folly::toAppend(hash.toString(), result);
+  auto offset = result->size();
+  result->resize(offset + kHexSize);
+  hexEncode(hash.getBytes(), &(*result)[offset]);
 }
 } // namespace eden
 } // namespace facebook
@@ -9,8 +9,23 @@
  */
 #include "Tree.h"
 
+#include <folly/memory/Malloc.h>
+#include "eden/fs/utils/Memory.h"
+
 namespace facebook {
 namespace eden {
+
+size_t Tree::getSizeInBytes() const {
+  size_t size = sizeof(*this);
+  if (entries_.capacity() > 0) {
+    size += folly::goodMallocSize(entries_.capacity() * sizeof(TreeEntry));
+  }
+  for (const auto& entry : entries_) {
+    size += estimateIndirectMemoryUsage(entry.getName().value());
+  }
+  return size;
+}
+
 bool operator==(const Tree& tree1, const Tree& tree2) {
   return (tree1.getHash() == tree2.getHash()) &&
       (tree1.getTreeEntries() == tree2.getTreeEntries());
@@ -70,6 +70,12 @@ class Tree {
     return *entry;
   }
 
+  /**
+   * Estimate the memory used by this Tree, including its entries and the
+   * heap storage of their names.
+   */
+  size_t getSizeInBytes() const;
+
   std::vector<PathComponent> getEntryNames() const {
     std::vector<PathComponent> results;
     results.reserve(entries_.size());
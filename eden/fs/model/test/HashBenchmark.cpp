@@ -0,0 +1,134 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/model/Hash.h"
+
+#include <folly/Benchmark.h>
+#include <folly/String.h>
+#include <folly/init/Init.h>
+#include <folly/io/IOBuf.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace facebook::eden;
+using folly::ByteRange;
+using folly::StringPiece;
+
+// Hex benchmarks report one iteration per hash, so the iterations per second
+// column is the number of hashes per second.  The SHA-1 benchmarks report one
+// iteration per byte hashed, so 1 / (time per iteration) is the throughput.
+
+namespace {
+std::vector<Hash> makeHashes() {
+  std::vector<Hash> hashes;
+  for (size_t n = 0; n < 1024; ++n) {
+    hashes.push_back(Hash::sha1(StringPiece{folly::to<std::string>(n)}));
+  }
+  return hashes;
+}
+
+std::vector<std::string> makeHexHashes() {
+  std::vector<std::string> hexHashes;
+  for (const auto& hash : makeHashes()) {
+    hexHashes.push_back(hash.toString());
+  }
+  return hexHashes;
+}
+
+void sha1ByteRange(size_t iters, size_t size) {
+  std::string data;
+  BENCHMARK_SUSPEND {
+    data.resize(size, 'x');
+  }
+  for (size_t i = 0; i < iters; i += size) {
+    folly::doNotOptimizeAway(Hash::sha1(ByteRange{StringPiece{data}}));
+  }
+}
+
+void sha1IOBufChain(size_t iters, size_t size) {
+  std::unique_ptr<folly::IOBuf> buf;
+  BENCHMARK_SUSPEND {
+    // Split the data across several buffers, as it is when hashing data
+    // fetched from a backing store.
+    constexpr size_t kChunkCount = 4;
+    for (size_t n = 0; n < kChunkCount; ++n) {
+      auto chunk = folly::IOBuf::create(size / kChunkCount);
+      memset(chunk->writableData(), 'x', size / kChunkCount);
+      chunk->append(size / kChunkCount);
+      if (buf) {
+        buf->prependChain(std::move(chunk));
+      } else {
+        buf = std::move(chunk);
+      }
+    }
+  }
+  for (size_t i = 0; i < iters; i += size) {
+    folly::doNotOptimizeAway(Hash::sha1(*buf));
+  }
+}
+} // namespace
+
+BENCHMARK(Hash_toString, iters) {
+  std::vector<Hash> hashes;
+  BENCHMARK_SUSPEND {
+    hashes = makeHashes();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(hashes[i % hashes.size()].toString());
+  }
+}
+
+BENCHMARK_RELATIVE(folly_hexlify, iters) {
+  std::vector<Hash> hashes;
+  BENCHMARK_SUSPEND {
+    hashes = makeHashes();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    std::string result;
+    folly::hexlify(hashes[i % hashes.size()].getBytes(), result);
+    folly::doNotOptimizeAway(result);
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(Hash_fromHex, iters) {
+  std::vector<std::string> hexHashes;
+  BENCHMARK_SUSPEND {
+    hexHashes = makeHexHashes();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(Hash::fromHex(hexHashes[i % hexHashes.size()]));
+  }
+}
+
+BENCHMARK_RELATIVE(Hash_constexprHexConstructor, iters) {
+  std::vector<std::string> hexHashes;
+  BENCHMARK_SUSPEND {
+    hexHashes = makeHexHashes();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(
+        Hash{StringPiece{hexHashes[i % hexHashes.size()]}});
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_PARAM(sha1ByteRange, 64)
+BENCHMARK_PARAM(sha1ByteRange, 4096)
+BENCHMARK_PARAM(sha1ByteRange, 1048576)
+BENCHMARK_PARAM(sha1IOBufChain, 4096)
+BENCHMARK_PARAM(sha1IOBufChain, 1048576)
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+}
@@ -219,3 +219,41 @@ TEST(Hash, getHashCode) {
   // using 64 bits of data to contribute to the hash code.
   EXPECT_EQ(folly::Endian::big(0xfaceb00cdeadbeef), testHash.getHashCode());
 }
+
+TEST(Hash, fromHex) {
+  EXPECT_EQ(testHash, Hash::fromHex(testHashHex));
+  EXPECT_EQ(
+      testHash, Hash::fromHex("FACEB00CDEADBEEFC00010FF1BADB0028BADF00D"));
+  EXPECT_EQ(kZeroHash, Hash::fromHex(kZeroHash.toString()));
+  EXPECT_EQ(kEmptySha1, Hash::fromHex(kEmptySha1.toString()));
+}
+
+TEST(Hash, fromHexRejectsMalformedInput) {
+  EXPECT_THROW(Hash::fromHex("badfood"), std::invalid_argument);
+  EXPECT_THROW(Hash::fromHex(testHashHex + "0"), std::invalid_argument);
+  // Check a bad character at every position, since the hex digits are parsed
+  // in overlapping blocks.
+  for (size_t index = 0; index < testHashHex.size(); ++index) {
+    for (char c : {'g', 'G', '/', ':', '@', '`', '\0', '\xff'}) {
+      auto hex = testHashHex;
+      hex[index] = c;
+      EXPECT_THROW(Hash::fromHex(hex), std::invalid_argument) << hex;
+    }
+  }
+}
+
+TEST(Hash, hexRoundTrip) {
+  Hash::Storage bytes;
+  for (size_t n = 0; n < 256; ++n) {
+    for (size_t index = 0; index < bytes.size(); ++index) {
+      bytes[index] = static_cast<uint8_t>(n * 31 + index * 7);
+    }
+    Hash hash{bytes};
+    auto hex = hash.toString();
+    EXPECT_EQ(folly::hexlify(hash.getBytes()), hex);
+    EXPECT_EQ(hash, Hash::fromHex(hex));
+    EXPECT_EQ(hash, Hash{StringPiece{hex}});
+    EXPECT_EQ(
+        folly::to<string>("hash:", hex), folly::to<string>("hash:", hash));
+  }
+}
@@ -69,3 +69,21 @@ TEST(Tree, testGetEntryPtr) {
   PathComponentPiece nonExistentPath("not_a_file");
   EXPECT_EQ(nullptr, tree.getEntryPtr(nonExistentPath));
 }
+
+TEST(Tree, getSizeInBytesCountsEntriesAndLongNames) {
+  Tree emptyTree(vector<TreeEntry>{});
+  EXPECT_EQ(sizeof(Tree), emptyTree.getSizeInBytes());
+
+  vector<TreeEntry> shortEntries;
+  shortEntries.emplace_back(testHash, "a", TreeEntryType::REGULAR_FILE);
+  Tree shortTree(std::move(shortEntries));
+  EXPECT_GE(shortTree.getSizeInBytes(), sizeof(Tree) + sizeof(TreeEntry));
+
+  // A name too long for the small string optimization is stored on the heap,
+  // and that storage is included in the estimate.
+  string longName(200, 'x');
+  vector<TreeEntry> longEntries;
+  longEntries.emplace_back(testHash, longName, TreeEntryType::REGULAR_FILE);
+  Tree longTree(std::move(longEntries));
+  EXPECT_GE(longTree.getSizeInBytes(), shortTree.getSizeInBytes() + 200);
+}
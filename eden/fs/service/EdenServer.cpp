@@ -39,6 +39,7 @@
 #include "eden/fs/inodes/InodeMap.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/service/StartupLogger.h"
+#include "eden/fs/store/PackFileLocalStore.h"
 #include "eden/fs/store/RocksDbLocalStore.h"
 #include "eden/fs/takeover/TakeoverClient.h"
 #include "eden/fs/takeover/TakeoverData.h"
@@ -49,10 +50,12 @@
 #include "eden/fs/service/EdenServiceHandler.h"
 #include "eden/fs/store/BlobCache.h"
 #include "eden/fs/store/EmptyBackingStore.h"
+#include "eden/fs/store/KeySpaces.h"
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
 #include "eden/fs/store/SqliteLocalStore.h"
+#include "eden/fs/store/TreeCache.h"
 #include "eden/fs/store/git/GitBackingStore.h"
 #include "eden/fs/store/hg/HgBackingStore.h"
 
@@ -87,6 +90,12 @@ DEFINE_string(
     "memory is currently very dangerous as you will "
     "lose state across restarts and graceful restarts! "
     "It is unsafe to change this between edenfs invocations!");
+DEFINE_string(
+    local_storage_pack_key_spaces,
+    "",
+    "Comma-separated list of local store key spaces (e.g. \"blob,tree\") to "
+    "keep in append-only pack files rather than in the storage engine. "
+    "It is unsafe to change this between edenfs invocations!");
 DEFINE_int32(
     thrift_num_workers,
     std::thread::hardware_concurrency(),
@@ -118,6 +127,14 @@ DEFINE_uint64(
     minimumBlobCacheEntryCount,
     16,
     "The minimum number of recent blobs to keep cached. Trumps maximumBlobCacheSize");
+DEFINE_uint64(
+    maximumTreeCacheSize,
+    40 * 1024 * 1024,
+    "How many bytes worth of trees to keep in memory, at most");
+DEFINE_uint64(
+    minimumTreeCacheEntryCount,
+    16,
+    "The minimum number of recent trees to keep cached. Trumps maximumTreeCacheSize");
 
 using apache::thrift::ThriftServer;
 using facebook::eden::FuseChannelData;
@@ -139,6 +156,7 @@ using namespace facebook::eden;
 
 constexpr StringPiece kRocksDBPath{"storage/rocks-db"};
 constexpr StringPiece kSqlitePath{"storage/sqlite.db"};
+constexpr StringPiece kPackFilePath{"storage/pack"};
 } // namespace
 
 namespace facebook {
@@ -197,6 +215,9 @@ EdenServer::EdenServer(
       blobCache_{BlobCache::create(
           FLAGS_maximumBlobCacheSize,
           FLAGS_minimumBlobCacheEntryCount)},
+      treeCache_{TreeCache::create(
+          FLAGS_maximumTreeCacheSize,
+          FLAGS_minimumTreeCacheEntryCount)},
       serverState_{make_shared<ServerState>(
           std::move(userInfo),
           std::move(privHelper),
@@ -344,6 +365,9 @@ void EdenServer::updatePeriodicTaskIntervals(const EdenConfig& config) {
   reloadConfigTask_.updateInterval(
       std::chrono::duration_cast<std::chrono::milliseconds>(
           config.getConfigReloadInterval()));
+  localStoreGCTask_.updateInterval(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          config.getLocalStoreGCInterval()));
 }
 
 #ifndef _WIN32
@@ -488,7 +512,10 @@ Future<Unit> EdenServer::prepareImpl(
     const auto rocksPath = edenDir_.getPath() + RelativePathPiece{kRocksDBPath};
     ensureDirectoryExists(rocksPath);
     localStore_ = make_shared<RocksDbLocalStore>(
-        rocksPath, &serverState_->getFaultInjector());
+        rocksPath,
+        &serverState_->getFaultInjector(),
+        RocksDBOpenMode::ReadWrite,
+        serverState_->getClock());
     logger->log(
         "Opened RocksDB store in ",
         watch.elapsed().count() / 1000.0,
@@ -501,6 +528,23 @@ Future<Unit> EdenServer::prepareImpl(
         FLAGS_local_storage_engine_unsafe));
   }
 
+#ifndef _WIN32
+  if (!FLAGS_local_storage_pack_key_spaces.empty()) {
+    const auto packPath = edenDir_.getPath() + RelativePathPiece{kPackFilePath};
+    logger->log("Opening pack file store ", packPath, "...");
+    folly::stop_watch<std::chrono::milliseconds> watch;
+    localStore_ = make_shared<PackFileLocalStore>(
+        packPath,
+        std::move(localStore_),
+        PackFileLocalStore::parseKeySpaces(
+            FLAGS_local_storage_pack_key_spaces));
+    logger->log(
+        "Opened pack file store in ",
+        watch.elapsed().count() / 1000.0,
+        " seconds.");
+  }
+#endif // !_WIN32
+
 #ifndef _WIN32
   // Start listening for graceful takeover requests
   takeoverServer_.reset(
@@ -752,6 +796,47 @@ void EdenServer::registerStats(std::shared_ptr<EdenMount> edenMount) {
         auto stats = edenMount->getJournal().getStats();
         return stats ? stats->entryCount : 0;
       });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::JOURNAL_COMPACTIONS),
+      [edenMount] {
+        auto stats = edenMount->getJournal().getStats();
+        return stats ? stats->compactionCount : 0;
+      });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::JOURNAL_TRUNCATIONS),
+      [edenMount] {
+        auto stats = edenMount->getJournal().getStats();
+        return stats ? stats->truncationCount : 0;
+      });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::STATUS_CACHE_HITS), [edenMount] {
+        return edenMount->getScmStatusCache().getHitCount();
+      });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::STATUS_CACHE_INCREMENTAL_HITS),
+      [edenMount] {
+        return edenMount->getScmStatusCache().getIncrementalHitCount();
+      });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::STATUS_CACHE_MISSES),
+      [edenMount] {
+        return edenMount->getScmStatusCache().getMissCount();
+      });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::STATUS_CACHE_REDIFF_PATHS),
+      [edenMount] {
+        return edenMount->getScmStatusCache().getRediffPathCount();
+      });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::OBJECT_STORE_COALESCED_TREES),
+      [edenMount] {
+        return edenMount->getObjectStore()->getCoalescedTreeRequestCount();
+      });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::OBJECT_STORE_COALESCED_BLOBS),
+      [edenMount] {
+        return edenMount->getObjectStore()->getCoalescedBlobRequestCount();
+      });
 #else
   NOT_IMPLEMENTED();
 #endif // !_WIN32
@@ -763,6 +848,26 @@ void EdenServer::unregisterStats(EdenMount* edenMount) {
   counters->unregisterCallback(edenMount->getCounterName(CounterName::LOADED));
   counters->unregisterCallback(
       edenMount->getCounterName(CounterName::UNLOADED));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::JOURNAL_MEMORY));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::JOURNAL_ENTRIES));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::JOURNAL_COMPACTIONS));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::JOURNAL_TRUNCATIONS));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::STATUS_CACHE_HITS));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::STATUS_CACHE_INCREMENTAL_HITS));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::STATUS_CACHE_MISSES));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::STATUS_CACHE_REDIFF_PATHS));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::OBJECT_STORE_COALESCED_TREES));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::OBJECT_STORE_COALESCED_BLOBS));
 #else
   NOT_IMPLEMENTED();
 #endif // !_WIN32
@@ -799,6 +904,7 @@ Future<Unit> EdenServer::completeTakeoverFuseStart(
   FuseChannelData channelData;
   channelData.fd = std::move(info.fuseFD);
   channelData.connInfo = info.connInfo;
+  channelData.clonedFds = std::move(info.clonedFuseFDs);
 
   // Start up the fuse workers.
   return folly::makeFutureWith(
@@ -811,7 +917,13 @@ folly::Future<std::shared_ptr<EdenMount>> EdenServer::mount(
     optional<TakeoverData::MountInfo>&& optionalTakeover) {
   auto backingStore = getBackingStore(
       initialConfig->getRepoType(), initialConfig->getRepoSource());
-  auto objectStore = ObjectStore::create(getLocalStore(), backingStore);
+  auto objectStore = ObjectStore::create(
+      getLocalStore(),
+      backingStore,
+      treeCache_,
+      serverState_->getReloadableConfig()
+          .getEdenConfig()
+          ->getBlobMetadataCacheSize());
 
 #if _WIN32
   // Create the EdenMount object and insert the mount into the mountPoints_ map.
@@ -834,6 +946,8 @@ folly::Future<std::shared_ptr<EdenMount>> EdenServer::mount(
   const bool doTakeover = optionalTakeover.has_value();
   auto initFuture = edenMount->initialize(
       optionalTakeover ? std::make_optional(optionalTakeover->inodeMap)
+                       : std::nullopt,
+      optionalTakeover ? optionalTakeover->journalSequenceNumber
                        : std::nullopt);
   return std::move(initFuture)
       .thenValue([this,
@@ -950,6 +1064,14 @@ void EdenServer::mountFinished(
   }
 
   const bool doTakeover = takeoverPromise.has_value();
+  if (doTakeover && takeover) {
+    // FUSE requests have stopped, so the journal is complete.  The new
+    // process checks that the journal log it restores ends here.
+    auto latest = edenMount->getJournal().getLatest();
+    if (latest) {
+      takeover->journalSequenceNumber = latest->toSequence;
+    }
+  }
 
   // Shutdown the EdenMount, and fulfill the unmount promise
   // when the shutdown completes
@@ -1204,11 +1326,77 @@ void EdenServer::reportMemoryStats() {
     stats::ServiceData::get()->addStatValue(
         kRssBytes, memoryStats->resident, stats::AVG);
   }
+
+  auto blobCacheStats = blobCache_->getStats();
+  auto serviceData = stats::ServiceData::get();
+  for (size_t shard = 0; shard < blobCacheStats.shards.size(); ++shard) {
+    const auto& shardStats = blobCacheStats.shards[shard];
+    auto prefix = folly::to<std::string>("blob_cache.shard.", shard, ".");
+    serviceData->setCounter(
+        prefix + "hit_rate_pct",
+        static_cast<int64_t>(shardStats.getHitRate() * 100));
+    serviceData->setCounter(prefix + "bytes_evicted", shardStats.bytesEvicted);
+    serviceData->setCounter(
+        prefix + "rejection_count", shardStats.rejectionCount);
+  }
 #else
   NOT_IMPLEMENTED();
 #endif // !_WIN32
 }
 
+void EdenServer::garbageCollectLocalStore() {
+  auto config = serverState_->getReloadableConfig().getEdenConfig();
+  LocalStore::SizeLimits sizeLimits{};
+  sizeLimits[LocalStore::BlobFamily] = config->getLocalStoreBlobSizeLimit();
+  sizeLimits[LocalStore::BlobMetaDataFamily] =
+      config->getLocalStoreBlobMetaSizeLimit();
+  sizeLimits[LocalStore::HgCommitToTreeFamily] =
+      config->getLocalStoreHgCommitToTreeSizeLimit();
+
+  // Garbage collection scans the recorded access times and compacts the
+  // store, which can take minutes, so it must not run on the main thread.
+  folly::via(
+      serverState_->getThreadPool().get(),
+      [localStore = localStore_, sizeLimits] {
+        try {
+          if (!localStore->garbageCollect(sizeLimits)) {
+            XLOG(DBG2) << "local store garbage collection already running";
+            return;
+          }
+        } catch (const std::exception& ex) {
+          XLOG(ERR) << "error garbage collecting the local store: "
+                    << folly::exceptionStr(ex);
+        }
+
+        auto status = localStore->getGarbageCollectionStatus();
+        auto serviceData = stats::ServiceData::get();
+        serviceData->setCounter("local_store.gc.runs", status.runCount);
+        serviceData->setCounter(
+            "local_store.gc.last_run_duration_ms",
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                status.lastRunDuration)
+                .count());
+        for (const auto& ks : kKeySpaceRecords) {
+          if (!LocalStore::isGarbageCollected(ks.keySpace)) {
+            continue;
+          }
+          const auto& ksStatus = status.keySpaces[ks.keySpace];
+          auto prefix = folly::to<std::string>("local_store.gc.", ks.name, ".");
+          serviceData->setCounter(prefix + "size", ksStatus.approximateSize);
+          serviceData->setCounter(
+              prefix + "entries_evicted", ksStatus.entriesEvicted);
+          serviceData->setCounter(
+              prefix + "bytes_reclaimed", ksStatus.bytesReclaimed);
+          serviceData->setCounter(prefix + "clear_count", ksStatus.clearCount);
+          serviceData->setCounter(
+              prefix + "compaction_time_ms",
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  ksStatus.lastCompactionTime)
+                  .count());
+        }
+      });
+}
+
 void EdenServer::reloadConfig() {
   // Get the config, forcing a reload now.
   auto config = serverState_->getReloadableConfig().getEdenConfig(
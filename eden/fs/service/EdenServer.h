@@ -68,6 +68,7 @@ class StartupLogger;
 #ifndef _WIN32
 class TakeoverServer;
 #endif
+class TreeCache;
 /*
  * EdenServer contains logic for running the Eden main loop.
  *
@@ -257,6 +258,10 @@ class EdenServer : private TakeoverHandler {
     return blobCache_;
   }
 
+  const std::shared_ptr<TreeCache>& getTreeCache() const {
+    return treeCache_;
+  }
+
   /**
    * Look up the BackingStore object for the specified repository type+name.
    *
@@ -427,6 +432,10 @@ class EdenServer : private TakeoverHandler {
   // Report memory usage statistics to ServiceData.
   void reportMemoryStats();
 
+  // Start a garbage collection of the LocalStore's ephemeral key spaces in
+  // the background, using the size limits from the EdenConfig.
+  void garbageCollectLocalStore();
+
   // Cancel all subscribers on all mounts so that we can tear
   // down the thrift server without blocking
   void shutdownSubscribers();
@@ -449,6 +458,7 @@ class EdenServer : private TakeoverHandler {
   std::shared_ptr<LocalStore> localStore_;
   folly::Synchronized<BackingStoreMap> backingStores_;
   const std::shared_ptr<BlobCache> blobCache_;
+  const std::shared_ptr<TreeCache> treeCache_;
 
   folly::Synchronized<MountMap> mountPoints_;
 
@@ -495,6 +505,9 @@ class EdenServer : private TakeoverHandler {
                                                              "flush_stats"};
   PeriodicFnTask<&EdenServer::reportMemoryStats> memoryStatsTask_{this,
                                                                   "mem_stats"};
+  PeriodicFnTask<&EdenServer::garbageCollectLocalStore> localStoreGCTask_{
+      this,
+      "local_store_gc"};
 };
 } // namespace eden
 } // namespace facebook
@@ -52,10 +52,14 @@
 #include "eden/fs/service/EdenServer.h"
 #include "eden/fs/service/StreamingSubscriber.h"
 #include "eden/fs/service/ThriftUtil.h"
+#include "eden/fs/store/BlobCache.h"
 #include "eden/fs/store/BlobMetadata.h"
 #include "eden/fs/store/Diff.h"
+#include "eden/fs/store/ImportPriority.h"
+#include "eden/fs/store/KeySpaces.h"
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/store/TreeCache.h"
 #include "eden/fs/tracing/Tracing.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/FaultInjector.h"
@@ -101,7 +105,7 @@ std::string logHash(StringPiece thriftArg) {
   if (thriftArg.size() == Hash::RAW_SIZE) {
     return Hash{folly::ByteRange{thriftArg}}.toString();
   } else if (thriftArg.size() == Hash::RAW_SIZE * 2) {
-    return Hash{thriftArg}.toString();
+    return Hash::fromHex(thriftArg).toString();
   } else {
     return folly::hexlify(thriftArg);
   }
@@ -131,7 +135,9 @@ class ThriftLogHelper {
         itcFileName_(itcFileName),
         itcLineNumber_(itcLineNumber),
         level_(level),
-        itcLogger_(logger) {}
+        itcLogger_(logger),
+        importPriority_(std::make_unique<facebook::eden::ImportPriorityScope>(
+            facebook::eden::ImportPriorityClass::Thrift)) {}
 
   ~ThriftLogHelper() {
     if (wrapperExecuted_) {
@@ -175,6 +181,9 @@ class ThriftLogHelper {
   const folly::Logger& itcLogger_;
   folly::stop_watch<std::chrono::microseconds> itcTimer_ = {};
   bool wrapperExecuted_ = false;
+  // Every thrift call creates one of these, so this is where source control
+  // imports for thrift requests are given their priority.
+  std::unique_ptr<facebook::eden::ImportPriorityScope> importPriority_;
 };
 
 #ifndef _WIN32
@@ -370,12 +379,55 @@ void EdenServiceHandler::getSHA1(
   auto helper = INSTRUMENT_THRIFT_CALL(
       DBG3, *mountPoint, "[" + folly::join(", ", *paths.get()) + "]");
 
-  vector<Future<Hash>> futures;
+  vector<Future<FileInodePtr>> inodeFutures;
   for (const auto& path : *paths) {
-    futures.emplace_back(getSHA1ForPathDefensively(*mountPoint, path));
+    inodeFutures.emplace_back(
+        getFileInodeForSHA1Defensively(*mountPoint, path));
+  }
+  auto inodes = folly::collectAllSemiFuture(std::move(inodeFutures)).get();
+
+  // Look up the SHA-1s of all of the unmaterialized files with a single
+  // ObjectStore batch, rather than one LocalStore read per file.  Like
+  // FileInode::getSha1(), this reports the contents the file had when we
+  // looked at it, even if it is modified concurrently.
+  vector<Try<Hash>> results(inodes.size());
+  ObjectStore* objectStore = nullptr;
+  vector<size_t> blobIndexes;
+  vector<Hash> blobHashes;
+  vector<size_t> materializedIndexes;
+  vector<Future<Hash>> materializedFutures;
+  for (size_t i = 0; i < inodes.size(); ++i) {
+    if (inodes[i].hasException()) {
+      results[i] = Try<Hash>{std::move(inodes[i].exception())};
+      continue;
+    }
+    auto& inode = inodes[i].value();
+    if (auto blobHash = inode->getBlobHash()) {
+      objectStore = inode->getMount()->getObjectStore();
+      blobIndexes.push_back(i);
+      blobHashes.push_back(*blobHash);
+    } else {
+      materializedIndexes.push_back(i);
+      materializedFutures.push_back(inode->getSha1());
+    }
+  }
+
+  if (objectStore) {
+    auto metadata = objectStore->getBlobMetadataBatch(blobHashes).get();
+    for (size_t n = 0; n < metadata.size(); ++n) {
+      if (metadata[n].hasValue()) {
+        results[blobIndexes[n]] = Try<Hash>{metadata[n]->sha1};
+      } else {
+        results[blobIndexes[n]] = Try<Hash>{std::move(metadata[n].exception())};
+      }
+    }
+  }
+  auto materializedResults =
+      folly::collectAllSemiFuture(std::move(materializedFutures)).get();
+  for (size_t n = 0; n < materializedResults.size(); ++n) {
+    results[materializedIndexes[n]] = std::move(materializedResults[n]);
   }
 
-  auto results = folly::collectAllSemiFuture(std::move(futures)).get();
   for (auto& result : results) {
     out.emplace_back();
     SHA1Result& sha1Result = out.back();
@@ -390,23 +442,23 @@ void EdenServiceHandler::getSHA1(
 #endif // !_WIN32
 }
 
-Future<Hash> EdenServiceHandler::getSHA1ForPathDefensively(
+Future<FileInodePtr> EdenServiceHandler::getFileInodeForSHA1Defensively(
     StringPiece mountPoint,
     StringPiece path) noexcept {
 #ifndef _WIN32
   return folly::makeFutureWith(
-      [&] { return getSHA1ForPath(mountPoint, path); });
+      [&] { return getFileInodeForSHA1(mountPoint, path); });
 #else
   NOT_IMPLEMENTED();
 #endif // !_WIN32
 }
 
-Future<Hash> EdenServiceHandler::getSHA1ForPath(
+Future<FileInodePtr> EdenServiceHandler::getFileInodeForSHA1(
     StringPiece mountPoint,
     StringPiece path) {
 #ifndef _WIN32
   if (path.empty()) {
-    return makeFuture<Hash>(
+    return makeFuture<FileInodePtr>(
         newEdenError(EINVAL, "path cannot be the empty string"));
   }
 
@@ -416,10 +468,10 @@ Future<Hash> EdenServiceHandler::getSHA1ForPath(
     auto fileInode = inode.asFilePtr();
     if (!S_ISREG(fileInode->getMode())) {
       // We intentionally want to refuse to compute the SHA1 of symlinks
-      return makeFuture<Hash>(
+      return makeFuture<FileInodePtr>(
           InodeError(EINVAL, fileInode, "file is a symlink"));
     }
-    return fileInode->getSha1();
+    return makeFuture(std::move(fileInode));
   });
 #else
   NOT_IMPLEMENTED();
@@ -558,7 +610,8 @@ void EdenServiceHandler::getFilesChangedSince(
 #ifndef _WIN32
   auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint);
   auto edenMount = server_->getMount(*mountPoint);
-  auto delta = edenMount->getJournal().getLatest();
+  auto& journal = edenMount->getJournal();
+  auto delta = journal.getLatest();
 
   if (fromPosition->mountGeneration !=
       static_cast<ssize_t>(edenMount->getMountGeneration())) {
@@ -575,11 +628,24 @@ void EdenServiceHandler::getFilesChangedSince(
 
   out.fromPosition = out.toPosition;
 
-  // The +1 is because the core merge stops at the item prior to
+  // The +1 is because accumulateRange() stops at the item prior to
   // its limitSequence parameter and we want the changes *since*
   // the provided sequence number.
-  auto merged = delta->merge(fromPosition->sequenceNumber + 1, true);
+  auto merged = journal.accumulateRange(fromPosition->sequenceNumber + 1);
+  if (merged &&
+      merged->fromSequence >
+          static_cast<Journal::SequenceNumber>(fromPosition->sequenceNumber) +
+              1) {
+    throw newEdenError(
+        ERANGE,
+        "the journal has been truncated past fromPosition.sequenceNumber.  "
+        "You need to compute a new basis for delta queries.");
+  }
   if (merged) {
+    // Deltas may have been added since getLatest() was called.
+    out.toPosition.sequenceNumber = merged->toSequence;
+    out.toPosition.snapshotHash = thriftHash(merged->toHash);
+
     out.fromPosition.sequenceNumber = merged->fromSequence;
     out.fromPosition.snapshotHash = thriftHash(merged->fromHash);
     out.fromPosition.mountGeneration = out.toPosition.mountGeneration;
@@ -603,33 +669,6 @@ void EdenServiceHandler::getFilesChangedSince(
 #endif
 }
 
-namespace {
-/**
- * Starting from the provided delta, walks the chain backwards until it finds
- * the delta whose [fromSequence, toSequence] range includes `target`.
- */
-const JournalDelta* FOLLY_NULLABLE
-findJournalDelta(const JournalDelta* delta, Journal::SequenceNumber target) {
-#ifndef _WIN32
-  // If the tip of the delta chain precedes the target, then do not bother to
-  // search.
-  if (delta == nullptr || delta->toSequence < target) {
-    return nullptr;
-  }
-
-  while (delta) {
-    if (delta->fromSequence <= target && target <= delta->toSequence) {
-      return delta;
-    }
-    delta = delta->previous.get();
-  }
-  return nullptr;
-#else
-  NOT_IMPLEMENTED();
-#endif // !_WIN32
-}
-} // namespace
-
 void EdenServiceHandler::debugGetRawJournal(
     DebugGetRawJournalResponse& out,
     std::unique_ptr<DebugGetRawJournalParams> params) {
@@ -647,40 +686,34 @@ void EdenServiceHandler::debugGetRawJournal(
         "You need to compute a new basis for delta queries.");
   }
 
-  auto latest = edenMount->getJournal().getLatest();
-
-  // Walk the journal until we find toPosition.
+  // Get the deltas from the one that includes toPosition back to the one that
+  // includes fromPosition, or the oldest one, whichever comes first.
   auto toPos =
-      findJournalDelta(latest.get(), params->toPosition.sequenceNumber);
-  if (toPos == nullptr) {
+      static_cast<Journal::SequenceNumber>(params->toPosition.sequenceNumber);
+  auto fromPos = static_cast<Journal::SequenceNumber>(
+      std::max<int64_t>(params->fromPosition.sequenceNumber, 0));
+  auto deltas = edenMount->getJournal().getDeltas(fromPos, toPos);
+  if (deltas.empty() || deltas.front().toSequence < toPos) {
     throw newEdenError(
         "no JournalDelta found for toPosition.sequenceNumber ",
         params->toPosition.sequenceNumber);
   }
 
-  // Walk the journal until we find a JournalDelta that preceeds fromPosition,
-  // or the beginning of the chain, whichever comes first.
-  auto current = toPos;
-  auto fromPos = params->fromPosition.sequenceNumber;
-  while (current) {
-    if (static_cast<ssize_t>(current->toSequence) < fromPos) {
-      break;
-    }
-
+  for (const auto& current : deltas) {
     DebugJournalDelta delta;
     JournalPosition fromPosition;
     fromPosition.set_mountGeneration(mountGeneration);
-    fromPosition.set_sequenceNumber(current->fromSequence);
-    fromPosition.set_snapshotHash(thriftHash(current->fromHash));
+    fromPosition.set_sequenceNumber(current.fromSequence);
+    fromPosition.set_snapshotHash(thriftHash(current.fromHash));
     delta.set_fromPosition(fromPosition);
 
     JournalPosition toPosition;
     toPosition.set_mountGeneration(mountGeneration);
-    toPosition.set_sequenceNumber(current->toSequence);
-    toPosition.set_snapshotHash(thriftHash(current->toHash));
+    toPosition.set_sequenceNumber(current.toSequence);
+    toPosition.set_snapshotHash(thriftHash(current.toHash));
     delta.set_toPosition(toPosition);
 
-    for (const auto& entry : current->changedFilesInOverlay) {
+    for (const auto& entry : current.changedFilesInOverlay) {
       auto& path = entry.first;
       auto& changeInfo = entry.second;
 
@@ -690,12 +723,11 @@ void EdenServiceHandler::debugGetRawJournal(
       delta.changedPaths.emplace(path.stringPiece().str(), debugChangeInfo);
     }
 
-    for (auto& path : current->uncleanPaths) {
+    for (auto& path : current.uncleanPaths) {
       delta.uncleanPaths.emplace(path.stringPiece().str());
     }
 
     out.allDeltas.push_back(delta);
-    current = current->previous.get();
   }
 #else
   NOT_IMPLEMENTED();
@@ -915,25 +947,27 @@ std::optional<mode_t> EdenServiceHandler::isInManifestAsFile(
     const EdenMount* mount,
     const RelativePathPiece filename) {
 #ifndef _WIN32
-  auto tree = mount->getRootTree();
-  auto parentDirectory = filename.dirname();
+  // Look up one entry per directory rather than loading each Tree on the
+  // way down.
+  auto treeId = mount->getRootTree()->getHash();
   auto objectStore = mount->getObjectStore();
-  for (auto piece : parentDirectory.components()) {
-    auto entry = tree->getEntryPtr(piece);
-    if (entry != nullptr && entry->isTree()) {
-      tree = objectStore->getTree(entry->getHash()).get();
-    } else {
+  std::optional<TreeEntry> entry;
+  for (auto piece : filename.components()) {
+    if (entry) {
+      if (!entry->isTree()) {
+        return std::nullopt;
+      }
+      treeId = entry->getHash();
+    }
+    entry = objectStore->getTreeEntry(treeId, piece).get();
+    if (!entry) {
       return std::nullopt;
     }
   }
 
-  if (tree != nullptr) {
-    auto entry = tree->getEntryPtr(filename.basename());
-    if (entry != nullptr && !entry->isTree()) {
-      return modeFromTreeEntryType(entry->getType());
-    }
+  if (entry && !entry->isTree()) {
+    return modeFromTreeEntryType(entry->getType());
   }
-
   return std::nullopt;
 #else
   NOT_IMPLEMENTED();
@@ -954,7 +988,10 @@ EdenServiceHandler::future_getScmStatus(
 
   auto mount = server_->getMount(*mountPoint);
   auto hash = hashFromThrift(*commitHash);
-  return helper.wrapFuture(diffMountForStatus(*mount, hash, listIgnored));
+  // The status cache lives in the mount, so keep it alive until the diff
+  // completes.
+  return helper.wrapFuture(
+      diffMountForStatus(*mount, hash, listIgnored).ensure([mount] {}));
 #else
   NOT_IMPLEMENTED();
 #endif // !_WIN32
@@ -1285,13 +1322,59 @@ void EdenServiceHandler::getStatInfo(InternalStats& result) {
     result.smaps = std::move(smaps);
   }
 
+  auto toCacheStats = [](const BlobCache::ShardStats& stats) {
+    CacheStats cacheStats;
+    cacheStats.entryCount = stats.blobCount;
+    cacheStats.totalSizeInBytes = stats.totalSizeInBytes;
+    cacheStats.hitCount = stats.hitCount;
+    cacheStats.missCount = stats.missCount;
+    cacheStats.evictionCount = stats.evictionCount;
+    cacheStats.dropCount = stats.dropCount;
+    cacheStats.bytesEvicted = stats.bytesEvicted;
+    cacheStats.rejectionCount = stats.rejectionCount;
+    return cacheStats;
+  };
   const auto blobCacheStats = server_->getBlobCache()->getStats();
-  result.blobCacheStats.entryCount = blobCacheStats.blobCount;
-  result.blobCacheStats.totalSizeInBytes = blobCacheStats.totalSizeInBytes;
-  result.blobCacheStats.hitCount = blobCacheStats.hitCount;
-  result.blobCacheStats.missCount = blobCacheStats.missCount;
-  result.blobCacheStats.evictionCount = blobCacheStats.evictionCount;
-  result.blobCacheStats.dropCount = blobCacheStats.dropCount;
+  result.blobCacheStats = toCacheStats(blobCacheStats);
+  for (const auto& shardStats : blobCacheStats.shards) {
+    result.blobCacheShardStats.push_back(toCacheStats(shardStats));
+  }
+
+  const auto treeCacheStats = server_->getTreeCache()->getStats();
+  result.treeCacheStats.entryCount = treeCacheStats.treeCount;
+  result.treeCacheStats.totalSizeInBytes = treeCacheStats.totalSizeInBytes;
+  result.treeCacheStats.hitCount = treeCacheStats.hitCount;
+  result.treeCacheStats.missCount = treeCacheStats.missCount;
+  result.treeCacheStats.evictionCount = treeCacheStats.evictionCount;
+
+  const auto gcStatus = server_->getLocalStore()->getGarbageCollectionStatus();
+  result.localStoreGCStats.running = gcStatus.running;
+  if (gcStatus.currentKeySpace) {
+    result.localStoreGCStats.currentKeySpace =
+        kKeySpaceRecords[*gcStatus.currentKeySpace].name.str();
+  }
+  result.localStoreGCStats.runCount = gcStatus.runCount;
+  result.localStoreGCStats.lastRunDurationMs =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          gcStatus.lastRunDuration)
+          .count();
+  for (const auto& ks : kKeySpaceRecords) {
+    if (!LocalStore::isGarbageCollected(ks.keySpace)) {
+      continue;
+    }
+    const auto& ksStatus = gcStatus.keySpaces[ks.keySpace];
+    KeySpaceGCStats ksStats;
+    ksStats.sizeLimit = ksStatus.sizeLimit;
+    ksStats.approximateSize = ksStatus.approximateSize;
+    ksStats.entriesEvicted = ksStatus.entriesEvicted;
+    ksStats.bytesReclaimed = ksStatus.bytesReclaimed;
+    ksStats.clearCount = ksStatus.clearCount;
+    ksStats.lastCompactionTimeMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            ksStatus.lastCompactionTime)
+            .count();
+    result.localStoreGCStats.keySpaces[ks.name.str()] = ksStats;
+  }
 #else
   NOT_IMPLEMENTED();
 #endif // !_WIN32
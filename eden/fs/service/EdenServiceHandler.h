@@ -11,6 +11,7 @@
 
 #include <optional>
 #include "common/fb303/cpp/FacebookBase2.h"
+#include "eden/fs/inodes/InodePtrFwd.h"
 #include "eden/fs/service/gen-cpp2/StreamingEdenService.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -200,11 +201,14 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
       std::unique_ptr<GetConfigParams> params) override;
 
  private:
-  folly::Future<Hash> getSHA1ForPath(
+  /**
+   * Look up the regular file whose SHA-1 getSHA1() should report.
+   */
+  folly::Future<FileInodePtr> getFileInodeForSHA1(
       folly::StringPiece mountPoint,
       folly::StringPiece path);
 
-  folly::Future<Hash> getSHA1ForPathDefensively(
+  folly::Future<FileInodePtr> getFileInodeForSHA1Defensively(
       folly::StringPiece mountPoint,
       folly::StringPiece path) noexcept;
 
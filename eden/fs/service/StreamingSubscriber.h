@@ -23,12 +23,11 @@ namespace eden {
  * connected subscribers so that they can take action as files
  * are modified in the eden mount.
  *
- * This initial implementation is relatively dumb in that it
- * will immediately try to send a notification to the subscriber.
+ * The journal coalesces changes made in quick succession and notifies us
+ * from its executor (see Journal::setSubscriberExecutor), so a burst of
+ * changes results in a single update rather than one per change.
  *
- * Future iterations will add the ability to rate control these
- * updates (no more than 1 update per specified time interval)
- * and potentially also add a predicate so that we only notify
+ * Future iterations may add a predicate so that we only notify
  * for updates that match certain criteria.
  */
 
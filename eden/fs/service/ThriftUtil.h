@@ -50,7 +50,7 @@ inline Hash hashFromThrift(const std::string& commitID) {
     return Hash(folly::ByteRange(folly::StringPiece(commitID)));
   } else if (commitID.size() == 2 * Hash::RAW_SIZE) {
     // This looks like 40 bytes of hexadecimal data.
-    return Hash(commitID);
+    return Hash::fromHex(commitID);
   } else {
     throw newEdenError(
         "expected argument to be a 20-byte binary hash or "
@@ -424,6 +424,54 @@ struct CacheStats {
   4: i64 missCount
   5: i64 evictionCount
   6: i64 dropCount
+  /**
+   * The total size of the entries counted by evictionCount.
+   */
+  7: i64 bytesEvicted
+  /**
+   * The number of inserted entries the cache declined to store because they
+   * were requested less often than the entries they would have evicted.
+   */
+  8: i64 rejectionCount
+}
+
+/**
+ * Garbage collection totals for one LocalStore key space.
+ */
+struct KeySpaceGCStats {
+  /**
+   * The configured limit, or 0 if the key space is not limited.
+   */
+  1: i64 sizeLimit
+  /**
+   * The approximate on-disk size after the most recent collection.
+   */
+  2: i64 approximateSize
+  3: i64 entriesEvicted
+  4: i64 bytesReclaimed
+  /**
+   * How many times the key space had to be cleared entirely, because too
+   * little of it had a recorded access time to evict by.
+   */
+  5: i64 clearCount
+  6: i64 lastCompactionTimeMs
+}
+
+/**
+ * Progress and totals of the LocalStore's background garbage collection.
+ */
+struct LocalStoreGCStats {
+  1: bool running
+  /**
+   * The key space being collected, if running is true.
+   */
+  2: string currentKeySpace
+  3: i64 runCount
+  4: i64 lastRunDurationMs
+  /**
+   * Totals for each garbage collected key space, by name.
+   */
+  5: map<string, KeySpaceGCStats> keySpaces
 }
 
 /**
@@ -466,6 +514,18 @@ struct InternalStats {
    * and whose value is information about the journal on that mount
    */
   8: map<PathString, JournalInfo> mountPointJournalInfo
+  /**
+   * Statistics about the in-memory tree cache.
+   */
+  9: CacheStats treeCacheStats
+  /**
+   * Statistics about garbage collection of the local store.
+   */
+  10: LocalStoreGCStats localStoreGCStats
+  /**
+   * The statistics in blobCacheStats, broken down by cache shard.
+   */
+  11: list<CacheStats> blobCacheShardStats
 }
 
 struct ManifestEntry {
@@ -0,0 +1,36 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/BackingStore.h"
+
+#include <folly/Conv.h>
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+folly::Future<BlobRange> BackingStore::getBlobRange(
+    const Hash& id,
+    uint64_t /*offset*/,
+    uint64_t /*length*/) {
+  return getBlob(id).thenValue([id](std::unique_ptr<Blob> blob) {
+    if (!blob) {
+      throw std::domain_error(
+          folly::to<std::string>("blob ", id.toString(), " not found"));
+    }
+    BlobRange range;
+    range.blobSize = blob->getSize();
+    range.data = blob->getContents();
+    return range;
+  });
+}
+
+} // namespace eden
+} // namespace facebook
@@ -10,8 +10,11 @@
 #pragma once
 
 #include <folly/futures/Future.h>
+#include <folly/io/IOBuf.h>
 #include <memory>
 
+#include "eden/fs/store/ImportPriority.h"
+
 namespace folly {
 template <typename T>
 class Future;
@@ -24,6 +27,23 @@ class Blob;
 class Hash;
 class Tree;
 
+/**
+ * Part of the contents of a blob, as returned by BackingStore::getBlobRange().
+ */
+struct BlobRange {
+  /**
+   * The offset of data within the blob.
+   */
+  uint64_t offset{0};
+
+  /**
+   * The size of the whole blob.
+   */
+  uint64_t blobSize{0};
+
+  folly::IOBuf data;
+};
+
 /**
  * Abstract interface for a BackingStore.
  *
@@ -42,11 +62,39 @@ class BackingStore {
   virtual folly::Future<std::unique_ptr<Blob>> getBlob(const Hash& id) = 0;
   virtual folly::Future<std::unique_ptr<Tree>> getTreeForCommit(
       const Hash& commitID) = 0;
+
+  /**
+   * Fetch at least the given range of a blob's contents, or as much of it as
+   * exists if the range extends past the end of the blob.
+   *
+   * The result may include more data than was requested.  The default
+   * implementation fetches the entire blob, so backing stores that can fetch
+   * part of a file should override this.
+   */
+  virtual folly::Future<BlobRange>
+  getBlobRange(const Hash& id, uint64_t offset, uint64_t length);
+
   FOLLY_NODISCARD virtual folly::Future<folly::Unit> prefetchBlobs(
       const std::vector<Hash>& ids) const {
     return folly::unit;
   }
 
+  /**
+   * Called when a more urgent caller starts waiting on an in-progress
+   * getTree() or getBlob() for the given object.
+   *
+   * ObjectStore merges concurrent requests for the same object, so the later
+   * caller never reaches the BackingStore itself.  Backing stores that queue
+   * fetches by priority should move the pending fetch up to the new priority.
+   * This must not throw.
+   */
+  virtual void raiseTreePriority(
+      const Hash& id,
+      ImportPriorityClass priority) {}
+  virtual void raiseBlobPriority(
+      const Hash& id,
+      ImportPriorityClass priority) {}
+
  private:
   // Forbidden copy constructor and assignment operator
   BackingStore(BackingStore const&) = delete;
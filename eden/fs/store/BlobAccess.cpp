@@ -11,6 +11,7 @@
 #include <folly/MapUtil.h>
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/store/BlobCache.h"
+#include "eden/fs/store/BlobChunk.h"
 #include "eden/fs/store/IObjectStore.h"
 
 namespace facebook {
@@ -38,5 +39,23 @@ folly::Future<BlobCache::GetResult> BlobAccess::getBlob(
       });
 }
 
+folly::Future<BlobCache::GetResult> BlobAccess::getBlobChunk(
+    const Hash& hash,
+    uint64_t chunkIndex,
+    BlobCache::Interest interest) {
+  auto result = blobCache_->get(getBlobChunkId(hash, chunkIndex), interest);
+  if (result.blob) {
+    return std::move(result);
+  }
+
+  return objectStore_->getBlobChunk(hash, chunkIndex)
+      .thenValue([blobCache = blobCache_,
+                  interest](std::shared_ptr<const Blob> chunk) {
+        auto interestHandle = blobCache->insert(chunk, interest);
+        return BlobCache::GetResult{std::move(chunk),
+                                    std::move(interestHandle)};
+      });
+}
+
 } // namespace eden
 } // namespace facebook
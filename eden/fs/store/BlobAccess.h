@@ -26,10 +26,9 @@ class IObjectStore;
  * cache for every read() request that makes into the edenfs process. Thus,
  * centralize blob access through this interface.
  *
- * TODO: To support large files, they should be split into a series of blobs,
- * and those blobs should get their own blob IDs, which could then be used
- * in this API. Splitting large blobs into a series of smaller blobs has the
- * benefit of helping bound Eden's memory usage here.
+ * Large files can also be read a chunk at a time with getBlobChunk(). Chunks
+ * have blob IDs of their own (see BlobChunk.h), so they are cached alongside
+ * whole blobs, which helps bound Eden's memory usage when reading large files.
  */
 class BlobAccess {
  public:
@@ -60,6 +59,17 @@ class BlobAccess {
       const Hash& hash,
       BlobCache::Interest interest = BlobCache::Interest::LikelyNeededAgain);
 
+  /**
+   * Loads and returns one chunk of a blob's contents, as described in
+   * BlobChunk.h, without loading the rest of the blob.
+   *
+   * The returned blob and interest handle are those of the chunk.
+   */
+  folly::Future<BlobCache::GetResult> getBlobChunk(
+      const Hash& hash,
+      uint64_t chunkIndex,
+      BlobCache::Interest interest = BlobCache::Interest::LikelyNeededAgain);
+
  private:
   BlobAccess(const BlobAccess&) = delete;
   BlobAccess& operator=(const BlobAccess&) = delete;
@@ -10,6 +10,8 @@
 #include "BlobCache.h"
 #include <folly/MapUtil.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
+#include <thread>
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/utils/IDGen.h"
 
@@ -31,15 +33,26 @@ void BlobInterestHandle::reset() noexcept {
     blobCache->dropInterestHandle(hash_, cacheItemGeneration_);
   }
   blobCache_.reset();
+  heldBlob_.reset();
 }
 
 std::shared_ptr<const Blob> BlobInterestHandle::getBlob() const {
+  if (heldBlob_) {
+    return heldBlob_;
+  }
+
   auto blobCache = blobCache_.lock();
   if (blobCache) {
     // UnlikelyNeededAgain because there's no need to create a new interest
-    // handle nor bump the refcount.
-    auto blob =
-        blobCache->get(hash_, BlobCache::Interest::UnlikelyNeededAgain).blob;
+    // handle nor bump the refcount. Lookups through an interest handle are the
+    // same use of the blob continuing, such as reading a large file in many
+    // chunks, so they do not count towards its frequency.
+    auto blob = blobCache
+                    ->lookup(
+                        hash_,
+                        BlobCache::Interest::UnlikelyNeededAgain,
+                        /*recordAccess=*/false)
+                    .blob;
     if (blob) {
       return blob;
     }
@@ -59,13 +72,48 @@ std::shared_ptr<BlobCache> BlobCache::create(
   return std::make_shared<BC>(maximumCacheSizeBytes, minimumEntryCount);
 }
 
+namespace {
+size_t getShardCount(size_t maximumCacheSizeBytes) {
+  auto shardCount = std::clamp<size_t>(
+      std::thread::hardware_concurrency(),
+      BlobCache::kMinimumShardCount,
+      BlobCache::kMaximumShardCount);
+  return std::clamp<size_t>(
+      maximumCacheSizeBytes / BlobCache::kMinimumShardSizeBytes, 1, shardCount);
+}
+} // namespace
+
 BlobCache::BlobCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount)
-    : maximumCacheSizeBytes_{maximumCacheSizeBytes},
-      minimumEntryCount_{minimumEntryCount} {}
+    : BlobCache{maximumCacheSizeBytes,
+                minimumEntryCount,
+                getShardCount(maximumCacheSizeBytes)} {}
+
+BlobCache::BlobCache(
+    size_t maximumCacheSizeBytes,
+    size_t minimumEntryCount,
+    size_t shardCount)
+    : maximumCacheSizeBytes_{maximumCacheSizeBytes / shardCount},
+      minimumEntryCount_{(minimumEntryCount + shardCount - 1) / shardCount} {
+  shards_.resize(shardCount);
+  for (auto& shard : shards_) {
+    shard = std::make_unique<SynchronizedState>();
+  }
+}
 
 BlobCache::~BlobCache() {}
 
+BlobCache::SynchronizedState& BlobCache::getShard(const Hash& hash) const {
+  // As in BlobMetadataCache, pick the shard from the last byte of the hash,
+  // since std::hash<Hash> uses the leading bytes.
+  return *shards_[hash.getBytes()[Hash::RAW_SIZE - 1] % shards_.size()];
+}
+
 BlobCache::GetResult BlobCache::get(const Hash& hash, Interest interest) {
+  return lookup(hash, interest, /*recordAccess=*/true);
+}
+
+BlobCache::GetResult
+BlobCache::lookup(const Hash& hash, Interest interest, bool recordAccess) {
   XLOG(DBG6) << "BlobCache::get " << hash;
 
   // Acquires BlobCache's lock upon destruction by calling dropInterestHandle,
@@ -73,15 +121,21 @@ BlobCache::GetResult BlobCache::get(const Hash& hash, Interest interest) {
   // runs after the lock is released.
   BlobInterestHandle interestHandle;
 
-  auto state = state_.wlock();
+  auto state = getShard(hash).rlock();
 
   auto* item = folly::get_ptr(state->items, hash);
   if (!item) {
     XLOG(DBG6) << "BlobCache::get missed";
+    // A miss is followed by inserting the loaded blob, which records the
+    // access.
     ++state->missCount;
     return GetResult{};
   }
 
+  if (recordAccess) {
+    state->frequencies.increment(hash);
+  }
+
   switch (interest) {
     case Interest::UnlikelyNeededAgain:
       interestHandle.blob_ = item->blob;
@@ -106,10 +160,12 @@ BlobCache::GetResult BlobCache::get(const Hash& hash, Interest interest) {
 
   XLOG(DBG6) << "BlobCache::get hit";
 
+  // Moving the item to the back of the eviction queue would need the lock
+  // for writing, so mark it instead, and let evictOne() move it.
+  //
   // TODO: Should we avoid promoting if interest is UnlikelyNeededAgain?
   // For now, we'll try not to be too clever.
-  state->evictionQueue.splice(
-      state->evictionQueue.end(), state->evictionQueue, item->index);
+  item->referenced.store(true, std::memory_order_relaxed);
   ++state->hitCount;
   return GetResult{item->blob, std::move(interestHandle)};
 }
@@ -139,7 +195,18 @@ BlobInterestHandle BlobCache::insert(
 
   XLOG(DBG6) << "  creating entry with generation=" << cacheItemGeneration;
 
-  auto state = state_.wlock();
+  auto state = getShard(hash).wlock();
+  state->frequencies.increment(hash);
+  if (!state->items.count(hash) && !shouldAdmit(*state, hash, size)) {
+    XLOG(DBG6) << "  not admitting " << hash;
+    // The handle holds the blob instead of the cache, so the caller can keep
+    // using it, and dropping the handle does not call back into the cache.
+    ++state->rejectionCount;
+    interestHandle.blobCache_.reset();
+    interestHandle.heldBlob_ = std::move(blob);
+    return interestHandle;
+  }
+
   auto [iter, inserted] =
       state->items.try_emplace(hash, std::move(blob), cacheItemGeneration);
   // noexcept from here until `try`
@@ -173,27 +240,45 @@ BlobInterestHandle BlobCache::insert(
 }
 
 bool BlobCache::contains(const Hash& hash) const {
-  auto state = state_.rlock();
+  auto state = getShard(hash).rlock();
   return 1 == state->items.count(hash);
 }
 
 void BlobCache::clear() {
   XLOG(DBG6) << "BlobCache::clear";
-  auto state = state_.wlock();
-  state->totalSize = 0;
-  state->items.clear();
-  state->evictionQueue.clear();
+  for (auto& shard : shards_) {
+    auto state = shard->wlock();
+    state->totalSize = 0;
+    state->items.clear();
+    state->evictionQueue.clear();
+  }
 }
 
 BlobCache::Stats BlobCache::getStats() const {
-  auto state = state_.rlock();
   Stats stats;
-  stats.blobCount = state->items.size();
-  stats.totalSizeInBytes = state->totalSize;
-  stats.hitCount = state->hitCount;
-  stats.missCount = state->missCount;
-  stats.evictionCount = state->evictionCount;
-  stats.dropCount = state->dropCount;
+  stats.shards.reserve(shards_.size());
+  for (const auto& shard : shards_) {
+    auto state = shard->rlock();
+    ShardStats shardStats;
+    shardStats.blobCount = state->items.size();
+    shardStats.totalSizeInBytes = state->totalSize;
+    shardStats.hitCount = state->hitCount;
+    shardStats.missCount = state->missCount;
+    shardStats.evictionCount = state->evictionCount;
+    shardStats.dropCount = state->dropCount;
+    shardStats.bytesEvicted = state->bytesEvicted;
+    shardStats.rejectionCount = state->rejectionCount;
+    stats.shards.push_back(shardStats);
+
+    stats.blobCount += shardStats.blobCount;
+    stats.totalSizeInBytes += shardStats.totalSizeInBytes;
+    stats.hitCount += shardStats.hitCount;
+    stats.missCount += shardStats.missCount;
+    stats.evictionCount += shardStats.evictionCount;
+    stats.dropCount += shardStats.dropCount;
+    stats.bytesEvicted += shardStats.bytesEvicted;
+    stats.rejectionCount += shardStats.rejectionCount;
+  }
   return stats;
 }
 
@@ -201,7 +286,7 @@ void BlobCache::dropInterestHandle(
     const Hash& hash,
     uint64_t generation) noexcept {
   XLOG(DBG6) << "dropInterestHandle " << hash << " generation=" << generation;
-  auto state = state_.wlock();
+  auto state = getShard(hash).wlock();
 
   auto* item = folly::get_ptr(state->items, hash);
   if (!item) {
@@ -229,6 +314,32 @@ void BlobCache::dropInterestHandle(
   }
 }
 
+bool BlobCache::shouldAdmit(State& state, const Hash& hash, size_t size)
+    const {
+  // If inserting this blob would evict anything, only admit it if it has been
+  // requested at least as often as the first blob it would evict. Blobs are
+  // admitted on ties, so that a cache of blobs that are each requested once
+  // behaves like a plain LRU.
+  if (state.evictionQueue.empty() ||
+      state.totalSize + size <= maximumCacheSizeBytes_ ||
+      state.evictionQueue.size() + 1 <= minimumEntryCount_) {
+    return true;
+  }
+  const auto& victimHash = nextVictim(state)->blob->getHash();
+  return state.frequencies.estimate(hash) >=
+      state.frequencies.estimate(victimHash);
+}
+
+BlobCache::CacheItem* BlobCache::nextVictim(State& state) noexcept {
+  auto& queue = state.evictionQueue;
+  // Each pass clears a referenced flag, and lookups cannot set them while
+  // the lock is held for writing, so this terminates.
+  while (queue.front()->referenced.exchange(false, std::memory_order_relaxed)) {
+    queue.splice(queue.end(), queue, queue.begin());
+  }
+  return queue.front();
+}
+
 void BlobCache::evictUntilFits(State& state) noexcept {
   XLOG(DBG6) << "state.totalSize=" << state.totalSize
              << ", maximumCacheSizeBytes_=" << maximumCacheSizeBytes_
@@ -241,9 +352,10 @@ void BlobCache::evictUntilFits(State& state) noexcept {
 }
 
 void BlobCache::evictOne(State& state) noexcept {
-  CacheItem* front = state.evictionQueue.front();
+  CacheItem* front = nextVictim(state);
   state.evictionQueue.pop_front();
   ++state.evictionCount;
+  state.bytesEvicted += front->blob->getSize();
   evictItem(state, front);
 }
 
@@ -10,10 +10,14 @@
 #pragma once
 
 #include <folly/Synchronized.h>
+#include <atomic>
 #include <cstddef>
 #include <list>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 #include "eden/fs/model/Hash.h"
+#include "eden/fs/store/FrequencySketch.h"
 
 namespace facebook {
 namespace eden {
@@ -62,6 +66,10 @@ class BlobInterestHandle {
   // retrieving it anyway.
   std::weak_ptr<const Blob> blob_;
 
+  // Set instead of blobCache_ if the cache did not admit the blob, so that the
+  // handle keeps it in memory until the handle is dropped.
+  std::shared_ptr<const Blob> heldBlob_;
+
   // Only causes eviction if this matches the corresponding
   // CacheItem::generation.
   uint64_t cacheItemGeneration_{0};
@@ -79,6 +87,19 @@ class BlobInterestHandle {
  * frequently-accessed large blobs when they are larger than the maximum cache
  * size.
  *
+ * So that concurrent lookups do not contend on a single lock, the cache is
+ * split into about one shard per core by blob hash, each with its own lock,
+ * eviction queue, and an equal share of the maximum size and minimum entry
+ * count. Lookups only take their shard's lock for reading: rather than moving
+ * a blob to the back of the eviction queue, a lookup marks it as referenced,
+ * and eviction gives referenced blobs a second chance (CLOCK).
+ *
+ * A blob is only admitted to a full shard if it has been requested at least
+ * as often recently as the blob it would evict first (TinyLFU). This keeps a
+ * one-off scan of large files from flushing the working set. Blobs are
+ * admitted unconditionally while their shard has room. The interest handle
+ * returned for a blob that is not admitted holds the blob itself.
+ *
  * It is safe to use this object from arbitrary threads.
  */
 class BlobCache : public std::enable_shared_from_this<BlobCache> {
@@ -117,15 +138,43 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
     GetResult& operator=(GetResult&&) = default;
   };
 
-  struct Stats {
+  struct ShardStats {
     size_t blobCount{0};
     size_t totalSizeInBytes{0};
     uint64_t hitCount{0};
     uint64_t missCount{0};
     uint64_t evictionCount{0};
     uint64_t dropCount{0};
+    /// The total size of the blobs counted by evictionCount.
+    uint64_t bytesEvicted{0};
+    /// Inserted blobs that were not admitted, because a blob they would have
+    /// displaced had been requested more often.
+    uint64_t rejectionCount{0};
+
+    /**
+     * The fraction of lookups that hit, or 0 if there have been none.
+     */
+    double getHitRate() const {
+      auto lookups = hitCount + missCount;
+      return lookups ? static_cast<double>(hitCount) / lookups : 0.0;
+    }
+  };
+
+  /**
+   * Totals across all shards, and the statistics of each shard.
+   */
+  struct Stats : ShardStats {
+    std::vector<ShardStats> shards;
   };
 
+  /**
+   * Caches use one shard per core, within these bounds.  Caches smaller than
+   * kMinimumShardSizeBytes per shard, as in tests, use fewer shards.
+   */
+  static constexpr size_t kMinimumShardCount = 8;
+  static constexpr size_t kMaximumShardCount = 16;
+  static constexpr size_t kMinimumShardSizeBytes = 1024 * 1024;
+
   static std::shared_ptr<BlobCache> create(
       size_t maximumCacheSizeBytes,
       size_t minimumEntryCount);
@@ -171,10 +220,14 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
 
   /**
    * Return information about the current size of the cache and the total number
-   * of hits and misses.
+   * of hits and misses, overall and for each shard.
    */
   Stats getStats() const;
 
+  size_t getShardCount() const {
+    return shards_.size();
+  }
+
  private:
   /*
    * TODO: This data structure could be implemented more efficiently. But since
@@ -199,13 +252,24 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
 
     /// Incremented on every LikelyNeededAgain or WantInterestHandle.
     /// Decremented on every dropInterestHandle. Evicted if it reaches zero.
-    uint64_t referenceCount{0};
+    /// Lookups increment it while holding the shard's lock for reading.
+    mutable std::atomic<uint64_t> referenceCount{0};
+
+    /// Set by lookups, and cleared when the item is given a second chance
+    /// instead of being evicted.
+    mutable std::atomic<bool> referenced{false};
 
     /// Given a unique value upon allocation. Used to verify InterestHandle
     // matches this specific item.
     uint64_t generation{0};
   };
 
+  /**
+   * The number of counters in each row of a shard's frequency sketch. Shards
+   * usually hold hundreds to a few thousand blobs.
+   */
+  static constexpr size_t kSketchWidth = 4096;
+
   struct State {
     size_t totalSize{0};
     std::unordered_map<Hash, CacheItem> items;
@@ -213,22 +277,48 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
     /// Entries are evicted from the front of the queue.
     std::list<CacheItem*> evictionQueue;
 
-    uint64_t hitCount{0};
-    uint64_t missCount{0};
+    /// How often each blob has been requested recently, whether or not it is
+    /// cached.
+    mutable FrequencySketch frequencies{kSketchWidth};
+
+    /// Updated by lookups, which hold the lock for reading.
+    mutable std::atomic<uint64_t> hitCount{0};
+    mutable std::atomic<uint64_t> missCount{0};
     uint64_t evictionCount{0};
     uint64_t dropCount{0};
+    uint64_t bytesEvicted{0};
+    uint64_t rejectionCount{0};
   };
 
+  using SynchronizedState = folly::Synchronized<State>;
+
   void dropInterestHandle(const Hash& hash, uint64_t generation) noexcept;
 
   explicit BlobCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount);
+  BlobCache(
+      size_t maximumCacheSizeBytes,
+      size_t minimumEntryCount,
+      size_t shardCount);
+  SynchronizedState& getShard(const Hash& hash) const;
+  /**
+   * get(), except that lookups through an interest handle pass recordAccess =
+   * false so they do not count towards the blob's frequency.
+   */
+  GetResult lookup(const Hash& hash, Interest interest, bool recordAccess);
+  bool shouldAdmit(State& state, const Hash& hash, size_t size) const;
+  /**
+   * Return the item at the front of the eviction queue, after moving any
+   * referenced items ahead of it to the back.  The queue must not be empty.
+   */
+  static CacheItem* nextVictim(State& state) noexcept;
   void evictUntilFits(State& state) noexcept;
   void evictOne(State& state) noexcept;
   void evictItem(State&, CacheItem* item) noexcept;
 
+  /// The maximum size and minimum entry count of each shard.
   const size_t maximumCacheSizeBytes_;
   const size_t minimumEntryCount_;
-  folly::Synchronized<State> state_;
+  std::vector<std::unique_ptr<SynchronizedState>> shards_;
 
   friend class BlobInterestHandle;
 };
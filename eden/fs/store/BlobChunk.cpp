@@ -0,0 +1,34 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/BlobChunk.h"
+
+#include <folly/lang/Bits.h>
+#include <array>
+#include <cstring>
+
+namespace facebook {
+namespace eden {
+
+Hash getBlobChunkId(const Hash& blobId, uint64_t chunkIndex) {
+  // Hash a tag along with the blob ID and index, so that chunk IDs cannot
+  // collide with IDs derived from a blob ID in some other way.
+  constexpr char kPrefix[] = "chunk";
+  constexpr size_t kPrefixSize = sizeof(kPrefix) - 1;
+  std::array<uint8_t, kPrefixSize + Hash::RAW_SIZE + sizeof(uint64_t)> input;
+  memcpy(input.data(), kPrefix, kPrefixSize);
+  memcpy(input.data() + kPrefixSize, blobId.getBytes().data(), Hash::RAW_SIZE);
+  folly::storeUnaligned(
+      input.data() + kPrefixSize + Hash::RAW_SIZE,
+      folly::Endian::big(chunkIndex));
+  return Hash::sha1(folly::ByteRange{input.data(), input.size()});
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,41 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Large blobs can be read a fixed-size chunk at a time, so that reading part
+ * of a large file does not require loading all of it into memory.
+ *
+ * Each chunk is a Blob of its own, with an ID derived from the ID of the
+ * whole blob and the chunk's index, so chunks are cached in the BlobCache and
+ * stored in the LocalStore just like whole blobs.  Every chunk but the last
+ * is exactly kBlobChunkSize bytes long.
+ */
+constexpr uint64_t kBlobChunkSize = 4 * 1024 * 1024;
+
+/**
+ * Files at least this large are read a chunk at a time rather than by loading
+ * the whole blob.
+ */
+constexpr uint64_t kChunkedBlobThreshold = 4 * kBlobChunkSize;
+
+/**
+ * Returns the ID of the given chunk of the blob with ID blobId.
+ */
+Hash getBlobChunkId(const Hash& blobId, uint64_t chunkIndex);
+
+} // namespace eden
+} // namespace facebook
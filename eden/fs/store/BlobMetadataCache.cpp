@@ -0,0 +1,104 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/BlobMetadataCache.h"
+
+#include <algorithm>
+
+namespace facebook {
+namespace eden {
+
+BlobMetadataCache::BlobMetadataCache(size_t maximumSizeBytes)
+    : entriesPerShard_{std::max<size_t>(
+          1,
+          maximumSizeBytes / getBytesPerEntry() / kShardCount)} {
+  for (auto& shard : shards_) {
+    shard = std::make_unique<SynchronizedShard>();
+  }
+}
+
+BlobMetadataCache::~BlobMetadataCache() {}
+
+BlobMetadataCache::SynchronizedShard& BlobMetadataCache::getShard(
+    const Hash& id) const {
+  // std::hash<Hash> uses the leading bytes of the ID, so pick the shard from
+  // the last byte to keep the two independent.
+  return *shards_[id.getBytes()[Hash::RAW_SIZE - 1] % kShardCount];
+}
+
+std::optional<BlobMetadata> BlobMetadataCache::get(const Hash& id) const {
+  auto shard = getShard(id).rlock();
+  auto it = shard->index.find(id);
+  if (it == shard->index.end()) {
+    return std::nullopt;
+  }
+  auto slotIndex = it->second;
+  // Avoid dirtying the cache line if the bit is already set.
+  auto& referenced = shard->referenced[slotIndex];
+  if (!referenced.load(std::memory_order_relaxed)) {
+    referenced.store(true, std::memory_order_relaxed);
+  }
+  return shard->slots[slotIndex].metadata;
+}
+
+void BlobMetadataCache::insert(const Hash& id, const BlobMetadata& metadata) {
+  auto shard = getShard(id).wlock();
+  auto it = shard->index.find(id);
+  if (it != shard->index.end()) {
+    shard->slots[it->second].metadata = metadata;
+    shard->referenced[it->second].store(true, std::memory_order_relaxed);
+    return;
+  }
+
+  auto& slots = shard->slots;
+  if (slots.size() < entriesPerShard_) {
+    if (slots.size() == slots.capacity()) {
+      // Grow geometrically, but never past the shard's capacity.
+      auto grown = std::max<size_t>(kMinimumGrowth, slots.size() * 2);
+      slots.reserve(std::min(entriesPerShard_, grown));
+    }
+    auto slotIndex = static_cast<uint32_t>(slots.size());
+    slots.emplace_back(id, metadata);
+    shard->referenced.emplace_back(false);
+    shard->index.emplace(id, slotIndex);
+    return;
+  }
+
+  // The shard is full.  Advance the clock hand to the first entry that has
+  // not been referenced since the hand last passed it, clearing referenced
+  // bits along the way, and replace that entry.  This terminates within two
+  // sweeps, since the first sweep clears every bit.
+  while (true) {
+    auto slotIndex = shard->hand;
+    shard->hand = (shard->hand + 1) % entriesPerShard_;
+    auto& referenced = shard->referenced[slotIndex];
+    if (referenced.load(std::memory_order_relaxed)) {
+      referenced.store(false, std::memory_order_relaxed);
+      continue;
+    }
+
+    auto& slot = shard->slots[slotIndex];
+    shard->index.erase(slot.id);
+    slot.id = id;
+    slot.metadata = metadata;
+    shard->index.emplace(id, static_cast<uint32_t>(slotIndex));
+    return;
+  }
+}
+
+size_t BlobMetadataCache::size() const {
+  size_t total = 0;
+  for (const auto& shard : shards_) {
+    total += shard->rlock()->slots.size();
+  }
+  return total;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/SharedMutex.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/store/BlobMetadata.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * A bounded in-memory cache of blob sizes and SHA-1s, keyed by blob ID.
+ *
+ * This is consulted on every getattr() of an unmaterialized file and on every
+ * SHA-1 lookup during status, so lookups must not serialize on a single lock.
+ * The cache is split into shards by blob ID, and each shard uses the CLOCK
+ * approximation of LRU: a lookup only sets a "referenced" bit on the entry, so
+ * it can be done while holding the shard's lock in shared mode.  Eviction
+ * sweeps a hand over the entries, clearing referenced bits and evicting the
+ * first entry whose bit is already clear.
+ *
+ * Entries are stored contiguously in each shard, with a separate index from
+ * blob ID to slot number, rather than as individually allocated list nodes.
+ *
+ * This class is thread-safe.
+ */
+class BlobMetadataCache {
+ public:
+  /**
+   * Create a cache that uses approximately maximumSizeBytes of memory once
+   * full.
+   */
+  explicit BlobMetadataCache(size_t maximumSizeBytes);
+  ~BlobMetadataCache();
+
+  BlobMetadataCache(const BlobMetadataCache&) = delete;
+  BlobMetadataCache& operator=(const BlobMetadataCache&) = delete;
+
+  /**
+   * Look up the metadata for a blob, marking it as recently used if present.
+   */
+  std::optional<BlobMetadata> get(const Hash& id) const;
+
+  /**
+   * Insert or replace the metadata for a blob, evicting another entry if the
+   * blob's shard is full.
+   */
+  void insert(const Hash& id, const BlobMetadata& metadata);
+
+  /**
+   * Returns the number of entries currently cached.
+   */
+  size_t size() const;
+
+  /**
+   * Returns the maximum number of entries this cache will hold.
+   */
+  size_t getMaximumEntryCount() const {
+    return entriesPerShard_ * kShardCount;
+  }
+
+  /**
+   * The approximate memory cost of each cached entry, including the index.
+   */
+  static constexpr size_t getBytesPerEntry();
+
+ private:
+  static constexpr size_t kShardCount = 16;
+  /** The number of slots a shard allocates when it first grows */
+  static constexpr size_t kMinimumGrowth = 64;
+
+  struct Slot {
+    Slot(const Hash& i, const BlobMetadata& m) : id{i}, metadata{m} {}
+
+    Hash id;
+    BlobMetadata metadata;
+  };
+
+  /**
+   * The slots, index and referenced bits grow as entries are inserted, up to
+   * entriesPerShard_, so an unused cache costs almost nothing.
+   */
+  struct Shard {
+    std::vector<Slot> slots;
+    folly::F14ValueMap<Hash, uint32_t> index;
+    // One referenced bit per slot.  These are set by readers holding the
+    // shard lock in shared mode, so they are atomic.  A deque can grow
+    // without moving them.
+    std::deque<std::atomic<bool>> referenced;
+    size_t hand{0};
+  };
+
+  using SynchronizedShard = folly::Synchronized<Shard, folly::SharedMutex>;
+
+  SynchronizedShard& getShard(const Hash& id) const;
+
+  size_t entriesPerShard_;
+  mutable std::array<std::unique_ptr<SynchronizedShard>, kShardCount> shards_;
+};
+
+constexpr size_t BlobMetadataCache::getBytesPerEntry() {
+  // F14ValueMap stores its entries inline in chunks with one byte of tag and
+  // some per-chunk overhead per entry.
+  return sizeof(Slot) + sizeof(std::pair<Hash, uint32_t>) + 2 +
+      sizeof(std::atomic<bool>);
+}
+
+} // namespace eden
+} // namespace facebook
@@ -13,7 +13,10 @@
 #include <folly/Synchronized.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "eden/fs/model/Tree.h"
@@ -27,6 +30,7 @@ using folly::Synchronized;
 using folly::Try;
 using folly::Unit;
 using std::make_unique;
+using std::shared_ptr;
 using std::vector;
 
 namespace facebook {
@@ -317,6 +321,196 @@ Future<Unit> TreeDiffer::waitOnResults(ChildFutures&& childFutures) {
       });
 }
 
+/**
+ * ChangedObjectLister walks two trees one directory level at a time, listing
+ * the objects from the second tree that differ from the first.
+ *
+ * Each level is processed only after all of its trees have been fetched, so
+ * result_ is never accessed concurrently.
+ */
+class ChangedObjectLister {
+ public:
+  /**
+   * A pair of trees at the same path.  tree1 is null if there is no tree at
+   * this path on the first side.
+   */
+  struct TreePair {
+    shared_ptr<const Tree> tree1;
+    shared_ptr<const Tree> tree2;
+    RelativePath path;
+  };
+
+  ChangedObjectLister(
+      ObjectStore* store,
+      size_t maxTreeFetches,
+      size_t treeBatchSize,
+      std::function<bool(RelativePathPiece)> shouldWalk)
+      : store_(store),
+        maxTreeFetches_(std::max<size_t>(maxTreeFetches, 1)),
+        treeBatchSize_(std::max<size_t>(treeBatchSize, 1)),
+        shouldWalk_(std::move(shouldWalk)) {}
+
+  /**
+   * List the changed objects under each of the given pairs of trees,
+   * and then recurse into the changed subdirectories.
+   */
+  FOLLY_NODISCARD Future<Unit> walk(vector<TreePair> level);
+
+  /**
+   * Extract the listed objects
+   */
+  ChangedObjects extractResult() {
+    return std::move(result_);
+  }
+
+ private:
+  struct HashPair {
+    std::optional<Hash> hash1;
+    Hash hash2;
+    RelativePath path;
+  };
+
+  void compareTrees(
+      const Tree* tree1,
+      const Tree& tree2,
+      RelativePathPiece path,
+      vector<HashPair>& next);
+  void addChangedEntry(
+      const TreeEntry* entry1,
+      const TreeEntry& entry2,
+      RelativePathPiece parentPath,
+      vector<HashPair>& next);
+  Future<vector<TreePair>> fetchTrees(vector<HashPair> batch);
+
+  ObjectStore* store_;
+  size_t maxTreeFetches_;
+  size_t treeBatchSize_;
+  std::function<bool(RelativePathPiece)> shouldWalk_;
+  ChangedObjects result_;
+};
+
+Future<Unit> ChangedObjectLister::walk(vector<TreePair> level) {
+  vector<HashPair> next;
+  for (const auto& trees : level) {
+    compareTrees(trees.tree1.get(), *trees.tree2, trees.path, next);
+  }
+  if (next.empty()) {
+    return makeFuture();
+  }
+
+  // Release this level's trees before fetching the next one.
+  level.clear();
+  vector<vector<HashPair>> batches;
+  for (size_t n = 0; n < next.size(); n += treeBatchSize_) {
+    auto begin = next.begin() + n;
+    auto end = next.begin() + std::min(next.size(), n + treeBatchSize_);
+    batches.emplace_back(begin, end);
+  }
+  auto fetches = folly::window(
+      std::move(batches),
+      [this](vector<HashPair> batch) { return fetchTrees(std::move(batch)); },
+      maxTreeFetches_);
+  return folly::collect(fetches).thenValue(
+      [this](vector<vector<TreePair>>&& fetched) {
+        vector<TreePair> nextLevel;
+        for (auto& batch : fetched) {
+          for (auto& trees : batch) {
+            nextLevel.push_back(std::move(trees));
+          }
+        }
+        return walk(std::move(nextLevel));
+      });
+}
+
+void ChangedObjectLister::compareTrees(
+    const Tree* tree1,
+    const Tree& tree2,
+    RelativePathPiece path,
+    vector<HashPair>& next) {
+  // This relies on the fact that the entry list in each tree is always sorted.
+  const auto& entries2 = tree2.getTreeEntries();
+  if (!tree1) {
+    for (const auto& entry2 : entries2) {
+      addChangedEntry(nullptr, entry2, path, next);
+    }
+    return;
+  }
+
+  const auto& entries1 = tree1->getTreeEntries();
+  size_t idx1 = 0;
+  for (const auto& entry2 : entries2) {
+    while (idx1 < entries1.size() &&
+           entries1[idx1].getName() < entry2.getName()) {
+      ++idx1;
+    }
+    if (idx1 < entries1.size() &&
+        entries1[idx1].getName() == entry2.getName()) {
+      addChangedEntry(&entries1[idx1], entry2, path, next);
+      ++idx1;
+    } else {
+      addChangedEntry(nullptr, entry2, path, next);
+    }
+  }
+}
+
+void ChangedObjectLister::addChangedEntry(
+    const TreeEntry* entry1,
+    const TreeEntry& entry2,
+    RelativePathPiece parentPath,
+    vector<HashPair>& next) {
+  if (entry1 && entry1->getType() == entry2.getType() &&
+      entry1->getHash() == entry2.getHash()) {
+    return;
+  }
+
+  if (!entry2.isTree()) {
+    result_.blobs.push_back(entry2.getHash());
+    return;
+  }
+
+  auto path = parentPath + entry2.getName();
+  if (shouldWalk_ && !shouldWalk_(path)) {
+    return;
+  }
+
+  result_.trees.push_back(entry2.getHash());
+  std::optional<Hash> hash1;
+  if (entry1 && entry1->isTree()) {
+    hash1 = entry1->getHash();
+  }
+  next.push_back(HashPair{hash1, entry2.getHash(), std::move(path)});
+}
+
+Future<vector<ChangedObjectLister::TreePair>> ChangedObjectLister::fetchTrees(
+    vector<HashPair> batch) {
+  // Fetch both sides of every pair in the batch with one ObjectStore call,
+  // so that the trees already in the LocalStore are read together.
+  vector<Hash> ids;
+  for (const auto& hashes : batch) {
+    if (hashes.hash1) {
+      ids.push_back(*hashes.hash1);
+    }
+    ids.push_back(hashes.hash2);
+  }
+  return store_->getTrees(ids).thenValue(
+      [batch = std::move(batch)](
+          vector<folly::Try<shared_ptr<const Tree>>>&& trees) {
+        vector<TreePair> pairs;
+        pairs.reserve(batch.size());
+        size_t n = 0;
+        for (const auto& hashes : batch) {
+          TreePair pair;
+          if (hashes.hash1) {
+            pair.tree1 = std::move(trees[n++].value());
+          }
+          pair.tree2 = std::move(trees[n++].value());
+          pair.path = hashes.path;
+          pairs.push_back(std::move(pair));
+        }
+        return pairs;
+      });
+}
+
 } // namespace
 
 folly::Future<ScmStatus>
@@ -354,5 +548,25 @@ diffTrees(ObjectStore* store, const Tree& tree1, const Tree& tree2) {
   });
 }
 
+folly::Future<ChangedObjects> listChangedObjects(
+    ObjectStore* store,
+    shared_ptr<const Tree> tree1,
+    shared_ptr<const Tree> tree2,
+    size_t maxTreeFetches,
+    size_t treeBatchSize,
+    std::function<bool(RelativePathPiece)> shouldWalk) {
+  return folly::makeFutureWith([&] {
+    auto lister = make_unique<ChangedObjectLister>(
+        store, maxTreeFetches, treeBatchSize, std::move(shouldWalk));
+    auto* listerRawPtr = lister.get();
+    vector<ChangedObjectLister::TreePair> roots;
+    roots.push_back({std::move(tree1), std::move(tree2), RelativePath{}});
+    return listerRawPtr->walk(std::move(roots))
+        .thenValue([lister = std::move(lister)](auto&&) {
+          return lister->extractResult();
+        });
+  });
+}
+
 } // namespace eden
 } // namespace facebook
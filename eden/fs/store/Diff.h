@@ -9,6 +9,11 @@
  */
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/PathFuncs.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
 
 namespace folly {
@@ -19,7 +24,6 @@ class Future;
 namespace facebook {
 namespace eden {
 
-class Hash;
 class ObjectStore;
 class Tree;
 
@@ -42,5 +46,41 @@ folly::Future<ScmStatus> diffTrees(ObjectStore* store, Hash tree1, Hash tree2);
 folly::Future<ScmStatus>
 diffTrees(ObjectStore* store, const Tree& tree1, const Tree& tree2);
 
+/**
+ * The source control objects that are new or changed in one tree relative to
+ * another.
+ */
+struct ChangedObjects {
+  std::vector<Hash> trees;
+  std::vector<Hash> blobs;
+};
+
+/**
+ * List every Tree and Blob reachable from tree2 that differs from the object
+ * at the same path in tree1.  Objects that only exist in tree1 are not
+ * listed.
+ *
+ * This fetches every listed Tree from the ObjectStore as it walks, so once
+ * the returned Future completes those Trees are available locally.  The walk
+ * proceeds one directory level at a time.  Each level's Trees are requested
+ * with ObjectStore::getTrees() in batches of up to treeBatchSize directories,
+ * with at most maxTreeFetches batches outstanding at once.  Blobs are only
+ * listed, not fetched.
+ *
+ * If shouldWalk is set, a changed subdirectory is only listed and walked if
+ * shouldWalk(path) returns true for it.  shouldWalk is called from whichever
+ * thread fetched the parent Tree.
+ *
+ * The caller is responsible for ensuring that the ObjectStore remains valid
+ * until the returned Future completes.
+ */
+folly::Future<ChangedObjects> listChangedObjects(
+    ObjectStore* store,
+    std::shared_ptr<const Tree> tree1,
+    std::shared_ptr<const Tree> tree2,
+    size_t maxTreeFetches,
+    size_t treeBatchSize,
+    std::function<bool(RelativePathPiece)> shouldWalk = nullptr);
+
 } // namespace eden
 } // namespace facebook
@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/FrequencySketch.h"
+
+#include <folly/hash/SpookyHashV2.h>
+#include <folly/lang/Bits.h>
+#include <algorithm>
+
+namespace facebook {
+namespace eden {
+
+FrequencySketch::FrequencySketch(size_t width) {
+  width = folly::nextPowTwo(std::max(width, kCountersPerWord));
+  widthMask_ = width - 1;
+  sampleLimit_ = 10 * width;
+  tableSize_ = kDepth * width / kCountersPerWord;
+  table_.reset(new std::atomic<uint64_t>[tableSize_]());
+}
+
+template <typename Fn>
+void FrequencySketch::forEachCounter(const Hash& hash, Fn&& fn) const {
+  // Object IDs are usually SHA-1s, but not always (tests in particular use
+  // IDs that differ in a single byte), so hash them again rather than using
+  // their bytes as indices directly.  Derive one index per row by double
+  // hashing.
+  auto bytes = hash.getBytes();
+  auto h = folly::hash::SpookyHashV2::Hash64(bytes.data(), bytes.size(), 0);
+  auto h1 = static_cast<uint32_t>(h);
+  auto h2 = static_cast<uint32_t>(h >> 32) | 1;
+  auto rowWords = (widthMask_ + 1) / kCountersPerWord;
+  for (size_t row = 0; row < kDepth; ++row) {
+    auto index = (h1 + row * h2) & widthMask_;
+    auto word = row * rowWords + index / kCountersPerWord;
+    auto shift = (index % kCountersPerWord) * 4;
+    fn(word, shift);
+  }
+}
+
+void FrequencySketch::increment(const Hash& hash) {
+  forEachCounter(hash, [this](size_t word, size_t shift) {
+    auto& counters = table_[word];
+    auto value = counters.load(std::memory_order_relaxed);
+    while (((value >> shift) & 0xf) < kMaximumFrequency &&
+           !counters.compare_exchange_weak(
+               value,
+               value + (uint64_t{1} << shift),
+               std::memory_order_relaxed)) {
+    }
+  });
+  // Only the increment that reaches the limit halves the counters.
+  if (sampleCount_.fetch_add(1, std::memory_order_relaxed) + 1 ==
+      sampleLimit_) {
+    halve();
+  }
+}
+
+uint8_t FrequencySketch::estimate(const Hash& hash) const {
+  uint8_t frequency = kMaximumFrequency;
+  forEachCounter(hash, [&](size_t word, size_t shift) {
+    auto value = table_[word].load(std::memory_order_relaxed);
+    frequency =
+        std::min(frequency, static_cast<uint8_t>((value >> shift) & 0xf));
+  });
+  return frequency;
+}
+
+void FrequencySketch::clear() {
+  for (size_t word = 0; word < tableSize_; ++word) {
+    table_[word].store(0, std::memory_order_relaxed);
+  }
+  sampleCount_.store(0, std::memory_order_relaxed);
+}
+
+void FrequencySketch::halve() {
+  for (size_t word = 0; word < tableSize_; ++word) {
+    // Shift every counter right by one, dropping the bit that moves into the
+    // neighboring counter.
+    auto value = table_[word].load(std::memory_order_relaxed);
+    while (!table_[word].compare_exchange_weak(
+        value,
+        (value >> 1) & 0x7777777777777777ull,
+        std::memory_order_relaxed)) {
+    }
+  }
+  sampleCount_.store(sampleLimit_ / 2, std::memory_order_relaxed);
+}
+
+} // namespace eden
+} // namespace facebook
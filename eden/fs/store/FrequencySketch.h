@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * An approximate count of how often each object has been accessed recently,
+ * for deciding which of two objects is more worth caching (TinyLFU).
+ *
+ * This is a count-min sketch of 4-bit counters: each access increments one
+ * counter in each of several rows, and the estimate is the smallest of them.
+ * Collisions can only inflate an estimate.  Once the number of recorded
+ * accesses reaches ten times the row width, every counter is halved, so that
+ * objects which used to be popular age out.
+ *
+ * It is safe to use this object from arbitrary threads.  Counters are updated
+ * atomically, but increments made while the counters are being halved may be
+ * lost, which only makes the estimates slightly less accurate.
+ */
+class FrequencySketch {
+ public:
+  /**
+   * The largest estimate the sketch can return.
+   */
+  static constexpr uint8_t kMaximumFrequency = 15;
+
+  /**
+   * Create a sketch with width counters per row, rounded up to a power of
+   * two.  The width should be about the number of objects being compared.
+   */
+  explicit FrequencySketch(size_t width);
+
+  /**
+   * Record an access to hash.
+   */
+  void increment(const Hash& hash);
+
+  /**
+   * Estimate how many times hash has been accessed recently.
+   */
+  uint8_t estimate(const Hash& hash) const;
+
+  /**
+   * Forget every recorded access.
+   */
+  void clear();
+
+ private:
+  static constexpr size_t kDepth = 4;
+  static constexpr size_t kCountersPerWord = 16;
+
+  template <typename Fn>
+  void forEachCounter(const Hash& hash, Fn&& fn) const;
+
+  void halve();
+
+  size_t widthMask_;
+  std::atomic<size_t> sampleCount_{0};
+  size_t sampleLimit_;
+  size_t tableSize_;
+  // kDepth rows of 4-bit counters, packed 16 to a word.
+  std::unique_ptr<std::atomic<uint64_t>[]> table_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -37,6 +38,9 @@ class IObjectStore {
       const Hash& id) const = 0;
   virtual folly::Future<std::shared_ptr<const Blob>> getBlob(
       const Hash& id) const = 0;
+  virtual folly::Future<std::shared_ptr<const Blob>> getBlobChunk(
+      const Hash& id,
+      uint64_t chunkIndex) const = 0;
   virtual folly::Future<std::shared_ptr<const Tree>> getTreeForCommit(
       const Hash& commitID) const = 0;
   virtual folly::Future<BlobMetadata> getBlobMetadata(const Hash& id) const = 0;
@@ -0,0 +1,64 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/ImportPriority.h"
+
+#include <memory>
+#include <string>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+const std::string kImportPriorityKey{"eden.import_priority"};
+
+class ImportPriorityData : public folly::RequestData {
+ public:
+  explicit ImportPriorityData(ImportPriorityClass priority)
+      : priority_{priority} {}
+
+  bool hasCallback() override {
+    return false;
+  }
+
+  ImportPriorityClass getPriority() const {
+    return priority_;
+  }
+
+ private:
+  ImportPriorityClass priority_;
+};
+} // namespace
+
+folly::StringPiece getImportPriorityClassName(ImportPriorityClass priority) {
+  switch (priority) {
+    case ImportPriorityClass::Interactive:
+      return "interactive";
+    case ImportPriorityClass::Thrift:
+      return "thrift";
+    case ImportPriorityClass::Prefetch:
+      return "prefetch";
+    case ImportPriorityClass::Background:
+      return "background";
+  }
+  return "unknown";
+}
+
+ImportPriorityClass getCurrentImportPriority() {
+  auto* data = static_cast<ImportPriorityData*>(
+      folly::RequestContext::get()->getContextData(kImportPriorityKey));
+  return data ? data->getPriority() : ImportPriorityClass::Interactive;
+}
+
+ImportPriorityScope::ImportPriorityScope(ImportPriorityClass priority)
+    : guard_{kImportPriorityKey,
+             std::make_unique<ImportPriorityData>(priority)} {}
+
+} // namespace eden
+} // namespace facebook
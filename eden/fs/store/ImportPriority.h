@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/io/async/Request.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * How urgently the caller needs an object that has to be imported from the
+ * source control backing store.  Lower values are more urgent.
+ */
+enum class ImportPriorityClass : uint8_t {
+  /// Someone is blocked in a filesystem call waiting for the object.
+  Interactive = 0,
+  /// A thrift client, such as `hg status` or `eden prefetch`, is waiting.
+  Thrift = 1,
+  /// Bulk prefetching ahead of an operation, such as checkout.
+  Prefetch = 2,
+  /// Speculative work that nobody is waiting on.
+  Background = 3,
+};
+
+constexpr size_t kImportPriorityClassCount = 4;
+
+folly::StringPiece getImportPriorityClassName(ImportPriorityClass priority);
+
+/**
+ * Returns the import priority of the current request.
+ *
+ * This is set with ImportPriorityScope and is carried through the
+ * folly::RequestContext, so it follows a request across the futures it
+ * spawns.  Requests that never set it, such as FUSE requests, are
+ * Interactive.
+ */
+ImportPriorityClass getCurrentImportPriority();
+
+/**
+ * Sets the import priority of the current request for the lifetime of this
+ * object.  Futures created while it is alive keep the priority after it is
+ * destroyed.
+ */
+class ImportPriorityScope {
+ public:
+  explicit ImportPriorityScope(ImportPriorityClass priority);
+
+  ImportPriorityScope(const ImportPriorityScope&) = delete;
+  ImportPriorityScope& operator=(const ImportPriorityScope&) = delete;
+
+ private:
+  folly::ShallowCopyRequestContextScopeGuard guard_;
+};
+
+} // namespace eden
+} // namespace facebook
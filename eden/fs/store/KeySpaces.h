@@ -41,7 +41,13 @@ static constexpr std::
 
             LocalStore::KeySpaceRecord{LocalStore::HgCommitToTreeFamily,
                                        LocalStore::Persistence::Ephemeral,
-                                       "hgcommit2tree"}};
+                                       "hgcommit2tree"},
+
+            // When each entry in the other Ephemeral key spaces was last read
+            // or written, for LocalStore::garbageCollect().
+            LocalStore::KeySpaceRecord{LocalStore::AccessTimeFamily,
+                                       LocalStore::Persistence::Ephemeral,
+                                       "accesstime"}};
 
 } // namespace eden
 } // namespace facebook
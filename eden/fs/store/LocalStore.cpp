@@ -10,20 +10,24 @@
 #include "eden/fs/store/LocalStore.h"
 
 #include <folly/Format.h>
+#include <folly/ScopeGuard.h>
 #include <folly/String.h>
 #include <folly/futures/Future.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/lang/Bits.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <array>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/git/GitBlob.h"
 #include "eden/fs/model/git/GitTree.h"
+#include "eden/fs/store/BlobChunk.h"
 #include "eden/fs/store/KeySpaces.h"
 #include "eden/fs/store/SerializedBlobMetadata.h"
+#include "eden/fs/store/SerializedTree.h"
 #include "eden/fs/store/StoreResult.h"
 
 using facebook::eden::Hash;
@@ -35,6 +39,12 @@ using std::optional;
 using std::string;
 using std::unique_ptr;
 
+DEFINE_bool(
+    binaryTreeFormat,
+    false,
+    "store trees in the binary format, which can be searched without parsing "
+    "it but cannot be read by older versions of edenfs");
+
 namespace facebook {
 namespace eden {
 
@@ -57,6 +67,77 @@ void LocalStore::clearCaches() {
   }
 }
 
+bool LocalStore::isGarbageCollected(KeySpace keySpace) {
+  return keySpace != KeySpace::AccessTimeFamily &&
+      kKeySpaceRecords[keySpace].persistence == Persistence::Ephemeral;
+}
+
+bool LocalStore::garbageCollect(const SizeLimits& sizeLimits) {
+  {
+    auto status = gcStatus_.wlock();
+    if (status->running) {
+      return false;
+    }
+    status->running = true;
+  }
+  SCOPE_EXIT {
+    auto status = gcStatus_.wlock();
+    status->running = false;
+    status->currentKeySpace.reset();
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  for (const auto& ks : kKeySpaceRecords) {
+    if (!isGarbageCollected(ks.keySpace)) {
+      continue;
+    }
+    gcStatus_.wlock()->currentKeySpace = ks.keySpace;
+
+    auto sizeLimit = sizeLimits[ks.keySpace];
+    auto result = garbageCollectKeySpace(ks.keySpace, sizeLimit);
+    if (result.entriesEvicted > 0 || result.cleared) {
+      XLOG(INFO) << "local store garbage collection evicted "
+                 << result.entriesEvicted << " entries from " << ks.name
+                 << (result.cleared ? " (cleared)" : "") << ", size went from "
+                 << result.sizeBefore << " to " << result.sizeAfter
+                 << " bytes";
+    }
+
+    auto status = gcStatus_.wlock();
+    auto& ksStatus = status->keySpaces[ks.keySpace];
+    ksStatus.sizeLimit = sizeLimit;
+    ksStatus.approximateSize = result.sizeAfter;
+    ksStatus.entriesEvicted += result.entriesEvicted;
+    if (result.sizeBefore > result.sizeAfter) {
+      ksStatus.bytesReclaimed += result.sizeBefore - result.sizeAfter;
+    }
+    if (result.cleared) {
+      ++ksStatus.clearCount;
+    }
+    if (result.compactionTime.count() > 0) {
+      ksStatus.lastCompactionTime = result.compactionTime;
+    }
+  }
+
+  auto status = gcStatus_.wlock();
+  ++status->runCount;
+  status->lastRunDuration = std::chrono::steady_clock::now() - start;
+  return true;
+}
+
+LocalStore::KeySpaceGCResult LocalStore::garbageCollectKeySpace(
+    KeySpace,
+    uint64_t) {
+  return KeySpaceGCResult{};
+}
+
+LocalStore::KeySpaceGCResult LocalStore::garbageCollectDelegate(
+    LocalStore& store,
+    KeySpace keySpace,
+    uint64_t sizeLimit) {
+  return store.garbageCollectKeySpace(keySpace, sizeLimit);
+}
+
 void LocalStore::compactStorage() {
   for (auto ks : kKeySpaceRecords) {
     compactKeySpace(ks.keySpace);
@@ -101,7 +182,7 @@ folly::Future<std::unique_ptr<Tree>> LocalStore::getTree(const Hash& id) const {
         if (!data.isValid()) {
           return std::unique_ptr<Tree>(nullptr);
         }
-        return deserializeGitTree(id, data.bytes());
+        return deserializeTree(id, data.bytes());
       });
 }
 
@@ -116,6 +197,12 @@ folly::Future<std::unique_ptr<Blob>> LocalStore::getBlob(const Hash& id) const {
       });
 }
 
+folly::Future<std::unique_ptr<Blob>> LocalStore::getBlobChunk(
+    const Hash& blobId,
+    uint64_t chunkIndex) const {
+  return getBlob(getBlobChunkId(blobId, chunkIndex));
+}
+
 folly::Future<optional<BlobMetadata>> LocalStore::getBlobMetadata(
     const Hash& id) const {
   return getFuture(KeySpace::BlobMetaDataFamily, id.getBytes())
@@ -140,18 +227,87 @@ folly::Future<std::optional<size_t>> LocalStore::getBlobSize(
       });
 }
 
+namespace {
+std::vector<folly::ByteRange> getKeys(const std::vector<Hash>& ids) {
+  std::vector<folly::ByteRange> keys;
+  keys.reserve(ids.size());
+  for (const auto& id : ids) {
+    keys.push_back(id.getBytes());
+  }
+  return keys;
+}
+} // namespace
+
+folly::Future<std::vector<std::unique_ptr<Tree>>> LocalStore::getTreeBatch(
+    const std::vector<Hash>& ids) const {
+  return getBatch(KeySpace::TreeFamily, getKeys(ids))
+      .thenValue([ids](std::vector<StoreResult>&& data) {
+        std::vector<std::unique_ptr<Tree>> trees;
+        trees.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+          if (data[i].isValid()) {
+            trees.push_back(deserializeTree(ids[i], data[i].bytes()));
+          } else {
+            trees.emplace_back(nullptr);
+          }
+        }
+        return trees;
+      });
+}
+
+folly::Future<std::vector<std::unique_ptr<Blob>>> LocalStore::getBlobBatch(
+    const std::vector<Hash>& ids) const {
+  return getBatch(KeySpace::BlobFamily, getKeys(ids))
+      .thenValue([ids](std::vector<StoreResult>&& data) {
+        std::vector<std::unique_ptr<Blob>> blobs;
+        blobs.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+          if (data[i].isValid()) {
+            auto buf = data[i].extractIOBuf();
+            blobs.push_back(deserializeGitBlob(ids[i], &buf));
+          } else {
+            blobs.emplace_back(nullptr);
+          }
+        }
+        return blobs;
+      });
+}
+
+folly::Future<std::vector<optional<BlobMetadata>>>
+LocalStore::getBlobMetadataBatch(const std::vector<Hash>& ids) const {
+  return getBatch(KeySpace::BlobMetaDataFamily, getKeys(ids))
+      .thenValue([ids](std::vector<StoreResult>&& data) {
+        std::vector<optional<BlobMetadata>> metadata;
+        metadata.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+          if (data[i].isValid()) {
+            metadata.push_back(SerializedBlobMetadata::parse(ids[i], data[i]));
+          } else {
+            metadata.emplace_back(std::nullopt);
+          }
+        }
+        return metadata;
+      });
+}
+
 std::pair<Hash, folly::IOBuf> LocalStore::serializeTree(const Tree* tree) {
+  auto id = tree->getHash();
+  if (FLAGS_binaryTreeFormat && id != Hash()) {
+    return std::make_pair(id, SerializedTree::serialize(*tree));
+  }
+
+  // Trees without an ID of their own (those imported from flat manifests)
+  // are identified by the hash of their git tree object, so store that
+  // object rather than serializing them a second time.
   GitTreeSerializer serializer;
   for (auto& entry : tree->getTreeEntries()) {
-    serializer.addEntry(std::move(entry));
+    serializer.addEntry(entry);
   }
   IOBuf treeBuf = serializer.finalize();
-
-  auto id = tree->getHash();
   if (id == Hash()) {
     id = Hash::sha1(treeBuf);
   }
-  return std::make_pair(id, treeBuf);
+  return std::make_pair(id, std::move(treeBuf));
 }
 
 bool LocalStore::hasKey(KeySpace keySpace, const Hash& id) const {
@@ -210,8 +366,23 @@ BlobMetadata LocalStore::WriteBatch::putBlob(const Hash& id, const Blob* blob) {
 
   SerializedBlobMetadata metadataBytes(metadata);
 
-  auto hashSlice = id.getBytes();
+  putBlobContents(id, contents);
+  put(LocalStore::KeySpace::BlobMetaDataFamily,
+      id.getBytes(),
+      metadataBytes.slice());
+  return metadata;
+}
+
+void LocalStore::WriteBatch::putBlobChunk(
+    const Hash& blobId,
+    uint64_t chunkIndex,
+    const folly::IOBuf& contents) {
+  putBlobContents(getBlobChunkId(blobId, chunkIndex), contents);
+}
 
+void LocalStore::WriteBatch::putBlobContents(
+    const Hash& id,
+    const folly::IOBuf& contents) {
   // Add a git-style blob prefix
   auto prefix = folly::to<string>("blob ", contents.computeChainDataLength());
   prefix.push_back('\0');
@@ -229,11 +400,7 @@ BlobMetadata LocalStore::WriteBatch::putBlob(const Hash& id, const Blob* blob) {
     cursor.skip(bytes.size());
   }
 
-  put(LocalStore::KeySpace::BlobFamily, hashSlice, bodySlices);
-  put(LocalStore::KeySpace::BlobMetaDataFamily,
-      hashSlice,
-      metadataBytes.slice());
-  return metadata;
+  put(LocalStore::KeySpace::BlobFamily, id.getBytes(), bodySlices);
 }
 
 LocalStore::WriteBatch::~WriteBatch() {}
@@ -10,6 +10,9 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <array>
+#include <chrono>
 #include <memory>
 #include <optional>
 #include "eden/fs/store/BlobMetadata.h"
@@ -61,6 +64,7 @@ class LocalStore {
     TreeFamily = 2,
     HgProxyHashFamily = 3,
     HgCommitToTreeFamily = 4,
+    AccessTimeFamily = 5,
 
     End, // must be last!
   };
@@ -103,6 +107,68 @@ class LocalStore {
    */
   virtual void clearKeySpace(KeySpace keySpace) = 0;
 
+  /**
+   * Returns true if keySpace is kept under a size limit by garbageCollect().
+   *
+   * This is every Ephemeral KeySpace except AccessTimeFamily, which holds
+   * the access times that the garbage collector evicts by.
+   */
+  static bool isGarbageCollected(KeySpace keySpace);
+
+  /**
+   * The approximate size limit, in bytes, for each KeySpace.  0 means no
+   * limit.
+   */
+  using SizeLimits = std::array<uint64_t, KeySpace::End>;
+
+  /**
+   * The outcome of garbage collecting a single KeySpace.
+   */
+  struct KeySpaceGCResult {
+    uint64_t sizeBefore{0};
+    uint64_t sizeAfter{0};
+    uint64_t entriesEvicted{0};
+    // True if the KeySpace had to be cleared entirely because too little of
+    // its data has a recorded access time.
+    bool cleared{false};
+    std::chrono::steady_clock::duration compactionTime{0};
+  };
+
+  /**
+   * Progress of the current garbage collection and totals over all previous
+   * ones, for reporting.
+   */
+  struct GarbageCollectionStatus {
+    struct KeySpaceStatus {
+      uint64_t sizeLimit{0};
+      uint64_t approximateSize{0};
+      uint64_t entriesEvicted{0};
+      uint64_t bytesReclaimed{0};
+      uint64_t clearCount{0};
+      std::chrono::steady_clock::duration lastCompactionTime{0};
+    };
+
+    bool running{false};
+    std::optional<KeySpace> currentKeySpace;
+    uint64_t runCount{0};
+    std::chrono::steady_clock::duration lastRunDuration{0};
+    std::array<KeySpaceStatus, KeySpace::End> keySpaces{};
+  };
+
+  /**
+   * Evict the least recently accessed entries from each garbage collected
+   * KeySpace that is larger than its limit in sizeLimits, and compact it.
+   *
+   * This may take a long time, and should be run on a background thread.
+   * Only one garbage collection runs at a time: if one is already in
+   * progress this returns false without doing anything.
+   */
+  bool garbageCollect(const SizeLimits& sizeLimits);
+
+  GarbageCollectionStatus getGarbageCollectionStatus() const {
+    return *gcStatus_.rlock();
+  }
+
   /**
    * Ask the storage engine to compact the KeySpace.
    */
@@ -147,6 +213,16 @@ class LocalStore {
    */
   folly::Future<std::unique_ptr<Blob>> getBlob(const Hash& id) const;
 
+  /**
+   * Get one chunk of a large blob, as described in BlobChunk.h.
+   *
+   * Returns nullptr if the chunk is not present in the store, even if the
+   * whole blob is.
+   */
+  folly::Future<std::unique_ptr<Blob>> getBlobChunk(
+      const Hash& blobId,
+      uint64_t chunkIndex) const;
+
   /**
    * Get the size of a blob and the SHA-1 hash of its contents.
    *
@@ -159,7 +235,25 @@ class LocalStore {
   folly::Future<std::optional<size_t>> getBlobSize(const Hash& id) const;
 
   /**
-   * Compute the serialized version of the tree.
+   * Get several Trees, Blobs, or BlobMetadata entries from the store at once.
+   *
+   * These look up all of the keys with a single getBatch() call, which lets
+   * stores such as RocksDbLocalStore use a bulk read rather than one read per
+   * key.  The results are in the same order as ids, with nullptr or
+   * std::nullopt for keys that are not present in the store.
+   */
+  folly::Future<std::vector<std::unique_ptr<Tree>>> getTreeBatch(
+      const std::vector<Hash>& ids) const;
+  folly::Future<std::vector<std::unique_ptr<Blob>>> getBlobBatch(
+      const std::vector<Hash>& ids) const;
+  folly::Future<std::vector<std::optional<BlobMetadata>>> getBlobMetadataBatch(
+      const std::vector<Hash>& ids) const;
+
+  /**
+   * Compute the serialized version of the tree.  Trees are stored as git tree
+   * objects unless --binaryTreeFormat is set, in which case trees with their
+   * own ID use the binary format described in SerializedTree.h.  Readers
+   * accept both formats, so the flag can be turned off again.
    * Returns the key and the (not coalesced) serialized data.
    * This does not modify the contents of the store; it is the method
    * used by the putTree method to compute the data that it stores.
@@ -227,6 +321,17 @@ class LocalStore {
      */
     BlobMetadata putBlob(const Hash& id, const Blob* blob);
 
+    /**
+     * Store one chunk of a large blob, as described in BlobChunk.h.
+     *
+     * Unlike putBlob(), this does not record any metadata, since the chunk's
+     * size and SHA-1 are not those of the blob.
+     */
+    void putBlobChunk(
+        const Hash& blobId,
+        uint64_t chunkIndex,
+        const folly::IOBuf& contents);
+
     /**
      * Put arbitrary data in the store.
      */
@@ -257,6 +362,11 @@ class LocalStore {
     WriteBatch() = default;
 
    private:
+    /**
+     * Store a blob's contents in the BlobFamily KeySpace under id.
+     */
+    void putBlobContents(const Hash& id, const folly::IOBuf& contents);
+
     friend class LocalStore;
   };
 
@@ -270,6 +380,30 @@ class LocalStore {
    * destruction either.
    */
   virtual std::unique_ptr<WriteBatch> beginWrite(size_t bufSize = 0) = 0;
+
+ protected:
+  /**
+   * Bring keySpace under sizeLimit by evicting its least recently accessed
+   * entries.
+   *
+   * Stores that do not track sizes and access times leave the KeySpace alone;
+   * this default implementation does nothing.
+   */
+  virtual KeySpaceGCResult garbageCollectKeySpace(
+      KeySpace keySpace,
+      uint64_t sizeLimit);
+
+  /**
+   * Call garbageCollectKeySpace() on another LocalStore, for stores that keep
+   * some of their key spaces in a delegate store.
+   */
+  static KeySpaceGCResult garbageCollectDelegate(
+      LocalStore& store,
+      KeySpace keySpace,
+      uint64_t sizeLimit);
+
+ private:
+  folly::Synchronized<GarbageCollectionStatus> gcStatus_;
 };
 } // namespace eden
 } // namespace facebook
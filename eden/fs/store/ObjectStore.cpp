@@ -10,83 +10,367 @@
 #include "ObjectStore.h"
 
 #include <folly/Conv.h>
+#include <folly/MapUtil.h>
 #include <folly/futures/Future.h>
+#include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
 #include <stdexcept>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/store/BackingStore.h"
+#include "eden/fs/store/BlobChunk.h"
 #include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/SerializedTree.h"
+#include "eden/fs/store/StoreResult.h"
+#include "eden/fs/store/TreeCache.h"
 
 using folly::Future;
 using folly::IOBuf;
 using folly::makeFuture;
+using folly::Try;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 namespace facebook {
 namespace eden {
 
+namespace {
+/**
+ * Store every complete chunk in range under its chunk ID.
+ */
+void putBlobChunks(
+    LocalStore::WriteBatch& batch,
+    const Hash& id,
+    const BlobRange& range) {
+  auto dataEnd = range.offset + range.data.computeChainDataLength();
+  auto end = std::min(dataEnd, range.blobSize);
+  auto index = (range.offset + kBlobChunkSize - 1) / kBlobChunkSize;
+  if (index * kBlobChunkSize >= end) {
+    return;
+  }
+
+  folly::io::Cursor cursor{&range.data};
+  cursor.skip(index * kBlobChunkSize - range.offset);
+  for (; index * kBlobChunkSize < end; ++index) {
+    auto chunkStart = index * kBlobChunkSize;
+    auto chunkEnd = std::min(chunkStart + kBlobChunkSize, range.blobSize);
+    if (chunkEnd > dataEnd) {
+      break;
+    }
+    IOBuf contents;
+    cursor.clone(contents, chunkEnd - chunkStart);
+    batch.putBlobChunk(id, index, contents);
+  }
+}
+
+/**
+ * Copy one chunk of a blob out of range, so that caching it does not keep the
+ * rest of the range in memory.  Returns nullptr if range does not include the
+ * whole chunk.
+ */
+shared_ptr<const Blob>
+copyBlobChunk(const Hash& id, uint64_t chunkIndex, const BlobRange& range) {
+  auto chunkId = getBlobChunkId(id, chunkIndex);
+  auto chunkStart = chunkIndex * kBlobChunkSize;
+  if (chunkStart >= range.blobSize) {
+    return std::make_shared<const Blob>(chunkId, IOBuf{});
+  }
+  auto chunkEnd = std::min(chunkStart + kBlobChunkSize, range.blobSize);
+  if (chunkStart < range.offset ||
+      chunkEnd > range.offset + range.data.computeChainDataLength()) {
+    return nullptr;
+  }
+
+  auto length = chunkEnd - chunkStart;
+  IOBuf contents{IOBuf::CREATE, length};
+  folly::io::Cursor cursor{&range.data};
+  cursor.skip(chunkStart - range.offset);
+  cursor.pull(contents.writableData(), length);
+  contents.append(length);
+  return std::make_shared<const Blob>(chunkId, std::move(contents));
+}
+
+/**
+ * Store a blob fetched from the BackingStore.  Large blobs are also stored a
+ * chunk at a time, since reads of them look up chunks rather than the whole
+ * blob, and would otherwise fetch it again.
+ */
+BlobMetadata putBlob(LocalStore& localStore, const Hash& id, const Blob& blob) {
+  auto size = blob.getSize();
+  auto chunked = size >= kChunkedBlobThreshold;
+  auto batch = localStore.beginWrite((chunked ? 2 * size : size) + 64);
+  auto metadata = batch->putBlob(id, &blob);
+  if (chunked) {
+    BlobRange range;
+    range.blobSize = size;
+    range.data = blob.getContents();
+    putBlobChunks(*batch, id, range);
+  }
+  batch->flush();
+  return metadata;
+}
+} // namespace
+
 std::shared_ptr<ObjectStore> ObjectStore::create(
     shared_ptr<LocalStore> localStore,
-    shared_ptr<BackingStore> backingStore) {
-  return std::shared_ptr<ObjectStore>{
-      new ObjectStore{std::move(localStore), std::move(backingStore)}};
+    shared_ptr<BackingStore> backingStore,
+    shared_ptr<TreeCache> treeCache,
+    size_t metadataCacheSize) {
+  return std::shared_ptr<ObjectStore>{new ObjectStore{std::move(localStore),
+                                                      std::move(backingStore),
+                                                      std::move(treeCache),
+                                                      metadataCacheSize}};
 }
 
 ObjectStore::ObjectStore(
     shared_ptr<LocalStore> localStore,
-    shared_ptr<BackingStore> backingStore)
-    : metadataCache_{folly::in_place, kMetadataCacheSize},
+    shared_ptr<BackingStore> backingStore,
+    shared_ptr<TreeCache> treeCache,
+    size_t metadataCacheSize)
+    : metadataCache_{metadataCacheSize},
       localStore_{std::move(localStore)},
-      backingStore_{std::move(backingStore)} {}
+      backingStore_{std::move(backingStore)},
+      treeCache_{std::move(treeCache)} {}
 
 ObjectStore::~ObjectStore() {}
 
+template <typename T, typename Fetch>
+Future<T> ObjectStore::getCoalesced(
+    const Hash& id,
+    folly::Synchronized<PendingRequestMap<T>>& pending,
+    std::atomic<uint64_t>& coalescedCount,
+    RaisePriority raise,
+    Fetch&& fetch) const {
+  auto priority = getCurrentImportPriority();
+  std::shared_ptr<folly::SharedPromise<T>> promise;
+  {
+    auto pendingMap = pending.wlock();
+    auto ret = pendingMap->try_emplace(id);
+    if (!ret.second) {
+      coalescedCount.fetch_add(1, std::memory_order_relaxed);
+      auto& request = ret.first->second;
+      auto future = request.promise->getFuture();
+      if (priority < request.priority) {
+        request.priority = priority;
+        pendingMap.unlock();
+        (backingStore_.get()->*raise)(id, priority);
+      }
+      return future;
+    }
+    promise = std::make_shared<folly::SharedPromise<T>>();
+    ret.first->second = PendingRequest<T>{promise, priority};
+  }
+
+  auto future = promise->getFuture();
+  folly::makeFutureWith(std::forward<Fetch>(fetch))
+      .thenTry([id, &pending, promise, self = shared_from_this()](
+                   folly::Try<T>&& result) {
+        // Remove the entry before fulfilling the promise, so that a request
+        // made from one of the callbacks starts a new load rather than
+        // joining this completed one.
+        pending.wlock()->erase(id);
+        promise->setTry(std::move(result));
+      });
+  return future;
+}
+
+template <typename T, typename Fetch>
+auto ObjectStore::fetchAtPendingPriority(
+    const Hash& id,
+    folly::Synchronized<PendingRequestMap<T>>& pending,
+    RaisePriority raise,
+    Fetch&& fetch) const {
+  auto getPriority = [&] {
+    auto pendingMap = pending.rlock();
+    auto* request = folly::get_ptr(*pendingMap, id);
+    return request ? request->priority : getCurrentImportPriority();
+  };
+
+  auto priority = getPriority();
+  auto future = [&] {
+    ImportPriorityScope scope{priority};
+    return fetch();
+  }();
+
+  // A more urgent caller may have joined after the priority was read but
+  // before the request reached the BackingStore, when raising it did nothing.
+  auto joinedPriority = getPriority();
+  if (joinedPriority < priority) {
+    (backingStore_.get()->*raise)(id, joinedPriority);
+  }
+  return future;
+}
+
 Future<shared_ptr<const Tree>> ObjectStore::getTree(const Hash& id) const {
+  if (treeCache_) {
+    if (auto tree = treeCache_->get(id)) {
+      XLOG(DBG4) << "tree " << id << " found in tree cache";
+      return makeFuture(std::move(tree));
+    }
+  }
+
+  return getCoalesced(
+      id,
+      pendingTrees_,
+      coalescedTreeRequests_,
+      &BackingStore::raiseTreePriority,
+      [this, id] { return fetchTree(id); });
+}
+
+Future<std::optional<TreeEntry>> ObjectStore::getTreeEntry(
+    const Hash& treeId,
+    PathComponentPiece name) const {
+  auto findEntry = [entryName = PathComponent{name}](
+                       const Tree& tree) -> std::optional<TreeEntry> {
+    if (auto* entry = tree.getEntryPtr(entryName)) {
+      return *entry;
+    }
+    return std::nullopt;
+  };
+  if (treeCache_) {
+    if (auto tree = treeCache_->get(treeId)) {
+      return makeFuture(findEntry(*tree));
+    }
+  }
+
+  return localStore_->getFuture(LocalStore::TreeFamily, treeId.getBytes())
+      .thenValue([self = shared_from_this(),
+                  treeId,
+                  entryName = PathComponent{name},
+                  findEntry](StoreResult&& data) {
+        if (data.isValid() && SerializedTree::isSerializedTree(data.bytes())) {
+          XLOG(DBG4) << "tree " << treeId << " searched in local store";
+          return makeFuture(SerializedTree{data.bytes()}.getEntry(entryName));
+        }
+        return self->getTree(treeId).thenValue(
+            [findEntry](shared_ptr<const Tree> tree) {
+              return findEntry(*tree);
+            });
+      });
+}
+
+Future<shared_ptr<const Tree>> ObjectStore::fetchTree(const Hash& id) const {
   // Check in the LocalStore first
   return localStore_->getTree(id).thenValue(
-      [id, backingStore = backingStore_](shared_ptr<const Tree> tree) {
+      [id, self = shared_from_this()](shared_ptr<const Tree> tree) {
         if (tree) {
           XLOG(DBG4) << "tree " << id << " found in local store";
+          if (self->treeCache_) {
+            self->treeCache_->insert(tree);
+          }
           return makeFuture(std::move(tree));
         }
 
-        // Note: We don't currently have logic here to avoid duplicate work if
-        // multiple callers request the same tree at once.  We could store a map
-        // of pending lookups as (Hash --> std::list<Promise<unique_ptr<Tree>>),
-        // and just add a new Promise to the list if this Hash already exists in
-        // the pending list.
+        return self->fetchTreeFromBackingStore(id);
+      });
+}
+
+Future<shared_ptr<const Tree>> ObjectStore::fetchTreeFromBackingStore(
+    const Hash& id) const {
+  return fetchAtPendingPriority(
+             id,
+             pendingTrees_,
+             &BackingStore::raiseTreePriority,
+             [&] { return backingStore_->getTree(id); })
+      .thenValue([id, treeCache = treeCache_](
+                     unique_ptr<const Tree> loadedTree) {
+        if (!loadedTree) {
+          // TODO: Perhaps we should do some short-term negative caching?
+          XLOG(DBG2) << "unable to find tree " << id;
+          throw std::domain_error(
+              folly::to<string>("tree ", id.toString(), " not found"));
+        }
+
+        // TODO: For now, the BackingStore objects actually end up already
+        // saving the Tree object in the LocalStore, so we don't do
+        // anything here.
         //
-        // However, de-duplication of object loads will already be done at the
-        // Inode layer.  Therefore we currently don't bother de-duping loads at
-        // this layer.
-
-        // Load the tree from the BackingStore.
-        return backingStore->getTree(id).thenValue(
-            [id](unique_ptr<const Tree> loadedTree) {
-              if (!loadedTree) {
-                // TODO: Perhaps we should do some short-term negative caching?
-                XLOG(DBG2) << "unable to find tree " << id;
-                throw std::domain_error(
-                    folly::to<string>("tree ", id.toString(), " not found"));
-              }
+        // localStore_->putTree(loadedTree.get());
+        XLOG(DBG3) << "tree " << id << " retrieved from backing store";
+        shared_ptr<const Tree> tree{std::move(loadedTree)};
+        if (treeCache) {
+          treeCache->insert(tree);
+        }
+        return tree;
+      });
+}
+
+Future<vector<Try<shared_ptr<const Tree>>>> ObjectStore::getTrees(
+    const vector<Hash>& ids) const {
+  auto results = std::make_shared<vector<Try<shared_ptr<const Tree>>>>(
+      ids.size());
+  vector<size_t> localIndexes;
+  vector<Hash> localIds;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (treeCache_) {
+      if (auto tree = treeCache_->get(ids[i])) {
+        (*results)[i] = Try<shared_ptr<const Tree>>{std::move(tree)};
+        continue;
+      }
+    }
+    localIndexes.push_back(i);
+    localIds.push_back(ids[i]);
+  }
+  if (localIds.empty()) {
+    return makeFuture(std::move(*results));
+  }
+
+  return localStore_->getTreeBatch(localIds).thenValue(
+      [self = shared_from_this(),
+       results,
+       localIndexes = std::move(localIndexes),
+       localIds](vector<unique_ptr<Tree>>&& trees) {
+        vector<size_t> missIndexes;
+        vector<Future<shared_ptr<const Tree>>> fetches;
+        for (size_t n = 0; n < trees.size(); ++n) {
+          if (trees[n]) {
+            XLOG(DBG4) << "tree " << localIds[n] << " found in local store";
+            shared_ptr<const Tree> tree{std::move(trees[n])};
+            if (self->treeCache_) {
+              self->treeCache_->insert(tree);
+            }
+            (*results)[localIndexes[n]] =
+                Try<shared_ptr<const Tree>>{std::move(tree)};
+            continue;
+          }
+
+          auto id = localIds[n];
+          missIndexes.push_back(localIndexes[n]);
+          fetches.push_back(self->getCoalesced(
+              id,
+              self->pendingTrees_,
+              self->coalescedTreeRequests_,
+              &BackingStore::raiseTreePriority,
+              [self, id] { return self->fetchTreeFromBackingStore(id); }));
+        }
 
-              // TODO: For now, the BackingStore objects actually end up already
-              // saving the Tree object in the LocalStore, so we don't do
-              // anything here.
-              //
-              // localStore_->putTree(loadedTree.get());
-              XLOG(DBG3) << "tree " << id << " retrieved from backing store";
-              return shared_ptr<const Tree>(std::move(loadedTree));
+        return folly::collectAllSemiFuture(std::move(fetches))
+            .toUnsafeFuture()
+            .thenValue([results, missIndexes = std::move(missIndexes)](
+                           vector<Try<shared_ptr<const Tree>>>&& fetched) {
+              for (size_t n = 0; n < fetched.size(); ++n) {
+                (*results)[missIndexes[n]] = std::move(fetched[n]);
+              }
+              return std::move(*results);
             });
       });
 }
 
 Future<shared_ptr<const Blob>> ObjectStore::getBlob(const Hash& id) const {
+  return getCoalesced(
+      id,
+      pendingBlobs_,
+      coalescedBlobRequests_,
+      &BackingStore::raiseBlobPriority,
+      [this, id] { return fetchBlob(id); });
+}
+
+Future<shared_ptr<const Blob>> ObjectStore::fetchBlob(const Hash& id) const {
   return localStore_->getBlob(id).thenValue(
       [id, self = shared_from_this()](shared_ptr<const Blob> blob) {
         if (blob) {
@@ -99,20 +383,144 @@ Future<shared_ptr<const Blob>> ObjectStore::getBlob(const Hash& id) const {
           return makeFuture(shared_ptr<const Blob>(std::move(blob)));
         }
 
-        // Look in the BackingStore
-        return self->backingStore_->getBlob(id).thenValue(
-            [self, id](unique_ptr<const Blob> loadedBlob) {
-              if (!loadedBlob) {
-                XLOG(DBG2) << "unable to find blob " << id;
-                // TODO: Perhaps we should do some short-term negative caching?
-                throw std::domain_error(
-                    folly::to<string>("blob ", id.toString(), " not found"));
+        return self->fetchBlobFromBackingStore(id);
+      });
+}
+
+Future<shared_ptr<const Blob>> ObjectStore::fetchBlobFromBackingStore(
+    const Hash& id) const {
+  return fetchAtPendingPriority(
+             id,
+             pendingBlobs_,
+             &BackingStore::raiseBlobPriority,
+             [&] { return backingStore_->getBlob(id); })
+      .thenValue([self = shared_from_this(),
+                  id](unique_ptr<const Blob> loadedBlob) {
+        if (!loadedBlob) {
+          XLOG(DBG2) << "unable to find blob " << id;
+          // TODO: Perhaps we should do some short-term negative caching?
+          throw std::domain_error(
+              folly::to<string>("blob ", id.toString(), " not found"));
+        }
+
+        XLOG(DBG3) << "blob " << id << "  retrieved from backing store";
+        auto metadata = putBlob(*self->localStore_, id, *loadedBlob);
+        self->metadataCache_.insert(id, metadata);
+        return shared_ptr<const Blob>(std::move(loadedBlob));
+      });
+}
+
+Future<shared_ptr<const Blob>> ObjectStore::getBlobChunk(
+    const Hash& id,
+    uint64_t chunkIndex) const {
+  // Chunks have IDs of their own, so concurrent requests for a chunk can be
+  // coalesced alongside requests for whole blobs.
+  return getCoalesced(
+      getBlobChunkId(id, chunkIndex),
+      pendingBlobs_,
+      coalescedBlobRequests_,
+      &BackingStore::raiseBlobPriority,
+      [this, id, chunkIndex] {
+        return localStore_->getBlobChunk(id, chunkIndex)
+            .thenValue([id, chunkIndex, self = shared_from_this()](
+                           unique_ptr<Blob> chunk) {
+              if (chunk) {
+                XLOG(DBG4) << "blob " << id << " chunk " << chunkIndex
+                           << " found in local store";
+                return makeFuture(shared_ptr<const Blob>(std::move(chunk)));
+              }
+              return self->fetchBlobChunkFromBackingStore(id, chunkIndex);
+            });
+      });
+}
+
+Future<shared_ptr<const Blob>> ObjectStore::fetchBlobChunkFromBackingStore(
+    const Hash& id,
+    uint64_t chunkIndex) const {
+  return getCoalesced(
+             id,
+             pendingBlobRanges_,
+             coalescedBlobRequests_,
+             &BackingStore::raiseBlobPriority,
+             [this, id, chunkIndex] { return fetchBlobRange(id, chunkIndex); })
+      .thenValue([self = shared_from_this(), id, chunkIndex](
+                     shared_ptr<const BlobRange> range) {
+        if (auto chunk = copyBlobChunk(id, chunkIndex, *range)) {
+          return makeFuture(std::move(chunk));
+        }
+
+        // The range fetched for another chunk of this blob did not include
+        // this one.
+        return self->fetchBlobRange(id, chunkIndex)
+            .thenValue([id, chunkIndex](shared_ptr<const BlobRange> range) {
+              auto chunk = copyBlobChunk(id, chunkIndex, *range);
+              if (!chunk) {
+                throw std::runtime_error(folly::to<string>(
+                    "backing store returned a range of blob ",
+                    id.toString(),
+                    " that does not include chunk ",
+                    chunkIndex));
               }
+              return chunk;
+            });
+      });
+}
+
+Future<shared_ptr<const BlobRange>> ObjectStore::fetchBlobRange(
+    const Hash& id,
+    uint64_t chunkIndex) const {
+  return backingStore_
+      ->getBlobRange(id, chunkIndex * kBlobChunkSize, kBlobChunkSize)
+      .thenValue([self = shared_from_this(), id](BlobRange range) {
+        XLOG(DBG3) << "blob " << id << " range at " << range.offset
+                   << " retrieved from backing store";
+        auto batch = self->localStore_->beginWrite(
+            range.data.computeChainDataLength() + 64);
+        putBlobChunks(*batch, id, range);
+        batch->flush();
+        return std::make_shared<const BlobRange>(std::move(range));
+      });
+}
 
-              XLOG(DBG3) << "blob " << id << "  retrieved from backing store";
-              auto metadata = self->localStore_->putBlob(id, loadedBlob.get());
-              self->metadataCache_.wlock()->set(id, metadata);
-              return shared_ptr<const Blob>(std::move(loadedBlob));
+Future<vector<Try<shared_ptr<const Blob>>>> ObjectStore::getBlobs(
+    const vector<Hash>& ids) const {
+  if (ids.empty()) {
+    return makeFuture(vector<Try<shared_ptr<const Blob>>>{});
+  }
+
+  return localStore_->getBlobBatch(ids).thenValue(
+      [self = shared_from_this(), ids](vector<unique_ptr<Blob>>&& blobs) {
+        auto results =
+            std::make_shared<vector<Try<shared_ptr<const Blob>>>>(ids.size());
+        vector<size_t> missIndexes;
+        vector<Future<shared_ptr<const Blob>>> fetches;
+        for (size_t n = 0; n < blobs.size(); ++n) {
+          if (blobs[n]) {
+            XLOG(DBG4) << "blob " << ids[n] << "  found in local store";
+            (*results)[n] = Try<shared_ptr<const Blob>>{std::move(blobs[n])};
+            continue;
+          }
+
+          // The BackingStore batches these itself where it can; HgBackingStore
+          // imports queued blobs together.
+          auto id = ids[n];
+          missIndexes.push_back(n);
+          fetches.push_back(self->getCoalesced(
+              id,
+              self->pendingBlobs_,
+              self->coalescedBlobRequests_,
+              &BackingStore::raiseBlobPriority,
+              [self, id] { return self->fetchBlobFromBackingStore(id); }));
+        }
+
+        return folly::collectAllSemiFuture(std::move(fetches))
+            .toUnsafeFuture()
+            .thenValue([results, missIndexes = std::move(missIndexes)](
+                           vector<Try<shared_ptr<const Blob>>>&& fetched) {
+              for (size_t n = 0; n < fetched.size(); ++n) {
+                (*results)[missIndexes[n]] = std::move(fetched[n]);
+              }
+              return std::move(*results);
             });
       });
 }
@@ -138,7 +546,7 @@ Future<shared_ptr<const Tree>> ObjectStore::getTreeForCommit(
   XLOG(DBG3) << "getTreeForCommit(" << commitID << ")";
 
   return backingStore_->getTreeForCommit(commitID).thenValue(
-      [commitID](std::shared_ptr<const Tree> tree) {
+      [commitID, treeCache = treeCache_](std::shared_ptr<const Tree> tree) {
         if (!tree) {
           throw std::domain_error(folly::to<string>(
               "unable to import commit ", commitID.toString()));
@@ -147,46 +555,109 @@ Future<shared_ptr<const Tree>> ObjectStore::getTreeForCommit(
         // For now we assume that the BackingStore will insert the Tree into the
         // LocalStore on its own, so we don't have to update the LocalStore
         // ourselves here.
+        //
+        // The root tree will usually be loaded again by its own hash shortly,
+        // so remember it in the tree cache.
+        if (treeCache) {
+          treeCache->insert(tree);
+        }
         return tree;
       });
 }
 
 Future<BlobMetadata> ObjectStore::getBlobMetadata(const Hash& id) const {
   // First, check the in-memory cache.
-  {
-    auto metadataCache = metadataCache_.wlock();
-    auto cacheIter = metadataCache->find(id);
-    if (cacheIter != metadataCache->end()) {
-      return cacheIter->second;
-    }
+  if (auto metadata = metadataCache_.get(id)) {
+    return *metadata;
   }
 
   return localStore_->getBlobMetadata(id).thenValue(
       [id, self = shared_from_this()](std::optional<BlobMetadata>&& localData) {
         if (localData.has_value()) {
-          self->metadataCache_.wlock()->set(id, localData.value());
+          self->metadataCache_.insert(id, localData.value());
           return makeFuture(localData.value());
         }
 
-        // Load the blob from the BackingStore.
-        //
-        // TODO: It would be nice to add a smarter API to the BackingStore so
-        // that we can query it just for the blob metadata if it supports
-        // getting that without retrieving the full blob data.
-        //
-        // TODO: This should probably check the LocalStore for the blob first,
-        // especially when we begin to expire entries in RocksDB.
-        return self->backingStore_->getBlob(id).thenValue(
-            [self, id](std::unique_ptr<Blob> blob) {
-              if (!blob) {
-                // TODO: Perhaps we should do some short-term negative caching?
-                throw std::domain_error(
-                    folly::to<string>("blob ", id.toString(), " not found"));
-              }
+        return self->fetchBlobMetadataFromBackingStore(id);
+      });
+}
+
+Future<BlobMetadata> ObjectStore::fetchBlobMetadataFromBackingStore(
+    const Hash& id) const {
+  // Load the blob from the BackingStore, joining any load of it that is
+  // already in progress.
+  //
+  // TODO: It would be nice to add a smarter API to the BackingStore so
+  // that we can query it just for the blob metadata if it supports
+  // getting that without retrieving the full blob data.
+  return getCoalesced(
+             id,
+             pendingBlobs_,
+             coalescedBlobRequests_,
+             &BackingStore::raiseBlobPriority,
+             [self = shared_from_this(), id] {
+               return self->fetchBlobFromBackingStore(id);
+             })
+      .thenValue([self = shared_from_this(), id](shared_ptr<const Blob> blob) {
+        // fetchBlobFromBackingStore() caches the metadata, but the load we
+        // joined may have found the blob in the LocalStore instead, or the
+        // entry may already have been evicted.
+        if (auto metadata = self->metadataCache_.get(id)) {
+          return *metadata;
+        }
+        const IOBuf& contents = blob->getContents();
+        BlobMetadata metadata{Hash::sha1(contents),
+                              contents.computeChainDataLength()};
+        self->metadataCache_.insert(id, metadata);
+        return metadata;
+      });
+}
+
+Future<vector<Try<BlobMetadata>>> ObjectStore::getBlobMetadataBatch(
+    const vector<Hash>& ids) const {
+  auto results = std::make_shared<vector<Try<BlobMetadata>>>(ids.size());
+  vector<size_t> localIndexes;
+  vector<Hash> localIds;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (auto metadata = metadataCache_.get(ids[i])) {
+      (*results)[i] = Try<BlobMetadata>{*metadata};
+      continue;
+    }
+    localIndexes.push_back(i);
+    localIds.push_back(ids[i]);
+  }
+  if (localIds.empty()) {
+    return makeFuture(std::move(*results));
+  }
+
+  return localStore_->getBlobMetadataBatch(localIds).thenValue(
+      [self = shared_from_this(),
+       results,
+       localIndexes = std::move(localIndexes),
+       localIds](vector<std::optional<BlobMetadata>>&& localData) {
+        vector<size_t> missIndexes;
+        vector<Future<BlobMetadata>> fetches;
+        for (size_t n = 0; n < localData.size(); ++n) {
+          if (localData[n].has_value()) {
+            self->metadataCache_.insert(localIds[n], localData[n].value());
+            (*results)[localIndexes[n]] =
+                Try<BlobMetadata>{localData[n].value()};
+            continue;
+          }
 
-              auto metadata = self->localStore_->putBlob(id, blob.get());
-              self->metadataCache_.wlock()->set(id, metadata);
-              return metadata;
+          missIndexes.push_back(localIndexes[n]);
+          fetches.push_back(
+              self->fetchBlobMetadataFromBackingStore(localIds[n]));
+        }
+
+        return folly::collectAllSemiFuture(std::move(fetches))
+            .toUnsafeFuture()
+            .thenValue([results, missIndexes = std::move(missIndexes)](
+                           vector<Try<BlobMetadata>>&& fetched) {
+              for (size_t n = 0; n < fetched.size(); ++n) {
+                (*results)[missIndexes[n]] = std::move(fetched[n]);
+              }
+              return std::move(*results);
             });
       });
 }
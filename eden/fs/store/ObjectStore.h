@@ -10,19 +10,28 @@
 #pragma once
 
 #include <folly/Synchronized.h>
-#include <folly/container/EvictingCacheMap.h>
+#include <folly/Try.h>
+#include <folly/container/F14Map.h>
+#include <folly/futures/SharedPromise.h>
+#include <atomic>
 #include <memory>
+#include <optional>
 #include "eden/fs/model/Hash.h"
+#include "eden/fs/model/TreeEntry.h"
 #include "eden/fs/store/BlobMetadata.h"
+#include "eden/fs/store/BlobMetadataCache.h"
 #include "eden/fs/store/IObjectStore.h"
+#include "eden/fs/store/ImportPriority.h"
 
 namespace facebook {
 namespace eden {
 
 class BackingStore;
 class Blob;
+struct BlobRange;
 class LocalStore;
 class Tree;
+class TreeCache;
 
 /**
  * ObjectStore is a content-addressed store for eden object data.
@@ -37,9 +46,23 @@ class Tree;
 class ObjectStore : public IObjectStore,
                     public std::enable_shared_from_this<ObjectStore> {
  public:
+  static constexpr size_t kDefaultMetadataCacheSize = 64 * 1024 * 1024;
+
+  /**
+   * Create an ObjectStore.
+   *
+   * If treeCache is non-null, Trees are looked up there before the LocalStore
+   * and inserted into it once loaded.  It may be shared by several
+   * ObjectStores.
+   *
+   * metadataCacheSize is the approximate number of bytes to use for caching
+   * blob sizes and SHA-1s in memory.
+   */
   static std::shared_ptr<ObjectStore> create(
       std::shared_ptr<LocalStore> localStore,
-      std::shared_ptr<BackingStore> backingStore);
+      std::shared_ptr<BackingStore> backingStore,
+      std::shared_ptr<TreeCache> treeCache = nullptr,
+      size_t metadataCacheSize = kDefaultMetadataCacheSize);
   ~ObjectStore() override;
 
   /**
@@ -52,6 +75,18 @@ class ObjectStore : public IObjectStore,
   folly::Future<std::shared_ptr<const Tree>> getTree(
       const Hash& id) const override;
 
+  /**
+   * Look up the entry with the given name in a Tree, or std::nullopt if the
+   * Tree has no such entry.
+   *
+   * A Tree that the LocalStore holds in the binary format is searched in
+   * place, without materializing its other entries.  Otherwise this loads
+   * the whole Tree, as getTree() does.
+   */
+  folly::Future<std::optional<TreeEntry>> getTreeEntry(
+      const Hash& treeId,
+      PathComponentPiece name) const;
+
   /**
    * Get a Blob by ID.
    *
@@ -61,9 +96,46 @@ class ObjectStore : public IObjectStore,
    */
   folly::Future<std::shared_ptr<const Blob>> getBlob(
       const Hash& id) const override;
+
+  /**
+   * Get one chunk of a large Blob, as described in BlobChunk.h, without
+   * loading the rest of it.
+   *
+   * Chunks are looked up in the LocalStore, and otherwise fetched with
+   * BackingStore::getBlobRange().  Concurrent fetches of chunks of one blob
+   * share a single range request, and every complete chunk it returns is
+   * saved to the LocalStore, so a BackingStore that can only fetch whole
+   * blobs is asked for each blob once.  Chunks past the end of the blob are
+   * empty.
+   */
+  folly::Future<std::shared_ptr<const Blob>> getBlobChunk(
+      const Hash& id,
+      uint64_t chunkIndex) const override;
+
   folly::Future<folly::Unit> prefetchBlobs(
       const std::vector<Hash>& ids) const override;
 
+  /**
+   * Get several Trees at once.
+   *
+   * All of the Trees that are not in the tree cache are looked up in the
+   * LocalStore with a single batch read, and only the ones that are missing
+   * from the LocalStore are requested from the BackingStore.  The results are
+   * in the same order as ids.  A failure to load one Tree does not affect the
+   * others.
+   */
+  folly::Future<std::vector<folly::Try<std::shared_ptr<const Tree>>>> getTrees(
+      const std::vector<Hash>& ids) const;
+
+  /**
+   * Get several Blobs at once.
+   *
+   * This behaves like getTrees(): one LocalStore batch read, and then a
+   * BackingStore request for each Blob that was not found locally.
+   */
+  folly::Future<std::vector<folly::Try<std::shared_ptr<const Blob>>>> getBlobs(
+      const std::vector<Hash>& ids) const;
+
   /**
    * Get a commit's root Tree.
    *
@@ -83,6 +155,14 @@ class ObjectStore : public IObjectStore,
    */
   folly::Future<BlobMetadata> getBlobMetadata(const Hash& id) const override;
 
+  /**
+   * Returns the metadata of a Blob if it is in the in-memory metadata cache,
+   * without loading it from the LocalStore or BackingStore.
+   */
+  std::optional<BlobMetadata> getCachedBlobMetadata(const Hash& id) const {
+    return metadataCache_.get(id);
+  }
+
   /**
    * Returns the size of the contents of the blob with the given ID.
    */
@@ -93,6 +173,32 @@ class ObjectStore : public IObjectStore,
    */
   folly::Future<Hash> getBlobSha1(const Hash& id) const;
 
+  /**
+   * Get the metadata for several Blobs at once.
+   *
+   * Entries missing from the in-memory metadata cache are looked up in the
+   * LocalStore with a single batch read.  The results are in the same order
+   * as ids.
+   */
+  folly::Future<std::vector<folly::Try<BlobMetadata>>> getBlobMetadataBatch(
+      const std::vector<Hash>& ids) const;
+
+  /**
+   * Returns the number of getTree() calls that were satisfied by joining an
+   * identical request that was already in progress.
+   */
+  uint64_t getCoalescedTreeRequestCount() const {
+    return coalescedTreeRequests_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the number of getBlob() calls that were satisfied by joining an
+   * identical request that was already in progress.
+   */
+  uint64_t getCoalescedBlobRequestCount() const {
+    return coalescedBlobRequests_.load(std::memory_order_relaxed);
+  }
+
   /**
    * Get the LocalStore used by this ObjectStore
    */
@@ -111,29 +217,114 @@ class ObjectStore : public IObjectStore,
   // Forbidden constructor. Use create().
   ObjectStore(
       std::shared_ptr<LocalStore> localStore,
-      std::shared_ptr<BackingStore> backingStore);
+      std::shared_ptr<BackingStore> backingStore,
+      std::shared_ptr<TreeCache> treeCache,
+      size_t metadataCacheSize);
   // Forbidden copy constructor and assignment operator
   ObjectStore(ObjectStore const&) = delete;
   ObjectStore& operator=(ObjectStore const&) = delete;
 
-  static constexpr size_t kMetadataCacheSize = 1000000;
+  template <typename T>
+  struct PendingRequest {
+    std::shared_ptr<folly::SharedPromise<T>> promise;
+    // The most urgent import priority of everyone waiting on this request.
+    ImportPriorityClass priority;
+  };
+  template <typename T>
+  using PendingRequestMap = folly::F14NodeMap<Hash, PendingRequest<T>>;
+
+  /**
+   * BackingStore::raiseTreePriority() or BackingStore::raiseBlobPriority().
+   */
+  using RaisePriority =
+      void (BackingStore::*)(const Hash& id, ImportPriorityClass priority);
+
+  folly::Future<std::shared_ptr<const Tree>> fetchTree(const Hash& id) const;
+  folly::Future<std::shared_ptr<const Blob>> fetchBlob(const Hash& id) const;
+
+  /**
+   * Load an object from the BackingStore, once it is known not to be in the
+   * LocalStore.
+   */
+  folly::Future<std::shared_ptr<const Tree>> fetchTreeFromBackingStore(
+      const Hash& id) const;
+  folly::Future<std::shared_ptr<const Blob>> fetchBlobFromBackingStore(
+      const Hash& id) const;
+  folly::Future<BlobMetadata> fetchBlobMetadataFromBackingStore(
+      const Hash& id) const;
+  folly::Future<std::shared_ptr<const Blob>> fetchBlobChunkFromBackingStore(
+      const Hash& id,
+      uint64_t chunkIndex) const;
+
+  /**
+   * Fetch the range of a blob starting at the given chunk from the
+   * BackingStore, and save every complete chunk it includes to the
+   * LocalStore.
+   */
+  folly::Future<std::shared_ptr<const BlobRange>> fetchBlobRange(
+      const Hash& id,
+      uint64_t chunkIndex) const;
+
+  /**
+   * Return a future for the object with the given ID, calling fetch() to
+   * retrieve it only if there is not already a request for it in progress.
+   *
+   * A caller that joins a request already in progress never reaches the
+   * BackingStore, so if it is more urgent than everyone already waiting,
+   * raise() is called to pass its priority on.
+   */
+  template <typename T, typename Fetch>
+  folly::Future<T> getCoalesced(
+      const Hash& id,
+      folly::Synchronized<PendingRequestMap<T>>& pending,
+      std::atomic<uint64_t>& coalescedCount,
+      RaisePriority raise,
+      Fetch&& fetch) const;
+
+  /**
+   * Call fetch(), which starts a BackingStore request for the object with the
+   * given ID, at the most urgent priority of everyone waiting on the pending
+   * request for it.
+   */
+  template <typename T, typename Fetch>
+  auto fetchAtPendingPriority(
+      const Hash& id,
+      folly::Synchronized<PendingRequestMap<T>>& pending,
+      RaisePriority raise,
+      Fetch&& fetch) const;
 
   /**
    * During status and checkout, it's common to look up the SHA-1 for a given
    * blob ID. To avoid needing to hit RocksDB, keep a bounded in-memory cache of
-   * the sizes and SHA-1s of blobs we've seen. Each node is somewhere around 50
-   * bytes (20+28 + LRU overhead) and we store kMetadataCacheSize entries, which
-   * EvictingCacheMap divides in two for some reason. At the time of this
-   * comment, EvictingCacheMap does not store its nodes densely, so there may
-   * also be some jemalloc tracking overhead and some internal fragmentation
-   * depending on whether the node fits cleanly into one of jemalloc's size
-   * classes.
+   * the sizes and SHA-1s of blobs we've seen.
+   */
+  mutable BlobMetadataCache metadataCache_;
+
+  /**
+   * Trees and blobs currently being loaded from the LocalStore or the
+   * BackingStore.
    *
-   * TODO: It never makes sense to rlock an LRU cache, since cache hits mutate
-   * the data structure. Thus, should we use a more appropriate type of lock?
+   * Concurrent requests for the same object share a single load rather than
+   * each querying the LocalStore and BackingStore.  Fetching an object from
+   * the BackingStore can be expensive (for HgImporter it is a round trip
+   * through the hg_import_helper process), and the inode layer only
+   * de-duplicates loads of a single inode.  Identical files at different
+   * paths still share one object ID.
+   */
+  mutable folly::Synchronized<PendingRequestMap<std::shared_ptr<const Tree>>>
+      pendingTrees_;
+  mutable folly::Synchronized<PendingRequestMap<std::shared_ptr<const Blob>>>
+      pendingBlobs_;
+  /**
+   * BackingStore::getBlobRange() requests in progress, by blob ID.  Fetches
+   * of different chunks of a blob join one of these rather than each asking
+   * for the whole blob from a BackingStore that cannot fetch part of one.
    */
-  mutable folly::Synchronized<folly::EvictingCacheMap<Hash, BlobMetadata>>
-      metadataCache_;
+  mutable folly::Synchronized<
+      PendingRequestMap<std::shared_ptr<const BlobRange>>>
+      pendingBlobRanges_;
+  mutable std::atomic<uint64_t> coalescedTreeRequests_{0};
+  mutable std::atomic<uint64_t> coalescedBlobRequests_{0};
 
   /*
    * The LocalStore.
@@ -148,6 +339,12 @@ class ObjectStore : public IObjectStore,
    * Multiple ObjectStores may share the same BackingStore.
    */
   std::shared_ptr<BackingStore> backingStore_;
+  /*
+   * An in-memory cache of deserialized Trees.  May be null.
+   *
+   * Multiple ObjectStores may share the same TreeCache.
+   */
+  std::shared_ptr<TreeCache> treeCache_;
 };
 } // namespace eden
 } // namespace facebook
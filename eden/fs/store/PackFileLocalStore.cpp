@@ -0,0 +1,1071 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/PackFileLocalStore.h"
+
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <map>
+#include <optional>
+
+#include <boost/filesystem.hpp>
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/ExceptionString.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/SharedMutex.h>
+#include <folly/String.h>
+#include <folly/Synchronized.h>
+#include <folly/futures/Future.h>
+#include <folly/hash/SpookyHashV2.h>
+#include <folly/io/IOBuf.h>
+#include <folly/logging/xlog.h>
+#include <folly/stop_watch.h>
+
+#include "eden/fs/store/KeySpaces.h"
+#include "eden/fs/store/StoreResult.h"
+#include "eden/fs/utils/MappedDiskVector.h"
+
+using folly::ByteRange;
+using folly::IOBuf;
+using folly::StringPiece;
+using std::string;
+
+namespace facebook {
+namespace eden {
+
+namespace {
+// Every segment file starts with a SegmentHeader.
+constexpr StringPiece kSegmentMagic{"EDENPACK"};
+constexpr uint32_t kSegmentVersion = 1;
+constexpr StringPiece kSegmentSuffix{".pack"};
+
+struct SegmentHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+// Followed by the key and then the value.  Records are written body first,
+// so a record whose header has kRecordPresent set is complete.  The unused
+// tail of a segment is zero-filled, so the first header without
+// kRecordPresent marks the end of the segment's data.
+struct RecordHeader {
+  uint32_t valueLength;
+  uint16_t keyLength;
+  uint16_t flags;
+};
+constexpr uint16_t kRecordPresent = 0x01;
+
+constexpr uint32_t kEmptySlot = 0;
+constexpr uint32_t kTombstoneSlot = std::numeric_limits<uint32_t>::max();
+constexpr size_t kMinIndexCapacity = 1 << 16;
+constexpr PathComponentPiece kIndexName{"index"};
+constexpr PathComponentPiece kIndexTempName{"index.tmp"};
+
+uint64_t hashKey(ByteRange key) {
+  // The hash is persisted in the index, so it must be stable across runs.
+  return folly::hash::SpookyHashV2::Hash64(key.data(), key.size(), 0);
+}
+
+size_t recordLength(ByteRange key, ByteRange value) {
+  return sizeof(RecordHeader) + key.size() + value.size();
+}
+
+/**
+ * Returns the smallest power of two index capacity that keeps the index at
+ * most half full with entryCount entries.
+ */
+size_t indexCapacityFor(size_t entryCount) {
+  size_t capacity = kMinIndexCapacity;
+  while (entryCount * 2 > capacity) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+void releaseSegment(void* /* buffer */, void* userData);
+} // namespace
+
+/**
+ * One slot of the open-addressing hash table that maps keys to records.
+ *
+ * Warning: This data structure is stored directly on disk via
+ * MappedDiskVector.  Do not change the order, sizes, or meanings of the
+ * fields without bumping VERSION.
+ */
+struct PackIndexSlot {
+  enum { VERSION = 1 };
+
+  uint64_t keyHash;
+  uint64_t offset;
+  // kEmptySlot if this slot has never been used, kTombstoneSlot if its entry
+  // was removed.
+  uint32_t segment;
+  uint32_t length;
+};
+using PackIndex = MappedDiskVector<PackIndexSlot>;
+
+/**
+ * A memory-mapped segment file.
+ *
+ * Segments are shared with the IOBufs returned by get(), so they must remain
+ * usable after the key space has dropped them.  All non-const methods must be
+ * called with the owning PackedKeySpace's write lock held.
+ */
+class PackSegment {
+ public:
+  struct Record {
+    ByteRange key;
+    ByteRange value;
+  };
+
+  PackSegment(
+      uint32_t id,
+      AbsolutePath path,
+      folly::File file,
+      uint64_t capacity,
+      uint64_t end)
+      : id_(id),
+        path_(std::move(path)),
+        file_(std::move(file)),
+        capacity_(capacity),
+        end_(end) {
+    auto map =
+        mmap(nullptr, capacity_, PROT_READ, MAP_SHARED, file_.fd(), 0);
+    if (map == MAP_FAILED) {
+      folly::throwSystemError("failed to mmap pack segment ", path_);
+    }
+    map_ = static_cast<const uint8_t*>(map);
+  }
+
+  ~PackSegment() {
+    munmap(const_cast<uint8_t*>(map_), capacity_);
+  }
+
+  PackSegment(const PackSegment&) = delete;
+  PackSegment& operator=(const PackSegment&) = delete;
+
+  static AbsolutePath getPath(AbsolutePathPiece dir, uint32_t id) {
+    return dir +
+        PathComponent{folly::sformat("{:08d}{}", id, kSegmentSuffix)};
+  }
+
+  static std::shared_ptr<PackSegment>
+  create(AbsolutePathPiece dir, uint32_t id, uint64_t capacity) {
+    auto path = getPath(dir, id);
+    folly::File file{
+        path.stringPiece(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600};
+    // The file is sparse, so only the space that is actually written to
+    // occupies disk space.
+    folly::checkUnixError(
+        folly::ftruncateNoInt(file.fd(), capacity),
+        "failed to size pack segment ",
+        path);
+
+    SegmentHeader header{};
+    memcpy(header.magic, kSegmentMagic.data(), sizeof(header.magic));
+    header.version = kSegmentVersion;
+    auto written = folly::pwriteFull(file.fd(), &header, sizeof(header), 0);
+    folly::checkUnixError(written, "failed to write pack segment ", path);
+
+    return std::make_shared<PackSegment>(
+        id, std::move(path), std::move(file), capacity, sizeof(header));
+  }
+
+  /**
+   * Open an existing segment.  Only the newest segment may still be appended
+   * to; all others were sealed, and so end exactly where their data does.
+   */
+  static std::shared_ptr<PackSegment>
+  open(AbsolutePathPiece dir, uint32_t id, bool newest) {
+    auto path = getPath(dir, id);
+    folly::File file{path.stringPiece(), O_RDWR | O_CLOEXEC};
+    struct stat st;
+    folly::checkUnixError(
+        fstat(file.fd(), &st), "failed to stat pack segment ", path);
+    auto capacity = static_cast<uint64_t>(st.st_size);
+
+    SegmentHeader header{};
+    if (capacity < sizeof(header) ||
+        folly::preadFull(file.fd(), &header, sizeof(header), 0) !=
+            static_cast<ssize_t>(sizeof(header)) ||
+        StringPiece{header.magic, sizeof(header.magic)} != kSegmentMagic ||
+        header.version != kSegmentVersion) {
+      throw std::runtime_error(
+          folly::to<string>("invalid pack segment header in ", path));
+    }
+
+    auto segment = std::make_shared<PackSegment>(
+        id, std::move(path), std::move(file), capacity, capacity);
+    if (newest) {
+      segment->end_ = segment->findEnd();
+    } else {
+      segment->sealed_ = true;
+    }
+    return segment;
+  }
+
+  uint32_t id() const {
+    return id_;
+  }
+
+  /**
+   * The number of bytes of this segment that are in use.
+   */
+  uint64_t end() const {
+    return end_;
+  }
+
+  /**
+   * The number of bytes occupied by records that the index still refers to.
+   */
+  uint64_t liveBytes() const {
+    return liveBytes_;
+  }
+
+  void addLiveBytes(uint64_t bytes) {
+    liveBytes_ += bytes;
+  }
+
+  void removeLiveBytes(uint64_t bytes) {
+    liveBytes_ -= std::min(liveBytes_, bytes);
+  }
+
+  bool hasRoom(size_t length) const {
+    return !sealed_ && end_ + length <= capacity_;
+  }
+
+  /**
+   * Append a record, returning its offset.
+   */
+  uint64_t append(ByteRange key, ByteRange value) {
+    XDCHECK(hasRoom(recordLength(key, value)));
+    auto offset = end_;
+
+    std::array<iovec, 2> body;
+    body[0].iov_base = const_cast<uint8_t*>(key.data());
+    body[0].iov_len = key.size();
+    body[1].iov_base = const_cast<uint8_t*>(value.data());
+    body[1].iov_len = value.size();
+    auto bodyOffset = offset + sizeof(RecordHeader);
+    folly::checkUnixError(
+        folly::pwritevFull(file_.fd(), body.data(), body.size(), bodyOffset),
+        "failed to append to pack segment ",
+        path_);
+
+    RecordHeader header{};
+    header.valueLength = static_cast<uint32_t>(value.size());
+    header.keyLength = static_cast<uint16_t>(key.size());
+    header.flags = kRecordPresent;
+    folly::checkUnixError(
+        folly::pwriteFull(file_.fd(), &header, sizeof(header), offset),
+        "failed to append to pack segment ",
+        path_);
+
+    end_ += recordLength(key, value);
+    return offset;
+  }
+
+  /**
+   * Get the record at offset, or std::nullopt if there is no complete record
+   * there.
+   */
+  std::optional<Record> read(uint64_t offset) const {
+    RecordHeader header;
+    if (offset < sizeof(SegmentHeader) ||
+        offset + sizeof(header) > end_) {
+      return std::nullopt;
+    }
+    memcpy(&header, map_ + offset, sizeof(header));
+    if (!(header.flags & kRecordPresent)) {
+      return std::nullopt;
+    }
+    auto keyOffset = offset + sizeof(header);
+    auto valueOffset = keyOffset + header.keyLength;
+    if (valueOffset + header.valueLength > end_) {
+      return std::nullopt;
+    }
+    return Record{ByteRange{map_ + keyOffset, header.keyLength},
+                  ByteRange{map_ + valueOffset, header.valueLength}};
+  }
+
+  /**
+   * Call fn(offset, record) for every record in the segment.
+   */
+  template <typename Fn>
+  void forEachRecord(Fn&& fn) const {
+    uint64_t offset = sizeof(SegmentHeader);
+    while (auto record = read(offset)) {
+      fn(offset, *record);
+      offset += recordLength(record->key, record->value);
+    }
+  }
+
+  /**
+   * Stop appending to this segment, and release its unused space.
+   */
+  void seal() {
+    if (sealed_) {
+      return;
+    }
+    sealed_ = true;
+    // Accessing the mapping past the end of the file is an error, but we
+    // never read beyond end_.
+    folly::checkUnixError(
+        folly::ftruncateNoInt(file_.fd(), end_),
+        "failed to truncate pack segment ",
+        path_);
+  }
+
+  /**
+   * Delete the segment file.  The mapping remains valid until every
+   * reference to this segment is gone.
+   */
+  void remove() {
+    if (unlink(path_.c_str()) != 0 && errno != ENOENT) {
+      folly::throwSystemError("failed to remove pack segment ", path_);
+    }
+  }
+
+  /**
+   * Wrap value, which must point into this segment, in an IOBuf that keeps
+   * the segment mapped.
+   */
+  static IOBuf wrap(
+      std::shared_ptr<const PackSegment> segment,
+      ByteRange value) {
+    auto holder = std::make_unique<std::shared_ptr<const PackSegment>>(
+        std::move(segment));
+    return IOBuf{IOBuf::TAKE_OWNERSHIP,
+                 const_cast<uint8_t*>(value.data()),
+                 value.size(),
+                 releaseSegment,
+                 holder.release()};
+  }
+
+ private:
+  uint64_t findEnd() const {
+    uint64_t offset = sizeof(SegmentHeader);
+    RecordHeader header;
+    while (offset + sizeof(header) <= capacity_) {
+      memcpy(&header, map_ + offset, sizeof(header));
+      auto length =
+          sizeof(header) + header.keyLength + uint64_t{header.valueLength};
+      if (!(header.flags & kRecordPresent) || offset + length > capacity_) {
+        break;
+      }
+      offset += length;
+    }
+    return offset;
+  }
+
+  const uint32_t id_;
+  const AbsolutePath path_;
+  folly::File file_;
+  const uint8_t* map_{nullptr};
+  const uint64_t capacity_;
+  uint64_t end_;
+  uint64_t liveBytes_{0};
+  bool sealed_{false};
+};
+
+namespace {
+void releaseSegment(void* /* buffer */, void* userData) {
+  delete static_cast<std::shared_ptr<const PackSegment>*>(userData);
+}
+} // namespace
+
+/**
+ * The segments and index of one packed key space.
+ */
+class PackedKeySpace {
+ public:
+  PackedKeySpace(AbsolutePathPiece dir, uint64_t segmentSize)
+      : dir_(dir), segmentSize_(segmentSize) {
+    auto state = state_.wlock();
+    loadSegments(*state);
+    loadIndex(*state);
+  }
+
+  StoreResult get(ByteRange key) const {
+    auto state = state_.rlock();
+    return lookup(*state, key);
+  }
+
+  std::vector<StoreResult> getBatch(const std::vector<ByteRange>& keys) const {
+    std::vector<StoreResult> results;
+    results.reserve(keys.size());
+    auto state = state_.rlock();
+    for (auto key : keys) {
+      results.push_back(lookup(*state, key));
+    }
+    return results;
+  }
+
+  bool hasKey(ByteRange key) const {
+    auto state = state_.rlock();
+    return findSlot(*state, key, hashKey(key)).has_value();
+  }
+
+  void put(ByteRange key, ByteRange value) {
+    auto state = state_.wlock();
+    insert(*state, key, value);
+  }
+
+  void putBatch(const std::vector<std::pair<string, string>>& entries) {
+    auto state = state_.wlock();
+    for (const auto& entry : entries) {
+      insert(*state, StringPiece{entry.first}, StringPiece{entry.second});
+    }
+  }
+
+  uint64_t getSize() const {
+    auto state = state_.rlock();
+    return getSize(*state);
+  }
+
+  void clear() {
+    auto state = state_.wlock();
+    for (const auto& entry : state->segments) {
+      entry.second->remove();
+    }
+    state->segments.clear();
+    state->active.reset();
+    writeIndex(*state, kMinIndexCapacity, [](auto&&) {});
+  }
+
+  /**
+   * Copy the live records out of segments that are mostly garbage, so those
+   * segments can be deleted, and drop tombstones from the index.
+   */
+  void compact() {
+    auto state = state_.wlock();
+    compact(*state);
+  }
+
+  /**
+   * Drop the oldest segments until the key space is under 90% of sizeLimit.
+   */
+  LocalStore::KeySpaceGCResult garbageCollect(uint64_t sizeLimit) {
+    LocalStore::KeySpaceGCResult result;
+    auto state = state_.wlock();
+    result.sizeBefore = getSize(*state);
+    result.sizeAfter = result.sizeBefore;
+    if (sizeLimit == 0 || result.sizeBefore <= sizeLimit) {
+      return result;
+    }
+
+    // Leave some headroom so that we don't immediately go over the limit
+    // again.
+    auto target = sizeLimit - sizeLimit / 10;
+    std::vector<std::shared_ptr<PackSegment>> dropped;
+    for (const auto& entry : state->segments) {
+      if (result.sizeAfter <= target) {
+        break;
+      }
+      dropped.push_back(entry.second);
+      result.sizeAfter -= entry.second->end();
+    }
+
+    auto isDropped = [&](uint32_t segment) {
+      for (const auto& droppedSegment : dropped) {
+        if (droppedSegment->id() == segment) {
+          return true;
+        }
+      }
+      return false;
+    };
+    auto& index = *state->index;
+    for (size_t i = 0; i < index.size(); ++i) {
+      auto& slot = index[i];
+      if (slot.segment != kEmptySlot && slot.segment != kTombstoneSlot &&
+          isDropped(slot.segment)) {
+        slot.segment = kTombstoneSlot;
+        --state->usedSlots;
+        ++state->tombstones;
+        ++result.entriesEvicted;
+      }
+    }
+
+    for (const auto& segment : dropped) {
+      if (segment == state->active) {
+        state->active.reset();
+      }
+      state->segments.erase(segment->id());
+      segment->remove();
+    }
+
+    folly::stop_watch<std::chrono::steady_clock::duration> watch;
+    compact(*state);
+    result.compactionTime = watch.elapsed();
+    result.sizeAfter = getSize(*state);
+    return result;
+  }
+
+ private:
+  struct State {
+    std::optional<PackIndex> index;
+    size_t usedSlots{0};
+    size_t tombstones{0};
+    // Ordered by id, which is also the order the segments were created in.
+    std::map<uint32_t, std::shared_ptr<PackSegment>> segments;
+    // The segment new records are appended to, if any.
+    std::shared_ptr<PackSegment> active;
+    uint32_t nextSegmentId{1};
+  };
+
+  void loadSegments(State& state) {
+    ensureDirectoryExists(dir_);
+    std::vector<uint32_t> ids;
+    auto boostPath = boost::filesystem::path{dir_.value().c_str()};
+    for (const auto& entry : boost::filesystem::directory_iterator(boostPath)) {
+      auto name = entry.path().filename().string();
+      StringPiece namePiece{name};
+      if (!namePiece.removeSuffix(kSegmentSuffix)) {
+        continue;
+      }
+      auto id = folly::tryTo<uint32_t>(namePiece);
+      if (id.hasValue() && id.value() != kEmptySlot &&
+          id.value() != kTombstoneSlot) {
+        ids.push_back(id.value());
+      }
+    }
+    if (ids.empty()) {
+      return;
+    }
+
+    std::sort(ids.begin(), ids.end());
+    state.nextSegmentId = ids.back() + 1;
+    for (auto id : ids) {
+      auto newest = id == ids.back();
+      try {
+        auto segment = PackSegment::open(dir_, id, newest);
+        state.segments.emplace(id, segment);
+        if (newest) {
+          state.active = std::move(segment);
+        }
+      } catch (const std::exception& ex) {
+        XLOG(WARN) << "ignoring unreadable pack segment " << id << " in "
+                   << dir_ << ": " << folly::exceptionStr(ex);
+      }
+    }
+  }
+
+  void loadIndex(State& state) {
+    auto indexPath = dir_ + kIndexName;
+    try {
+      state.index = PackIndex::open(indexPath.stringPiece());
+    } catch (const std::exception& ex) {
+      XLOG(WARN) << "rebuilding unreadable pack index " << indexPath << ": "
+                 << folly::exceptionStr(ex);
+      rebuildIndexFromSegments(state);
+      return;
+    }
+
+    auto& index = *state.index;
+    auto capacity = index.size();
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+      if (capacity != 0 || !state.segments.empty()) {
+        XLOG(WARN) << "rebuilding pack index " << indexPath
+                   << " with invalid capacity " << capacity;
+      }
+      rebuildIndexFromSegments(state);
+      return;
+    }
+
+    // Discard entries that refer to records that did not make it to disk,
+    // and recompute how much of each segment is still in use.
+    for (size_t i = 0; i < capacity; ++i) {
+      auto& slot = index[i];
+      if (slot.segment == kEmptySlot) {
+        continue;
+      }
+      if (slot.segment == kTombstoneSlot) {
+        ++state.tombstones;
+        continue;
+      }
+      auto it = state.segments.find(slot.segment);
+      if (it == state.segments.end() || !it->second->read(slot.offset)) {
+        slot.segment = kTombstoneSlot;
+        ++state.tombstones;
+        continue;
+      }
+      it->second->addLiveBytes(slot.length);
+      ++state.usedSlots;
+    }
+  }
+
+  void rebuildIndexFromSegments(State& state) {
+    for (const auto& entry : state.segments) {
+      entry.second->removeLiveBytes(entry.second->liveBytes());
+    }
+    state.index.reset();
+    writeIndex(state, kMinIndexCapacity, [](auto&&) {});
+    for (const auto& entry : state.segments) {
+      const auto& segment = entry.second;
+      segment->forEachRecord(
+          [&](uint64_t offset, const PackSegment::Record& record) {
+            auto length = recordLength(record.key, record.value);
+            auto hash = hashKey(record.key);
+            if (auto existing = findSlot(state, record.key, hash)) {
+              replaceSlot(state, *existing, segment.get(), offset, length);
+            } else {
+              addSlot(state, hash, segment.get(), offset, length);
+            }
+          });
+    }
+  }
+
+  /**
+   * Replace the index with a new, empty one with the given capacity, then
+   * call fill(newIndex) to populate it.
+   *
+   * The new index is written to a temporary file and renamed over the old
+   * one, so a crash never leaves a partially written index behind.
+   */
+  template <typename Fn>
+  void writeIndex(State& state, size_t capacity, Fn&& fill) {
+    auto tmpPath = dir_ + kIndexTempName;
+    auto newIndex = PackIndex::createOrOverwrite(tmpPath.stringPiece());
+    try {
+      for (size_t i = 0; i < capacity; ++i) {
+        newIndex.emplace_back(PackIndexSlot{0, 0, kEmptySlot, 0});
+      }
+      state.usedSlots = 0;
+      state.tombstones = 0;
+      fill(newIndex);
+
+      auto indexPath = dir_ + kIndexName;
+      if (rename(tmpPath.c_str(), indexPath.c_str()) != 0) {
+        folly::throwSystemError("failed to replace pack index ", indexPath);
+      }
+    } catch (const std::exception&) {
+      unlink(tmpPath.c_str());
+      throw;
+    }
+    state.index = std::move(newIndex);
+  }
+
+  /**
+   * Rewrite the index with room for at least entryCount entries, dropping its
+   * tombstones.
+   */
+  void resizeIndex(State& state, size_t entryCount) {
+    auto oldIndex = std::move(state.index);
+    writeIndex(state, indexCapacityFor(entryCount), [&](PackIndex& newIndex) {
+      auto mask = newIndex.size() - 1;
+      for (size_t i = 0; i < oldIndex->size(); ++i) {
+        const auto& slot = (*oldIndex)[i];
+        if (slot.segment == kEmptySlot || slot.segment == kTombstoneSlot) {
+          continue;
+        }
+        auto pos = slot.keyHash & mask;
+        while (newIndex[pos].segment != kEmptySlot) {
+          pos = (pos + 1) & mask;
+        }
+        newIndex[pos] = slot;
+        ++state.usedSlots;
+      }
+    });
+  }
+
+  /**
+   * Find the index slot holding key, if it is present.
+   */
+  std::optional<size_t>
+  findSlot(const State& state, ByteRange key, uint64_t hash) const {
+    const auto& index = *state.index;
+    auto mask = index.size() - 1;
+    auto pos = hash & mask;
+    for (size_t probes = 0; probes < index.size(); ++probes) {
+      const auto& slot = index[pos];
+      if (slot.segment == kEmptySlot) {
+        break;
+      }
+      if (slot.segment != kTombstoneSlot && slot.keyHash == hash) {
+        auto record = readSlot(state, slot);
+        if (record && record->second.key == key) {
+          return pos;
+        }
+      }
+      pos = (pos + 1) & mask;
+    }
+    return std::nullopt;
+  }
+
+  std::optional<std::pair<std::shared_ptr<PackSegment>, PackSegment::Record>>
+  readSlot(const State& state, const PackIndexSlot& slot) const {
+    auto it = state.segments.find(slot.segment);
+    if (it == state.segments.end()) {
+      return std::nullopt;
+    }
+    auto record = it->second->read(slot.offset);
+    if (!record) {
+      return std::nullopt;
+    }
+    return std::make_pair(it->second, *record);
+  }
+
+  StoreResult lookup(const State& state, ByteRange key) const {
+    auto pos = findSlot(state, key, hashKey(key));
+    if (!pos) {
+      return StoreResult();
+    }
+    auto record = readSlot(state, (*state.index)[*pos]);
+    auto value = record->second.value;
+    if (value.empty()) {
+      return StoreResult(string{});
+    }
+    return StoreResult(PackSegment::wrap(std::move(record->first), value));
+  }
+
+  void insert(State& state, ByteRange key, ByteRange value) {
+    if (key.size() > std::numeric_limits<uint16_t>::max() ||
+        value.size() > std::numeric_limits<uint32_t>::max()) {
+      throw std::length_error(folly::to<string>(
+          "value of ",
+          value.size(),
+          " bytes is too large for pack segments in ",
+          dir_));
+    }
+
+    auto hash = hashKey(key);
+    auto existing = findSlot(state, key, hash);
+    if (existing) {
+      // Keys are almost always content hashes, so the value is usually
+      // unchanged and there is nothing to do.
+      auto record = readSlot(state, (*state.index)[*existing]);
+      if (record && record->second.value == value) {
+        return;
+      }
+    }
+
+    auto length = recordLength(key, value);
+    if (!state.active || !state.active->hasRoom(length)) {
+      startSegment(state, length);
+    }
+    auto offset = state.active->append(key, value);
+    if (existing) {
+      replaceSlot(state, *existing, state.active.get(), offset, length);
+    } else {
+      addSlot(state, hash, state.active.get(), offset, length);
+    }
+  }
+
+  void startSegment(State& state, size_t minRecordLength) {
+    if (state.active) {
+      state.active->seal();
+    }
+    auto id = state.nextSegmentId++;
+    auto capacity = std::max<uint64_t>(
+        segmentSize_, sizeof(SegmentHeader) + minRecordLength);
+    state.active = PackSegment::create(dir_, id, capacity);
+    state.segments.emplace(id, state.active);
+  }
+
+  void addSlot(
+      State& state,
+      uint64_t hash,
+      PackSegment* segment,
+      uint64_t offset,
+      size_t length) {
+    // Keep the load factor, including tombstones, under 70%.
+    if ((state.usedSlots + state.tombstones + 1) * 10 >
+        state.index->size() * 7) {
+      resizeIndex(state, state.usedSlots + 1);
+    }
+
+    auto& index = *state.index;
+    auto mask = index.size() - 1;
+    auto pos = hash & mask;
+    while (index[pos].segment != kEmptySlot &&
+           index[pos].segment != kTombstoneSlot) {
+      pos = (pos + 1) & mask;
+    }
+    if (index[pos].segment == kTombstoneSlot) {
+      --state.tombstones;
+    }
+    index[pos] = PackIndexSlot{
+        hash, offset, segment->id(), static_cast<uint32_t>(length)};
+    segment->addLiveBytes(length);
+    ++state.usedSlots;
+  }
+
+  void replaceSlot(
+      State& state,
+      size_t pos,
+      PackSegment* segment,
+      uint64_t offset,
+      size_t length) {
+    auto& slot = (*state.index)[pos];
+    auto it = state.segments.find(slot.segment);
+    if (it != state.segments.end()) {
+      it->second->removeLiveBytes(slot.length);
+    }
+    slot.segment = segment->id();
+    slot.offset = offset;
+    slot.length = static_cast<uint32_t>(length);
+    segment->addLiveBytes(length);
+  }
+
+  void compact(State& state) {
+    // Rewrite sealed segments that are less than half live.  This is rare in
+    // practice, since content-addressed records are never replaced.
+    std::vector<std::shared_ptr<PackSegment>> sparse;
+    for (const auto& entry : state.segments) {
+      const auto& segment = entry.second;
+      if (segment != state.active &&
+          segment->liveBytes() * 2 < segment->end() - sizeof(SegmentHeader)) {
+        sparse.push_back(segment);
+      }
+    }
+
+    auto& index = *state.index;
+    for (const auto& segment : sparse) {
+      for (size_t i = 0; i < index.size(); ++i) {
+        auto& slot = index[i];
+        if (slot.segment != segment->id()) {
+          continue;
+        }
+        auto record = segment->read(slot.offset);
+        if (!record) {
+          slot.segment = kTombstoneSlot;
+          --state.usedSlots;
+          ++state.tombstones;
+          continue;
+        }
+        if (!state.active || !state.active->hasRoom(slot.length)) {
+          startSegment(state, slot.length);
+        }
+        auto offset = state.active->append(record->key, record->value);
+        replaceSlot(state, i, state.active.get(), offset, slot.length);
+      }
+      state.segments.erase(segment->id());
+      segment->remove();
+    }
+
+    if (state.tombstones > 0) {
+      resizeIndex(state, state.usedSlots);
+    }
+  }
+
+  uint64_t getSize(const State& state) const {
+    uint64_t size = 0;
+    for (const auto& entry : state.segments) {
+      size += entry.second->end();
+    }
+    return size;
+  }
+
+  const AbsolutePath dir_;
+  const uint64_t segmentSize_;
+  folly::Synchronized<State, folly::SharedMutex> state_;
+};
+
+/**
+ * Sends writes to packed key spaces to their PackedKeySpace, and all others
+ * to a WriteBatch of the delegate store.
+ */
+class PackFileWriteBatch : public LocalStore::WriteBatch {
+ public:
+  PackFileWriteBatch(PackFileLocalStore* store, size_t bufSize)
+      : store_(store),
+        bufSize_(bufSize),
+        delegateBatch_(store->delegate_->beginWrite(bufSize)) {}
+
+  void put(LocalStore::KeySpace keySpace, ByteRange key, ByteRange value)
+      override {
+    if (!store_->isPacked(keySpace)) {
+      delegateBatch_->put(keySpace, key, value);
+      return;
+    }
+    pending_[keySpace].emplace_back(
+        StringPiece{key}.str(), StringPiece{value}.str());
+    pendingBytes_ += key.size() + value.size();
+    if (bufSize_ > 0 && pendingBytes_ >= bufSize_) {
+      flushPacked();
+    }
+  }
+
+  void put(
+      LocalStore::KeySpace keySpace,
+      ByteRange key,
+      std::vector<ByteRange> valueSlices) override {
+    if (!store_->isPacked(keySpace)) {
+      delegateBatch_->put(keySpace, key, std::move(valueSlices));
+      return;
+    }
+    string value;
+    for (const auto& slice : valueSlices) {
+      value.append(reinterpret_cast<const char*>(slice.data()), slice.size());
+    }
+    put(keySpace, key, StringPiece{value});
+  }
+
+  void flush() override {
+    flushPacked();
+    delegateBatch_->flush();
+  }
+
+ private:
+  void flushPacked() {
+    for (size_t keySpace = 0; keySpace < pending_.size(); ++keySpace) {
+      if (!pending_[keySpace].empty()) {
+        store_->packed_[keySpace]->putBatch(pending_[keySpace]);
+        pending_[keySpace].clear();
+      }
+    }
+    pendingBytes_ = 0;
+  }
+
+  PackFileLocalStore* store_;
+  size_t bufSize_;
+  std::unique_ptr<LocalStore::WriteBatch> delegateBatch_;
+  std::array<std::vector<std::pair<string, string>>, LocalStore::KeySpace::End>
+      pending_;
+  size_t pendingBytes_{0};
+};
+
+PackFileLocalStore::PackFileLocalStore(
+    AbsolutePathPiece path,
+    std::shared_ptr<LocalStore> delegate,
+    const std::vector<KeySpace>& packedKeySpaces,
+    uint64_t segmentSize)
+    : delegate_(std::move(delegate)) {
+  ensureDirectoryExists(path);
+  for (auto keySpace : packedKeySpaces) {
+    if (keySpace == KeySpace::AccessTimeFamily) {
+      throw std::invalid_argument(
+          "the accesstime key space cannot be stored in pack files");
+    }
+    if (!packed_[keySpace]) {
+      packed_[keySpace] = std::make_unique<PackedKeySpace>(
+          path + PathComponentPiece{kKeySpaceRecords[keySpace].name},
+          segmentSize);
+    }
+  }
+}
+
+PackFileLocalStore::~PackFileLocalStore() {}
+
+void PackFileLocalStore::close() {
+  delegate_->close();
+}
+
+void PackFileLocalStore::clearKeySpace(KeySpace keySpace) {
+  if (isPacked(keySpace)) {
+    packed_[keySpace]->clear();
+  } else {
+    delegate_->clearKeySpace(keySpace);
+  }
+}
+
+void PackFileLocalStore::compactKeySpace(KeySpace keySpace) {
+  if (isPacked(keySpace)) {
+    packed_[keySpace]->compact();
+  } else {
+    delegate_->compactKeySpace(keySpace);
+  }
+}
+
+StoreResult PackFileLocalStore::get(KeySpace keySpace, ByteRange key) const {
+  if (isPacked(keySpace)) {
+    return packed_[keySpace]->get(key);
+  }
+  return delegate_->get(keySpace, key);
+}
+
+folly::Future<StoreResult> PackFileLocalStore::getFuture(
+    KeySpace keySpace,
+    ByteRange key) const {
+  if (isPacked(keySpace)) {
+    // Lookups only touch memory-mapped files, so there is no need to move
+    // them to another thread.
+    return folly::makeFutureWith(
+        [&] { return packed_[keySpace]->get(key); });
+  }
+  return delegate_->getFuture(keySpace, key);
+}
+
+folly::Future<std::vector<StoreResult>> PackFileLocalStore::getBatch(
+    KeySpace keySpace,
+    const std::vector<ByteRange>& keys) const {
+  if (isPacked(keySpace)) {
+    return folly::makeFutureWith(
+        [&] { return packed_[keySpace]->getBatch(keys); });
+  }
+  return delegate_->getBatch(keySpace, keys);
+}
+
+bool PackFileLocalStore::hasKey(KeySpace keySpace, ByteRange key) const {
+  if (isPacked(keySpace)) {
+    return packed_[keySpace]->hasKey(key);
+  }
+  return delegate_->hasKey(keySpace, key);
+}
+
+void PackFileLocalStore::put(
+    KeySpace keySpace,
+    ByteRange key,
+    ByteRange value) {
+  if (isPacked(keySpace)) {
+    packed_[keySpace]->put(key, value);
+  } else {
+    delegate_->put(keySpace, key, value);
+  }
+}
+
+std::unique_ptr<LocalStore::WriteBatch> PackFileLocalStore::beginWrite(
+    size_t bufSize) {
+  return std::make_unique<PackFileWriteBatch>(this, bufSize);
+}
+
+uint64_t PackFileLocalStore::getPackedSize(KeySpace keySpace) const {
+  if (!isPacked(keySpace)) {
+    return 0;
+  }
+  return packed_[keySpace]->getSize();
+}
+
+LocalStore::KeySpaceGCResult PackFileLocalStore::garbageCollectKeySpace(
+    KeySpace keySpace,
+    uint64_t sizeLimit) {
+  if (isPacked(keySpace)) {
+    return packed_[keySpace]->garbageCollect(sizeLimit);
+  }
+  return garbageCollectDelegate(*delegate_, keySpace, sizeLimit);
+}
+
+std::vector<LocalStore::KeySpace> PackFileLocalStore::parseKeySpaces(
+    StringPiece names) {
+  std::vector<StringPiece> parts;
+  folly::split(',', names, parts, /*ignoreEmpty=*/true);
+
+  std::vector<KeySpace> keySpaces;
+  for (auto part : parts) {
+    auto name = folly::trimWhitespace(part);
+    auto it = std::find_if(
+        kKeySpaceRecords.begin(),
+        kKeySpaceRecords.end(),
+        [&](const KeySpaceRecord& record) { return record.name == name; });
+    if (it == kKeySpaceRecords.end()) {
+      throw std::invalid_argument(
+          folly::to<string>("unknown key space \"", name, "\""));
+    }
+    keySpaces.push_back(it->keySpace);
+  }
+  return keySpaces;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,118 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "eden/fs/store/LocalStore.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+class PackedKeySpace;
+
+/**
+ * An implementation of LocalStore that appends the values of selected key
+ * spaces to large, append-only segment files, and forwards every other key
+ * space to a delegate LocalStore.
+ *
+ * Each packed key space lives in its own directory, holding:
+ * - A sequence of segment files.  Records are only ever appended to the
+ *   newest segment; older segments are never modified.
+ * - An index mapping each key to the segment and offset of its record.  The
+ *   index is an open-addressing hash table stored in a MappedDiskVector, so it
+ *   is persisted without any explicit serialization.  If the index is lost or
+ *   cannot be read it is rebuilt by scanning the segments.
+ *
+ * Segments are memory-mapped, and values are returned as IOBufs pointing
+ * directly into the mapping, so reading a blob does not copy it.  Each such
+ * IOBuf keeps its segment mapped until it is destroyed, even if the segment
+ * has since been garbage collected.
+ *
+ * Rather than evicting individual entries, garbage collection drops whole
+ * segments, oldest first.  Since blobs and trees are content-addressed and
+ * never rewritten, this is a FIFO cache with almost no per-entry bookkeeping.
+ *
+ * PackFileLocalStore is thread safe.  Reads of a packed key space run
+ * concurrently with each other; writes are serialized.
+ */
+class PackFileLocalStore : public LocalStore {
+ public:
+  static constexpr uint64_t kDefaultSegmentSize = 256 * 1024 * 1024;
+
+  /**
+   * Store the key spaces in packedKeySpaces in subdirectories of path, and
+   * all of the others in delegate.
+   *
+   * New segments are created once the current one reaches segmentSize bytes.
+   */
+  PackFileLocalStore(
+      AbsolutePathPiece path,
+      std::shared_ptr<LocalStore> delegate,
+      const std::vector<KeySpace>& packedKeySpaces,
+      uint64_t segmentSize = kDefaultSegmentSize);
+  ~PackFileLocalStore() override;
+
+  void close() override;
+  void clearKeySpace(KeySpace keySpace) override;
+  void compactKeySpace(KeySpace keySpace) override;
+  StoreResult get(LocalStore::KeySpace keySpace, folly::ByteRange key)
+      const override;
+  FOLLY_NODISCARD folly::Future<StoreResult> getFuture(
+      KeySpace keySpace,
+      folly::ByteRange key) const override;
+  FOLLY_NODISCARD folly::Future<std::vector<StoreResult>> getBatch(
+      KeySpace keySpace,
+      const std::vector<folly::ByteRange>& keys) const override;
+  bool hasKey(LocalStore::KeySpace keySpace, folly::ByteRange key)
+      const override;
+  void put(
+      LocalStore::KeySpace keySpace,
+      folly::ByteRange key,
+      folly::ByteRange value) override;
+  std::unique_ptr<WriteBatch> beginWrite(size_t bufSize = 0) override;
+
+  /**
+   * Returns true if keySpace is stored in segment files rather than in the
+   * delegate store.
+   */
+  bool isPacked(KeySpace keySpace) const {
+    return packed_[keySpace] != nullptr;
+  }
+
+  /**
+   * Get the number of bytes stored in the segments of a packed key space.
+   */
+  uint64_t getPackedSize(KeySpace keySpace) const;
+
+  /**
+   * Parse a comma-separated list of key space names, as they appear in
+   * kKeySpaceRecords.
+   *
+   * Throws std::invalid_argument if a name is not recognized.
+   */
+  static std::vector<KeySpace> parseKeySpaces(folly::StringPiece names);
+
+ protected:
+  KeySpaceGCResult garbageCollectKeySpace(KeySpace keySpace, uint64_t sizeLimit)
+      override;
+
+ private:
+  friend class PackFileWriteBatch;
+
+  std::shared_ptr<LocalStore> delegate_;
+  std::array<std::unique_ptr<PackedKeySpace>, KeySpace::End> packed_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -10,6 +10,9 @@
 #include "eden/fs/store/RocksDbLocalStore.h"
 
 #include <array>
+#include <iterator>
+#include <map>
+#include <optional>
 
 #include <folly/Format.h>
 #include <folly/String.h>
@@ -113,6 +116,57 @@ rocksdb::Slice _createSlice(folly::ByteRange bytes) {
   return Slice(reinterpret_cast<const char*>(bytes.data()), bytes.size());
 }
 
+/**
+ * AccessTimeFamily keys are the KeySpace followed by the entry's key, so
+ * that the entries of one KeySpace are contiguous.
+ */
+std::string makeAccessKey(LocalStore::KeySpace keySpace, ByteRange key) {
+  std::string accessKey;
+  accessKey.reserve(key.size() + 1);
+  accessKey.push_back(static_cast<char>(keySpace));
+  accessKey.append(reinterpret_cast<const char*>(key.data()), key.size());
+  return accessKey;
+}
+
+/**
+ * AccessTimeFamily values are the access time interval and the size of the
+ * entry's value, as little-endian 64-bit integers.
+ */
+struct AccessRecord {
+  uint64_t interval;
+  uint64_t valueSize;
+};
+constexpr size_t kAccessRecordSize = 2 * sizeof(uint64_t);
+
+std::string serializeAccessRecord(uint64_t interval, uint64_t valueSize) {
+  std::string value(kAccessRecordSize, '\0');
+  folly::storeUnaligned(&value[0], folly::Endian::little(interval));
+  folly::storeUnaligned(
+      &value[sizeof(uint64_t)], folly::Endian::little(valueSize));
+  return value;
+}
+
+std::optional<AccessRecord> parseAccessRecord(Slice value) {
+  if (value.size() != kAccessRecordSize) {
+    return std::nullopt;
+  }
+  return AccessRecord{
+      folly::Endian::little(folly::loadUnaligned<uint64_t>(value.data())),
+      folly::Endian::little(
+          folly::loadUnaligned<uint64_t>(value.data() + sizeof(uint64_t)))};
+}
+
+/**
+ * The number of entries to evict per RocksDB write during garbage
+ * collection.
+ */
+constexpr size_t kEvictionBatchSize = 4096;
+
+} // namespace
+
+namespace facebook {
+namespace eden {
+
 class RocksDbWriteBatch : public LocalStore::WriteBatch {
  public:
   void put(
@@ -126,10 +180,14 @@ class RocksDbWriteBatch : public LocalStore::WriteBatch {
   void flush() override;
   ~RocksDbWriteBatch() override;
   // Use LocalStore::beginWrite() to create a write batch
-  RocksDbWriteBatch(RocksHandles& dbHandles, size_t bufferSize);
+  RocksDbWriteBatch(
+      RocksDbLocalStore& store,
+      RocksHandles& dbHandles,
+      size_t bufferSize);
 
   void flushIfNeeded();
 
+  RocksDbLocalStore& store_;
   RocksHandles& dbHandles_;
   rocksdb::WriteBatch writeBatch_;
   size_t bufSize_;
@@ -163,8 +221,12 @@ void RocksDbWriteBatch::flushIfNeeded() {
   }
 }
 
-RocksDbWriteBatch::RocksDbWriteBatch(RocksHandles& dbHandles, size_t bufSize)
+RocksDbWriteBatch::RocksDbWriteBatch(
+    RocksDbLocalStore& store,
+    RocksHandles& dbHandles,
+    size_t bufSize)
     : LocalStore::WriteBatch(),
+      store_(store),
       dbHandles_(dbHandles),
       writeBatch_(bufSize),
       bufSize_(bufSize) {}
@@ -184,6 +246,7 @@ void RocksDbWriteBatch::put(
       dbHandles_.columns[keySpace].get(),
       _createSlice(key),
       _createSlice(value));
+  store_.recordWrite(writeBatch_, keySpace, key, value.size());
 
   flushIfNeeded();
 }
@@ -193,9 +256,11 @@ void RocksDbWriteBatch::put(
     folly::ByteRange key,
     std::vector<folly::ByteRange> valueSlices) {
   std::vector<Slice> slices;
+  size_t valueSize = 0;
 
   for (auto& valueSlice : valueSlices) {
     slices.emplace_back(_createSlice(valueSlice));
+    valueSize += valueSlice.size();
   }
 
   auto keySlice = _createSlice(key);
@@ -204,10 +269,16 @@ void RocksDbWriteBatch::put(
       dbHandles_.columns[keySpace].get(),
       keyParts,
       SliceParts(slices.data(), slices.size()));
+  store_.recordWrite(writeBatch_, keySpace, key, valueSize);
 
   flushIfNeeded();
 }
 
+} // namespace eden
+} // namespace facebook
+
+namespace {
+
 rocksdb::Options getRocksdbOptions() {
   rocksdb::Options options;
   // Optimize RocksDB. This is the easiest way to get RocksDB to perform well.
@@ -249,12 +320,15 @@ namespace eden {
 RocksDbLocalStore::RocksDbLocalStore(
     AbsolutePathPiece pathToRocksDb,
     FaultInjector* faultInjector,
-    RocksDBOpenMode mode)
+    RocksDBOpenMode mode,
+    std::shared_ptr<Clock> clock)
     : faultInjector_(*faultInjector),
+      clock_(std::move(clock)),
       dbHandles_(openDB(pathToRocksDb, mode)),
       ioPool_(12, "RocksLocalStore") {}
 
 RocksDbLocalStore::~RocksDbLocalStore() {
+  flushAccessTimes();
 #ifdef FOLLY_SANITIZE_ADDRESS
   // RocksDB has some race conditions around setting up and tearing down
   // the threads that it uses to maintain the database.  This manifests
@@ -270,6 +344,7 @@ RocksDbLocalStore::~RocksDbLocalStore() {
 }
 
 void RocksDbLocalStore::close() {
+  flushAccessTimes();
   dbHandles_.close();
 }
 
@@ -365,6 +440,7 @@ StoreResult RocksDbLocalStore::get(LocalStore::KeySpace keySpace, ByteRange key)
     throw RocksException::build(
         status, "failed to get ", folly::hexlify(key), " from local store");
   }
+  recordRead(keySpace, key, value.size());
   return StoreResult(std::move(value));
 }
 
@@ -447,6 +523,10 @@ RocksDbLocalStore::getBatch(
                           folly::hexlify(keys->at(i)),
                           " from local store");
                     }
+                    recordRead(
+                        keySpace,
+                        folly::ByteRange{StringPiece{keys->at(i)}},
+                        values[i].size());
                     results.emplace_back(std::move(values[i]));
                   }
                   return results;
@@ -493,18 +573,20 @@ bool RocksDbLocalStore::hasKey(
 
 std::unique_ptr<LocalStore::WriteBatch> RocksDbLocalStore::beginWrite(
     size_t bufSize) {
-  return std::make_unique<RocksDbWriteBatch>(dbHandles_, bufSize);
+  return std::make_unique<RocksDbWriteBatch>(*this, dbHandles_, bufSize);
 }
 
 void RocksDbLocalStore::put(
     LocalStore::KeySpace keySpace,
     folly::ByteRange key,
     folly::ByteRange value) {
-  dbHandles_.db->Put(
-      WriteOptions(),
+  rocksdb::WriteBatch batch;
+  batch.Put(
       dbHandles_.columns[keySpace].get(),
       _createSlice(key),
       _createSlice(value));
+  recordWrite(batch, keySpace, key, value.size());
+  dbHandles_.db->Write(WriteOptions(), &batch);
 }
 
 uint64_t RocksDbLocalStore::getApproximateSize(
@@ -552,5 +634,223 @@ uint64_t RocksDbLocalStore::getApproximateSize(
   return size;
 }
 
+uint64_t RocksDbLocalStore::getAccessInterval() const {
+  return clock_->getRealtime().tv_sec / kAccessTimeGranularity.count();
+}
+
+bool RocksDbLocalStore::markAccessed(
+    const std::string& accessKey,
+    uint64_t interval) const {
+  // Zero marks an empty slot.
+  auto fingerprint = std::hash<std::string>{}(accessKey) | 1;
+  auto index = fingerprint % kAccessShardCount;
+  auto slot = (fingerprint / kAccessShardCount) % kAccessSlotsPerShard;
+  auto shard = accessShards_[index].wlock();
+  if (shard->interval != interval) {
+    shard->interval = interval;
+    shard->fingerprints.fill(0);
+  }
+  if (shard->fingerprints[slot] == fingerprint) {
+    return false;
+  }
+  shard->fingerprints[slot] = fingerprint;
+  return true;
+}
+
+void RocksDbLocalStore::recordRead(
+    KeySpace keySpace,
+    folly::ByteRange key,
+    size_t valueSize) const {
+  if (!isGarbageCollected(keySpace)) {
+    return;
+  }
+  auto interval = getAccessInterval();
+  auto accessKey = makeAccessKey(keySpace, key);
+  if (!markAccessed(accessKey, interval)) {
+    return;
+  }
+
+  // Don't write to RocksDB on the read path.  Reads that arrive while a flush
+  // is waiting on ioPool_ are written along with it.
+  bool scheduleFlush;
+  {
+    auto pending = pendingAccessTimes_.wlock();
+    pending->batch.Put(
+        dbHandles_.columns[KeySpace::AccessTimeFamily].get(),
+        accessKey,
+        serializeAccessRecord(interval, valueSize));
+    scheduleFlush = !pending->flushScheduled;
+    pending->flushScheduled = true;
+  }
+  if (scheduleFlush) {
+    ioPool_.add([this] { flushAccessTimes(); });
+  }
+}
+
+void RocksDbLocalStore::flushAccessTimes() const {
+  std::lock_guard<std::mutex> flushLock{accessFlushMutex_};
+  rocksdb::WriteBatch batch;
+  {
+    auto pending = pendingAccessTimes_.wlock();
+    std::swap(batch, pending->batch);
+    pending->flushScheduled = false;
+  }
+  if (batch.Count() == 0 || !dbHandles_.db) {
+    return;
+  }
+
+  // Losing a few access times in a crash only makes the garbage collector
+  // slightly less accurate, so skip the write-ahead log.
+  WriteOptions options;
+  options.disableWAL = true;
+  auto status = dbHandles_.db->Write(options, &batch);
+  if (!status.ok()) {
+    XLOG(WARN) << "failed to record " << batch.Count()
+               << " access times: " << status.ToString();
+  }
+}
+
+void RocksDbLocalStore::recordWrite(
+    rocksdb::WriteBatch& batch,
+    KeySpace keySpace,
+    folly::ByteRange key,
+    size_t valueSize) {
+  if (!isGarbageCollected(keySpace)) {
+    return;
+  }
+  auto interval = getAccessInterval();
+  auto accessKey = makeAccessKey(keySpace, key);
+  batch.Put(
+      dbHandles_.columns[KeySpace::AccessTimeFamily].get(),
+      accessKey,
+      serializeAccessRecord(interval, valueSize));
+  markAccessed(accessKey, interval);
+}
+
+LocalStore::KeySpaceGCResult RocksDbLocalStore::garbageCollectKeySpace(
+    KeySpace keySpace,
+    uint64_t sizeLimit) {
+  KeySpaceGCResult result;
+  result.sizeBefore = getApproximateSize(keySpace);
+  result.sizeAfter = result.sizeBefore;
+  if (sizeLimit == 0 || result.sizeBefore <= sizeLimit) {
+    return result;
+  }
+
+  // Aim somewhat below the limit, so that the next collection does not have
+  // to run again as soon as a little more data is written.
+  auto target = sizeLimit - sizeLimit / 10;
+  auto excess = result.sizeBefore - target;
+
+  auto dataColumn = dbHandles_.columns[keySpace].get();
+  auto accessColumn = dbHandles_.columns[KeySpace::AccessTimeFamily].get();
+  auto prefix = makeAccessKey(keySpace, ByteRange{});
+  ReadOptions readOptions;
+  // Our column families are optimized for point lookups, so iterating over
+  // them in key order has to be requested explicitly.
+  readOptions.total_order_seek = true;
+
+  // Include the access times of recent reads.
+  flushAccessTimes();
+
+  // Scan the access times once, keeping the least recently accessed entries
+  // until they add up to the excess.  Value sizes are only an approximation
+  // of the space the entries use on disk.
+  struct Candidate {
+    std::string key;
+    uint64_t valueSize;
+  };
+  struct IntervalCandidates {
+    uint64_t bytes{0};
+    std::vector<Candidate> entries;
+  };
+  std::map<uint64_t, IntervalCandidates> candidates;
+  uint64_t candidateBytes = 0;
+  uint64_t trackedBytes = 0;
+  {
+    unique_ptr<rocksdb::Iterator> it{
+        dbHandles_.db->NewIterator(readOptions, accessColumn)};
+    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
+         it->Next()) {
+      auto record = parseAccessRecord(it->value());
+      if (!record) {
+        continue;
+      }
+      trackedBytes += record->valueSize;
+      if (candidateBytes >= excess &&
+          record->interval > candidates.rbegin()->first) {
+        continue;
+      }
+
+      auto key = it->key();
+      key.remove_prefix(prefix.size());
+      auto& interval = candidates[record->interval];
+      interval.bytes += record->valueSize;
+      interval.entries.push_back(Candidate{key.ToString(), record->valueSize});
+      candidateBytes += record->valueSize;
+
+      // Drop the most recent interval once the older ones cover the excess.
+      while (candidates.size() > 1 &&
+             candidateBytes - candidates.rbegin()->second.bytes >= excess) {
+        candidateBytes -= candidates.rbegin()->second.bytes;
+        candidates.erase(std::prev(candidates.end()));
+      }
+    }
+    RocksException::check(
+        it->status(), "error reading access times for ", dataColumn->GetName());
+  }
+
+  if (trackedBytes < excess) {
+    // Most of the data was written before access times were recorded, so
+    // there is no way to tell which of it is old.  Fall back to dropping the
+    // whole KeySpace, as clearCaches() does.
+    XLOG(WARN) << "only " << trackedBytes << " of " << result.sizeBefore
+               << " bytes in " << dataColumn->GetName()
+               << " have a recorded access time; clearing it";
+    clearKeySpace(keySpace);
+    auto end = makeAccessKey(static_cast<KeySpace>(keySpace + 1), ByteRange{});
+    RocksException::check(
+        dbHandles_.db->DeleteRange(WriteOptions(), accessColumn, prefix, end),
+        "error deleting access times for ",
+        dataColumn->GetName());
+    result.cleared = true;
+  } else {
+    // Evict the candidates oldest first: every interval before the last one
+    // entirely, and as much of the last one as is still needed.
+    rocksdb::WriteBatch batch;
+    auto writeBatch = [&] {
+      RocksException::check(
+          dbHandles_.db->Write(WriteOptions(), &batch),
+          "error evicting entries from ",
+          dataColumn->GetName());
+      batch.Clear();
+    };
+
+    uint64_t evictedBytes = 0;
+    for (const auto& interval : candidates) {
+      for (const auto& candidate : interval.second.entries) {
+        if (evictedBytes >= excess) {
+          break;
+        }
+        batch.Delete(accessColumn, prefix + candidate.key);
+        batch.Delete(dataColumn, candidate.key);
+        evictedBytes += candidate.valueSize;
+        ++result.entriesEvicted;
+        if (result.entriesEvicted % kEvictionBatchSize == 0) {
+          writeBatch();
+        }
+      }
+    }
+    writeBatch();
+  }
+
+  // Deleting entries only writes tombstones; compaction reclaims the space.
+  auto compactionStart = std::chrono::steady_clock::now();
+  compactKeySpace(keySpace);
+  result.compactionTime = std::chrono::steady_clock::now() - compactionStart;
+  result.sizeAfter = getApproximateSize(keySpace);
+  return result;
+}
+
 } // namespace eden
 } // namespace facebook
@@ -9,15 +9,21 @@
  */
 #pragma once
 #include <folly/CppAttributes.h>
+#include <folly/Synchronized.h>
+#include <rocksdb/write_batch.h>
+#include <array>
+#include <mutex>
 
 #include "eden/fs/rocksdb/RocksHandles.h"
 #include "eden/fs/store/LocalStore.h"
+#include "eden/fs/utils/Clock.h"
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
 
 namespace facebook {
 namespace eden {
 
 class FaultInjector;
+class RocksDbWriteBatch;
 
 /** An implementation of LocalStore that uses RocksDB for the underlying
  * storage.
@@ -27,11 +33,15 @@ class RocksDbLocalStore : public LocalStore {
   /**
    * The given FaultInjector must be valid during the lifetime of this
    * RocksDbLocalStore object.
+   *
+   * clock is used to record when entries are accessed, for garbage
+   * collection.
    */
   explicit RocksDbLocalStore(
       AbsolutePathPiece pathToRocksDb,
       FaultInjector* FOLLY_NONNULL faultInjector,
-      RocksDBOpenMode mode = RocksDBOpenMode::ReadWrite);
+      RocksDBOpenMode mode = RocksDBOpenMode::ReadWrite,
+      std::shared_ptr<Clock> clock = std::make_shared<UnixClock>());
   ~RocksDbLocalStore();
   void close() override;
   void clearKeySpace(KeySpace keySpace) override;
@@ -59,9 +69,86 @@ class RocksDbLocalStore : public LocalStore {
   // specified key space.
   uint64_t getApproximateSize(KeySpace keySpace) const;
 
+  /**
+   * Entries' access times are recorded with this granularity.  An entry that
+   * is read many times within one interval only has its access time written
+   * once.
+   */
+  static constexpr std::chrono::seconds kAccessTimeGranularity{3600};
+
+ protected:
+  KeySpaceGCResult garbageCollectKeySpace(KeySpace keySpace, uint64_t sizeLimit)
+      override;
+
  private:
+  friend class RocksDbWriteBatch;
+
+  static constexpr size_t kAccessShardCount = 16;
+  static constexpr size_t kAccessSlotsPerShard = 8192;
+
+  /**
+   * Fingerprints of the keys whose access time has been recorded during the
+   * current access time interval, sharded to reduce lock contention.
+   *
+   * Each key maps to a single slot, so the memory used is fixed.  A key is
+   * forgotten when another key takes its slot, which only costs an extra
+   * access time write.
+   */
+  struct AccessShard {
+    uint64_t interval{0};
+    std::array<uint64_t, kAccessSlotsPerShard> fingerprints{};
+  };
+
+  /**
+   * Access times recorded by reads, waiting to be written by
+   * flushAccessTimes().
+   */
+  struct PendingAccessTimes {
+    rocksdb::WriteBatch batch;
+    bool flushScheduled{false};
+  };
+
+  uint64_t getAccessInterval() const;
+
+  /**
+   * Returns false if accessKey's access time was already recorded during
+   * interval.  May return true for a key that was recorded, but never
+   * returns false for one that was not.
+   */
+  bool markAccessed(const std::string& accessKey, uint64_t interval) const;
+
+  /**
+   * Write the access times recorded by reads since the last flush.
+   */
+  void flushAccessTimes() const;
+
+  /**
+   * Record that an entry of valueSize bytes was just read.  The access time
+   * is written later, on ioPool_.
+   */
+  void recordRead(KeySpace keySpace, folly::ByteRange key, size_t valueSize)
+      const;
+
+  /**
+   * Add a record that an entry of valueSize bytes was just written to batch.
+   */
+  void recordWrite(
+      rocksdb::WriteBatch& batch,
+      KeySpace keySpace,
+      folly::ByteRange key,
+      size_t valueSize);
+
   FaultInjector& faultInjector_;
+  std::shared_ptr<Clock> clock_;
   RocksHandles dbHandles_;
+  mutable std::array<folly::Synchronized<AccessShard>, kAccessShardCount>
+      accessShards_;
+  // Declared before ioPool_, so that they outlive a flushAccessTimes() call
+  // still queued on it during destruction.
+  mutable folly::Synchronized<PendingAccessTimes> pendingAccessTimes_;
+  // Held while writing access times, so that garbage collection can wait
+  // for a flush already in progress.
+  mutable std::mutex accessFlushMutex_;
   mutable UnboundedQueueExecutor ioPool_;
 };
 
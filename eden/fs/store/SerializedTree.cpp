@@ -0,0 +1,251 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/SerializedTree.h"
+
+#include <folly/Format.h>
+#include <folly/lang/Bits.h>
+#include <folly/logging/xlog.h>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/model/git/GitTree.h"
+
+using folly::ByteRange;
+using folly::IOBuf;
+using folly::StringPiece;
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr uint8_t kMarker = 0;
+constexpr size_t kHeaderSize = 8;
+constexpr size_t kOffsetSize = sizeof(uint32_t);
+// type, flags, name length, and hash
+constexpr size_t kRecordFixedSize = 4 + Hash::RAW_SIZE;
+
+constexpr uint8_t kHasSize = 0x01;
+constexpr uint8_t kHasContentSha1 = 0x02;
+
+template <typename T>
+T loadBigEndian(const uint8_t* data) {
+  return folly::Endian::big(folly::loadUnaligned<T>(data));
+}
+
+template <typename T>
+uint8_t* storeBigEndian(uint8_t* data, T value) {
+  folly::storeUnaligned(data, folly::Endian::big(value));
+  return data + sizeof(T);
+}
+
+uint8_t* storeBytes(uint8_t* data, ByteRange bytes) {
+  memcpy(data, bytes.data(), bytes.size());
+  return data + bytes.size();
+}
+
+size_t getRecordSize(uint8_t flags, size_t nameLength) {
+  return kRecordFixedSize + ((flags & kHasSize) ? sizeof(uint64_t) : 0) +
+      ((flags & kHasContentSha1) ? Hash::RAW_SIZE : 0) + nameLength;
+}
+
+size_t getNameOffset(uint8_t flags) {
+  return getRecordSize(flags, 0);
+}
+
+uint8_t getFlags(const TreeEntry& entry) {
+  return (entry.getSize() ? kHasSize : 0) |
+      (entry.getContentSha1() ? kHasContentSha1 : 0);
+}
+} // namespace
+
+SerializedTree::SerializedTree(ByteRange data) : data_(data) {
+  if (!isSerializedTree(data_) || data_.size() < kHeaderSize) {
+    throw std::invalid_argument("serialized tree has a truncated header");
+  }
+  if (data_[1] != kVersion) {
+    throw std::invalid_argument(folly::sformat(
+        "serialized tree has unsupported version {}",
+        static_cast<unsigned int>(data_[1])));
+  }
+  entryCount_ = loadBigEndian<uint32_t>(data_.data() + 4);
+
+  // Records are only checked when they are read, so that a lookup touches
+  // just the records its binary search visits.
+  recordsStart_ = kHeaderSize + uint64_t{entryCount_} * kOffsetSize;
+  if (recordsStart_ > data_.size()) {
+    throw std::invalid_argument(folly::sformat(
+        "serialized tree is too short for {} entries", entryCount_));
+  }
+}
+
+bool SerializedTree::isSerializedTree(ByteRange data) {
+  return !data.empty() && data[0] == kMarker;
+}
+
+IOBuf SerializedTree::serialize(const Tree& tree) {
+  const auto& entries = tree.getTreeEntries();
+  std::vector<size_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  auto byName = [&](size_t a, size_t b) {
+    return entries[a].getName() < entries[b].getName();
+  };
+  if (!std::is_sorted(order.begin(), order.end(), byName)) {
+    std::sort(order.begin(), order.end(), byName);
+  }
+
+  size_t totalSize = kHeaderSize + entries.size() * kOffsetSize;
+  for (const auto& entry : entries) {
+    auto nameLength = entry.getName().stringPiece().size();
+    if (nameLength > std::numeric_limits<uint16_t>::max()) {
+      throw std::invalid_argument(folly::sformat(
+          "tree entry name of {} bytes is too long to serialize", nameLength));
+    }
+    totalSize += getRecordSize(getFlags(entry), nameLength);
+  }
+  if (totalSize > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument(folly::sformat(
+        "tree of {} bytes is too large to serialize", totalSize));
+  }
+
+  IOBuf buf{IOBuf::CREATE, totalSize};
+  auto* data = buf.writableData();
+  buf.append(totalSize);
+
+  auto* header = data;
+  *header++ = kMarker;
+  *header++ = kVersion;
+  header = storeBigEndian<uint16_t>(header, 0);
+  storeBigEndian<uint32_t>(header, static_cast<uint32_t>(entries.size()));
+
+  auto* offsets = data + kHeaderSize;
+  auto* record = offsets + entries.size() * kOffsetSize;
+  for (auto index : order) {
+    const auto& entry = entries[index];
+    offsets = storeBigEndian<uint32_t>(
+        offsets, static_cast<uint32_t>(record - data));
+
+    auto flags = getFlags(entry);
+    auto name = entry.getName().stringPiece();
+    *record++ = static_cast<uint8_t>(entry.getType());
+    *record++ = flags;
+    record = storeBigEndian<uint16_t>(record, name.size());
+    record = storeBytes(record, entry.getHash().getBytes());
+    if (flags & kHasSize) {
+      record = storeBigEndian<uint64_t>(record, *entry.getSize());
+    }
+    if (flags & kHasContentSha1) {
+      record = storeBytes(record, entry.getContentSha1()->getBytes());
+    }
+    record = storeBytes(record, ByteRange{name});
+  }
+  XDCHECK_EQ(record, data + totalSize);
+  return buf;
+}
+
+ByteRange SerializedTree::getRecordAt(size_t index) const {
+  auto offset = loadBigEndian<uint32_t>(
+      data_.data() + kHeaderSize + index * kOffsetSize);
+  if (offset < recordsStart_ || offset + kRecordFixedSize > data_.size()) {
+    throw std::invalid_argument(folly::sformat(
+        "serialized tree entry {} has invalid offset {}", index, offset));
+  }
+  auto type = data_[offset];
+  auto flags = data_[offset + 1];
+  auto nameLength = loadBigEndian<uint16_t>(data_.data() + offset + 2);
+  auto recordSize = getRecordSize(flags, nameLength);
+  if (type > static_cast<uint8_t>(TreeEntryType::SYMLINK) ||
+      (flags & ~(kHasSize | kHasContentSha1)) != 0 || nameLength == 0 ||
+      offset + recordSize > data_.size()) {
+    throw std::invalid_argument(
+        folly::sformat("serialized tree entry {} is invalid", index));
+  }
+  return ByteRange{data_.data() + offset, recordSize};
+}
+
+StringPiece SerializedTree::getNameAt(size_t index) const {
+  auto record = getRecordAt(index);
+  record.advance(getNameOffset(record[1]));
+  return StringPiece{record};
+}
+
+TreeEntry SerializedTree::getEntryAt(size_t index) const {
+  auto record = getRecordAt(index);
+  auto type = static_cast<TreeEntryType>(record[0]);
+  auto flags = record[1];
+  record.advance(4);
+
+  Hash hash{ByteRange{record.data(), Hash::RAW_SIZE}};
+  record.advance(Hash::RAW_SIZE);
+
+  std::optional<uint64_t> size;
+  if (flags & kHasSize) {
+    size = loadBigEndian<uint64_t>(record.data());
+    record.advance(sizeof(uint64_t));
+  }
+  std::optional<Hash> contentSha1;
+  if (flags & kHasContentSha1) {
+    contentSha1 = Hash{ByteRange{record.data(), Hash::RAW_SIZE}};
+    record.advance(Hash::RAW_SIZE);
+  }
+  return TreeEntry{hash, StringPiece{record}, type, size, contentSha1};
+}
+
+std::optional<TreeEntry> SerializedTree::getEntry(
+    PathComponentPiece name) const {
+  size_t begin = 0;
+  size_t end = entryCount_;
+  while (begin < end) {
+    auto middle = begin + (end - begin) / 2;
+    if (getNameAt(middle) < name.stringPiece()) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  if (begin < entryCount_ && getNameAt(begin) == name.stringPiece()) {
+    return getEntryAt(begin);
+  }
+#ifdef _WIN32
+  // As in Tree::getEntryPtr(), fall back to a case insensitive search.
+  for (size_t index = 0; index < entryCount_; ++index) {
+    if (getNameAt(index).equals(
+            name.stringPiece(), folly::AsciiCaseInsensitive())) {
+      return getEntryAt(index);
+    }
+  }
+#endif
+  return std::nullopt;
+}
+
+std::unique_ptr<Tree> SerializedTree::toTree(const Hash& hash) const {
+  std::vector<TreeEntry> entries;
+  entries.reserve(entryCount_);
+  for (size_t index = 0; index < entryCount_; ++index) {
+    entries.push_back(getEntryAt(index));
+    if (index > 0 &&
+        !(entries[index - 1].getName() < entries[index].getName())) {
+      throw std::invalid_argument(folly::sformat(
+          "serialized tree entries are not sorted at entry {}", index));
+    }
+  }
+  return std::make_unique<Tree>(std::move(entries), hash);
+}
+
+std::unique_ptr<Tree> deserializeTree(const Hash& hash, ByteRange data) {
+  if (SerializedTree::isSerializedTree(data)) {
+    return SerializedTree{data}.toTree(hash);
+  }
+  return deserializeGitTree(hash, data);
+}
+
+} // namespace eden
+} // namespace facebook
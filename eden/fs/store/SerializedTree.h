@@ -0,0 +1,111 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+#include <memory>
+#include <optional>
+
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/TreeEntry.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+class Tree;
+
+/**
+ * A read-only view of a Tree stored in the LocalStore's binary tree format.
+ *
+ * Unlike git tree objects, this format can be searched without parsing it:
+ * entries are sorted by name and indexed by offset, so getEntry() is a binary
+ * search over the stored bytes that only materializes the TreeEntry it
+ * returns.  It also records each entry's size and content SHA-1 when they are
+ * known.
+ *
+ * The serialized data is stored as:
+ * - marker (1 byte, always 0, which never starts a git tree object)
+ * - version (1 byte)
+ * - reserved (2 bytes)
+ * - entry count (4 bytes, big endian)
+ * - entry offsets, relative to the start of the data, in name order
+ *   (4 bytes each, big endian)
+ * - entries, each made up of:
+ *   - type (1 byte)
+ *   - flags (1 byte): whether the size and content SHA-1 are present
+ *   - name length (2 bytes, big endian)
+ *   - hash (20 bytes)
+ *   - size (8 bytes, big endian), if present
+ *   - content SHA-1 (20 bytes), if present
+ *   - name
+ *
+ * SerializedTree does not own the data it views; the caller must keep it
+ * alive.
+ */
+class SerializedTree {
+ public:
+  static constexpr uint8_t kVersion = 1;
+
+  /**
+   * Construct a view of data.
+   *
+   * Throws std::invalid_argument if data does not start with a valid header.
+   * Each record is checked when it is read, so the other methods can throw
+   * std::invalid_argument too.
+   */
+  explicit SerializedTree(folly::ByteRange data);
+
+  /**
+   * Returns true if data is in this format, or false if it is presumably a
+   * git tree object.
+   */
+  static bool isSerializedTree(folly::ByteRange data);
+
+  /**
+   * Serialize tree's entries.  Entries are sorted by name even if the tree's
+   * entries are not.
+   */
+  static folly::IOBuf serialize(const Tree& tree);
+
+  size_t size() const {
+    return entryCount_;
+  }
+
+  folly::StringPiece getNameAt(size_t index) const;
+  TreeEntry getEntryAt(size_t index) const;
+
+  /**
+   * Find the entry with the given name, or std::nullopt if there is none.
+   */
+  std::optional<TreeEntry> getEntry(PathComponentPiece name) const;
+
+  /**
+   * Materialize a Tree with every entry.
+   */
+  std::unique_ptr<Tree> toTree(const Hash& hash) const;
+
+ private:
+  folly::ByteRange getRecordAt(size_t index) const;
+
+  folly::ByteRange data_;
+  uint32_t entryCount_;
+  uint64_t recordsStart_;
+};
+
+/**
+ * Create a Tree from data in either the binary tree format or the git tree
+ * format, which older versions of Eden stored in the LocalStore.
+ */
+std::unique_ptr<Tree> deserializeTree(const Hash& hash, folly::ByteRange data);
+
+} // namespace eden
+} // namespace facebook
@@ -10,6 +10,7 @@
 #include "StoreResult.h"
 
 #include <folly/io/IOBuf.h>
+#include <folly/logging/xlog.h>
 
 using folly::IOBuf;
 
@@ -23,6 +24,38 @@ void freeString(void* /* buffer */, void* userData) {
 namespace facebook {
 namespace eden {
 
+StoreResult::StoreResult(IOBuf&& buf)
+    : valid_(true), buf_(std::make_unique<IOBuf>(std::move(buf))) {
+  XDCHECK(!buf_->isChained());
+}
+
+StoreResult::StoreResult(StoreResult&&) noexcept = default;
+StoreResult& StoreResult::operator=(StoreResult&&) noexcept = default;
+StoreResult::~StoreResult() = default;
+
+const std::string& StoreResult::asString() const {
+  ensureValid();
+  if (buf_ && data_.empty() && buf_->length() > 0) {
+    data_.assign(reinterpret_cast<const char*>(buf_->data()), buf_->length());
+  }
+  return data_;
+}
+
+std::string StoreResult::extractValue() {
+  ensureValid();
+  valid_ = false;
+  if (buf_) {
+    auto buf = std::move(buf_);
+    return std::string{reinterpret_cast<const char*>(buf->data()),
+                       buf->length()};
+  }
+  return std::move(data_);
+}
+
+folly::ByteRange StoreResult::bufBytes() const {
+  return folly::ByteRange{buf_->data(), buf_->length()};
+}
+
 IOBuf StoreResult::iobufWrapper() const {
   ensureValid();
   return IOBuf{IOBuf::WRAP_BUFFER, bytes()};
@@ -30,6 +63,10 @@ IOBuf StoreResult::iobufWrapper() const {
 
 folly::IOBuf StoreResult::extractIOBuf() {
   ensureValid();
+  if (buf_) {
+    auto buf = std::move(buf_);
+    return std::move(*buf);
+  }
 
   // Unfortunately RocksDB returns data to us in a std::string.  This makes it
   // difficult for us to control the lifetime.  We end up having to allocate a
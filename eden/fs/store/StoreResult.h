@@ -10,6 +10,7 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <memory>
 #include <string>
 
 namespace folly {
@@ -31,6 +32,11 @@ namespace eden {
  * - It is move-only, so prevents us from ever unintentionally copying the
  *   string data.
  * - It provides APIs for creating IOBuf objects around the string result.
+ *
+ * Stores that can hand out their data without copying it (such as
+ * PackFileLocalStore, which returns views of memory-mapped files) may instead
+ * construct a StoreResult from an IOBuf.  The data is then only copied into a
+ * std::string if asString() or extractValue() is called.
  */
 class StoreResult {
  public:
@@ -45,8 +51,16 @@ class StoreResult {
   explicit StoreResult(std::string&& data)
       : valid_(true), data_(std::move(data)) {}
 
-  StoreResult(StoreResult&&) = default;
-  StoreResult& operator=(StoreResult&&) = default;
+  /**
+   * Construct a StoreResult from an IOBuf.
+   *
+   * The IOBuf must consist of a single buffer.
+   */
+  explicit StoreResult(folly::IOBuf&& buf);
+
+  StoreResult(StoreResult&&) noexcept;
+  StoreResult& operator=(StoreResult&&) noexcept;
+  ~StoreResult();
 
   /**
    * Returns true if the value was found in the store,
@@ -60,11 +74,11 @@ class StoreResult {
    * Get a reference to the std::string result.
    *
    * Throws std::domain_error if the key was not present in the store.
+   *
+   * If this StoreResult was constructed from an IOBuf the data is copied into
+   * a std::string on the first call.
    */
-  const std::string& asString() const {
-    ensureValid();
-    return data_;
-  }
+  const std::string& asString() const;
 
   /**
    * Get a ByteRange pointing to the result.
@@ -73,6 +87,9 @@ class StoreResult {
    */
   folly::ByteRange bytes() const {
     ensureValid();
+    if (buf_) {
+      return bufBytes();
+    }
     return folly::StringPiece{data_};
   }
 
@@ -82,8 +99,7 @@ class StoreResult {
    * Throws std::domain_error if the key was not present in the store.
    */
   folly::StringPiece piece() const {
-    ensureValid();
-    return folly::StringPiece{data_};
+    return folly::StringPiece{bytes()};
   }
 
   /**
@@ -98,11 +114,7 @@ class StoreResult {
   /**
    * Extract the std::string contained in this StoreResult.
    */
-  std::string extractValue() {
-    ensureValid();
-    valid_ = false;
-    return std::move(data_);
-  }
+  std::string extractValue();
 
   /**
    * Extract the data as an IOBuf.
@@ -112,7 +124,8 @@ class StoreResult {
    *
    * This does require a memory allocation to move the stored std::string onto
    * the heap (but it just does a small allocation for the string object
-   * itself, and not the string data).
+   * itself, and not the string data).  A StoreResult constructed from an
+   * IOBuf simply returns that IOBuf.
    */
   folly::IOBuf extractIOBuf();
 
@@ -132,12 +145,16 @@ class StoreResult {
   StoreResult& operator=(StoreResult const&) = delete;
 
   [[noreturn]] void throwInvalidError() const;
+  folly::ByteRange bufBytes() const;
 
   // Whether or not the result is value
   // If the key was not found in the store, valid_ will be false.
   bool valid_{false};
-  // The std::string containing the data
-  std::string data_;
+  // The std::string containing the data.  If buf_ is set this is only filled
+  // in on demand, by asString().
+  mutable std::string data_;
+  // The IOBuf containing the data, if this result was constructed from one
+  std::unique_ptr<folly::IOBuf> buf_;
 };
 } // namespace eden
 } // namespace facebook
@@ -0,0 +1,123 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/TreeCache.h"
+
+#include <folly/MapUtil.h>
+#include <folly/logging/xlog.h>
+#include "eden/fs/model/Tree.h"
+
+namespace facebook {
+namespace eden {
+
+std::shared_ptr<TreeCache> TreeCache::create(
+    size_t maximumCacheSizeBytes,
+    size_t minimumEntryCount) {
+  return std::shared_ptr<TreeCache>{
+      new TreeCache{maximumCacheSizeBytes, minimumEntryCount}};
+}
+
+TreeCache::TreeCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount)
+    : maximumCacheSizeBytes_{maximumCacheSizeBytes},
+      minimumEntryCount_{minimumEntryCount} {}
+
+TreeCache::~TreeCache() {}
+
+TreeCache::TreePtr TreeCache::get(const Hash& hash) {
+  auto state = state_.rlock();
+
+  auto* item = folly::get_ptr(state->items, hash);
+  if (!item) {
+    XLOG(DBG6) << "TreeCache::get missed " << hash;
+    missCount_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  XLOG(DBG6) << "TreeCache::get hit " << hash;
+  // Avoid dirtying the cache line if the bit is already set.
+  if (!item->referenced.load(std::memory_order_relaxed)) {
+    item->referenced.store(true, std::memory_order_relaxed);
+  }
+  hitCount_.fetch_add(1, std::memory_order_relaxed);
+  return item->tree;
+}
+
+void TreeCache::insert(TreePtr tree) {
+  auto hash = tree->getHash();
+  auto size = tree->getSizeInBytes();
+  XLOG(DBG6) << "TreeCache::insert " << hash << " size=" << size;
+
+  auto state = state_.wlock();
+  auto [iter, inserted] = state->items.try_emplace(hash, std::move(tree), size);
+  auto* itemPtr = &iter->second;
+  if (!inserted) {
+    itemPtr->referenced.store(true, std::memory_order_relaxed);
+    return;
+  }
+
+  try {
+    state->evictionQueue.push_back(itemPtr);
+  } catch (std::exception&) {
+    state->items.erase(iter);
+    throw;
+  }
+  itemPtr->index = std::prev(state->evictionQueue.end());
+  state->totalSize += size;
+  evictUntilFits(*state);
+}
+
+bool TreeCache::contains(const Hash& hash) const {
+  auto state = state_.rlock();
+  return 1 == state->items.count(hash);
+}
+
+void TreeCache::clear() {
+  XLOG(DBG6) << "TreeCache::clear";
+  auto state = state_.wlock();
+  state->totalSize = 0;
+  state->items.clear();
+  state->evictionQueue.clear();
+}
+
+TreeCache::Stats TreeCache::getStats() const {
+  auto state = state_.rlock();
+  Stats stats;
+  stats.treeCount = state->items.size();
+  stats.totalSizeInBytes = state->totalSize;
+  stats.hitCount = hitCount_.load(std::memory_order_relaxed);
+  stats.missCount = missCount_.load(std::memory_order_relaxed);
+  stats.evictionCount = state->evictionCount;
+  return stats;
+}
+
+void TreeCache::evictUntilFits(State& state) noexcept {
+  while (state.totalSize > maximumCacheSizeBytes_ &&
+         state.evictionQueue.size() > minimumEntryCount_) {
+    CacheItem* front = state.evictionQueue.front();
+    if (front->referenced.load(std::memory_order_relaxed)) {
+      // Used since it was last considered for eviction: give it another
+      // pass through the queue.  Each entry is skipped at most once, so
+      // this terminates.
+      front->referenced.store(false, std::memory_order_relaxed);
+      state.evictionQueue.splice(
+          state.evictionQueue.end(), state.evictionQueue, front->index);
+      continue;
+    }
+    state.evictionQueue.pop_front();
+    ++state.evictionCount;
+    // Copy the hash, since erasing the item destroys the tree.
+    auto hash = front->tree->getHash();
+    XLOG(DBG6) << "TreeCache evicting " << hash;
+    state.totalSize -= front->size;
+    state.items.erase(hash);
+  }
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+class Tree;
+
+/**
+ * An in-memory cache for deserialized Trees, so that frequently accessed
+ * directories are not re-read from the LocalStore and re-parsed every time
+ * they are loaded.
+ *
+ * Like BlobCache, it is parameterized by both a maximum cache size and a
+ * minimum entry count.  The size of each Tree is estimated with
+ * Tree::getSizeInBytes().
+ *
+ * Trees are looked up on every directory load, so lookups only take the lock
+ * in shared mode.  Rather than reordering the eviction queue, a lookup sets a
+ * referenced bit on the entry, as in BlobMetadataCache.  Eviction gives
+ * referenced entries a second chance by moving them to the back of the queue
+ * and clearing their bit, which approximates LRU.
+ *
+ * It is safe to use this object from arbitrary threads.
+ */
+class TreeCache {
+ public:
+  using TreePtr = std::shared_ptr<const Tree>;
+
+  struct Stats {
+    size_t treeCount{0};
+    size_t totalSizeInBytes{0};
+    uint64_t hitCount{0};
+    uint64_t missCount{0};
+    uint64_t evictionCount{0};
+  };
+
+  static std::shared_ptr<TreeCache> create(
+      size_t maximumCacheSizeBytes,
+      size_t minimumEntryCount);
+  ~TreeCache();
+
+  /**
+   * If a tree for the given hash is in cache, return it and mark it as
+   * recently used.  Otherwise return nullptr.
+   */
+  TreePtr get(const Hash& hash);
+
+  /**
+   * Inserts a tree into the cache for future lookup.  If the new total size
+   * exceeds the maximum cache size and the minimum entry count, old entries are
+   * evicted.
+   */
+  void insert(TreePtr tree);
+
+  /**
+   * Returns true if the cache contains a tree for the given hash.
+   */
+  bool contains(const Hash& hash) const;
+
+  /**
+   * Evicts everything from cache.
+   */
+  void clear();
+
+  /**
+   * Return information about the current size of the cache and the total number
+   * of hits, misses, and evictions.
+   */
+  Stats getStats() const;
+
+ private:
+  struct CacheItem {
+    // WARNING: leaves index unset, as in BlobCache::CacheItem.
+    CacheItem(TreePtr t, size_t s) : tree{std::move(t)}, size{s} {}
+
+    TreePtr tree;
+    // Computed once on insertion, since walking the entries is not free.
+    size_t size;
+    std::list<CacheItem*>::iterator index;
+    // Set by get() while holding the lock in shared mode.
+    mutable std::atomic<bool> referenced{false};
+  };
+
+  struct State {
+    size_t totalSize{0};
+    std::unordered_map<Hash, CacheItem> items;
+
+    /// Entries are evicted from the front of the queue.
+    std::list<CacheItem*> evictionQueue;
+
+    uint64_t evictionCount{0};
+  };
+
+  TreeCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount);
+
+  void evictUntilFits(State& state) noexcept;
+
+  const size_t maximumCacheSizeBytes_;
+  const size_t minimumEntryCount_;
+  folly::Synchronized<State> state_;
+
+  // Updated by get() without the exclusive lock.
+  std::atomic<uint64_t> hitCount_{0};
+  std::atomic<uint64_t> missCount_{0};
+};
+
+} // namespace eden
+} // namespace facebook
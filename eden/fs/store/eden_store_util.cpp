@@ -8,10 +8,14 @@
  *
  */
 #include <sysexits.h>
+#include <algorithm>
 #include <memory>
+#include <numeric>
 #include <optional>
+#include <random>
 
 #include <folly/Range.h>
+#include <folly/ScopeGuard.h>
 #include <folly/String.h>
 #include <folly/container/Array.h>
 #include <folly/container/Enumerate.h>
@@ -23,10 +27,15 @@
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/config/ReloadableConfig.h"
 #include "eden/fs/fuse/privhelper/UserInfo.h"
+#include "eden/fs/model/Hash.h"
 #include "eden/fs/service/EdenInit.h"
 #include "eden/fs/service/EdenStateDir.h"
 #include "eden/fs/store/KeySpaces.h"
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/PackFileLocalStore.h"
 #include "eden/fs/store/RocksDbLocalStore.h"
+#include "eden/fs/store/SqliteLocalStore.h"
+#include "eden/fs/store/StoreResult.h"
 #include "eden/fs/utils/FaultInjector.h"
 
 using namespace facebook::eden;
@@ -38,6 +47,14 @@ using std::optional;
 FOLLY_INIT_LOGGING_CONFIG("eden=DBG2; default:async=true");
 
 DEFINE_string(keySpace, "", "operate on just a single key space");
+DEFINE_int64(
+    benchmarkCount,
+    20000,
+    "number of values to write and read in the benchmark command");
+DEFINE_int64(
+    benchmarkValueSize,
+    16 * 1024,
+    "size in bytes of each value written in the benchmark command");
 
 namespace {
 
@@ -209,13 +226,102 @@ class ShowSizesCommand : public Command {
   }
 };
 
+class BenchmarkCommand : public Command {
+ public:
+  static constexpr auto name = StringPiece("benchmark");
+  static constexpr auto help = StringPiece(
+      "Compare blob write and read throughput of the local store engines");
+
+  void run() override {
+    const auto benchmarkPath =
+        edenDir_.getPath() + "storage/benchmark"_relpath;
+    removeRecursively(benchmarkPath);
+    ensureDirectoryExists(benchmarkPath);
+    SCOPE_EXIT {
+      removeRecursively(benchmarkPath);
+    };
+
+    const auto count = static_cast<size_t>(FLAGS_benchmarkCount);
+    std::vector<Hash> keys;
+    keys.reserve(count);
+    std::string value(FLAGS_benchmarkValueSize, 'x');
+    for (size_t n = 0; n < count; ++n) {
+      keys.push_back(Hash::sha1(folly::to<std::string>(n)));
+    }
+    XLOG(INFO) << "Writing and reading " << count << " values of "
+               << folly::prettyPrint(value.size(), folly::PRETTY_BYTES_IEC);
+
+    benchmark(
+        "rocksdb",
+        make_unique<RocksDbLocalStore>(
+            benchmarkPath + "rocks-db"_pc, &faultInjector_),
+        keys,
+        value);
+    benchmark(
+        "sqlite",
+        make_unique<SqliteLocalStore>(benchmarkPath + "sqlite.db"_pc),
+        keys,
+        value);
+    benchmark(
+        "pack",
+        make_unique<PackFileLocalStore>(
+            benchmarkPath + "pack"_pc,
+            std::make_shared<MemoryLocalStore>(),
+            std::vector<LocalStore::KeySpace>{LocalStore::BlobFamily}),
+        keys,
+        value);
+  }
+
+ private:
+  void benchmark(
+      StringPiece engine,
+      std::unique_ptr<LocalStore> store,
+      const std::vector<Hash>& keys,
+      const std::string& value) {
+    auto totalBytes = static_cast<double>(keys.size() * value.size());
+    auto report = [&](StringPiece operation, double seconds) {
+      XLOG(INFO) << engine << " " << operation << ": " << seconds
+                 << " seconds, " << (keys.size() / seconds) << " values/s, "
+                 << folly::prettyPrint(
+                        totalBytes / seconds, folly::PRETTY_BYTES_IEC)
+                 << "/s";
+    };
+
+    folly::stop_watch<std::chrono::microseconds> watch;
+    auto batch = store->beginWrite(/*bufSize=*/8 * 1024 * 1024);
+    for (const auto& key : keys) {
+      batch->put(LocalStore::BlobFamily, key, StringPiece{value});
+    }
+    batch->flush();
+    report("write", watch.lap().count() / 1000000.0);
+
+    // Read the values back in random order, touching every byte the way
+    // serving a file read would.
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937{});
+    size_t checksum = 0;
+    for (auto index : order) {
+      auto buf = store->get(LocalStore::BlobFamily, keys[index]).extractIOBuf();
+      for (auto byte : buf) {
+        checksum += std::accumulate(byte.begin(), byte.end(), size_t{0});
+      }
+    }
+    report("random read", watch.lap().count() / 1000000.0);
+    XLOG(DBG3) << engine << " checksum: " << checksum;
+
+    store->close();
+  }
+};
+
 std::unique_ptr<Command> createCommand(StringPiece name) {
   auto commands = make_array<std::unique_ptr<CommandFactory>>(
       make_unique<CommandFactoryT<GcCommand>>(),
       make_unique<CommandFactoryT<ClearCommand>>(),
       make_unique<CommandFactoryT<CompactCommand>>(),
       make_unique<CommandFactoryT<RepairCommand>>(),
-      make_unique<CommandFactoryT<ShowSizesCommand>>());
+      make_unique<CommandFactoryT<ShowSizesCommand>>(),
+      make_unique<CommandFactoryT<BenchmarkCommand>>());
 
   std::unique_ptr<Command> command;
   for (const auto& factory : commands) {
@@ -36,6 +36,7 @@
 #include "eden/fs/utils/ServiceAddress.h"
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
 
+#include <algorithm>
 #include "edenscm/hgext/extlib/cstore/uniondatapackstore.h" // @manual=//scm/hg:datapack
 #include "edenscm/hgext/extlib/ctreemanifest/treemanifest.h" // @manual=//scm/hg:datapack
 #ifndef EDEN_WIN_NO_RUST_DATAPACK
@@ -75,6 +76,17 @@ DEFINE_bool(
     "Set this parameter to \"no\" to disable fetching missing treemanifest "
     "trees from the remote mercurial server.  This is generally only useful "
     "for testing/debugging purposes");
+DEFINE_int32(
+    hg_import_batch_size,
+    32,
+    "the maximum number of pending blob imports to send to the hg import "
+    "helper in a single request");
+DEFINE_int32(
+    hg_import_aging_interval_ms,
+    1000,
+    "Queued hg imports are treated as one priority class more urgent for each "
+    "interval of this many milliseconds that they wait, so that prefetch and "
+    "background imports are not starved.  0 disables aging.");
 DEFINE_int32(
     mononoke_timeout,
     120000, // msec
@@ -98,6 +110,15 @@ Importer& getThreadLocalImporter() {
   return *threadLocalImporter;
 }
 
+/**
+ * The importQueue_ key of a tree import.  Identical concurrent fetches are
+ * merged, so the key must include the path: the same manifest node can
+ * appear at more than one path.
+ */
+std::string treeImportKey(RelativePathPiece path, const Hash& manifestNode) {
+  return folly::to<std::string>("tree:", path, ":", manifestNode);
+}
+
 /**
  * Thread factory that sets thread name and initializes a thread local
  * HgImporter.
@@ -228,6 +249,9 @@ HgBackingStore::HgBackingStore(
     std::shared_ptr<EdenStats> stats)
     : localStore_(localStore),
       stats_(stats),
+      importQueue_(
+          stats,
+          std::chrono::milliseconds(FLAGS_hg_import_aging_interval_ms)),
       importThreadPool_(make_unique<folly::CPUThreadPoolExecutor>(
           FLAGS_num_hg_import_threads,
           /* Eden performance will degrade when, for example, a status operation
@@ -270,7 +294,10 @@ HgBackingStore::HgBackingStore(
     LocalStore* localStore,
     std::shared_ptr<EdenStats> stats)
     : localStore_{localStore},
-      stats_{std::move(stats)},
+      stats_{stats},
+      importQueue_{
+          std::move(stats),
+          std::chrono::milliseconds(FLAGS_hg_import_aging_interval_ms)},
       importThreadPool_{std::make_unique<HgImporterTestExecutor>(importer)},
       serverThreadPool_{importThreadPool_.get()} {}
 
@@ -605,12 +632,15 @@ folly::Future<std::unique_ptr<Tree>> HgBackingStore::fetchTreeFromImporter(
     RelativePath path,
     std::shared_ptr<LocalStore::WriteBatch> writeBatch) {
   auto fut =
-      folly::via(
-          importThreadPool_.get(),
-          [path, manifestNode] {
-            return getThreadLocalImporter().fetchTree(path, manifestNode);
-          })
+      importQueue_
+          .enqueueKeyed(
+              getCurrentImportPriority(),
+              treeImportKey(path, manifestNode),
+              [path, manifestNode] {
+                getThreadLocalImporter().fetchTree(path, manifestNode);
+              })
           .via(serverThreadPool_);
+  scheduleImportThread();
   return std::move(fut).thenTry(
       [this,
        ownedPath = std::move(path),
@@ -709,8 +739,8 @@ std::unique_ptr<Tree> HgBackingStore::processTree(
 }
 
 folly::Future<Hash> HgBackingStore::importTreeManifest(const Hash& commitId) {
-  return folly::via(
-             importThreadPool_.get(),
+  return scheduleImport(
+             getCurrentImportPriority(),
              [commitId] {
                return getThreadLocalImporter().resolveManifestNode(
                    commitId.toString());
@@ -788,24 +818,115 @@ Future<unique_ptr<Blob>> HgBackingStore::getBlob(const Hash& id) {
   return getBlobFromHgImporter(id);
 }
 
+void HgBackingStore::raiseTreePriority(
+    const Hash& id,
+    ImportPriorityClass priority) {
+  try {
+    HgProxyHash pathInfo(localStore_, id, "raiseTreePriority");
+    importQueue_.raiseKeyedPriority(
+        treeImportKey(pathInfo.path(), pathInfo.revHash()), priority);
+  } catch (const std::exception& ex) {
+    // Only a tree this store is importing can be in importQueue_.
+    XLOG(DBG3) << "not raising priority of tree " << id << ": " << ex.what();
+  }
+}
+
+void HgBackingStore::raiseBlobPriority(
+    const Hash& id,
+    ImportPriorityClass priority) {
+  importQueue_.raiseBlobPriority(id, priority);
+}
+
 Future<std::unique_ptr<Blob>> HgBackingStore::getBlobFromHgImporter(
     const Hash& id) {
-  return folly::via(
-             importThreadPool_.get(),
-             [id] { return getThreadLocalImporter().importFileContents(id); })
-      // Ensure that the control moves back to the main thread pool
-      // to process the caller-attached .then routine.
-      .via(serverThreadPool_);
+  auto future = importQueue_.enqueueBlob(id, getCurrentImportPriority());
+  scheduleImportThread();
+  // Ensure that the control moves back to the main thread pool
+  // to process the caller-attached .then routine.
+  return std::move(future).via(serverThreadPool_);
+}
+
+template <typename Fn>
+auto HgBackingStore::scheduleImport(ImportPriorityClass priority, Fn&& fn)
+    const {
+  auto future = importQueue_.enqueue(priority, std::forward<Fn>(fn));
+  scheduleImportThread();
+  return future;
+}
+
+void HgBackingStore::scheduleImportThread() const {
+  // The executor only decides when an importer thread is free; which request
+  // that thread runs is up to importQueue_.  Because every queued request
+  // schedules one call, requests merged into an earlier one or batched with
+  // it leave calls that find nothing to do.
+  importThreadPool_->add([this] { runNextImport(); });
+}
+
+void HgBackingStore::runNextImport() const {
+  auto batch = importQueue_.dequeue(
+      static_cast<size_t>(std::max(FLAGS_hg_import_batch_size, 1)));
+  if (!batch) {
+    return;
+  }
+  if (batch->blobs.empty()) {
+    batch->work();
+    return;
+  }
+  importBlobBatch(batch->blobs);
+}
+
+void HgBackingStore::importBlobBatch(
+    std::vector<HgImportRequestQueue::BlobImport>& batch) const {
+  auto& importer = getThreadLocalImporter();
+  if (batch.size() == 1) {
+    // Idle importer threads pick up requests one at a time, so keep using
+    // the single-file request for them.
+    HgImportRequestQueue::setBlobResult(
+        batch[0],
+        folly::makeTryWith(
+            [&] { return importer.importFileContents(batch[0].id); }));
+    return;
+  }
+
+  std::vector<Hash> ids;
+  ids.reserve(batch.size());
+  for (const auto& import : batch) {
+    ids.push_back(import.id);
+  }
+  XLOG(DBG4) << "importing a batch of " << ids.size() << " blobs";
+
+  try {
+    auto results = importer.importFileContentsBatch(ids);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      HgImportRequestQueue::setBlobResult(batch[i], std::move(results[i]));
+    }
+  } catch (const std::exception& ex) {
+    auto ew = folly::exception_wrapper{std::current_exception(), ex};
+    for (auto& import : batch) {
+      HgImportRequestQueue::setBlobResult(
+          import, folly::Try<std::unique_ptr<Blob>>{ew});
+    }
+  }
 }
 
 folly::Future<folly::Unit> HgBackingStore::prefetchBlobs(
     const std::vector<Hash>& ids) const {
+  // Prefetches are never more urgent than the Prefetch class, even when a
+  // FUSE or thrift request asks for them.
+  auto priority =
+      std::max(getCurrentImportPriority(), ImportPriorityClass::Prefetch);
   return HgProxyHash::getBatch(localStore_, ids)
-      .via(importThreadPool_.get())
-      .thenValue([](std::vector<std::pair<RelativePath, Hash>>&& hgPathHashes) {
-        return getThreadLocalImporter().prefetchFiles(hgPathHashes);
-      })
-      .via(serverThreadPool_);
+      .via(serverThreadPool_)
+      .thenValue(
+          [this, priority](
+              std::vector<std::pair<RelativePath, Hash>>&& hgPathHashes) {
+            return scheduleImport(
+                       priority,
+                       [hgPathHashes = std::move(hgPathHashes)] {
+                         getThreadLocalImporter().prefetchFiles(hgPathHashes);
+                       })
+                .via(serverThreadPool_);
+          });
 }
 
 Future<unique_ptr<Tree>> HgBackingStore::getTreeForCommit(
@@ -859,8 +980,8 @@ folly::Future<Hash> HgBackingStore::importManifest(Hash commitId) {
 }
 
 folly::Future<Hash> HgBackingStore::importFlatManifest(Hash commitId) {
-  return folly::via(
-             importThreadPool_.get(),
+  return scheduleImport(
+             getCurrentImportPriority(),
              [commitId] {
                return getThreadLocalImporter().importFlatManifest(
                    commitId.toString());
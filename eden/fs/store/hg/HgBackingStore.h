@@ -13,6 +13,7 @@
 #include "eden/fs/eden-config.h"
 #include "eden/fs/store/BackingStore.h"
 #include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/hg/HgImportRequestQueue.h"
 #include "eden/fs/utils/PathFuncs.h"
 #ifndef EDEN_WIN_NO_RUST_DATAPACK
 #include "scm/hg/lib/revisionstore/RevisionStore.h"
@@ -80,6 +81,10 @@ class HgBackingStore : public BackingStore {
       const Hash& commitID) override;
   FOLLY_NODISCARD folly::Future<folly::Unit> prefetchBlobs(
       const std::vector<Hash>& ids) const override;
+  void raiseTreePriority(const Hash& id, ImportPriorityClass priority)
+      override;
+  void raiseBlobPriority(const Hash& id, ImportPriorityClass priority)
+      override;
 
   /**
    * Import the manifest for the specified revision using mercurial
@@ -157,6 +162,27 @@ class HgBackingStore : public BackingStore {
 
   folly::Future<std::unique_ptr<Blob>> getBlobFromHgImporter(const Hash& id);
 
+  /**
+   * Queue work on importQueue_ and arrange for an importer thread to run it.
+   */
+  template <typename Fn>
+  auto scheduleImport(ImportPriorityClass priority, Fn&& fn) const;
+
+  /**
+   * Schedule one call to runNextImport() on an importer thread.  Call this
+   * once for every request added to importQueue_.
+   */
+  void scheduleImportThread() const;
+
+  /**
+   * Run on an importer thread: take the most urgent request from
+   * importQueue_ and run it.  Blob imports are batched into a single request
+   * to the import helper.
+   */
+  void runNextImport() const;
+  void importBlobBatch(std::vector<HgImportRequestQueue::BlobImport>& batch)
+      const;
+
   folly::Future<std::unique_ptr<Tree>> getTreeForCommitImpl(Hash commitID);
 
   // Import the Tree from Hg and cache it in the LocalStore before returning it.
@@ -191,6 +217,11 @@ class HgBackingStore : public BackingStore {
 
   LocalStore* localStore_{nullptr};
   std::shared_ptr<EdenStats> stats_;
+  // Requests waiting for an importer thread.  This is declared before
+  // importThreadPool_ so that it outlives the tasks still running when the
+  // pool is joined during destruction.  It is mutable because the const
+  // prefetchBlobs() queues work too.
+  mutable HgImportRequestQueue importQueue_;
   // A set of threads owning HgImporter instances
   std::unique_ptr<folly::Executor> importThreadPool_;
   std::shared_ptr<ReloadableConfig> config_;
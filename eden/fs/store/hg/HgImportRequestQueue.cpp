@@ -0,0 +1,263 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/hg/HgImportRequestQueue.h"
+
+#include <folly/MapUtil.h>
+#include <algorithm>
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/tracing/EdenStats.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+using HistogramPtr =
+    EdenThreadStatsBase::Histogram HgBackingStoreThreadStats::*;
+
+constexpr std::array<HistogramPtr, kImportPriorityClassCount> kDepthHistograms{
+    &HgBackingStoreThreadStats::importQueueDepthInteractive,
+    &HgBackingStoreThreadStats::importQueueDepthThrift,
+    &HgBackingStoreThreadStats::importQueueDepthPrefetch,
+    &HgBackingStoreThreadStats::importQueueDepthBackground,
+};
+constexpr std::array<HistogramPtr, kImportPriorityClassCount> kWaitHistograms{
+    &HgBackingStoreThreadStats::importQueueWaitInteractive,
+    &HgBackingStoreThreadStats::importQueueWaitThrift,
+    &HgBackingStoreThreadStats::importQueueWaitPrefetch,
+    &HgBackingStoreThreadStats::importQueueWaitBackground,
+};
+
+// When batching blob imports, give up looking for more blobs in a queue after
+// examining this many entries per blob wanted.
+constexpr size_t kBatchScanFactor = 4;
+
+size_t toIndex(ImportPriorityClass priority) {
+  return static_cast<size_t>(priority);
+}
+} // namespace
+
+HgImportRequestQueue::HgImportRequestQueue(
+    std::shared_ptr<EdenStats> stats,
+    std::chrono::milliseconds agingInterval)
+    : stats_{std::move(stats)}, agingInterval_{agingInterval} {}
+
+HgImportRequestQueue::~HgImportRequestQueue() {}
+
+folly::SemiFuture<std::unique_ptr<Blob>> HgImportRequestQueue::enqueueBlob(
+    const Hash& id,
+    ImportPriorityClass priority) {
+  folly::Promise<std::unique_ptr<Blob>> promise;
+  auto future = promise.getSemiFuture();
+
+  auto state = state_.wlock();
+  if (auto* pending = folly::get_ptr(state->pendingBlobs, id)) {
+    (*pending)->blobPromises.push_back(std::move(promise));
+    raisePriority(*state, *pending, priority);
+    return future;
+  }
+
+  auto request = std::make_shared<Request>();
+  request->priority = priority;
+  request->blobId = id;
+  request->blobPromises.push_back(std::move(promise));
+  state->pendingBlobs.emplace(id, request);
+  push(*state, std::move(request));
+  return future;
+}
+
+folly::SemiFuture<folly::Unit> HgImportRequestQueue::enqueueKeyed(
+    ImportPriorityClass priority,
+    std::string key,
+    folly::Function<void()> work) {
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getSemiFuture();
+
+  auto state = state_.wlock();
+  if (auto* pending = folly::get_ptr(state->pendingKeyed, key)) {
+    (*pending)->keyedPromises.push_back(std::move(promise));
+    raisePriority(*state, *pending, priority);
+    return future;
+  }
+
+  auto request = std::make_shared<Request>();
+  request->priority = priority;
+  request->key = key;
+  request->work = std::move(work);
+  request->keyedPromises.push_back(std::move(promise));
+  state->pendingKeyed.emplace(std::move(key), request);
+  push(*state, std::move(request));
+  return future;
+}
+
+void HgImportRequestQueue::raiseBlobPriority(
+    const Hash& id,
+    ImportPriorityClass priority) {
+  auto state = state_.wlock();
+  if (auto* pending = folly::get_ptr(state->pendingBlobs, id)) {
+    raisePriority(*state, *pending, priority);
+  }
+}
+
+void HgImportRequestQueue::raiseKeyedPriority(
+    folly::StringPiece key,
+    ImportPriorityClass priority) {
+  auto state = state_.wlock();
+  if (auto* pending = folly::get_ptr(state->pendingKeyed, key.str())) {
+    raisePriority(*state, *pending, priority);
+  }
+}
+
+void HgImportRequestQueue::enqueueWork(
+    ImportPriorityClass priority,
+    folly::Function<void()> work) {
+  auto request = std::make_shared<Request>();
+  request->priority = priority;
+  request->work = std::move(work);
+  push(*state_.wlock(), std::move(request));
+}
+
+void HgImportRequestQueue::push(State& state, RequestPtr request) {
+  auto index = toIndex(request->priority);
+  request->enqueueTime = std::chrono::steady_clock::now();
+  state.queues[index].push_back(std::move(request));
+  ++state.depth[index];
+  (stats_->getHgBackingStoreStatsForCurrentThread().*kDepthHistograms[index])
+      .addValue(state.depth[index]);
+}
+
+void HgImportRequestQueue::raisePriority(
+    State& state,
+    const RequestPtr& request,
+    ImportPriorityClass priority) {
+  if (toIndex(priority) >= toIndex(request->priority)) {
+    return;
+  }
+  --state.depth[toIndex(request->priority)];
+  request->priority = priority;
+  ++state.depth[toIndex(priority)];
+  // The request keeps its original enqueue time, so it has already aged.
+  state.queues[toIndex(priority)].push_back(request);
+}
+
+bool HgImportRequestQueue::isLive(const Request& request, size_t queueIndex) {
+  return !request.dequeued && toIndex(request.priority) == queueIndex;
+}
+
+void HgImportRequestQueue::take(State& state, Request& request) {
+  auto index = toIndex(request.priority);
+  request.dequeued = true;
+  --state.depth[index];
+  if (request.blobId) {
+    state.pendingBlobs.erase(*request.blobId);
+  } else if (request.key) {
+    state.pendingKeyed.erase(*request.key);
+  }
+
+  auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - request.enqueueTime);
+  (stats_->getHgBackingStoreStatsForCurrentThread().*kWaitHistograms[index])
+      .addValue(wait.count());
+}
+
+std::optional<HgImportRequestQueue::Batch> HgImportRequestQueue::dequeue(
+    size_t maxBlobs) {
+  auto now = std::chrono::steady_clock::now();
+  auto state = state_.wlock();
+
+  // Pick the most urgent request at the front of any queue, counting each
+  // agingInterval_ it has waited as one class more urgent.  Ties go to the
+  // request that has waited longest.
+  RequestPtr best;
+  size_t bestIndex = 0;
+  int64_t bestScore = 0;
+  for (size_t index = 0; index < kImportPriorityClassCount; ++index) {
+    auto& queue = state->queues[index];
+    while (!queue.empty() && !isLive(*queue.front(), index)) {
+      queue.pop_front();
+    }
+    if (queue.empty()) {
+      continue;
+    }
+
+    const auto& front = queue.front();
+    auto score = static_cast<int64_t>(index);
+    if (agingInterval_.count() > 0) {
+      score -= (now - front->enqueueTime) / agingInterval_;
+    }
+    if (!best || score < bestScore ||
+        (score == bestScore && front->enqueueTime < best->enqueueTime)) {
+      best = front;
+      bestIndex = index;
+      bestScore = score;
+    }
+  }
+  if (!best) {
+    return std::nullopt;
+  }
+
+  auto& queue = state->queues[bestIndex];
+  queue.pop_front();
+  take(*state, *best);
+
+  Batch batch;
+  if (best->blobId) {
+    batch.blobs.push_back(
+        BlobImport{*best->blobId, std::move(best->blobPromises)});
+
+    // Take more blob imports from the same class.  They are marked as
+    // dequeued and dropped from the queue once they reach its front.
+    auto scanLimit = std::min(queue.size(), maxBlobs * kBatchScanFactor);
+    for (size_t n = 0; n < scanLimit && batch.blobs.size() < maxBlobs; ++n) {
+      auto& request = *queue[n];
+      if (!isLive(request, bestIndex) || !request.blobId) {
+        continue;
+      }
+      take(*state, request);
+      batch.blobs.push_back(
+          BlobImport{*request.blobId, std::move(request.blobPromises)});
+    }
+  } else if (best->key) {
+    batch.work = [work = std::move(best->work),
+                  promises = std::move(best->keyedPromises)]() mutable {
+      auto result = folly::makeTryWith(work);
+      for (auto& promise : promises) {
+        promise.setTry(folly::Try<folly::Unit>{result});
+      }
+    };
+  } else {
+    batch.work = std::move(best->work);
+  }
+  return batch;
+}
+
+void HgImportRequestQueue::setBlobResult(
+    BlobImport& import,
+    folly::Try<std::unique_ptr<Blob>>&& result) {
+  if (result.hasException()) {
+    for (auto& promise : import.promises) {
+      promise.setException(result.exception());
+    }
+    return;
+  }
+
+  auto& blob = result.value();
+  for (size_t n = 1; n < import.promises.size(); ++n) {
+    import.promises[n].setValue(
+        std::make_unique<Blob>(blob->getHash(), blob->getContents()));
+  }
+  import.promises[0].setValue(std::move(blob));
+}
+
+size_t HgImportRequestQueue::getQueueDepth(ImportPriorityClass priority) const {
+  return state_.rlock()->depth[toIndex(priority)];
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,190 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Function.h>
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/Try.h>
+#include <folly/Unit.h>
+#include <folly/container/F14Map.h>
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/store/ImportPriority.h"
+
+namespace facebook {
+namespace eden {
+
+class Blob;
+class EdenStats;
+
+/**
+ * The queue of work waiting for an HgImporter thread.
+ *
+ * Requests are kept in one FIFO per ImportPriorityClass, and importer threads
+ * take the most urgent request first, so that a large prefetch cannot delay
+ * an interactive read behind thousands of queued imports.  To keep lower
+ * classes from starving, a request is treated as one class more urgent for
+ * every agingInterval it has waited.
+ *
+ * Identical pending requests are merged: a second request for a blob or keyed
+ * piece of work that is already queued waits on the existing request, and
+ * raises its priority if it is more urgent.
+ *
+ * The queue does not run anything itself.  Whoever adds a request must make
+ * sure an importer thread later calls dequeue().
+ *
+ * This class is thread-safe.
+ */
+class HgImportRequestQueue {
+ public:
+  /**
+   * A pending blob import, and everyone waiting on it.
+   */
+  struct BlobImport {
+    Hash id;
+    std::vector<folly::Promise<std::unique_ptr<Blob>>> promises;
+  };
+
+  /**
+   * The next unit of work for an importer thread: either a batch of blob
+   * imports or a single piece of other work.
+   */
+  struct Batch {
+    std::vector<BlobImport> blobs;
+    folly::Function<void()> work;
+  };
+
+  HgImportRequestQueue(
+      std::shared_ptr<EdenStats> stats,
+      std::chrono::milliseconds agingInterval);
+  ~HgImportRequestQueue();
+
+  HgImportRequestQueue(const HgImportRequestQueue&) = delete;
+  HgImportRequestQueue& operator=(const HgImportRequestQueue&) = delete;
+
+  /**
+   * Queue an import of the given blob.
+   */
+  folly::SemiFuture<std::unique_ptr<Blob>> enqueueBlob(
+      const Hash& id,
+      ImportPriorityClass priority);
+
+  /**
+   * Queue a piece of work identified by key.  The work is skipped if another
+   * request with the same key is already pending; both callers then wait for
+   * the pending one.
+   */
+  folly::SemiFuture<folly::Unit> enqueueKeyed(
+      ImportPriorityClass priority,
+      std::string key,
+      folly::Function<void()> work);
+
+  /**
+   * Raise the priority of a pending blob import or keyed piece of work, as
+   * if it had been requested again at the given priority.  Does nothing if
+   * no such request is waiting.
+   */
+  void raiseBlobPriority(const Hash& id, ImportPriorityClass priority);
+  void raiseKeyedPriority(
+      folly::StringPiece key,
+      ImportPriorityClass priority);
+
+  /**
+   * Queue a piece of work, and return a future for its result.
+   */
+  template <typename Fn>
+  folly::SemiFuture<folly::lift_unit_t<std::invoke_result_t<Fn>>> enqueue(
+      ImportPriorityClass priority,
+      Fn&& fn) {
+    folly::Promise<folly::lift_unit_t<std::invoke_result_t<Fn>>> promise;
+    auto future = promise.getSemiFuture();
+    enqueueWork(
+        priority,
+        [promise = std::move(promise),
+         fn = std::forward<Fn>(fn)]() mutable { promise.setWith(fn); });
+    return future;
+  }
+
+  /**
+   * Remove the most urgent request from the queue.
+   *
+   * If that is a blob import, up to maxBlobs - 1 more pending blob imports of
+   * the same class are taken with it, so that they can be fetched together.
+   * Returns std::nullopt if the queue is empty.
+   */
+  std::optional<Batch> dequeue(size_t maxBlobs);
+
+  /**
+   * Complete a blob import taken from dequeue().  Every waiter gets its own
+   * Blob, sharing the same contents.
+   */
+  static void setBlobResult(
+      BlobImport& import,
+      folly::Try<std::unique_ptr<Blob>>&& result);
+
+  /**
+   * Returns the number of requests waiting at the given priority.
+   */
+  size_t getQueueDepth(ImportPriorityClass priority) const;
+
+ private:
+  struct Request {
+    ImportPriorityClass priority;
+    std::chrono::steady_clock::time_point enqueueTime;
+    bool dequeued{false};
+
+    // Set for blob imports.
+    std::optional<Hash> blobId;
+    std::vector<folly::Promise<std::unique_ptr<Blob>>> blobPromises;
+
+    // Set for other work.  Keyed work also has the promises of everyone
+    // waiting on it.
+    std::optional<std::string> key;
+    folly::Function<void()> work;
+    std::vector<folly::Promise<folly::Unit>> keyedPromises;
+  };
+  using RequestPtr = std::shared_ptr<Request>;
+
+  struct State {
+    // A request whose priority is raised is also pushed onto the more urgent
+    // queue, and left behind in the old one.  Entries whose request has been
+    // dequeued or moved to another class are skipped.
+    std::array<std::deque<RequestPtr>, kImportPriorityClassCount> queues;
+    std::array<size_t, kImportPriorityClassCount> depth{};
+    folly::F14FastMap<Hash, RequestPtr> pendingBlobs;
+    folly::F14FastMap<std::string, RequestPtr> pendingKeyed;
+  };
+
+  void enqueueWork(ImportPriorityClass priority, folly::Function<void()> work);
+  void push(State& state, RequestPtr request);
+  void raisePriority(
+      State& state,
+      const RequestPtr& request,
+      ImportPriorityClass priority);
+  void take(State& state, Request& request);
+  static bool isLive(const Request& request, size_t queueIndex);
+
+  std::shared_ptr<EdenStats> stats_;
+  std::chrono::milliseconds agingInterval_;
+  folly::Synchronized<State> state_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -13,6 +13,7 @@
 #include <boost/filesystem/path.hpp>
 #include <folly/Conv.h>
 #include <folly/FileUtil.h>
+#include <folly/String.h>
 #include <folly/container/Array.h>
 #include <folly/dynamic.h>
 #include <folly/experimental/EnvUtil.h>
@@ -26,6 +27,10 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #ifndef _WIN32
+#include <folly/Exception.h>
+#include <folly/File.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #else
 #include "eden/fs/win/utils/Pipe.h" // @manual
@@ -106,6 +111,20 @@ DEFINE_int32(
     256 * 1024 * 1024, // 256MB
     "Buffer size for batching LocalStore writes during hg manifest imports");
 
+DEFINE_string(
+    hgImportSharedMemoryDir,
+    "/dev/shm",
+    "A directory on a memory-backed file system through which the mercurial "
+    "import helper can send large file contents without copying them over "
+    "its pipe");
+
+DEFINE_int32(
+    hgImportSharedMemoryThreshold,
+    1024 * 1024, // 1MB
+    "Files at least this large are sent from the mercurial import helper "
+    "through hgImportSharedMemoryDir rather than over its pipe.  Set this to "
+    "0 to always use the pipe.");
+
 namespace {
 using namespace facebook::eden;
 
@@ -126,6 +145,17 @@ using namespace facebook::eden;
 
 constexpr int HELPER_PIPE_FD = 5;
 
+/**
+ * Environment variables telling the import helper where and above what size
+ * to write file contents for shared memory transfer.  These are passed in the
+ * environment rather than on the command line so that helpers which do not
+ * know about them simply ignore them and keep using the pipe.
+ */
+constexpr StringPiece kSharedMemoryDirEnvVar{
+    "EDEN_HG_IMPORT_SHARED_MEMORY_DIR"};
+constexpr StringPiece kSharedMemoryThresholdEnvVar{
+    "EDEN_HG_IMPORT_SHARED_MEMORY_THRESHOLD"};
+
 /**
  * Internal helper function for use by getImportHelperPath().
  *
@@ -308,6 +338,16 @@ HgImporter::HgImporter(
   (*env)["HGPLAIN"] = "1";
   (*env)["CHGDISABLE"] = "1";
 
+  createSharedMemoryDir();
+  SCOPE_FAIL {
+    removeSharedMemoryDir();
+  };
+  if (sharedMemoryDir_) {
+    (*env)[kSharedMemoryDirEnvVar.str()] = sharedMemoryDir_->value().str();
+    (*env)[kSharedMemoryThresholdEnvVar.str()] =
+        folly::to<string>(FLAGS_hgImportSharedMemoryThreshold);
+  }
+
   auto envVector = env.toVector();
   helper_ = Subprocess{cmd, opts, nullptr, &envVector};
   SCOPE_FAIL {
@@ -340,6 +380,12 @@ HgImporter::HgImporter(
 
 #endif
   options_ = waitForHelperStart();
+#ifndef _WIN32
+  if (!options_.sharedMemoryTransfer) {
+    // The helper will never write to the directory, so don't keep it around.
+    removeSharedMemoryDir();
+  }
+#endif
   XLOG(DBG1) << "hg_import_helper started for repository " << repoPath_;
 }
 
@@ -411,6 +457,9 @@ ImporterOptions HgImporter::waitForHelperStart() {
     options.repoName = cursor.readFixedString(nameLength);
   }
 
+  options.sharedMemoryTransfer =
+      (flags & StartFlag::SHARED_MEMORY_SUPPORTED) != 0;
+
   return options;
 }
 
@@ -431,9 +480,43 @@ void HgImporter::stopHelperProcess() {
     helper_.closeParentFd(STDIN_FILENO);
     helper_.wait();
   }
+  removeSharedMemoryDir();
 #endif
 }
 
+#ifndef _WIN32
+void HgImporter::createSharedMemoryDir() {
+  if (FLAGS_hgImportSharedMemoryThreshold <= 0 ||
+      FLAGS_hgImportSharedMemoryDir.empty()) {
+    return;
+  }
+
+  auto dirTemplate = folly::to<string>(
+      FLAGS_hgImportSharedMemoryDir, "/edenfs_hg_import.XXXXXX");
+  if (!mkdtemp(&dirTemplate[0])) {
+    XLOG(WARN) << "unable to create a shared memory directory in "
+               << FLAGS_hgImportSharedMemoryDir << ": "
+               << folly::errnoStr(errno)
+               << "; file contents will be sent over the pipe";
+    return;
+  }
+  sharedMemoryDir_ = realpath(dirTemplate);
+}
+
+void HgImporter::removeSharedMemoryDir() {
+  if (!sharedMemoryDir_) {
+    return;
+  }
+  boost::system::error_code ec;
+  boost::filesystem::remove_all(sharedMemoryDir_->value().str(), ec);
+  if (ec) {
+    XLOG(WARN) << "error removing shared memory directory "
+               << *sharedMemoryDir_ << ": " << ec.message();
+  }
+  sharedMemoryDir_.reset();
+}
+#endif
+
 Hash HgImporter::importFlatManifest(StringPiece revName) {
   // Send the manifest request to the helper process
   auto requestID = sendManifestRequest(revName);
@@ -506,25 +589,121 @@ unique_ptr<Blob> HgImporter::importFileContents(Hash blobHash) {
   // In the future we might want to consider if it is more efficient to receive
   // the body data in fixed-size chunks, particularly for very large files.
   auto header = readChunkHeader(requestID, "CMD_CAT_FILE");
+  auto blob = readFileResponseBody(
+      header, blobHash, hgInfo.path(), hgInfo.revHash(), "CMD_CAT_FILE");
+
+  stats_->hgBackingStoreGetBlob.addValue(watch.elapsed().count());
+  return blob;
+}
+
+std::vector<folly::Try<unique_ptr<Blob>>> HgImporter::importFileContentsBatch(
+    const std::vector<Hash>& blobHashes) {
+  folly::stop_watch<std::chrono::milliseconds> watch;
+  std::vector<folly::Try<unique_ptr<Blob>>> results(blobHashes.size());
+
+  // Look up the mercurial path and file revision hash for each blob.  A blob
+  // we cannot find is reported as an error without being requested.
+  std::vector<std::pair<RelativePath, Hash>> files;
+  std::vector<size_t> resultIndices;
+  files.reserve(blobHashes.size());
+  resultIndices.reserve(blobHashes.size());
+  for (size_t n = 0; n < blobHashes.size(); ++n) {
+    try {
+      HgProxyHash hgInfo(store_, blobHashes[n], "importFileContentsBatch");
+      files.emplace_back(hgInfo.path().copy(), hgInfo.revHash());
+      resultIndices.push_back(n);
+    } catch (const std::exception& ex) {
+      results[n] = folly::Try<unique_ptr<Blob>>(
+          folly::exception_wrapper{std::current_exception(), ex});
+    }
+  }
+  if (files.empty()) {
+    return results;
+  }
+
+  XLOG(DBG5) << "requesting file contents of " << files.size() << " files";
+  auto requestID = sendFilesRequest(files);
+
+  // The helper sends one chunk per file, in request order.  A file it could
+  // not read gets an error chunk, with FLAG_MORE_CHUNKS still set if more
+  // files follow.  An error chunk without FLAG_MORE_CHUNKS before the last
+  // file means the whole request failed.
+  for (size_t n = 0; n < files.size(); ++n) {
+    auto& result = results[resultIndices[n]];
+    const auto& blobHash = blobHashes[resultIndices[n]];
+    auto header = readRawChunkHeader();
+    if ((header.flags & FLAG_ERROR) != 0) {
+      bool moreChunks = (header.flags & FLAG_MORE_CHUNKS) != 0;
+      try {
+        readErrorAndThrow(header);
+      } catch (const HgImportPyError& ex) {
+        if (!moreChunks && n + 1 < files.size()) {
+          throw;
+        }
+        result = folly::Try<unique_ptr<Blob>>(
+            folly::exception_wrapper{std::current_exception(), ex});
+      }
+      continue;
+    }
+    checkTransactionID(header, requestID, "CMD_CAT_FILES");
+    try {
+      result = folly::Try<unique_ptr<Blob>>(readFileResponseBody(
+          header,
+          blobHash,
+          files[n].first,
+          files[n].second,
+          "CMD_CAT_FILES"));
+    } catch (const HgImporterError&) {
+      // Errors communicating with the helper fail the whole batch.
+      throw;
+    } catch (const std::exception& ex) {
+      result = folly::Try<unique_ptr<Blob>>(
+          folly::exception_wrapper{std::current_exception(), ex});
+    }
+  }
+
+  XLOG(DBG4) << "imported " << files.size() << " blobs in "
+             << watch.elapsed().count() << "ms";
+  stats_->hgBackingStoreGetBlobBatch.addValue(watch.elapsed().count());
+  return results;
+}
+
+unique_ptr<Blob> HgImporter::readFileResponseBody(
+    const ChunkHeader& header,
+    const Hash& blobHash,
+    RelativePathPiece path,
+    const Hash& revHash,
+    StringPiece cmdName) {
+#ifndef _WIN32
+  if ((header.flags & FLAG_SHARED_MEMORY) != 0) {
+    return readSharedMemoryFileBody(header, blobHash, cmdName);
+  }
+#endif
+
+  // Read the whole body before validating it, so that the next response can
+  // still be read if this one is malformed.
+  auto buf = IOBuf(IOBuf::CREATE, header.dataLength);
+  readFromHelper(
+      buf.writableTail(),
+      header.dataLength,
+      folly::to<string>(cmdName, " response body"));
+  buf.append(header.dataLength);
+
   if (header.dataLength < sizeof(uint64_t)) {
     auto msg = folly::to<string>(
-        "CMD_CAT_FILE response for blob ",
+        cmdName,
+        " response for blob ",
         blobHash,
         " (",
-        hgInfo.path(),
+        path,
         ", ",
-        hgInfo.revHash(),
+        revHash,
         ") from hg_import_helper.py is too "
         "short for body length field: length = ",
         header.dataLength);
     XLOG(ERR) << msg;
     throw std::runtime_error(std::move(msg));
   }
-  auto buf = IOBuf(IOBuf::CREATE, header.dataLength);
-
-  readFromHelper(
-      buf.writableTail(), header.dataLength, "CMD_CAT_FILE response body");
-  buf.append(header.dataLength);
 
   // The last 8 bytes of the response are the body length.
   // Ensure that this looks correct, and advance the buffer past this data to
@@ -541,9 +720,9 @@ unique_ptr<Blob> HgImporter::importFileContents(Hash blobHash) {
         "inconsistent body length received when importing blob ",
         blobHash,
         " (",
-        hgInfo.path(),
+        path,
         ", ",
-        hgInfo.revHash(),
+        revHash,
         "): bodyLength=",
         bodyLength,
         " responseLength=",
@@ -552,13 +731,90 @@ unique_ptr<Blob> HgImporter::importFileContents(Hash blobHash) {
     throw std::runtime_error(std::move(msg));
   }
 
-  XLOG(DBG4) << "imported blob " << blobHash << " (" << hgInfo.path() << ", "
-             << hgInfo.revHash() << "); length=" << bodyLength;
+  XLOG(DBG4) << "imported blob " << blobHash << " (" << path << ", " << revHash
+             << "); length=" << bodyLength;
 
-  stats_->hgBackingStoreGetBlob.addValue(watch.elapsed().count());
   return make_unique<Blob>(blobHash, std::move(buf));
 }
 
+#ifndef _WIN32
+unique_ptr<Blob> HgImporter::readSharedMemoryFileBody(
+    const ChunkHeader& header,
+    const Hash& blobHash,
+    StringPiece cmdName) {
+  // The body is the name of a file in the shared memory directory, followed
+  // by the 8-byte length of its contents.
+  auto buf = IOBuf(IOBuf::CREATE, header.dataLength);
+  readFromHelper(
+      buf.writableTail(),
+      header.dataLength,
+      folly::to<string>(cmdName, " shared memory response body"));
+  buf.append(header.dataLength);
+
+  if (header.dataLength < sizeof(uint64_t)) {
+    throw std::runtime_error(folly::to<string>(
+        cmdName,
+        " shared memory response for blob ",
+        blobHash,
+        " is too short for body length field: length = ",
+        header.dataLength));
+  }
+  Cursor cursor(&buf);
+  auto name = cursor.readFixedString(header.dataLength - sizeof(uint64_t));
+  auto bodyLength = cursor.readBE<uint64_t>();
+  if (!sharedMemoryDir_ || name.empty() ||
+      name.find('/') != string::npos || name == "." || name == "..") {
+    throw std::runtime_error(folly::to<string>(
+        "unexpected shared memory response for blob ",
+        blobHash,
+        ": file name \"",
+        folly::cEscape<string>(name),
+        "\""));
+  }
+
+  // Unlink the file as soon as it is open, so that its memory is freed once
+  // the mapping below goes away, even if we crash.
+  auto path = *sharedMemoryDir_ + PathComponentPiece{name};
+  folly::File file{path.value(), O_RDONLY | O_CLOEXEC};
+  folly::checkUnixError(
+      unlink(path.value().c_str()), "error unlinking ", path.value());
+
+  struct stat st;
+  folly::checkUnixError(fstat(file.fd(), &st), "error statting ", path.value());
+  if (static_cast<uint64_t>(st.st_size) != bodyLength) {
+    throw std::runtime_error(folly::to<string>(
+        "inconsistent body length received when importing blob ",
+        blobHash,
+        " through shared memory: bodyLength=",
+        bodyLength,
+        " fileLength=",
+        st.st_size));
+  }
+  if (bodyLength == 0) {
+    return make_unique<Blob>(blobHash, IOBuf{});
+  }
+
+  auto* data = mmap(nullptr, bodyLength, PROT_READ, MAP_SHARED, file.fd(), 0);
+  if (data == MAP_FAILED) {
+    folly::throwSystemError("error mapping ", path.value());
+  }
+  XLOG(DBG4) << "imported blob " << blobHash
+             << " through shared memory; length=" << bodyLength;
+
+  // The mapping stays valid after the file is closed, and is unmapped when the
+  // last reference to the Blob's contents goes away.
+  IOBuf contents{
+      IOBuf::TAKE_OWNERSHIP,
+      data,
+      bodyLength,
+      [](void* buf, void* userData) {
+        munmap(buf, reinterpret_cast<uintptr_t>(userData));
+      },
+      reinterpret_cast<void*>(static_cast<uintptr_t>(bodyLength))};
+  return make_unique<Blob>(blobHash, std::move(contents));
+}
+#endif
+
 void HgImporter::prefetchFiles(
     const std::vector<std::pair<RelativePath, Hash>>& files) {
   auto requestID = sendPrefetchFilesRequest(files);
@@ -655,6 +911,19 @@ void HgImporter::readManifestEntry(
 HgImporter::ChunkHeader HgImporter::readChunkHeader(
     TransactionID txnID,
     StringPiece cmdName) {
+  auto header = readRawChunkHeader();
+
+  // If the header indicates an error, read the error message
+  // and throw an exception.
+  if ((header.flags & FLAG_ERROR) != 0) {
+    readErrorAndThrow(header);
+  }
+
+  checkTransactionID(header, txnID, cmdName);
+  return header;
+}
+
+HgImporter::ChunkHeader HgImporter::readRawChunkHeader() {
   ChunkHeader header;
   readFromHelper(&header, sizeof(header), "response header");
 
@@ -662,13 +931,13 @@ HgImporter::ChunkHeader HgImporter::readChunkHeader(
   header.command = Endian::big(header.command);
   header.flags = Endian::big(header.flags);
   header.dataLength = Endian::big(header.dataLength);
+  return header;
+}
 
-  // If the header indicates an error, read the error message
-  // and throw an exception.
-  if ((header.flags & FLAG_ERROR) != 0) {
-    readErrorAndThrow(header);
-  }
-
+void HgImporter::checkTransactionID(
+    const ChunkHeader& header,
+    TransactionID txnID,
+    StringPiece cmdName) {
   if (header.requestID != txnID) {
     auto err = HgImporterError(
         "received unexpected transaction ID (",
@@ -681,8 +950,6 @@ HgImporter::ChunkHeader HgImporter::readChunkHeader(
     XLOG(ERR) << err.what();
     throw err;
   }
-
-  return header;
 }
 
 [[noreturn]] void HgImporter::readErrorAndThrow(const ChunkHeader& header) {
@@ -776,6 +1043,53 @@ HgImporter::TransactionID HgImporter::sendFileRequest(
   return txnID;
 }
 
+HgImporter::TransactionID HgImporter::sendFilesRequest(
+    const std::vector<std::pair<RelativePath, Hash>>& files) {
+#if defined(EDEN_HAVE_STATS)
+  stats_->catFiles.addValue(1);
+#endif
+
+  auto txnID = nextRequestID_++;
+  ChunkHeader header;
+  header.command = Endian::big<uint32_t>(CMD_CAT_FILES);
+  header.requestID = Endian::big<uint32_t>(txnID);
+  header.flags = 0;
+
+  // Compute the length of the body
+  size_t dataLength = sizeof(uint32_t);
+  for (const auto& pair : files) {
+    dataLength +=
+        sizeof(uint32_t) + Hash::RAW_SIZE + pair.first.stringPiece().size();
+  }
+  if (dataLength > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error(
+        folly::to<string>("cat files request is too large: ", dataLength));
+  }
+  header.dataLength = Endian::big<uint32_t>(dataLength);
+
+  // Serialize the body: the file count, then for each file its path length,
+  // its binary revision hash, and its path.
+  IOBuf buf(IOBuf::CREATE, dataLength);
+  Appender appender(&buf, 0);
+  appender.writeBE<uint32_t>(files.size());
+  for (const auto& pair : files) {
+    auto fileName = pair.first.stringPiece();
+    appender.writeBE<uint32_t>(fileName.size());
+    appender.push(pair.second.getBytes());
+    appender.push(fileName);
+  }
+  DCHECK_EQ(buf.length(), dataLength);
+
+  std::array<struct iovec, 2> iov;
+  iov[0].iov_base = &header;
+  iov[0].iov_len = sizeof(header);
+  iov[1].iov_base = const_cast<uint8_t*>(buf.data());
+  iov[1].iov_len = buf.length();
+  writeToHelper(iov, "CMD_CAT_FILES");
+
+  return txnID;
+}
+
 HgImporter::TransactionID HgImporter::sendPrefetchFilesRequest(
     const std::vector<std::pair<RelativePath, Hash>>& files) {
 #if defined(EDEN_HAVE_STATS)
@@ -1001,6 +1315,47 @@ unique_ptr<Blob> HgImporterManager::importFileContents(Hash blobHash) {
   });
 }
 
+std::vector<folly::Try<unique_ptr<Blob>>>
+HgImporterManager::importFileContentsBatch(
+    const std::vector<Hash>& blobHashes) {
+  auto results = retryOnError([&](HgImporter* importer) {
+    return importer->importFileContentsBatch(blobHashes);
+  });
+
+  // Errors for individual files are returned rather than thrown, so
+  // retryOnError() does not see them.  If the helper asked to be restarted
+  // while reading some of the files, restart it and retry those files once.
+  std::vector<size_t> retryIndices;
+  std::vector<Hash> retryHashes;
+  for (size_t n = 0; n < results.size(); ++n) {
+    if (!results[n].hasException()) {
+      continue;
+    }
+    bool resetRepo = false;
+    results[n].exception().with_exception([&](const HgImportPyError& ex) {
+      resetRepo = ex.errorType() == "ResetRepoError";
+    });
+    if (resetRepo) {
+      retryIndices.push_back(n);
+      retryHashes.push_back(blobHashes[n]);
+    }
+  }
+  if (retryHashes.empty()) {
+    return results;
+  }
+
+  resetHgImporter(*results[retryIndices[0]].exception().get_exception());
+  XLOG(INFO) << "restarting hg_import_helper and retrying "
+             << retryHashes.size() << " files";
+  auto retried = retryOnError([&](HgImporter* importer) {
+    return importer->importFileContentsBatch(retryHashes);
+  });
+  for (size_t n = 0; n < retryIndices.size(); ++n) {
+    results[retryIndices[n]] = std::move(retried[n]);
+  }
+  return results;
+}
+
 void HgImporterManager::prefetchFiles(
     const std::vector<std::pair<RelativePath, Hash>>& files) {
   return retryOnError(
@@ -10,7 +10,9 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Try.h>
 #include <optional>
+#include <vector>
 #ifndef _WIN32
 #include <folly/Subprocess.h>
 #else
@@ -68,6 +70,12 @@ struct ImporterOptions {
    * The name of the repo
    */
   std::string repoName;
+
+  /**
+   * Whether the helper may send large file contents through files in the
+   * shared memory directory rather than over the pipe.
+   */
+  bool sharedMemoryTransfer{false};
 };
 
 class Importer {
@@ -101,6 +109,15 @@ class Importer {
    */
   virtual std::unique_ptr<Blob> importFileContents(Hash blobHash) = 0;
 
+  /**
+   * Import the contents of several files with a single request.
+   *
+   * Returns one result per requested hash, in the same order.  A failure to
+   * import one file is reported in its result and does not affect the others.
+   */
+  virtual std::vector<folly::Try<std::unique_ptr<Blob>>>
+  importFileContentsBatch(const std::vector<Hash>& blobHashes) = 0;
+
   virtual void prefetchFiles(
       const std::vector<std::pair<RelativePath, Hash>>& files) = 0;
 
@@ -151,6 +168,8 @@ class HgImporter : public Importer {
   Hash importFlatManifest(folly::StringPiece revName) override;
   Hash resolveManifestNode(folly::StringPiece revName) override;
   std::unique_ptr<Blob> importFileContents(Hash blobHash) override;
+  std::vector<folly::Try<std::unique_ptr<Blob>>> importFileContentsBatch(
+      const std::vector<Hash>& blobHashes) override;
   void prefetchFiles(
       const std::vector<std::pair<RelativePath, Hash>>& files) override;
   void fetchTree(RelativePathPiece path, Hash pathManifestNode) override;
@@ -166,6 +185,7 @@ class HgImporter : public Importer {
   enum : uint32_t {
     FLAG_ERROR = 0x01,
     FLAG_MORE_CHUNKS = 0x02,
+    FLAG_SHARED_MEMORY = 0x04,
   };
   /**
    * hg_import_helper protocol version number.
@@ -178,7 +198,7 @@ class HgImporter : public Importer {
    * hg_import_helper.py
    */
   enum : uint32_t {
-    PROTOCOL_VERSION = 1,
+    PROTOCOL_VERSION = 3,
   };
   /**
    * Flags for the CMD_STARTED response
@@ -186,6 +206,7 @@ class HgImporter : public Importer {
   enum StartFlag : uint32_t {
     TREEMANIFEST_SUPPORTED = 0x01,
     MONONOKE_SUPPORTED = 0x02,
+    SHARED_MEMORY_SUPPORTED = 0x04,
   };
   /**
    * Command type values.
@@ -202,6 +223,7 @@ class HgImporter : public Importer {
     CMD_FETCH_TREE = 5,
     CMD_PREFETCH_FILES = 6,
     CMD_CAT_FILE = 7,
+    CMD_CAT_FILES = 8,
   };
   using TransactionID = uint32_t;
   struct ChunkHeader {
@@ -247,6 +269,50 @@ class HgImporter : public Importer {
    */
   ChunkHeader readChunkHeader(TransactionID txnID, folly::StringPiece cmdName);
 
+  /**
+   * Read a response chunk header without checking it for errors or for the
+   * expected transaction ID.
+   */
+  ChunkHeader readRawChunkHeader();
+
+  /**
+   * Throw an HgImporterError if the header's transaction ID is not txnID.
+   */
+  void checkTransactionID(
+      const ChunkHeader& header,
+      TransactionID txnID,
+      folly::StringPiece cmdName);
+
+  /**
+   * Read the body of a CMD_CAT_FILE response, or of one file's chunk in a
+   * CMD_CAT_FILES response, and return it as a Blob.
+   */
+  std::unique_ptr<Blob> readFileResponseBody(
+      const ChunkHeader& header,
+      const Hash& blobHash,
+      RelativePathPiece path,
+      const Hash& revHash,
+      folly::StringPiece cmdName);
+
+#ifndef _WIN32
+  /**
+   * Read the body of a file response chunk sent with FLAG_SHARED_MEMORY, and
+   * return a Blob that refers directly to the shared memory.
+   */
+  std::unique_ptr<Blob> readSharedMemoryFileBody(
+      const ChunkHeader& header,
+      const Hash& blobHash,
+      folly::StringPiece cmdName);
+
+  /**
+   * Create the private directory the helper writes large file contents to.
+   * Leaves sharedMemoryDir_ unset if shared memory transfer is disabled or
+   * the directory cannot be created.
+   */
+  void createSharedMemoryDir();
+  void removeSharedMemoryDir();
+#endif
+
   /**
    * Read the body of an error message, and throw it as an exception.
    */
@@ -272,6 +338,12 @@ class HgImporter : public Importer {
    * of the given file at the specified file revision.
    */
   TransactionID sendFileRequest(RelativePathPiece path, Hash fileRevHash);
+  /**
+   * Send a single request to the helper process, asking it to send us the
+   * contents of each of the given (path, file revision) pairs.
+   */
+  TransactionID sendFilesRequest(
+      const std::vector<std::pair<RelativePath, Hash>>& files);
   /**
    * Send a request to the helper process, asking it to send us the
    * manifest node (NOT the full manifest!) for the specified revision.
@@ -313,6 +385,13 @@ class HgImporter : public Importer {
 
   edenfd_t helperIn_{kInvalidFd};
   edenfd_t helperOut_{kInvalidFd};
+
+  /**
+   * A directory on a memory-backed file system that the helper writes large
+   * file contents to.  Each file is unlinked as soon as it has been opened,
+   * and the directory is removed when the helper is stopped.
+   */
+  std::optional<AbsolutePath> sharedMemoryDir_;
 };
 
 class HgImporterError : public std::exception {
@@ -347,6 +426,8 @@ class HgImporterManager : public Importer {
   Hash resolveManifestNode(folly::StringPiece revName) override;
 
   std::unique_ptr<Blob> importFileContents(Hash blobHash) override;
+  std::vector<folly::Try<std::unique_ptr<Blob>>> importFileContentsBatch(
+      const std::vector<Hash>& blobHashes) override;
   void prefetchFiles(
       const std::vector<std::pair<RelativePath, Hash>>& files) override;
   void fetchTree(RelativePathPiece path, Hash pathManifestNode) override;
@@ -16,6 +16,7 @@ import logging
 import os
 import struct
 import sys
+import tempfile
 import time
 
 
@@ -104,10 +105,11 @@ SHA1_NUM_BYTES = 20
 #
 # This must be kept in sync with the PROTOCOL_VERSION field in the C++
 # HgImporter code.
-PROTOCOL_VERSION = 1
+PROTOCOL_VERSION = 3
 
 START_FLAGS_TREEMANIFEST_SUPPORTED = 0x01
 START_FLAGS_MONONOKE_SUPPORTED = 0x02
+START_FLAGS_SHARED_MEMORY_SUPPORTED = 0x04
 
 #
 # Message types.
@@ -123,6 +125,7 @@ CMD_MANIFEST_NODE_FOR_COMMIT = 4
 CMD_FETCH_TREE = 5
 CMD_PREFETCH_FILES = 6
 CMD_CAT_FILE = 7
+CMD_CAT_FILES = 8
 
 #
 # Flag values.
@@ -140,6 +143,19 @@ FLAG_ERROR = 0x01
 #   same request/response.  If this flag is not set, this is the final chunk in
 #   this request/response.
 FLAG_MORE_CHUNKS = 0x02
+# FLAG_SHARED_MEMORY:
+# - This is only set on CMD_CAT_FILE and CMD_CAT_FILES responses, and only if
+#   START_FLAGS_SHARED_MEMORY_SUPPORTED was sent in CMD_STARTED.  The file
+#   contents were written to a file in the shared memory directory, and the
+#   chunk body contains <file_name><file_size> instead of the contents.  The
+#   receiver is responsible for unlinking the file.
+FLAG_SHARED_MEMORY = 0x04
+
+# Environment variables set by edenfs to enable shared memory transfer of
+# large file contents.  These are passed in the environment rather than as
+# arguments so that older helpers simply ignore them.
+SHARED_MEMORY_DIR_ENV_VAR = "EDEN_HG_IMPORT_SHARED_MEMORY_DIR"
+SHARED_MEMORY_THRESHOLD_ENV_VAR = "EDEN_HG_IMPORT_SHARED_MEMORY_THRESHOLD"
 
 
 class Request(object):
@@ -233,6 +249,18 @@ class HgServer(object):
         self.repo = None
         self.ui = None
 
+        self.shared_memory_dir = os.environ.get(SHARED_MEMORY_DIR_ENV_VAR) or None
+        try:
+            self.shared_memory_threshold = int(
+                os.environ.get(SHARED_MEMORY_THRESHOLD_ENV_VAR, "0")
+            )
+        except ValueError:
+            self.shared_memory_threshold = 0
+        if self.shared_memory_threshold <= 0 or not (
+            self.shared_memory_dir and os.access(self.shared_memory_dir, os.W_OK)
+        ):
+            self.shared_memory_dir = None
+
         # Populate our command dictionary
         self._commands = {}
         for member_name in dir(self):
@@ -341,6 +369,9 @@ class HgServer(object):
         if use_mononoke:
             flags |= START_FLAGS_MONONOKE_SUPPORTED
 
+        if self.shared_memory_dir is not None:
+            flags |= START_FLAGS_SHARED_MEMORY_SUPPORTED
+
         # Options format:
         # - Protocol version number
         # - Is treemanifest supported?
@@ -478,6 +509,9 @@ class HgServer(object):
         Response body format:
         - <file_contents>
         - <file_size>
+
+        If the response has FLAG_SHARED_MEMORY set, <file_contents> is instead
+        the name of a file in the shared memory directory holding the contents.
         """
         if len(request.body) < SHA1_NUM_BYTES + 1:
             raise Exception("cat_file request data too short")
@@ -492,8 +526,74 @@ class HgServer(object):
         )
 
         contents = self.get_file(path, rev_hash)
-        length_data = struct.pack(b">Q", len(contents))
-        self.send_chunk(request, contents, length_data)
+        self.send_file_contents(request, contents)
+
+    @cmd(CMD_CAT_FILES)
+    def cmd_cat_files(self, request):
+        """CMD_CAT_FILES: get the contents of several files.
+
+        Request body format:
+        - <num_files>
+        - <path_length><rev_hash><path> for each file
+          Fields:
+          - <num_files>: The number of files, as a 32-bit big-endian integer.
+          - <path_length>: The length of <path>, as a 32-bit big-endian integer.
+          - <rev_hash>: The file revision hash, as a 20-byte binary value.
+          - <path>: The file path, relative to the root of the repository.
+
+        Response:
+          One chunk per requested file, in request order.  FLAG_MORE_CHUNKS is
+          set on all but the last chunk.  Each chunk has the same body format as
+          a CMD_CAT_FILE response.
+
+          If a single file cannot be read, its chunk is an error chunk instead,
+          and the remaining files are still sent.  An error chunk without
+          FLAG_MORE_CHUNKS before the last file means the whole request failed.
+        """
+        files = self._parse_cat_files_request(request.body)
+        self.debug("(pid:%s) getting contents of %d files", os.getpid(), len(files))
+
+        # Fetch any file revisions missing from the local cache in one
+        # round trip to the server, rather than one per file.
+        if hasattr(self.repo, "fileservice"):
+            try:
+                self.repo.fileservice.prefetch(
+                    [(path, hex(rev_hash)) for path, rev_hash in files]
+                )
+            except Exception:
+                logging.exception("error prefetching files for CMD_CAT_FILES")
+
+        for idx, (path, rev_hash) in enumerate(files):
+            is_last = idx == len(files) - 1
+            try:
+                contents = self.get_file(path, rev_hash)
+            except Exception as ex:
+                logging.exception(
+                    "error getting contents of file %r revision %s",
+                    path,
+                    hex(rev_hash),
+                )
+                self.send_exception(request, ex, is_last=is_last)
+                continue
+            self.send_file_contents(request, contents, is_last=is_last)
+
+    def _parse_cat_files_request(self, body):
+        [num_files] = struct.unpack_from(b">I", body, 0)
+        offset = 4  # struct.calcsize(">I")
+        files = []
+        for _ in range(num_files):
+            [path_length] = struct.unpack_from(b">I", body, offset)
+            offset += 4
+            rev_hash = body[offset : offset + SHA1_NUM_BYTES]
+            offset += SHA1_NUM_BYTES
+            path = body[offset : offset + path_length]
+            offset += path_length
+            if len(rev_hash) < SHA1_NUM_BYTES or len(path) < path_length:
+                raise Exception("cat_files request data too short")
+            files.append((path, rev_hash))
+        if offset != len(body):
+            raise Exception("cat_files request has trailing data")
+        return files
 
     @cmd(CMD_MANIFEST_NODE_FOR_COMMIT)
     def cmd_manifest_node_for_commit(self, request):
@@ -590,10 +690,49 @@ class HgServer(object):
             request.txn_id, command=CMD_RESPONSE, flags=flags, data_blocks=data
         )
 
-    def send_exception(self, request, exc):
-        self.send_error(request, type(exc).__name__, str(exc))
+    def send_file_contents(self, request, contents, is_last=True):
+        length_data = struct.pack(b">Q", len(contents))
+        if (
+            self.shared_memory_dir is not None
+            and len(contents) >= self.shared_memory_threshold
+        ):
+            try:
+                name = self._write_shared_memory_file(contents)
+            except Exception:
+                logging.exception(
+                    "error writing to shared memory; falling back to the pipe"
+                )
+            else:
+                flags = FLAG_SHARED_MEMORY
+                if not is_last:
+                    flags |= FLAG_MORE_CHUNKS
+                self._send_chunk(
+                    request.txn_id,
+                    command=CMD_RESPONSE,
+                    flags=flags,
+                    data_blocks=(name, length_data),
+                )
+                return
+
+        self.send_chunk(request, contents, length_data, is_last=is_last)
+
+    def _write_shared_memory_file(self, contents):
+        fd, path = tempfile.mkstemp(dir=self.shared_memory_dir, prefix="blob.")
+        try:
+            with os.fdopen(fd, "wb") as f:
+                f.write(contents)
+        except Exception:
+            os.unlink(path)
+            raise
+        name = os.path.basename(path)
+        if not isinstance(name, bytes):
+            name = name.encode("utf-8")
+        return name
 
-    def send_error(self, request, error_type, message):
+    def send_exception(self, request, exc, is_last=True):
+        self.send_error(request, type(exc).__name__, str(exc), is_last=is_last)
+
+    def send_error(self, request, error_type, message, is_last=True):
         txn_id = 0
         if request is not None:
             txn_id = request.txn_id
@@ -606,8 +745,11 @@ class HgServer(object):
                 message,
             ]
         )
+        flags = FLAG_ERROR
+        if not is_last:
+            flags |= FLAG_MORE_CHUNKS
         self._send_chunk(
-            txn_id, command=CMD_RESPONSE, flags=FLAG_ERROR, data_blocks=(data,)
+            txn_id, command=CMD_RESPONSE, flags=flags, data_blocks=(data,)
         )
 
     def _send_chunk(self, txn_id, command, flags, data_blocks):
@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/String.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/init/Init.h>
+#include <folly/stop_watch.h>
+#include <gflags/gflags.h>
+#include <algorithm>
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/hg/HgImporter.h"
+#include "eden/fs/testharness/HgRepo.h"
+#include "eden/fs/tracing/EdenStats.h"
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+using folly::test::TemporaryDirectory;
+
+DEFINE_uint64(files, 2000, "Number of files in the test repository");
+DEFINE_uint64(file_size, 4096, "Size of each file in bytes");
+DEFINE_string(
+    batch_sizes,
+    "1,8,32,128",
+    "Comma-separated list of CAT_FILES batch sizes to measure");
+
+namespace {
+
+void collectBlobs(
+    LocalStore& localStore,
+    const Hash& treeHash,
+    std::vector<Hash>& blobs) {
+  auto tree = localStore.getTree(treeHash).get(10s);
+  for (const auto& entry : tree->getTreeEntries()) {
+    if (entry.isTree()) {
+      collectBlobs(localStore, entry.getHash(), blobs);
+    } else {
+      blobs.push_back(entry.getHash());
+    }
+  }
+}
+
+void benchmarkBatchImport() {
+  // Measures blob import throughput from the hg import helper, sending
+  // CMD_CAT_FILE for a batch size of 1 and CMD_CAT_FILES otherwise.  Every
+  // batch size uses a fresh helper process so the results are comparable.
+  TemporaryDirectory testDir{"eden_hg_import_batch_benchmark"};
+  AbsolutePath testPath{testDir.path().string()};
+  HgRepo repo{testPath + "repo"_pc};
+  repo.hgInit();
+
+  std::string contents(FLAGS_file_size, 'x');
+  for (uint64_t i = 0; i < FLAGS_files; ++i) {
+    auto dir = folly::to<std::string>("dir", i % 100);
+    if (i < 100) {
+      repo.mkdir(dir);
+    }
+    repo.writeFile(folly::to<std::string>(dir, "/file", i), contents);
+  }
+  repo.hg("add");
+  auto commit = repo.commit("Initial commit");
+
+  MemoryLocalStore localStore;
+  auto stats = std::make_shared<HgImporterThreadStats>();
+  Hash rootTreeHash;
+  {
+    HgImporter importer(repo.path(), &localStore, stats);
+    rootTreeHash = importer.importFlatManifest(commit.toString());
+  }
+  std::vector<Hash> blobs;
+  collectBlobs(localStore, rootTreeHash, blobs);
+
+  std::vector<size_t> batchSizes;
+  folly::split(',', FLAGS_batch_sizes, batchSizes);
+
+  printf(
+      "Importing %zu blobs of %" PRIu64 " bytes\n",
+      blobs.size(),
+      FLAGS_file_size);
+  for (auto batchSize : batchSizes) {
+    if (batchSize == 0) {
+      continue;
+    }
+    HgImporter importer(repo.path(), &localStore, stats);
+
+    folly::stop_watch<> timer;
+    for (size_t start = 0; start < blobs.size(); start += batchSize) {
+      auto end = std::min(start + batchSize, blobs.size());
+      if (batchSize == 1) {
+        importer.importFileContents(blobs[start]);
+      } else {
+        std::vector<Hash> batch{blobs.begin() + start, blobs.begin() + end};
+        for (auto& result : importer.importFileContentsBatch(batch)) {
+          result.throwIfFailed();
+        }
+      }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+        timer.elapsed());
+
+    printf(
+        "batch size %4zu: %10.0f blobs/sec\n",
+        batchSize,
+        blobs.size() / elapsed.count());
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+
+  if (FLAGS_files == 0) {
+    fprintf(stderr, "error: files must be nonzero\n");
+    return 1;
+  }
+
+  benchmarkBatchImport();
+
+  return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/hg/HgImportRequestQueue.h"
+
+#include <folly/test/TestUtils.h>
+#include <gtest/gtest.h>
+#include <thread>
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/testharness/TestUtil.h"
+#include "eden/fs/tracing/EdenStats.h"
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+using namespace std::chrono_literals;
+
+namespace {
+
+class HgImportRequestQueueTest : public ::testing::Test {
+ protected:
+  // Take the next request, which must be a single blob import, and complete
+  // it.  Returns the blob ID.
+  Hash runNextBlob() {
+    auto batch = queue_.dequeue(1);
+    EXPECT_TRUE(batch);
+    EXPECT_EQ(1, batch->blobs.size());
+    auto& import = batch->blobs[0];
+    HgImportRequestQueue::setBlobResult(
+        import, std::make_unique<Blob>(import.id, "contents"_sp));
+    return import.id;
+  }
+
+  std::shared_ptr<EdenStats> stats_ = std::make_shared<EdenStats>();
+  // Disable aging unless a test needs it.
+  HgImportRequestQueue queue_{stats_, 0ms};
+};
+
+} // namespace
+
+TEST_F(HgImportRequestQueueTest, emptyQueue) {
+  EXPECT_FALSE(queue_.dequeue(8));
+}
+
+TEST_F(HgImportRequestQueueTest, moreUrgentClassesGoFirst) {
+  auto prefetch = queue_.enqueueBlob(
+      makeTestHash("1"), ImportPriorityClass::Prefetch);
+  auto background = queue_.enqueueBlob(
+      makeTestHash("2"), ImportPriorityClass::Background);
+  auto interactive = queue_.enqueueBlob(
+      makeTestHash("3"), ImportPriorityClass::Interactive);
+  auto thrift =
+      queue_.enqueueBlob(makeTestHash("4"), ImportPriorityClass::Thrift);
+
+  EXPECT_EQ(1, queue_.getQueueDepth(ImportPriorityClass::Interactive));
+  EXPECT_EQ(makeTestHash("3"), runNextBlob());
+  EXPECT_EQ(makeTestHash("4"), runNextBlob());
+  EXPECT_EQ(makeTestHash("1"), runNextBlob());
+  EXPECT_EQ(makeTestHash("2"), runNextBlob());
+  EXPECT_FALSE(queue_.dequeue(1));
+
+  EXPECT_EQ(makeTestHash("3"), std::move(interactive).get()->getHash());
+  EXPECT_EQ(makeTestHash("2"), std::move(background).get()->getHash());
+}
+
+TEST_F(HgImportRequestQueueTest, sameClassIsFifo) {
+  auto first = queue_.enqueue(ImportPriorityClass::Thrift, [] { return 1; });
+  auto second = queue_.enqueue(ImportPriorityClass::Thrift, [] { return 2; });
+
+  auto batch = queue_.dequeue(8);
+  ASSERT_TRUE(batch);
+  batch->work();
+  EXPECT_TRUE(first.isReady());
+  EXPECT_FALSE(second.isReady());
+  EXPECT_EQ(1, std::move(first).get());
+}
+
+TEST_F(HgImportRequestQueueTest, duplicateBlobRequestsAreMerged) {
+  auto id = makeTestHash("1");
+  auto first = queue_.enqueueBlob(id, ImportPriorityClass::Prefetch);
+  auto second = queue_.enqueueBlob(id, ImportPriorityClass::Prefetch);
+  EXPECT_EQ(1, queue_.getQueueDepth(ImportPriorityClass::Prefetch));
+
+  EXPECT_EQ(id, runNextBlob());
+  EXPECT_FALSE(queue_.dequeue(1));
+
+  auto firstBlob = std::move(first).get();
+  auto secondBlob = std::move(second).get();
+  EXPECT_NE(firstBlob.get(), secondBlob.get());
+  EXPECT_EQ("contents", firstBlob->getContents().clone()->moveToFbString());
+  EXPECT_EQ("contents", secondBlob->getContents().clone()->moveToFbString());
+}
+
+TEST_F(HgImportRequestQueueTest, duplicateRequestRaisesPriority) {
+  auto prefetched = makeTestHash("1");
+  auto other = makeTestHash("2");
+  auto first = queue_.enqueueBlob(prefetched, ImportPriorityClass::Background);
+  auto thrift = queue_.enqueueBlob(other, ImportPriorityClass::Thrift);
+  auto second =
+      queue_.enqueueBlob(prefetched, ImportPriorityClass::Interactive);
+
+  EXPECT_EQ(0, queue_.getQueueDepth(ImportPriorityClass::Background));
+  EXPECT_EQ(1, queue_.getQueueDepth(ImportPriorityClass::Interactive));
+  EXPECT_EQ(prefetched, runNextBlob());
+  EXPECT_EQ(other, runNextBlob());
+  // The stale entry left in the background queue is skipped.
+  EXPECT_FALSE(queue_.dequeue(1));
+  EXPECT_TRUE(first.isReady());
+  EXPECT_TRUE(second.isReady());
+}
+
+TEST_F(HgImportRequestQueueTest, raisingPriorityWithoutANewRequest) {
+  auto id = makeTestHash("1");
+  auto blob = queue_.enqueueBlob(id, ImportPriorityClass::Prefetch);
+  auto tree = queue_.enqueueKeyed(
+      ImportPriorityClass::Background, "tree:foo", [] {});
+
+  queue_.raiseBlobPriority(id, ImportPriorityClass::Interactive);
+  queue_.raiseKeyedPriority("tree:foo", ImportPriorityClass::Thrift);
+  // Requests that are not pending are ignored.
+  queue_.raiseBlobPriority(makeTestHash("2"), ImportPriorityClass::Thrift);
+  queue_.raiseKeyedPriority("tree:bar", ImportPriorityClass::Thrift);
+
+  EXPECT_EQ(1, queue_.getQueueDepth(ImportPriorityClass::Interactive));
+  EXPECT_EQ(1, queue_.getQueueDepth(ImportPriorityClass::Thrift));
+  EXPECT_EQ(0, queue_.getQueueDepth(ImportPriorityClass::Prefetch));
+  EXPECT_EQ(0, queue_.getQueueDepth(ImportPriorityClass::Background));
+  EXPECT_EQ(id, runNextBlob());
+  EXPECT_TRUE(blob.isReady());
+}
+
+TEST_F(HgImportRequestQueueTest, keyedWorkIsMerged) {
+  int runs = 0;
+  auto first = queue_.enqueueKeyed(
+      ImportPriorityClass::Prefetch, "tree:foo", [&] { ++runs; });
+  auto second = queue_.enqueueKeyed(
+      ImportPriorityClass::Thrift, "tree:foo", [&] { ++runs; });
+  auto third = queue_.enqueueKeyed(
+      ImportPriorityClass::Thrift, "tree:bar", [&] { ++runs; });
+
+  while (auto batch = queue_.dequeue(1)) {
+    batch->work();
+  }
+  EXPECT_EQ(2, runs);
+  EXPECT_TRUE(first.isReady());
+  EXPECT_TRUE(second.isReady());
+  EXPECT_TRUE(third.isReady());
+}
+
+TEST_F(HgImportRequestQueueTest, keyedWorkErrorsReachEveryWaiter) {
+  auto first = queue_.enqueueKeyed(ImportPriorityClass::Thrift, "key", [] {
+    throw std::runtime_error("fetch failed");
+  });
+  auto second =
+      queue_.enqueueKeyed(ImportPriorityClass::Thrift, "key", [] {});
+
+  queue_.dequeue(1)->work();
+  EXPECT_THROW_RE(std::move(first).get(), std::runtime_error, "fetch failed");
+  EXPECT_THROW_RE(std::move(second).get(), std::runtime_error, "fetch failed");
+}
+
+TEST_F(HgImportRequestQueueTest, blobImportsAreBatchedWithinAClass) {
+  std::vector<folly::SemiFuture<std::unique_ptr<Blob>>> futures;
+  for (int i = 0; i < 5; ++i) {
+    futures.push_back(queue_.enqueueBlob(
+        makeTestHash(folly::to<std::string>(i + 1)),
+        ImportPriorityClass::Prefetch));
+  }
+  auto work = queue_.enqueue(ImportPriorityClass::Prefetch, [] {});
+  auto thrift =
+      queue_.enqueueBlob(makeTestHash("99"), ImportPriorityClass::Thrift);
+
+  // The thrift blob goes first, on its own.
+  EXPECT_EQ(makeTestHash("99"), runNextBlob());
+
+  auto batch = queue_.dequeue(3);
+  ASSERT_TRUE(batch);
+  ASSERT_EQ(3, batch->blobs.size());
+  EXPECT_EQ(makeTestHash("1"), batch->blobs[0].id);
+  EXPECT_EQ(makeTestHash("2"), batch->blobs[1].id);
+  EXPECT_EQ(makeTestHash("3"), batch->blobs[2].id);
+  EXPECT_EQ(3, queue_.getQueueDepth(ImportPriorityClass::Prefetch));
+
+  // Blobs queued behind other work are still batched together.
+  batch = queue_.dequeue(8);
+  ASSERT_TRUE(batch);
+  ASSERT_EQ(2, batch->blobs.size());
+  EXPECT_EQ(makeTestHash("4"), batch->blobs[0].id);
+  EXPECT_EQ(makeTestHash("5"), batch->blobs[1].id);
+
+  batch = queue_.dequeue(8);
+  ASSERT_TRUE(batch);
+  EXPECT_TRUE(batch->blobs.empty());
+  batch->work();
+  EXPECT_TRUE(work.isReady());
+  EXPECT_FALSE(queue_.dequeue(8));
+}
+
+TEST_F(HgImportRequestQueueTest, failedBlobImportReachesEveryWaiter) {
+  auto id = makeTestHash("1");
+  auto first = queue_.enqueueBlob(id, ImportPriorityClass::Interactive);
+  auto second = queue_.enqueueBlob(id, ImportPriorityClass::Interactive);
+
+  auto batch = queue_.dequeue(1);
+  ASSERT_TRUE(batch);
+  HgImportRequestQueue::setBlobResult(
+      batch->blobs[0],
+      folly::Try<std::unique_ptr<Blob>>{
+          folly::make_exception_wrapper<std::runtime_error>("import failed")});
+  EXPECT_THROW_RE(std::move(first).get(), std::runtime_error, "import failed");
+  EXPECT_THROW_RE(
+      std::move(second).get(), std::runtime_error, "import failed");
+}
+
+TEST_F(HgImportRequestQueueTest, oldRequestsAgeIntoMoreUrgentClasses) {
+  HgImportRequestQueue queue{stats_, 10ms};
+  auto background =
+      queue.enqueueBlob(makeTestHash("1"), ImportPriorityClass::Background);
+  // Waiting more than three aging intervals makes the background request as
+  // urgent as an interactive one that just arrived, and it has waited longer.
+  std::this_thread::sleep_for(50ms);
+  auto interactive =
+      queue.enqueueBlob(makeTestHash("2"), ImportPriorityClass::Interactive);
+
+  auto batch = queue.dequeue(1);
+  ASSERT_TRUE(batch);
+  EXPECT_EQ(makeTestHash("1"), batch->blobs[0].id);
+}
@@ -7,9 +7,11 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <boost/filesystem.hpp>
 #include <folly/experimental/TestUtil.h>
 #include <folly/futures/Future.h>
 #include <folly/test/TestUtils.h>
+#include <gflags/gflags.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -32,6 +34,9 @@ using folly::test::TemporaryDirectory;
 using std::vector;
 using testing::ElementsAre;
 
+DECLARE_string(hgImportSharedMemoryDir);
+DECLARE_int32(hgImportSharedMemoryThreshold);
+
 namespace {
 
 class HgImportTest : public ::testing::Test {
@@ -168,3 +173,82 @@ TEST_F(HgImportTest, importerHelperExitsCleanly) {
   EXPECT_EQ(status.str(), "exited with status 0");
 }
 #endif
+
+TEST_F(HgImportTest, importFileContentsBatch) {
+  repo_.mkdir("foo");
+  StringPiece barData = "this is a test file\n";
+  repo_.writeFile("foo/bar.txt", barData);
+  StringPiece testData = "testing\n1234\ntesting\n";
+  repo_.writeFile("foo/test.txt", testData);
+  StringPiece mainData = "print('hello world\\n')\n";
+  repo_.writeFile("main.py", mainData);
+  repo_.hg("add");
+  auto commit1 = repo_.commit("Initial commit");
+
+  HgImporter importer(repo_.path(), &localStore_, stats_);
+  auto rootTreeHash = importer.importFlatManifest(commit1.toString());
+  auto rootTree = localStore_.getTree(rootTreeHash).get(10s);
+  auto fooTree =
+      localStore_.getTree(rootTree->getEntryAt("foo"_pc).getHash()).get(10s);
+  ASSERT_TRUE(fooTree);
+
+  // A hash with no proxy hash in the LocalStore fails on its own, without
+  // affecting the rest of the batch.
+  Hash noSuchHash = makeTestHash("123");
+  auto results = importer.importFileContentsBatch({
+      fooTree->getEntryAt("bar.txt"_pc).getHash(),
+      noSuchHash,
+      fooTree->getEntryAt("test.txt"_pc).getHash(),
+      rootTree->getEntryAt("main.py"_pc).getHash(),
+  });
+  ASSERT_EQ(4, results.size());
+  EXPECT_BLOB_EQ(results[0].value(), barData);
+  EXPECT_THROW_RE(
+      results[1].value(), std::exception, "value not present in store");
+  EXPECT_BLOB_EQ(results[2].value(), testData);
+  EXPECT_BLOB_EQ(results[3].value(), mainData);
+
+  // The importer is still usable after a batch with a failure in it.
+  auto mainBlob =
+      importer.importFileContents(rootTree->getEntryAt("main.py"_pc).getHash());
+  EXPECT_BLOB_EQ(mainBlob, mainData);
+}
+
+#ifndef _WIN32
+TEST_F(HgImportTest, importLargeFileThroughSharedMemory) {
+  gflags::FlagSaver flagSaver;
+  auto shmDir = testPath_ + "shm"_pc;
+  boost::filesystem::create_directory(shmDir.value().str());
+  FLAGS_hgImportSharedMemoryDir = shmDir.value().str();
+  FLAGS_hgImportSharedMemoryThreshold = 1024;
+
+  std::string smallData = "small file\n";
+  std::string largeData(64 * 1024, 'x');
+  repo_.writeFile("small.txt", smallData);
+  repo_.writeFile("large.txt", largeData);
+  repo_.hg("add");
+  auto commit1 = repo_.commit("Initial commit");
+
+  {
+    HgImporter importer(repo_.path(), &localStore_, stats_);
+    auto rootTreeHash = importer.importFlatManifest(commit1.toString());
+    auto rootTree = localStore_.getTree(rootTreeHash).get(10s);
+    auto smallHash = rootTree->getEntryAt("small.txt"_pc).getHash();
+    auto largeHash = rootTree->getEntryAt("large.txt"_pc).getHash();
+
+    // Files above the threshold are sent through shared memory if the helper
+    // supports it, and over the pipe otherwise.  Either way the contents must
+    // be the same.
+    EXPECT_BLOB_EQ(importer.importFileContents(largeHash), largeData);
+    EXPECT_BLOB_EQ(importer.importFileContents(smallHash), smallData);
+
+    auto results = importer.importFileContentsBatch({largeHash, smallHash});
+    ASSERT_EQ(2, results.size());
+    EXPECT_BLOB_EQ(results[0].value(), largeData);
+    EXPECT_BLOB_EQ(results[1].value(), smallData);
+  }
+
+  // Nothing is left behind once the importer is gone.
+  EXPECT_TRUE(boost::filesystem::is_empty(shmDir.value().str()));
+}
+#endif
@@ -260,3 +260,137 @@ TEST(
   handle3.reset();
   EXPECT_TRUE(cache->contains(hash3));
 }
+
+TEST(BlobCache, evictions_are_counted_in_bytes) {
+  auto cache = BlobCache::create(10, 0);
+  cache->insert(blob3);
+  cache->insert(blob4);
+  cache->insert(blob5); // evicts blob3
+  cache->insert(blob6); // evicts blob4 and blob5
+  auto stats = cache->getStats();
+  EXPECT_EQ(3, stats.evictionCount);
+  EXPECT_EQ(12, stats.bytesEvicted);
+}
+
+TEST(BlobCache, does_not_admit_blob_requested_less_than_blob_it_would_evict) {
+  auto cache = BlobCache::create(10, 0);
+  cache->insert(blob4);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(cache->get(hash4).blob);
+  }
+
+  // blob9 would evict blob4, which has been requested more often.
+  auto handle9 = cache->insert(blob9);
+  EXPECT_TRUE(cache->contains(hash4));
+  EXPECT_FALSE(cache->contains(hash9));
+  EXPECT_EQ(1, cache->getStats().rejectionCount);
+  EXPECT_EQ(blob9, handle9.getBlob());
+
+  // Once blob9 has been requested as often as blob4, it is admitted.
+  cache->insert(blob9);
+  cache->insert(blob9);
+  EXPECT_FALSE(cache->contains(hash9));
+  cache->insert(blob9);
+  EXPECT_TRUE(cache->contains(hash9));
+  EXPECT_FALSE(cache->contains(hash4));
+  EXPECT_EQ(3, cache->getStats().rejectionCount);
+}
+
+TEST(BlobCache, interest_handle_holds_blob_that_was_not_admitted) {
+  auto cache = BlobCache::create(10, 0);
+  cache->insert(blob4);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(cache->get(hash4).blob);
+  }
+
+  auto blob = std::make_shared<Blob>(hash9, "999999999"_sp);
+  auto weak = std::weak_ptr<Blob>{blob};
+  auto handle9 = cache->insert(blob, BlobCache::Interest::WantHandle);
+  blob.reset();
+  EXPECT_FALSE(cache->contains(hash9));
+  EXPECT_TRUE(cache->contains(hash4));
+  EXPECT_EQ(1, cache->getStats().rejectionCount);
+
+  EXPECT_TRUE(handle9.getBlob());
+  handle9.reset();
+  EXPECT_FALSE(weak.lock());
+  EXPECT_TRUE(cache->contains(hash4));
+}
+
+TEST(BlobCache, a_miss_and_the_insert_that_follows_count_once) {
+  auto cache = BlobCache::create(10, 0);
+  cache->insert(blob4);
+  EXPECT_TRUE(cache->get(hash4).blob);
+
+  // blob9 has been requested once, and blob4 twice.
+  EXPECT_FALSE(cache->get(hash9).blob);
+  cache->insert(blob9);
+  EXPECT_FALSE(cache->contains(hash9));
+  EXPECT_TRUE(cache->contains(hash4));
+}
+
+TEST(BlobCache, lookups_without_interest_raise_frequency) {
+  auto cache = BlobCache::create(10, 0);
+  cache->insert(blob4);
+  EXPECT_TRUE(
+      cache->get(hash4, BlobCache::Interest::UnlikelyNeededAgain).blob);
+  cache->insert(blob9);
+  EXPECT_FALSE(cache->contains(hash9));
+  EXPECT_TRUE(cache->contains(hash4));
+}
+
+TEST(BlobCache, lookups_through_interest_handles_do_not_raise_frequency) {
+  auto cache = BlobCache::create(10, 0);
+  auto handle4 = cache->insert(blob4, BlobCache::Interest::WantHandle);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(handle4.getBlob());
+  }
+  // blob4 and blob9 have each been requested once, so blob9 is admitted.
+  cache->insert(blob9);
+  EXPECT_TRUE(cache->contains(hash9));
+  EXPECT_FALSE(cache->contains(hash4));
+}
+
+TEST(BlobCache, lookup_gives_blob_a_second_chance_before_eviction) {
+  auto cache = BlobCache::create(10, 0);
+  cache->insert(blob3);
+  cache->insert(blob4);
+  EXPECT_TRUE(cache->get(hash3).blob);
+
+  cache->insert(blob5);
+  EXPECT_TRUE(cache->contains(hash3));
+  EXPECT_FALSE(cache->contains(hash4));
+  EXPECT_TRUE(cache->contains(hash5));
+}
+
+TEST(BlobCache, large_caches_are_sharded) {
+  EXPECT_EQ(1, BlobCache::create(10, 0)->getShardCount());
+  // The default cache size and minimum entry count.
+  auto cache = BlobCache::create(40 * 1024 * 1024, 16);
+  ASSERT_GE(cache->getShardCount(), BlobCache::kMinimumShardCount);
+  ASSERT_LE(cache->getShardCount(), BlobCache::kMaximumShardCount);
+
+  cache->insert(blob3);
+  cache->insert(blob4);
+  cache->insert(blob5);
+  EXPECT_TRUE(cache->get(hash3).blob);
+  EXPECT_FALSE(cache->get(hash6).blob);
+
+  auto stats = cache->getStats();
+  ASSERT_EQ(cache->getShardCount(), stats.shards.size());
+  EXPECT_EQ(3, stats.blobCount);
+  EXPECT_EQ(12, stats.totalSizeInBytes);
+  EXPECT_EQ(1, stats.hitCount);
+  EXPECT_EQ(1, stats.missCount);
+  // Each of these hashes differs in the last byte, so each is in its own
+  // shard.
+  size_t nonEmptyShards = 0;
+  for (const auto& shardStats : stats.shards) {
+    if (shardStats.blobCount) {
+      EXPECT_EQ(1, shardStats.blobCount);
+      ++nonEmptyShards;
+    }
+  }
+  EXPECT_EQ(3, nonEmptyShards);
+  EXPECT_EQ(1.0, stats.shards[0].getHitRate());
+}
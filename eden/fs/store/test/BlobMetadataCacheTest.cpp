@@ -0,0 +1,91 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/BlobMetadataCache.h"
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+namespace {
+
+/**
+ * Make a blob ID whose last byte is zero, so that all of the IDs land in the
+ * same shard.
+ */
+Hash makeSameShardHash(uint32_t n) {
+  Hash::Storage bytes{};
+  bytes[0] = n & 0xff;
+  bytes[1] = (n >> 8) & 0xff;
+  return Hash{bytes};
+}
+
+BlobMetadata makeMetadata(uint64_t size) {
+  return BlobMetadata{Hash::sha1(folly::to<std::string>(size)), size};
+}
+
+} // namespace
+
+TEST(BlobMetadataCache, returns_inserted_metadata) {
+  BlobMetadataCache cache{1024 * 1024};
+  auto id = makeSameShardHash(1);
+  EXPECT_FALSE(cache.get(id).has_value());
+
+  cache.insert(id, makeMetadata(10));
+  auto metadata = cache.get(id);
+  ASSERT_TRUE(metadata.has_value());
+  EXPECT_EQ(10, metadata->size);
+  EXPECT_EQ(makeMetadata(10).sha1, metadata->sha1);
+
+  cache.insert(id, makeMetadata(20));
+  EXPECT_EQ(20, cache.get(id)->size);
+  EXPECT_EQ(1, cache.size());
+}
+
+TEST(BlobMetadataCache, capacity_is_derived_from_size_in_bytes) {
+  BlobMetadataCache cache{1024 * 1024};
+  EXPECT_LE(
+      cache.getMaximumEntryCount() * BlobMetadataCache::getBytesPerEntry(),
+      1024 * 1024);
+  EXPECT_GT(cache.getMaximumEntryCount(), 0);
+}
+
+TEST(BlobMetadataCache, evicts_unreferenced_entries_first) {
+  // Room for four entries in each of the 16 shards.
+  BlobMetadataCache cache{BlobMetadataCache::getBytesPerEntry() * 16 * 4};
+  uint32_t perShard = cache.getMaximumEntryCount() / 16;
+  ASSERT_EQ(4, perShard);
+
+  for (uint32_t i = 0; i < perShard; ++i) {
+    cache.insert(makeSameShardHash(i), makeMetadata(i));
+  }
+  // Touch every entry but the last.
+  for (uint32_t i = 0; i + 1 < perShard; ++i) {
+    ASSERT_TRUE(cache.get(makeSameShardHash(i)).has_value());
+  }
+
+  cache.insert(makeSameShardHash(perShard), makeMetadata(perShard));
+  EXPECT_FALSE(cache.get(makeSameShardHash(perShard - 1)).has_value());
+  EXPECT_TRUE(cache.get(makeSameShardHash(perShard)).has_value());
+  for (uint32_t i = 0; i + 1 < perShard; ++i) {
+    EXPECT_TRUE(cache.get(makeSameShardHash(i)).has_value()) << i;
+  }
+}
+
+TEST(BlobMetadataCache, never_exceeds_maximum_entry_count) {
+  BlobMetadataCache cache{64 * 1024};
+  for (uint32_t i = 0; i < 10000; ++i) {
+    Hash::Storage bytes{};
+    bytes[0] = i & 0xff;
+    bytes[1] = (i >> 8) & 0xff;
+    bytes[Hash::RAW_SIZE - 1] = i & 0xff;
+    cache.insert(Hash{bytes}, makeMetadata(i));
+  }
+  EXPECT_EQ(cache.getMaximumEntryCount(), cache.size());
+}
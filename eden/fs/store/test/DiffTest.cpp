@@ -424,3 +424,95 @@ TEST_F(DiffTest, loadTreeError) {
       result.entries,
       UnorderedElementsAre(Pair("a/b/3.txt", ScmFileStatus::MODIFIED)));
 }
+
+TEST_F(DiffTest, listChangedObjects) {
+  FakeTreeBuilder builder;
+  builder.setFile("a/b/1.txt", "1");
+  builder.setFile("a/b/2.txt", "2");
+  builder.setFile("src/main.c", "hello world");
+  builder.setFile("src/lib.c", "helper code");
+  builder.setFile("src/test/test.c", "testing");
+  builder.setFile("unchanged/file.txt", "same");
+  builder.finalize(backingStore_, /* setReady */ true);
+
+  auto builder2 = builder.clone();
+  builder2.replaceFile("src/main.c", "hello world v2");
+  builder2.setFile("src/test/test2.c", "another test");
+  builder2.setFile("new/dir/x.txt", "x");
+  builder2.removeFile("a/b/1.txt");
+  builder2.finalize(backingStore_, /* setReady */ true);
+
+  auto tree1 = store_->getTree(builder.getRoot()->get().getHash()).get(100ms);
+  auto tree2 = store_->getTree(builder2.getRoot()->get().getHash()).get(100ms);
+  auto result =
+      facebook::eden::listChangedObjects(store_.get(), tree1, tree2, 2, 2)
+          .get(100ms);
+
+  auto treeHash = [&](StringPiece path) {
+    return builder2.getStoredTree(RelativePathPiece{path})->get().getHash();
+  };
+  auto blobHash = [&](StringPiece path) {
+    return builder2.getStoredBlob(RelativePathPiece{path})->get().getHash();
+  };
+  // Removed entries are not listed, but their parent trees changed.
+  EXPECT_THAT(
+      result.trees,
+      UnorderedElementsAre(
+          treeHash("a"),
+          treeHash("a/b"),
+          treeHash("new"),
+          treeHash("new/dir"),
+          treeHash("src"),
+          treeHash("src/test")));
+  EXPECT_THAT(
+      result.blobs,
+      UnorderedElementsAre(
+          blobHash("new/dir/x.txt"),
+          blobHash("src/main.c"),
+          blobHash("src/test/test2.c")));
+}
+
+TEST_F(DiffTest, listChangedObjectsOnlyWalksSelectedDirectories) {
+  FakeTreeBuilder builder;
+  builder.setFile("src/main.c", "hello world");
+  builder.setFile("src/test/test.c", "testing");
+  builder.setFile("docs/index.md", "docs");
+  builder.finalize(backingStore_, /* setReady */ true);
+
+  auto builder2 = builder.clone();
+  builder2.replaceFile("src/main.c", "hello world v2");
+  builder2.replaceFile("src/test/test.c", "testing v2");
+  builder2.replaceFile("docs/index.md", "docs v2");
+  builder2.finalize(backingStore_, /* setReady */ true);
+
+  auto tree1 = store_->getTree(builder.getRoot()->get().getHash()).get(100ms);
+  auto tree2 = store_->getTree(builder2.getRoot()->get().getHash()).get(100ms);
+  std::vector<RelativePath> asked;
+  auto result = facebook::eden::listChangedObjects(
+                    store_.get(),
+                    tree1,
+                    tree2,
+                    2,
+                    2,
+                    [&](RelativePathPiece path) {
+                      asked.emplace_back(path);
+                      return path == RelativePathPiece{"src"};
+                    })
+                    .get(100ms);
+
+  // Directories under one that is not walked are not asked about.
+  EXPECT_THAT(
+      asked,
+      UnorderedElementsAre(
+          RelativePath{"docs"}, RelativePath{"src"}, RelativePath{"src/test"}));
+  EXPECT_THAT(
+      result.trees,
+      UnorderedElementsAre(
+          builder2.getStoredTree(RelativePathPiece{"src"})->get().getHash()));
+  EXPECT_THAT(
+      result.blobs,
+      UnorderedElementsAre(
+          builder2.getStoredBlob(RelativePathPiece{"src/main.c"})
+              ->get()
+              .getHash()));
+}
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/FrequencySketch.h"
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+namespace {
+Hash makeHash(size_t n) {
+  return Hash::sha1(folly::StringPiece{folly::to<std::string>(n)});
+}
+} // namespace
+
+TEST(FrequencySketch, counts_increments) {
+  FrequencySketch sketch{64};
+  auto hash = makeHash(1);
+  EXPECT_EQ(0, sketch.estimate(hash));
+  sketch.increment(hash);
+  sketch.increment(hash);
+  sketch.increment(hash);
+  EXPECT_EQ(3, sketch.estimate(hash));
+
+  sketch.clear();
+  EXPECT_EQ(0, sketch.estimate(hash));
+}
+
+TEST(FrequencySketch, saturates) {
+  FrequencySketch sketch{64};
+  auto hash = makeHash(1);
+  for (int i = 0; i < 100; ++i) {
+    sketch.increment(hash);
+  }
+  EXPECT_EQ(FrequencySketch::kMaximumFrequency, sketch.estimate(hash));
+}
+
+TEST(FrequencySketch, distinguishes_frequent_from_infrequent_objects) {
+  FrequencySketch sketch{1024};
+  for (size_t n = 0; n < 100; ++n) {
+    for (size_t i = 0; i < (n < 10 ? 8 : 1); ++i) {
+      sketch.increment(makeHash(n));
+    }
+  }
+  for (size_t n = 0; n < 10; ++n) {
+    EXPECT_GE(sketch.estimate(makeHash(n)), 8) << n;
+  }
+  size_t overestimated = 0;
+  for (size_t n = 10; n < 100; ++n) {
+    if (sketch.estimate(makeHash(n)) > 1) {
+      ++overestimated;
+    }
+  }
+  EXPECT_LT(overestimated, 5);
+}
+
+TEST(FrequencySketch, ages_counts) {
+  // A width of 16 halves the counters every 160 increments.
+  FrequencySketch sketch{16};
+  auto hash = makeHash(0);
+  for (int i = 0; i < 159; ++i) {
+    sketch.increment(hash);
+  }
+  EXPECT_EQ(FrequencySketch::kMaximumFrequency, sketch.estimate(hash));
+  sketch.increment(hash);
+  EXPECT_EQ(FrequencySketch::kMaximumFrequency / 2, sketch.estimate(hash));
+}
@@ -0,0 +1,47 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/ImportPriority.h"
+#include <folly/futures/Future.h>
+#include <gtest/gtest.h>
+#include <optional>
+
+using namespace facebook::eden;
+
+TEST(ImportPriority, defaultsToInteractive) {
+  EXPECT_EQ(ImportPriorityClass::Interactive, getCurrentImportPriority());
+}
+
+TEST(ImportPriority, scopeSetsAndRestoresPriority) {
+  {
+    ImportPriorityScope thrift{ImportPriorityClass::Thrift};
+    EXPECT_EQ(ImportPriorityClass::Thrift, getCurrentImportPriority());
+    {
+      ImportPriorityScope prefetch{ImportPriorityClass::Prefetch};
+      EXPECT_EQ(ImportPriorityClass::Prefetch, getCurrentImportPriority());
+    }
+    EXPECT_EQ(ImportPriorityClass::Thrift, getCurrentImportPriority());
+  }
+  EXPECT_EQ(ImportPriorityClass::Interactive, getCurrentImportPriority());
+}
+
+TEST(ImportPriority, priorityFollowsFutureCallbacks) {
+  folly::Promise<folly::Unit> promise;
+  std::optional<ImportPriorityClass> seen;
+  auto future = [&] {
+    ImportPriorityScope background{ImportPriorityClass::Background};
+    return promise.getFuture().thenValue(
+        [&](auto&&) { seen = getCurrentImportPriority(); });
+  }();
+
+  EXPECT_EQ(ImportPriorityClass::Interactive, getCurrentImportPriority());
+  promise.setValue();
+  std::move(future).get();
+  EXPECT_EQ(ImportPriorityClass::Background, seen);
+}
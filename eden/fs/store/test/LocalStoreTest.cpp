@@ -8,9 +8,12 @@
  *
  */
 #include "eden/fs/store/test/LocalStoreTest.h"
+#include <gflags/gflags.h>
 #include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/SqliteLocalStore.h"
 
+DECLARE_bool(binaryTreeFormat);
+
 namespace {
 
 using namespace facebook::eden;
@@ -138,6 +141,36 @@ TEST_P(LocalStoreTest, testReadsAndWriteTree) {
   EXPECT_EQ(TreeEntryType::REGULAR_FILE, readmeEntry.getType());
 }
 
+TEST_P(LocalStoreTest, putTreeKeepsEntryMetadata) {
+  using namespace std::chrono_literals;
+
+  // Git tree objects cannot hold the size and content SHA-1.
+  gflags::FlagSaver flagSaver;
+  FLAGS_binaryTreeFormat = true;
+
+  Hash fileHash("c5f15617ed29cd35964dc197a7960aeaedf2c2d5");
+  Hash contentSha1("3a8f8eb91101860fd8484154885838bf322964d0");
+  std::vector<TreeEntry> entries;
+  entries.emplace_back(
+      fileHash, "README.md", TreeEntryType::REGULAR_FILE, 1234, contentSha1);
+  entries.emplace_back(
+      Hash("e95798e17f694c227b7a8441cc5c7dae50a187d0"),
+      "lib",
+      TreeEntryType::TREE);
+  Tree tree{std::move(entries),
+            Hash("8e073e366ed82de6465d1209d3f07da7eebabb93")};
+
+  auto id = store_->putTree(&tree);
+  auto storedTree = store_->getTree(id).get(10s);
+  ASSERT_TRUE(storedTree);
+  EXPECT_EQ(tree, *storedTree);
+
+  const auto& readmeEntry = storedTree->getEntryAt("README.md"_pc);
+  EXPECT_EQ(std::optional<uint64_t>{1234}, readmeEntry.getSize());
+  EXPECT_EQ(contentSha1, readmeEntry.getContentSha1());
+  EXPECT_EQ(std::nullopt, storedTree->getEntryAt("lib"_pc).getSize());
+}
+
 TEST_P(LocalStoreTest, testGetResult) {
   StringPiece key1 = "foo";
   StringPiece key2 = "bar";
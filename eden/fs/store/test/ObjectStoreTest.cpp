@@ -8,15 +8,21 @@
  *
  */
 #include <folly/test/TestUtils.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+#include "eden/fs/store/BlobChunk.h"
+#include "eden/fs/store/ImportPriority.h"
 #include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/store/TreeCache.h"
 #include "eden/fs/testharness/FakeBackingStore.h"
 #include "eden/fs/testharness/StoredObject.h"
 
 using namespace facebook::eden;
 
+DECLARE_bool(binaryTreeFormat);
+
 class ObjectStoreTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -73,3 +79,275 @@ TEST_F(ObjectStoreTest, getBlobSha1NotFound) {
       std::domain_error,
       "blob .* not found");
 }
+
+TEST_F(ObjectStoreTest, concurrentGetBlobCallsShareOneFetch) {
+  StoredBlob* storedBlob = backingStore_->putBlob("A");
+  Hash id = storedBlob->get().getHash();
+
+  auto future1 = objectStore_->getBlob(id);
+  auto future2 = objectStore_->getBlob(id);
+  EXPECT_FALSE(future1.isReady());
+  EXPECT_FALSE(future2.isReady());
+  EXPECT_EQ(1, backingStore_->getAccessCount(id));
+  EXPECT_EQ(1, objectStore_->getCoalescedBlobRequestCount());
+
+  storedBlob->setReady();
+  ASSERT_TRUE(future1.isReady());
+  ASSERT_TRUE(future2.isReady());
+  EXPECT_EQ(
+      std::move(future1).get()->getHash(), std::move(future2).get()->getHash());
+
+  // Once the fetch has finished, a new request loads the blob again, this
+  // time from the LocalStore.
+  auto blob = objectStore_->getBlob(id).get();
+  EXPECT_EQ(id, blob->getHash());
+  EXPECT_EQ(1, backingStore_->getAccessCount(id));
+  EXPECT_EQ(1, objectStore_->getCoalescedBlobRequestCount());
+}
+
+TEST_F(ObjectStoreTest, concurrentGetTreeCallsShareOneFetch) {
+  StoredTree* storedTree = backingStore_->putTree(std::vector<TreeEntry>{});
+  Hash id = storedTree->get().getHash();
+
+  auto future1 = objectStore_->getTree(id);
+  auto future2 = objectStore_->getTree(id);
+  EXPECT_EQ(1, backingStore_->getAccessCount(id));
+  EXPECT_EQ(1, objectStore_->getCoalescedTreeRequestCount());
+
+  storedTree->trigger();
+  ASSERT_TRUE(future1.isReady());
+  ASSERT_TRUE(future2.isReady());
+  EXPECT_EQ(id, std::move(future1).get()->getHash());
+  EXPECT_EQ(id, std::move(future2).get()->getHash());
+}
+
+TEST_F(ObjectStoreTest, joiningAFetchPassesAMoreUrgentPriorityOn) {
+  StoredBlob* storedBlob = backingStore_->putBlob("A");
+  Hash blobId = storedBlob->get().getHash();
+  StoredTree* storedTree = backingStore_->putTree(std::vector<TreeEntry>{});
+  Hash treeId = storedTree->get().getHash();
+
+  auto prefetchBlob = [&] {
+    ImportPriorityScope scope{ImportPriorityClass::Prefetch};
+    return objectStore_->getBlob(blobId);
+  }();
+  auto prefetchTree = [&] {
+    ImportPriorityScope scope{ImportPriorityClass::Background};
+    return objectStore_->getTree(treeId);
+  }();
+  EXPECT_EQ(
+      ImportPriorityClass::Prefetch, backingStore_->getImportPriority(blobId));
+  EXPECT_EQ(
+      ImportPriorityClass::Background,
+      backingStore_->getImportPriority(treeId));
+
+  // A less urgent caller leaves the priority alone.
+  auto backgroundBlob = [&] {
+    ImportPriorityScope scope{ImportPriorityClass::Background};
+    return objectStore_->getBlob(blobId);
+  }();
+  EXPECT_EQ(
+      ImportPriorityClass::Prefetch, backingStore_->getImportPriority(blobId));
+
+  // FUSE requests are Interactive.
+  auto interactiveBlob = objectStore_->getBlob(blobId);
+  auto interactiveTree = objectStore_->getTree(treeId);
+  EXPECT_EQ(1, backingStore_->getAccessCount(blobId));
+  EXPECT_EQ(1, backingStore_->getAccessCount(treeId));
+  EXPECT_EQ(
+      ImportPriorityClass::Interactive,
+      backingStore_->getImportPriority(blobId));
+  EXPECT_EQ(
+      ImportPriorityClass::Interactive,
+      backingStore_->getImportPriority(treeId));
+
+  storedBlob->setReady();
+  storedTree->setReady();
+  EXPECT_EQ(blobId, std::move(interactiveBlob).get()->getHash());
+  EXPECT_EQ(blobId, std::move(prefetchBlob).get()->getHash());
+  EXPECT_EQ(blobId, std::move(backgroundBlob).get()->getHash());
+  EXPECT_EQ(treeId, std::move(interactiveTree).get()->getHash());
+  EXPECT_EQ(treeId, std::move(prefetchTree).get()->getHash());
+}
+
+TEST_F(ObjectStoreTest, failedFetchIsReportedToAllWaiters) {
+  StoredBlob* storedBlob = backingStore_->putBlob("A");
+  Hash id = storedBlob->get().getHash();
+
+  auto future1 = objectStore_->getBlob(id);
+  auto future2 = objectStore_->getBlob(id);
+  storedBlob->triggerError(std::runtime_error("oh noes"));
+  EXPECT_THROW_RE(std::move(future1).get(), std::runtime_error, "oh noes");
+  EXPECT_THROW_RE(std::move(future2).get(), std::runtime_error, "oh noes");
+
+  // The failure is not remembered.
+  storedBlob->setReady();
+  EXPECT_EQ(id, objectStore_->getBlob(id).get()->getHash());
+}
+
+TEST_F(ObjectStoreTest, getTreeUsesTreeCache) {
+  auto treeCache = TreeCache::create(1024 * 1024, 0);
+  auto objectStore = ObjectStore::create(localStore_, backingStore_, treeCache);
+
+  StoredTree* storedTree = backingStore_->putTree(std::vector<TreeEntry>{});
+  storedTree->setReady();
+  Hash id = storedTree->get().getHash();
+
+  EXPECT_EQ(id, objectStore->getTree(id).get()->getHash());
+  EXPECT_EQ(1, backingStore_->getAccessCount(id));
+  EXPECT_TRUE(treeCache->contains(id));
+
+  EXPECT_EQ(id, objectStore->getTree(id).get()->getHash());
+  EXPECT_EQ(1, backingStore_->getAccessCount(id));
+  EXPECT_EQ(1, treeCache->getStats().hitCount);
+}
+
+TEST_F(ObjectStoreTest, getBlobsOnlyFetchesMissesFromBackingStore) {
+  Hash id1 = putReadyBlob("one");
+  Hash id2 = putReadyBlob("two");
+  Hash missing;
+
+  // Load the first blob so that it is in the LocalStore.
+  objectStore_->getBlob(id1).get();
+  EXPECT_EQ(1, backingStore_->getAccessCount(id1));
+
+  auto results = objectStore_->getBlobs({id2, missing, id1}).get();
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ("two", results[0].value()->getContents().moveToFbString());
+  EXPECT_THROW_RE(results[1].value(), std::domain_error, "blob .* not found");
+  EXPECT_EQ("one", results[2].value()->getContents().moveToFbString());
+  EXPECT_EQ(1, backingStore_->getAccessCount(id1));
+  EXPECT_EQ(1, backingStore_->getAccessCount(id2));
+}
+
+TEST_F(ObjectStoreTest, getTreesChecksLocalStoreBeforeBackingStore) {
+  auto treeCache = TreeCache::create(1024 * 1024, 0);
+  auto objectStore = ObjectStore::create(localStore_, backingStore_, treeCache);
+
+  StoredBlob* blob = backingStore_->putBlob("a");
+  StoredTree* localTree = backingStore_->putTree({{"a", blob}});
+  localStore_->putTree(&localTree->get());
+  StoredTree* remoteTree = backingStore_->putTree(std::vector<TreeEntry>{});
+  remoteTree->setReady();
+  Hash localId = localTree->get().getHash();
+  Hash remoteId = remoteTree->get().getHash();
+
+  auto results = objectStore->getTrees({localId, remoteId}).get();
+  ASSERT_EQ(2, results.size());
+  EXPECT_EQ(localId, results[0].value()->getHash());
+  EXPECT_EQ(remoteId, results[1].value()->getHash());
+  EXPECT_EQ(0, backingStore_->getAccessCount(localId));
+  EXPECT_EQ(1, backingStore_->getAccessCount(remoteId));
+  EXPECT_TRUE(treeCache->contains(localId));
+  EXPECT_TRUE(treeCache->contains(remoteId));
+}
+
+TEST_F(ObjectStoreTest, getTreeEntrySearchesBinaryTreesInPlace) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_binaryTreeFormat = true;
+
+  StoredBlob* blob = backingStore_->putBlob("a");
+  StoredTree* storedTree = backingStore_->putTree({{"a", blob}});
+  localStore_->putTree(&storedTree->get());
+  Hash id = storedTree->get().getHash();
+
+  auto entry = objectStore_->getTreeEntry(id, "a"_pc).get();
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(blob->get().getHash(), entry->getHash());
+  EXPECT_FALSE(objectStore_->getTreeEntry(id, "b"_pc).get());
+  EXPECT_EQ(0, backingStore_->getAccessCount(id));
+}
+
+TEST_F(ObjectStoreTest, getTreeEntryLoadsOtherTrees) {
+  StoredBlob* blob = backingStore_->putBlob("a");
+  StoredTree* storedTree = backingStore_->putTree({{"a", blob}});
+  storedTree->setReady();
+  Hash id = storedTree->get().getHash();
+
+  auto entry = objectStore_->getTreeEntry(id, "a"_pc).get();
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(blob->get().getHash(), entry->getHash());
+  EXPECT_EQ(1, backingStore_->getAccessCount(id));
+}
+
+TEST_F(ObjectStoreTest, getBlobMetadataBatch) {
+  Hash id1 = putReadyBlob("one");
+  Hash id2 = putReadyBlob("two");
+  Hash missing;
+
+  objectStore_->getBlobSha1(id1).get();
+  auto results = objectStore_->getBlobMetadataBatch({id1, id2, missing}).get();
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ(Hash::sha1(folly::StringPiece{"one"}), results[0]->sha1);
+  EXPECT_EQ(Hash::sha1(folly::StringPiece{"two"}), results[1]->sha1);
+  EXPECT_EQ(3, results[1]->size);
+  EXPECT_THROW_RE(results[2].value(), std::domain_error, "blob .* not found");
+  EXPECT_EQ(1, backingStore_->getAccessCount(id1));
+  EXPECT_EQ(1, backingStore_->getAccessCount(id2));
+}
+
+TEST_F(ObjectStoreTest, getBlobMetadataBatchJoinsBlobFetchesInProgress) {
+  StoredBlob* storedBlob = backingStore_->putBlob("one");
+  Hash id = storedBlob->get().getHash();
+
+  auto blobFuture = objectStore_->getBlob(id);
+  auto metadataFuture = objectStore_->getBlobMetadataBatch({id, id});
+  auto sha1Future = objectStore_->getBlobSha1(id);
+  EXPECT_FALSE(metadataFuture.isReady());
+  EXPECT_EQ(1, backingStore_->getAccessCount(id));
+  EXPECT_EQ(3, objectStore_->getCoalescedBlobRequestCount());
+
+  storedBlob->setReady();
+  auto results = std::move(metadataFuture).get();
+  ASSERT_EQ(2, results.size());
+  EXPECT_EQ(Hash::sha1(folly::StringPiece{"one"}), results[0]->sha1);
+  EXPECT_EQ(3, results[1]->size);
+  EXPECT_EQ(
+      Hash::sha1(folly::StringPiece{"one"}), std::move(sha1Future).get());
+  EXPECT_EQ(id, std::move(blobFuture).get()->getHash());
+}
+
+TEST_F(ObjectStoreTest, concurrentGetBlobChunkCallsShareOneRangeFetch) {
+  std::string data(2 * kBlobChunkSize + 10, 'a');
+  data[kBlobChunkSize] = 'b';
+  data[2 * kBlobChunkSize] = 'c';
+  StoredBlob* storedBlob = backingStore_->putBlob(data);
+  Hash id = storedBlob->get().getHash();
+
+  auto chunkFuture1 = objectStore_->getBlobChunk(id, 1);
+  auto chunkFuture2 = objectStore_->getBlobChunk(id, 2);
+  EXPECT_EQ(1, backingStore_->getAccessCount(id));
+  EXPECT_EQ(1, objectStore_->getCoalescedBlobRequestCount());
+
+  storedBlob->setReady();
+  auto chunk = std::move(chunkFuture1).get();
+  EXPECT_EQ(getBlobChunkId(id, 1), chunk->getHash());
+  EXPECT_EQ(kBlobChunkSize, chunk->getSize());
+  EXPECT_EQ('b', chunk->getContents().data()[0]);
+  auto last = std::move(chunkFuture2).get();
+  EXPECT_EQ(10, last->getSize());
+  EXPECT_EQ('c', last->getContents().data()[0]);
+
+  // FakeBackingStore returns the whole blob, so every chunk was saved to the
+  // LocalStore and is not fetched again.
+  EXPECT_NE(nullptr, localStore_->getBlobChunk(id, 0).get());
+  EXPECT_EQ(kBlobChunkSize, objectStore_->getBlobChunk(id, 0).get()->getSize());
+  EXPECT_EQ(1, backingStore_->getAccessCount(id));
+}
+
+TEST_F(ObjectStoreTest, fetchingLargeBlobSavesItsChunks) {
+  std::string data(kChunkedBlobThreshold, 'a');
+  Hash id = putReadyBlob(data);
+
+  EXPECT_EQ(data.size(), objectStore_->getBlob(id).get()->getSize());
+  auto chunk = objectStore_->getBlobChunk(id, 3).get();
+  EXPECT_EQ(kBlobChunkSize, chunk->getSize());
+  EXPECT_EQ(1, backingStore_->getAccessCount(id));
+}
+
+TEST_F(ObjectStoreTest, getBlobChunkPastEndOfBlobIsEmpty) {
+  Hash id = putReadyBlob("short");
+
+  auto chunk = objectStore_->getBlobChunk(id, 1).get();
+  EXPECT_EQ(0, chunk->getSize());
+}
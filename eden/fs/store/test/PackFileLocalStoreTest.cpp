@@ -0,0 +1,216 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/PackFileLocalStore.h"
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/test/LocalStoreTest.h"
+
+namespace {
+
+using namespace facebook::eden;
+using folly::StringPiece;
+using KeySpace = LocalStore::KeySpace;
+using namespace folly::string_piece_literals;
+
+const std::vector<KeySpace> kPackedKeySpaces{KeySpace::BlobFamily,
+                                             KeySpace::BlobMetaDataFamily,
+                                             KeySpace::TreeFamily};
+
+LocalStoreImplResult makePackFileLocalStore(FaultInjector*) {
+  auto tempDir = makeTempDir();
+  auto store = std::make_unique<PackFileLocalStore>(
+      AbsolutePathPiece{tempDir.path().string()},
+      std::make_shared<MemoryLocalStore>(),
+      kPackedKeySpaces);
+  return {std::move(tempDir), std::move(store)};
+}
+
+INSTANTIATE_TEST_CASE_P(
+    PackFile,
+    LocalStoreTest,
+    ::testing::Values(makePackFileLocalStore));
+
+std::unique_ptr<PackFileLocalStore> openStore(
+    const folly::test::TemporaryDirectory& dir,
+    std::shared_ptr<LocalStore> delegate,
+    uint64_t segmentSize = PackFileLocalStore::kDefaultSegmentSize) {
+  return std::make_unique<PackFileLocalStore>(
+      AbsolutePathPiece{dir.path().string()},
+      std::move(delegate),
+      kPackedKeySpaces,
+      segmentSize);
+}
+
+std::string makeValue(size_t n, size_t size = 1000) {
+  auto value = folly::to<std::string>(n, ":");
+  value.resize(size, 'x');
+  return value;
+}
+
+TEST(PackFileLocalStore, forwardsOtherKeySpacesToDelegate) {
+  auto tempDir = makeTempDir();
+  auto delegate = std::make_shared<MemoryLocalStore>();
+  auto store = openStore(tempDir, delegate);
+
+  store->put(KeySpace::HgProxyHashFamily, "key"_sp, "proxy"_sp);
+  store->put(KeySpace::BlobFamily, "key"_sp, "blob"_sp);
+  EXPECT_FALSE(store->isPacked(KeySpace::HgProxyHashFamily));
+  EXPECT_EQ(
+      "proxy", delegate->get(KeySpace::HgProxyHashFamily, "key"_sp).piece());
+  EXPECT_FALSE(delegate->hasKey(KeySpace::BlobFamily, "key"_sp));
+  EXPECT_EQ("blob", store->get(KeySpace::BlobFamily, "key"_sp).piece());
+}
+
+TEST(PackFileLocalStore, valuesSurviveReopening) {
+  auto tempDir = makeTempDir();
+  auto delegate = std::make_shared<MemoryLocalStore>();
+  {
+    auto store = openStore(tempDir, delegate, 64 * 1024);
+    auto batch = store->beginWrite();
+    for (size_t n = 0; n < 200; ++n) {
+      batch->put(
+          KeySpace::BlobFamily,
+          StringPiece{makeValue(n, 20)},
+          StringPiece{makeValue(n)});
+    }
+    batch->flush();
+  }
+
+  auto store = openStore(tempDir, delegate, 64 * 1024);
+  for (size_t n = 0; n < 200; ++n) {
+    auto result =
+        store->get(KeySpace::BlobFamily, StringPiece{makeValue(n, 20)});
+    ASSERT_TRUE(result.isValid()) << n;
+    EXPECT_EQ(makeValue(n), result.piece());
+  }
+
+  // New values are appended after the existing ones.
+  store->put(KeySpace::BlobFamily, "new"_sp, "value"_sp);
+  EXPECT_EQ("value", store->get(KeySpace::BlobFamily, "new"_sp).piece());
+  EXPECT_EQ(
+      makeValue(0),
+      store->get(KeySpace::BlobFamily, StringPiece{makeValue(0, 20)}).piece());
+}
+
+TEST(PackFileLocalStore, indexIsRebuiltFromSegments) {
+  auto tempDir = makeTempDir();
+  auto delegate = std::make_shared<MemoryLocalStore>();
+  {
+    auto store = openStore(tempDir, delegate, 64 * 1024);
+    for (size_t n = 0; n < 200; ++n) {
+      store->put(
+          KeySpace::BlobFamily,
+          StringPiece{makeValue(n, 20)},
+          StringPiece{makeValue(n)});
+    }
+    // Replace one value, so the rebuilt index must use the newest record.
+    store->put(
+        KeySpace::BlobFamily, StringPiece{makeValue(7, 20)}, "seven"_sp);
+  }
+
+  auto indexPath = tempDir.path() / "blob" / "index";
+  ASSERT_TRUE(folly::writeFile(std::string{"garbage"}, indexPath.c_str()));
+
+  auto store = openStore(tempDir, delegate, 64 * 1024);
+  for (size_t n = 0; n < 200; ++n) {
+    auto result =
+        store->get(KeySpace::BlobFamily, StringPiece{makeValue(n, 20)});
+    ASSERT_TRUE(result.isValid()) << n;
+    EXPECT_EQ(n == 7 ? "seven" : makeValue(n), result.piece());
+  }
+}
+
+TEST(PackFileLocalStore, extractedIOBufOutlivesClear) {
+  auto tempDir = makeTempDir();
+  auto store = openStore(tempDir, std::make_shared<MemoryLocalStore>());
+  auto value = makeValue(1, 100000);
+  store->put(KeySpace::BlobFamily, "key"_sp, StringPiece{value});
+
+  auto buf = store->get(KeySpace::BlobFamily, "key"_sp).extractIOBuf();
+  store->clearKeySpace(KeySpace::BlobFamily);
+  EXPECT_FALSE(store->hasKey(KeySpace::BlobFamily, "key"_sp));
+  EXPECT_EQ(0u, store->getPackedSize(KeySpace::BlobFamily));
+
+  EXPECT_FALSE(buf.isChained());
+  EXPECT_EQ(value, StringPiece{folly::ByteRange{buf.data(), buf.length()}});
+}
+
+TEST(PackFileLocalStore, garbageCollectionDropsOldestSegments) {
+  auto tempDir = makeTempDir();
+  auto store =
+      openStore(tempDir, std::make_shared<MemoryLocalStore>(), 64 * 1024);
+  for (size_t n = 0; n < 500; ++n) {
+    store->put(
+        KeySpace::BlobFamily,
+        StringPiece{makeValue(n, 20)},
+        StringPiece{makeValue(n)});
+  }
+
+  auto sizeBefore = store->getPackedSize(KeySpace::BlobFamily);
+  LocalStore::SizeLimits sizeLimits{};
+  sizeLimits[KeySpace::BlobFamily] = sizeBefore / 2;
+  EXPECT_TRUE(store->garbageCollect(sizeLimits));
+  EXPECT_LE(
+      store->getPackedSize(KeySpace::BlobFamily),
+      sizeLimits[KeySpace::BlobFamily]);
+
+  // Everything older than the first surviving entry was evicted.
+  size_t firstPresent = 0;
+  while (firstPresent < 500 &&
+         !store->hasKey(
+             KeySpace::BlobFamily, StringPiece{makeValue(firstPresent, 20)})) {
+    ++firstPresent;
+  }
+  EXPECT_GT(firstPresent, 0u);
+  for (size_t n = firstPresent; n < 500; ++n) {
+    EXPECT_TRUE(
+        store->hasKey(KeySpace::BlobFamily, StringPiece{makeValue(n, 20)}))
+        << n;
+  }
+
+  auto status = store->getGarbageCollectionStatus();
+  EXPECT_EQ(
+      firstPresent, status.keySpaces[KeySpace::BlobFamily].entriesEvicted);
+  EXPECT_EQ(
+      sizeBefore - store->getPackedSize(KeySpace::BlobFamily),
+      status.keySpaces[KeySpace::BlobFamily].bytesReclaimed);
+}
+
+TEST(PackFileLocalStore, compactionRewritesSparseSegments) {
+  auto tempDir = makeTempDir();
+  auto store =
+      openStore(tempDir, std::make_shared<MemoryLocalStore>(), 64 * 1024);
+  for (size_t n = 0; n < 50; ++n) {
+    store->put(
+        KeySpace::TreeFamily,
+        StringPiece{makeValue(n, 20)},
+        StringPiece{makeValue(n + 1000)});
+  }
+  // Replacing every value leaves the first segment mostly garbage.
+  for (size_t n = 0; n < 50; ++n) {
+    store->put(
+        KeySpace::TreeFamily,
+        StringPiece{makeValue(n, 20)},
+        StringPiece{makeValue(n)});
+  }
+
+  auto sizeBefore = store->getPackedSize(KeySpace::TreeFamily);
+  store->compactKeySpace(KeySpace::TreeFamily);
+  EXPECT_LT(store->getPackedSize(KeySpace::TreeFamily), sizeBefore);
+  for (size_t n = 0; n < 50; ++n) {
+    EXPECT_EQ(
+        makeValue(n),
+        store->get(KeySpace::TreeFamily, StringPiece{makeValue(n, 20)})
+            .piece());
+  }
+}
+
+} // namespace
@@ -8,7 +8,9 @@
  *
  */
 #include "eden/fs/store/RocksDbLocalStore.h"
+#include <folly/Conv.h>
 #include "eden/fs/store/test/LocalStoreTest.h"
+#include "eden/fs/testharness/FakeClock.h"
 
 namespace {
 
@@ -26,4 +28,57 @@ INSTANTIATE_TEST_CASE_P(
     LocalStoreTest,
     ::testing::Values(makeRocksDbLocalStore));
 
+TEST(RocksDbLocalStoreGC, evictsLeastRecentlyAccessedEntries) {
+  using namespace std::chrono_literals;
+  using KeySpace = LocalStore::KeySpace;
+
+  auto tempDir = makeTempDir();
+  FaultInjector faultInjector{/*enabled=*/false};
+  auto clock = std::make_shared<FakeClock>();
+  RocksDbLocalStore store{AbsolutePathPiece{tempDir.path().string()},
+                          &faultInjector,
+                          RocksDBOpenMode::ReadWrite,
+                          clock};
+
+  std::vector<Hash> ids;
+  std::string padding(64 * 1024, 'x');
+  for (int i = 0; i < 100; ++i) {
+    auto contents = folly::to<std::string>(i, padding);
+    auto id = Hash::sha1(folly::StringPiece{contents});
+    Blob blob{id, folly::StringPiece{contents}};
+    store.putBlob(id, &blob);
+    ids.push_back(id);
+  }
+
+  // Read the second half of the blobs again later on.
+  clock->advance(2 * RocksDbLocalStore::kAccessTimeGranularity);
+  for (size_t i = 50; i < ids.size(); ++i) {
+    ASSERT_TRUE(store.getBlob(ids[i]).get(10s));
+  }
+
+  LocalStore::SizeLimits sizeLimits{};
+  sizeLimits[KeySpace::BlobFamily] =
+      store.getApproximateSize(KeySpace::BlobFamily) * 4 / 5;
+  EXPECT_TRUE(store.garbageCollect(sizeLimits));
+
+  size_t evicted = 0;
+  for (size_t i = 0; i < 50; ++i) {
+    if (!store.hasKey(KeySpace::BlobFamily, ids[i])) {
+      ++evicted;
+    }
+    // Only the blobs themselves were over their limit.
+    EXPECT_TRUE(store.hasKey(KeySpace::BlobMetaDataFamily, ids[i]));
+  }
+  EXPECT_GT(evicted, 0);
+  for (size_t i = 50; i < ids.size(); ++i) {
+    EXPECT_TRUE(store.hasKey(KeySpace::BlobFamily, ids[i]));
+  }
+
+  auto status = store.getGarbageCollectionStatus();
+  EXPECT_FALSE(status.running);
+  EXPECT_EQ(1, status.runCount);
+  EXPECT_EQ(evicted, status.keySpaces[KeySpace::BlobFamily].entriesEvicted);
+  EXPECT_EQ(0, status.keySpaces[KeySpace::BlobMetaDataFamily].entriesEvicted);
+}
+
 } // namespace
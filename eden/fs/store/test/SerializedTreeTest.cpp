@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/SerializedTree.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/model/git/GitTree.h"
+
+using namespace facebook::eden;
+using folly::ByteRange;
+using folly::StringPiece;
+
+namespace {
+Tree makeTree() {
+  std::vector<TreeEntry> entries;
+  // Deliberately out of order; serialize() sorts the entries.
+  entries.emplace_back(
+      Hash("3610882f48696cc7ca0835929511c9db70acbec6"),
+      "zzz",
+      TreeEntryType::EXECUTABLE_FILE);
+  entries.emplace_back(
+      Hash("c5f15617ed29cd35964dc197a7960aeaedf2c2d5"),
+      "README.md",
+      TreeEntryType::REGULAR_FILE,
+      42,
+      Hash("3a8f8eb91101860fd8484154885838bf322964d0"));
+  entries.emplace_back(
+      Hash("e95798e17f694c227b7a8441cc5c7dae50a187d0"),
+      "lib",
+      TreeEntryType::TREE);
+  entries.emplace_back(
+      Hash("006babcf5734d028098961c6f4b6b6719656924b"),
+      "link",
+      TreeEntryType::SYMLINK,
+      7,
+      std::nullopt);
+  return Tree{std::move(entries)};
+}
+} // namespace
+
+TEST(SerializedTree, roundTrip) {
+  auto tree = makeTree();
+  auto buf = SerializedTree::serialize(tree);
+  auto bytes = buf.coalesce();
+  ASSERT_TRUE(SerializedTree::isSerializedTree(bytes));
+
+  SerializedTree serialized{bytes};
+  ASSERT_EQ(4u, serialized.size());
+  EXPECT_EQ("README.md", serialized.getNameAt(0));
+  EXPECT_EQ("lib", serialized.getNameAt(1));
+  EXPECT_EQ("link", serialized.getNameAt(2));
+  EXPECT_EQ("zzz", serialized.getNameAt(3));
+
+  auto hash = Hash::sha1(StringPiece{"tree"});
+  auto restored = serialized.toTree(hash);
+  EXPECT_EQ(hash, restored->getHash());
+  for (const auto& entry : tree.getTreeEntries()) {
+    const auto& restoredEntry = restored->getEntryAt(entry.getName());
+    EXPECT_EQ(entry, restoredEntry);
+    EXPECT_EQ(entry.getSize(), restoredEntry.getSize());
+    EXPECT_EQ(entry.getContentSha1(), restoredEntry.getContentSha1());
+  }
+}
+
+TEST(SerializedTree, getEntryBinarySearches) {
+  auto buf = SerializedTree::serialize(makeTree());
+  SerializedTree serialized{buf.coalesce()};
+
+  auto readme = serialized.getEntry("README.md"_pc);
+  ASSERT_TRUE(readme);
+  EXPECT_EQ(TreeEntryType::REGULAR_FILE, readme->getType());
+  EXPECT_EQ(std::optional<uint64_t>{42}, readme->getSize());
+  EXPECT_EQ(
+      Hash("3a8f8eb91101860fd8484154885838bf322964d0"),
+      readme->getContentSha1());
+
+  auto link = serialized.getEntry("link"_pc);
+  ASSERT_TRUE(link);
+  EXPECT_EQ(std::optional<uint64_t>{7}, link->getSize());
+  EXPECT_FALSE(link->getContentSha1().has_value());
+
+  EXPECT_TRUE(serialized.getEntry("zzz"_pc));
+  EXPECT_FALSE(serialized.getEntry("aaa"_pc));
+  EXPECT_FALSE(serialized.getEntry("lia"_pc));
+  EXPECT_FALSE(serialized.getEntry("zzzz"_pc));
+}
+
+TEST(SerializedTree, emptyTree) {
+  auto buf = SerializedTree::serialize(Tree{std::vector<TreeEntry>{}});
+  SerializedTree serialized{buf.coalesce()};
+  EXPECT_EQ(0u, serialized.size());
+  EXPECT_FALSE(serialized.getEntry("a"_pc));
+}
+
+TEST(SerializedTree, deserializeTreeReadsGitTrees) {
+  auto tree = makeTree();
+  GitTreeSerializer serializer;
+  // Git trees must be serialized in order.
+  std::vector<TreeEntry> entries = tree.getTreeEntries();
+  std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+    return a.getName() < b.getName();
+  });
+  for (const auto& entry : entries) {
+    serializer.addEntry(entry);
+  }
+  auto gitBuf = serializer.finalize();
+  auto gitBytes = gitBuf.coalesce();
+  EXPECT_FALSE(SerializedTree::isSerializedTree(gitBytes));
+
+  auto hash = Hash::sha1(gitBytes);
+  auto fromGit = deserializeTree(hash, gitBytes);
+  auto binaryBuf = SerializedTree::serialize(tree);
+  auto fromBinary = deserializeTree(hash, binaryBuf.coalesce());
+  EXPECT_EQ(*fromGit, *fromBinary);
+}
+
+TEST(SerializedTree, rejectsMalformedData) {
+  auto buf = SerializedTree::serialize(makeTree());
+  std::string data = StringPiece{buf.coalesce()}.str();
+  auto view = [](const std::string& str) {
+    return ByteRange{StringPiece{str}};
+  };
+
+  // Records are checked as they are read.
+  auto materialize = [&](const std::string& str) {
+    return SerializedTree{view(str)}.toTree(Hash{});
+  };
+
+  EXPECT_THROW(SerializedTree{view(data.substr(0, 6))}, std::invalid_argument);
+  EXPECT_THROW(
+      materialize(data.substr(0, data.size() - 1)), std::invalid_argument);
+
+  auto badVersion = data;
+  badVersion[1] = 99;
+  EXPECT_THROW(SerializedTree{view(badVersion)}, std::invalid_argument);
+
+  auto badOffset = data;
+  badOffset[8] = 0x7f;
+  EXPECT_THROW(
+      SerializedTree{view(badOffset)}.getEntry("README.md"_pc),
+      std::invalid_argument);
+  EXPECT_THROW(materialize(badOffset), std::invalid_argument);
+
+  // Renaming the last entry from "zzz" to "zza" keeps the entries sorted...
+  auto renamed = data;
+  renamed[data.size() - 1] = 'a';
+  EXPECT_NO_THROW(materialize(renamed));
+  // ...but renaming it to "Azz" does not.
+  auto unsorted = data;
+  unsorted[data.size() - 3] = 'A';
+  EXPECT_THROW(materialize(unsorted), std::invalid_argument);
+}
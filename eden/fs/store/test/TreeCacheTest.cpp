@@ -0,0 +1,90 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "eden/fs/store/TreeCache.h"
+#include <gtest/gtest.h>
+#include "eden/fs/model/Tree.h"
+
+using namespace folly::literals;
+using namespace facebook::eden;
+
+namespace {
+
+const auto hash1 = Hash{"0000000000000000000000000000000000000001"_sp};
+const auto hash2 = Hash{"0000000000000000000000000000000000000002"_sp};
+const auto hash3 = Hash{"0000000000000000000000000000000000000003"_sp};
+
+std::shared_ptr<const Tree> makeTree(const Hash& hash) {
+  std::vector<TreeEntry> entries;
+  entries.emplace_back(hash, "file", TreeEntryType::REGULAR_FILE);
+  return std::make_shared<const Tree>(std::move(entries), hash);
+}
+
+const auto tree1 = makeTree(hash1);
+const auto tree2 = makeTree(hash2);
+const auto tree3 = makeTree(hash3);
+
+// All of the test trees have the same estimated size.
+const auto treeSize = tree1->getSizeInBytes();
+} // namespace
+
+TEST(TreeCache, returns_inserted_trees_and_counts_hits) {
+  auto cache = TreeCache::create(10 * treeSize, 0);
+  EXPECT_EQ(nullptr, cache->get(hash1));
+  cache->insert(tree1);
+  EXPECT_EQ(tree1, cache->get(hash1));
+
+  auto stats = cache->getStats();
+  EXPECT_EQ(1, stats.treeCount);
+  EXPECT_EQ(treeSize, stats.totalSizeInBytes);
+  EXPECT_EQ(1, stats.hitCount);
+  EXPECT_EQ(1, stats.missCount);
+  EXPECT_EQ(0, stats.evictionCount);
+}
+
+TEST(TreeCache, evicts_least_recently_used_when_over_budget) {
+  auto cache = TreeCache::create(2 * treeSize, 0);
+  cache->insert(tree1);
+  cache->insert(tree2);
+  // tree1 is now more recently used than tree2.
+  EXPECT_EQ(tree1, cache->get(hash1));
+  cache->insert(tree3);
+
+  EXPECT_TRUE(cache->contains(hash1));
+  EXPECT_FALSE(cache->contains(hash2));
+  EXPECT_TRUE(cache->contains(hash3));
+  EXPECT_EQ(1, cache->getStats().evictionCount);
+  EXPECT_EQ(2 * treeSize, cache->getStats().totalSizeInBytes);
+}
+
+TEST(TreeCache, keeps_minimum_entry_count) {
+  auto cache = TreeCache::create(1, 2);
+  cache->insert(tree1);
+  cache->insert(tree2);
+  cache->insert(tree3);
+  EXPECT_FALSE(cache->contains(hash1));
+  EXPECT_TRUE(cache->contains(hash2));
+  EXPECT_TRUE(cache->contains(hash3));
+}
+
+TEST(TreeCache, duplicate_insert_does_not_double_count) {
+  auto cache = TreeCache::create(10 * treeSize, 0);
+  cache->insert(tree1);
+  cache->insert(makeTree(hash1));
+  EXPECT_EQ(1, cache->getStats().treeCount);
+  EXPECT_EQ(treeSize, cache->getStats().totalSizeInBytes);
+}
+
+TEST(TreeCache, clear_empties_the_cache) {
+  auto cache = TreeCache::create(10 * treeSize, 0);
+  cache->insert(tree1);
+  cache->clear();
+  EXPECT_FALSE(cache->contains(hash1));
+  EXPECT_EQ(0, cache->getStats().totalSizeInBytes);
+}
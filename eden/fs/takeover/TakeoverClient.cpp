@@ -75,20 +75,31 @@ TakeoverData takeoverMounts(
   auto& message = expectedMessage.value();
 
   auto data = TakeoverData::deserialize(&message.data);
+  size_t numClonedFDs = 0;
+  for (const auto& mountInfo : data.mountPoints) {
+    numClonedFDs += mountInfo.clonedFuseFDs.size();
+  }
   // Add 2 here for the lock file and the thrift socket
-  if (data.mountPoints.size() + 2 != message.files.size()) {
+  if (data.mountPoints.size() + numClonedFDs + 2 != message.files.size()) {
     throw std::runtime_error(folly::to<string>(
         "received ",
         data.mountPoints.size(),
-        " mount paths, but ",
+        " mount paths with ",
+        numClonedFDs,
+        " cloned FUSE devices, but ",
         message.files.size(),
         " FDs (including the lock file FD)"));
   }
   data.lockFile = std::move(message.files[0]);
   data.thriftSocket = std::move(message.files[1]);
-  for (size_t n = 0; n < data.mountPoints.size(); ++n) {
-    auto& mountInfo = data.mountPoints[n];
-    mountInfo.fuseFD = std::move(message.files[n + 2]);
+  size_t fileIndex = 2;
+  for (auto& mountInfo : data.mountPoints) {
+    mountInfo.fuseFD = std::move(message.files[fileIndex++]);
+  }
+  for (auto& mountInfo : data.mountPoints) {
+    for (auto& clonedFD : mountInfo.clonedFuseFDs) {
+      clonedFD = std::move(message.files[fileIndex++]);
+    }
   }
 
   return data;
@@ -25,7 +25,8 @@ namespace eden {
 
 const std::set<int32_t> kSupportedTakeoverVersions{
     TakeoverData::kTakeoverProtocolVersionOne,
-    TakeoverData::kTakeoverProtocolVersionThree};
+    TakeoverData::kTakeoverProtocolVersionThree,
+    TakeoverData::kTakeoverProtocolVersionFour};
 
 std::optional<int32_t> TakeoverData::computeCompatibleVersion(
     const std::set<int32_t>& versions,
@@ -51,7 +52,8 @@ IOBuf TakeoverData::serialize(int32_t protocolVersion) {
     case kTakeoverProtocolVersionOne:
       return serializeVersion1();
     case kTakeoverProtocolVersionThree:
-      return serializeVersion3();
+    case kTakeoverProtocolVersionFour:
+      return serializeVersion3(protocolVersion);
     default: {
       auto bug = EDEN_BUG()
           << "only kTakeoverProtocolVersionOne is supported, but somehow "
@@ -72,7 +74,8 @@ folly::IOBuf TakeoverData::serializeError(
     case kTakeoverProtocolVersionOne:
       return serializeErrorVersion1(ew);
     case kTakeoverProtocolVersionThree:
-      return serializeErrorVersion3(ew);
+    case kTakeoverProtocolVersionFour:
+      return serializeErrorVersion3(protocolVersion, ew);
     default: {
       auto bug = EDEN_BUG()
           << "only kTakeoverProtocolVersionOne is supported, but somehow "
@@ -94,9 +97,11 @@ TakeoverData TakeoverData::deserialize(IOBuf* buf) {
       // because it the messageType is needed to decode the response.
       return deserializeVersion1(buf);
     case kTakeoverProtocolVersionThree:
+    case kTakeoverProtocolVersionFour:
       // Version 3 (there was no 2 because of how Version 1 used word values
       // 1 and 2) doesn't care about this version byte, so we skip past it
-      // and let the underlying code decode the data
+      // and let the underlying code decode the data.  Version 4 only adds
+      // an optional field that is left unset by version 3.
       buf->trimStart(sizeof(uint32_t));
       return deserializeVersion3(buf);
     default:
@@ -266,14 +271,14 @@ TakeoverData TakeoverData::deserializeVersion1(IOBuf* buf) {
   return data;
 }
 
-IOBuf TakeoverData::serializeVersion3() {
+IOBuf TakeoverData::serializeVersion3(int32_t protocolVersion) {
   SerializedTakeoverData serialized;
 
   folly::IOBufQueue bufQ;
   folly::io::QueueAppender app(&bufQ, 0);
 
   // First word is the protocol version
-  app.writeBE<uint32_t>(kTakeoverProtocolVersionThree);
+  app.writeBE<uint32_t>(protocolVersion);
 
   std::vector<SerializedMountInfo> serializedMounts;
   for (const auto& mount : mountPoints) {
@@ -296,6 +301,14 @@ IOBuf TakeoverData::serializeVersion3() {
 
     serializedMount.inodeMap = mount.inodeMap;
 
+    if (protocolVersion >= kTakeoverProtocolVersionFour) {
+      serializedMount.clonedFuseDeviceCount = mount.clonedFuseFDs.size();
+    }
+
+    if (mount.journalSequenceNumber) {
+      serializedMount.set_journalSequenceNumber(*mount.journalSequenceNumber);
+    }
+
     serializedMounts.emplace_back(std::move(serializedMount));
   }
 
@@ -306,6 +319,7 @@ IOBuf TakeoverData::serializeVersion3() {
 }
 
 folly::IOBuf TakeoverData::serializeErrorVersion3(
+    int32_t protocolVersion,
     const folly::exception_wrapper& ew) {
   SerializedTakeoverData serialized;
   auto exceptionClassName = ew.class_name();
@@ -317,7 +331,7 @@ folly::IOBuf TakeoverData::serializeErrorVersion3(
   folly::io::QueueAppender app(&bufQ, 0);
 
   // First word is the protocol version
-  app.writeBE<uint32_t>(kTakeoverProtocolVersionThree);
+  app.writeBE<uint32_t>(protocolVersion);
 
   CompactSerializer::serialize(serialized, &bufQ);
   return std::move(*bufQ.move());
@@ -348,6 +362,14 @@ TakeoverData TakeoverData::deserializeVersion3(IOBuf* buf) {
             folly::File{},
             *connInfo,
             std::move(serializedMount.inodeMap));
+        // The cloned FDs themselves are attached to the message by the
+        // sender; TakeoverClient fills in these placeholders.
+        data.mountPoints.back().clonedFuseFDs.resize(
+            serializedMount.clonedFuseDeviceCount);
+        if (serializedMount.__isset.journalSequenceNumber) {
+          data.mountPoints.back().journalSequenceNumber =
+              serializedMount.journalSequenceNumber_ref().value_unchecked();
+        }
       }
       return data;
     }
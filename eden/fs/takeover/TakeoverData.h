@@ -61,6 +61,11 @@ class TakeoverData {
     // like too much of a headache, so we simply skip over using
     // version 2 to describe this next one.
     kTakeoverProtocolVersionThree = 3,
+
+    // This version uses the same thrift encoding as version 3, but also
+    // transfers the per-thread clones of each mount's FUSE device.  The
+    // cloned FDs are sent after all of the primary FUSE device FDs.
+    kTakeoverProtocolVersionFour = 4,
   };
 
   // Given a set of versions provided by a client, find the largest
@@ -89,8 +94,15 @@ class TakeoverData {
     AbsolutePath stateDirectory;
     std::vector<AbsolutePath> bindMounts;
     folly::File fuseFD;
+    // Clones of fuseFD made with FUSE_DEV_IOC_CLONE, one per additional
+    // FuseChannel worker thread.  Empty if the channel was not cloning the
+    // device or the protocol version in use does not transfer them.
+    std::vector<folly::File> clonedFuseFDs;
     fuse_init_out connInfo;
     SerializedInodeMap inodeMap;
+    // The sequence number of the last delta in the mount's journal.  Only
+    // transferred by protocol version 3 and later.
+    std::optional<uint64_t> journalSequenceNumber;
   };
 
   /**
@@ -155,19 +167,23 @@ class TakeoverData {
   static TakeoverData deserializeVersion1(folly::IOBuf* buf);
 
   /**
-   * Serialize data using version 2 of the takeover protocol.
+   * Serialize data using version 3 or 4 of the takeover protocol.
+   * Both versions share the thrift encoding; version 4 additionally records
+   * the number of cloned FUSE device FDs for each mount.
    */
-  folly::IOBuf serializeVersion3();
+  folly::IOBuf serializeVersion3(int32_t protocolVersion);
 
   /**
-   * Serialize an exception using version 2 of the takeover protocol.
+   * Serialize an exception using version 3 or 4 of the takeover protocol.
    */
   static folly::IOBuf serializeErrorVersion3(
+      int32_t protocolVersion,
       const folly::exception_wrapper& ew);
 
   /**
-   * Deserialize the TakeoverData from a buffer using version 2 of the takeover
-   * protocol.
+   * Deserialize the TakeoverData from a buffer using version 3 or 4 of the
+   * takeover protocol.  For each mount, clonedFuseFDs is filled with
+   * placeholder File objects, one per cloned FD that the sender attached.
    */
   static TakeoverData deserializeVersion3(folly::IOBuf* buf);
 
@@ -178,6 +178,16 @@ Future<Unit> TakeoverServer::ConnHandler::sendTakeoverData(
     for (auto& mount : data.mountPoints) {
       msg.files.push_back(std::move(mount.fuseFD));
     }
+    // Older protocol versions have no way to describe the cloned FUSE
+    // devices; they are simply closed and the new process clones the
+    // primary devices again.
+    if (protocolVersion_ >= TakeoverData::kTakeoverProtocolVersionFour) {
+      for (auto& mount : data.mountPoints) {
+        for (auto& clonedFD : mount.clonedFuseFDs) {
+          msg.files.push_back(std::move(clonedFD));
+        }
+      }
+    }
   } catch (const std::exception& ex) {
     auto ew = folly::exception_wrapper{std::current_exception(), ex};
     data.takeoverComplete.setException(ew);
@@ -49,6 +49,15 @@ struct SerializedMountInfo {
   // 5: SerializedFileHandleMap fileHandleMap,
 
   6: SerializedInodeMap inodeMap,
+
+  // The number of cloned FUSE device FDs sent for this mount, following
+  // the primary FUSE device FDs.  Only set by protocol version 4 and later.
+  7: i32 clonedFuseDeviceCount,
+
+  // The sequence number of the last delta in the mount's journal.  The new
+  // process only restores the journal from its log if the log ends with this
+  // delta.
+  8: optional i64 journalSequenceNumber,
 }
 
 union SerializedTakeoverData {
@@ -435,3 +435,93 @@ TEST(Takeover, oneToTwo) {
   // Make sure the received mount information is empty
   EXPECT_EQ(0, clientData.mountPoints.size());
 }
+
+namespace {
+/**
+ * Build a TakeoverData object for a single mount whose FUSE device has been
+ * cloned once for each entry in clonedFusePaths.
+ */
+TakeoverData makeClonedFuseData(
+    AbsolutePathPiece tmpDirPath,
+    AbsolutePathPiece fusePath,
+    const std::vector<AbsolutePath>& clonedFusePaths) {
+  TakeoverData serverData;
+  serverData.lockFile =
+      folly::File{(tmpDirPath + "lock"_pc).stringPiece(), O_RDWR | O_CREAT};
+  serverData.thriftSocket =
+      folly::File{(tmpDirPath + "thrift"_pc).stringPiece(), O_RDWR | O_CREAT};
+
+  serverData.mountPoints.emplace_back(
+      tmpDirPath + "mount"_pc,
+      tmpDirPath + "client"_pc,
+      std::vector<AbsolutePath>{},
+      folly::File{fusePath.stringPiece(), O_RDWR | O_CREAT},
+      fuse_init_out{},
+      SerializedInodeMap{});
+  for (const auto& clonedFusePath : clonedFusePaths) {
+    serverData.mountPoints.back().clonedFuseFDs.emplace_back(
+        clonedFusePath.stringPiece(), O_RDWR | O_CREAT);
+  }
+  return serverData;
+}
+} // namespace
+
+TEST(Takeover, clonedFuseDevices) {
+  TemporaryDirectory tmpDir("eden_takeover_test");
+  AbsolutePathPiece tmpDirPath{tmpDir.path().string()};
+
+  auto fusePath = tmpDirPath + "fuse"_pc;
+  std::vector<AbsolutePath> clonedFusePaths = {
+      tmpDirPath + "fuse_clone1"_pc,
+      tmpDirPath + "fuse_clone2"_pc,
+      tmpDirPath + "fuse_clone3"_pc,
+  };
+  auto serverData = makeClonedFuseData(tmpDirPath, fusePath, clonedFusePaths);
+
+  auto serverSendFuture = serverData.takeoverComplete.getFuture();
+  TestHandler handler{std::move(serverData)};
+  auto result = runTakeover(
+      tmpDir,
+      &handler,
+      std::set<int32_t>{TakeoverData::kTakeoverProtocolVersionFour});
+  ASSERT_TRUE(serverSendFuture.hasValue());
+  ASSERT_TRUE(result.hasValue());
+  const auto& clientData = result.value();
+
+  ASSERT_EQ(1, clientData.mountPoints.size());
+  const auto& mountInfo = clientData.mountPoints.at(0);
+  EXPECT_EQ(tmpDirPath + "mount"_pc, mountInfo.mountPath);
+  checkExpectedFile(mountInfo.fuseFD.fd(), fusePath);
+  ASSERT_EQ(clonedFusePaths.size(), mountInfo.clonedFuseFDs.size());
+  for (size_t n = 0; n < clonedFusePaths.size(); ++n) {
+    checkExpectedFile(mountInfo.clonedFuseFDs[n].fd(), clonedFusePaths[n]);
+  }
+}
+
+TEST(Takeover, clonedFuseDevicesDroppedByVersionThree) {
+  TemporaryDirectory tmpDir("eden_takeover_test");
+  AbsolutePathPiece tmpDirPath{tmpDir.path().string()};
+
+  auto fusePath = tmpDirPath + "fuse"_pc;
+  std::vector<AbsolutePath> clonedFusePaths = {
+      tmpDirPath + "fuse_clone1"_pc,
+  };
+  auto serverData = makeClonedFuseData(tmpDirPath, fusePath, clonedFusePaths);
+
+  // Version 3 has no way to describe the cloned devices, so only the
+  // primary FUSE device should be transferred.
+  auto serverSendFuture = serverData.takeoverComplete.getFuture();
+  TestHandler handler{std::move(serverData)};
+  auto result = runTakeover(
+      tmpDir,
+      &handler,
+      std::set<int32_t>{TakeoverData::kTakeoverProtocolVersionThree});
+  ASSERT_TRUE(serverSendFuture.hasValue());
+  ASSERT_TRUE(result.hasValue());
+  const auto& clientData = result.value();
+
+  ASSERT_EQ(1, clientData.mountPoints.size());
+  const auto& mountInfo = clientData.mountPoints.at(0);
+  checkExpectedFile(mountInfo.fuseFD.fd(), fusePath);
+  EXPECT_EQ(0, mountInfo.clonedFuseFDs.size());
+}
@@ -41,6 +41,7 @@ FakeBackingStore::~FakeBackingStore() {}
 Future<unique_ptr<Tree>> FakeBackingStore::getTree(const Hash& id) {
   auto data = data_.wlock();
   ++data->accessCounts[id];
+  data->importPriorities[id] = getCurrentImportPriority();
   auto it = data->trees.find(id);
   if (it == data->trees.end()) {
     // Throw immediately, as opposed to returning a Future that contains an
@@ -58,6 +59,7 @@ Future<unique_ptr<Tree>> FakeBackingStore::getTree(const Hash& id) {
 Future<unique_ptr<Blob>> FakeBackingStore::getBlob(const Hash& id) {
   auto data = data_.wlock();
   ++data->accessCounts[id];
+  data->importPriorities[id] = getCurrentImportPriority();
   auto it = data->blobs.find(id);
   if (it == data->blobs.end()) {
     // Throw immediately, for the same reasons mentioned in getTree()
@@ -105,6 +107,28 @@ Future<unique_ptr<Tree>> FakeBackingStore::getTreeForCommit(
       });
 }
 
+void FakeBackingStore::raiseTreePriority(
+    const Hash& id,
+    ImportPriorityClass priority) {
+  raisePriority(*data_.wlock(), id, priority);
+}
+
+void FakeBackingStore::raiseBlobPriority(
+    const Hash& id,
+    ImportPriorityClass priority) {
+  raisePriority(*data_.wlock(), id, priority);
+}
+
+void FakeBackingStore::raisePriority(
+    Data& data,
+    const Hash& id,
+    ImportPriorityClass priority) {
+  auto it = data.importPriorities.find(id);
+  if (it != data.importPriorities.end() && priority < it->second) {
+    it->second = priority;
+  }
+}
+
 Blob FakeBackingStore::makeBlob(folly::StringPiece contents) {
   return makeBlob(Hash::sha1(contents), contents);
 }
@@ -347,5 +371,15 @@ void FakeBackingStore::discardOutstandingRequests() {
 size_t FakeBackingStore::getAccessCount(const Hash& hash) const {
   return folly::get_default(data_.rlock()->accessCounts, hash, 0);
 }
+
+std::optional<ImportPriorityClass> FakeBackingStore::getImportPriority(
+    const Hash& hash) const {
+  auto data = data_.rlock();
+  auto it = data->importPriorities.find(hash);
+  if (it == data->importPriorities.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
 } // namespace eden
 } // namespace facebook
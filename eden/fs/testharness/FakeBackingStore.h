@@ -11,6 +11,7 @@
 
 #include <initializer_list>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 #include "eden/fs/model/Blob.h"
@@ -44,6 +45,10 @@ class FakeBackingStore : public BackingStore {
   folly::Future<std::unique_ptr<Blob>> getBlob(const Hash& id) override;
   folly::Future<std::unique_ptr<Tree>> getTreeForCommit(
       const Hash& commitID) override;
+  void raiseTreePriority(const Hash& id, ImportPriorityClass priority)
+      override;
+  void raiseBlobPriority(const Hash& id, ImportPriorityClass priority)
+      override;
 
   /**
    * Add a Blob to the backing store
@@ -136,14 +141,26 @@ class FakeBackingStore : public BackingStore {
    */
   size_t getAccessCount(const Hash& hash) const;
 
+  /**
+   * Returns the import priority of the most recent getTree or getBlob call
+   * for this hash, raised by any later call to raiseTreePriority or
+   * raiseBlobPriority.
+   */
+  std::optional<ImportPriorityClass> getImportPriority(const Hash& hash) const;
+
  private:
   struct Data {
     std::unordered_map<Hash, std::unique_ptr<StoredTree>> trees;
     std::unordered_map<Hash, std::unique_ptr<StoredBlob>> blobs;
     std::unordered_map<Hash, std::unique_ptr<StoredHash>> commits;
     std::unordered_map<Hash, size_t> accessCounts;
+    std::unordered_map<Hash, ImportPriorityClass> importPriorities;
   };
 
+  static void raisePriority(
+      Data& data,
+      const Hash& id,
+      ImportPriorityClass priority);
   static std::vector<TreeEntry> buildTreeEntries(
       const std::initializer_list<TreeEntryData>& entryArgs);
   static void sortTreeEntries(std::vector<TreeEntry>& entries);
@@ -11,6 +11,8 @@
 
 #include <folly/String.h>
 #include <folly/futures/Future.h>
+#include <folly/io/Cursor.h>
+#include "eden/fs/store/BlobChunk.h"
 
 using folly::Future;
 using folly::makeFuture;
@@ -76,6 +78,27 @@ Future<std::shared_ptr<const Blob>> FakeObjectStore::getBlob(
   return makeFuture(make_shared<Blob>(iter->second));
 }
 
+Future<std::shared_ptr<const Blob>> FakeObjectStore::getBlobChunk(
+    const Hash& id,
+    uint64_t chunkIndex) const {
+  ++accessCounts_[id];
+  auto iter = blobs_.find(id);
+  if (iter == blobs_.end()) {
+    return makeFuture<shared_ptr<const Blob>>(
+        std::domain_error("blob " + id.toString() + " not found"));
+  }
+  const auto& contents = iter->second.getContents();
+  folly::IOBuf chunk;
+  auto offset = chunkIndex * kBlobChunkSize;
+  if (offset < iter->second.getSize()) {
+    folly::io::Cursor cursor{&contents};
+    cursor.skip(offset);
+    cursor.cloneAtMost(chunk, kBlobChunkSize);
+  }
+  return makeFuture(
+      make_shared<Blob>(getBlobChunkId(id, chunkIndex), std::move(chunk)));
+}
+
 Future<shared_ptr<const Tree>> FakeObjectStore::getTreeForCommit(
     const Hash& commitID) const {
   ++accessCounts_[commitID];
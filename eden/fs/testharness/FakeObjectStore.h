@@ -37,6 +37,9 @@ class FakeObjectStore : public IObjectStore {
       const Hash& id) const override;
   folly::Future<std::shared_ptr<const Blob>> getBlob(
       const Hash& id) const override;
+  folly::Future<std::shared_ptr<const Blob>> getBlobChunk(
+      const Hash& id,
+      uint64_t chunkIndex) const override;
   folly::Future<std::shared_ptr<const Tree>> getTreeForCommit(
       const Hash& commitID) const override;
   folly::Future<BlobMetadata> getBlobMetadata(const Hash& id) const override;
@@ -61,11 +61,20 @@ EdenThreadStatsBase::EdenThreadStatsBase() {}
 
 EdenThreadStatsBase::Histogram EdenThreadStatsBase::createHistogram(
     const std::string& name) {
+  return createHistogram(
+      name, kBucketSize.count(), kMinValue.count(), kMaxValue.count());
+}
+
+EdenThreadStatsBase::Histogram EdenThreadStatsBase::createHistogram(
+    const std::string& name,
+    int64_t bucketSize,
+    int64_t min,
+    int64_t max) {
   return Histogram{this,
                    name,
-                   static_cast<size_t>(kBucketSize.count()),
-                   kMinValue.count(),
-                   kMaxValue.count(),
+                   static_cast<size_t>(bucketSize),
+                   min,
+                   max,
                    facebook::stats::COUNT,
                    50,
                    90,
@@ -83,6 +83,11 @@ class EdenThreadStatsBase : public facebook::stats::ThreadLocalStatsT<
 
  protected:
   Histogram createHistogram(const std::string& name);
+  Histogram createHistogram(
+      const std::string& name,
+      int64_t bucketSize,
+      int64_t min,
+      int64_t max);
 #if defined(EDEN_HAVE_STATS)
   Timeseries createTimeseries(const std::string& name);
 #endif
@@ -113,6 +118,7 @@ class FuseThreadStats : public EdenThreadStatsBase {
   Histogram fsync{createHistogram("fuse.fsync_us")};
   Histogram opendir{createHistogram("fuse.opendir_us")};
   Histogram readdir{createHistogram("fuse.readdir_us")};
+  Histogram readdirplus{createHistogram("fuse.readdirplus_us")};
   Histogram releasedir{createHistogram("fuse.releasedir_us")};
   Histogram fsyncdir{createHistogram("fuse.fsyncdir_us")};
   Histogram statfs{createHistogram("fuse.statfs_us")};
@@ -127,6 +133,10 @@ class FuseThreadStats : public EdenThreadStatsBase {
   Histogram poll{createHistogram("fuse.poll_us")};
   Histogram forgetmulti{createHistogram("fuse.forgetmulti_us")};
 
+  // Number of requests outstanding on a FuseChannel worker queue, sampled
+  // each time a request is read from that queue.
+  Histogram queueDepth{createHistogram("fuse.queue_depth", 1, 0, 64)};
+
   // Since we can potentially finish a request in a different
   // thread from the one used to initiate it, we use HistogramPtr
   // as a helper for referencing the pointer-to-member that we
@@ -156,6 +166,27 @@ class HgBackingStoreThreadStats : public EdenThreadStatsBase {
       createHistogram("store.mononoke.get_tree")};
   Histogram mononokeBackingStoreGetBlob{
       createHistogram("store.mononoke.get_blob")};
+
+  // Number of requests waiting for an importer thread in each priority class,
+  // sampled as each request is queued.
+  Histogram importQueueDepthInteractive{
+      createHistogram("store.hg.import_queue_depth.interactive")};
+  Histogram importQueueDepthThrift{
+      createHistogram("store.hg.import_queue_depth.thrift")};
+  Histogram importQueueDepthPrefetch{
+      createHistogram("store.hg.import_queue_depth.prefetch")};
+  Histogram importQueueDepthBackground{
+      createHistogram("store.hg.import_queue_depth.background")};
+  // Time in milliseconds each request waited for an importer thread, by the
+  // priority class it was queued with.
+  Histogram importQueueWaitInteractive{
+      createHistogram("store.hg.import_queue_wait.interactive")};
+  Histogram importQueueWaitThrift{
+      createHistogram("store.hg.import_queue_wait.thrift")};
+  Histogram importQueueWaitPrefetch{
+      createHistogram("store.hg.import_queue_wait.prefetch")};
+  Histogram importQueueWaitBackground{
+      createHistogram("store.hg.import_queue_wait.background")};
 };
 
 /**
@@ -165,9 +196,12 @@ class HgBackingStoreThreadStats : public EdenThreadStatsBase {
 class HgImporterThreadStats : public EdenThreadStatsBase {
  public:
   Histogram hgBackingStoreGetBlob{createHistogram("store.hg.get_file")};
+  Histogram hgBackingStoreGetBlobBatch{
+      createHistogram("store.hg.get_file_batch")};
 
 #if defined(EDEN_HAVE_STATS)
   Timeseries catFile{createTimeseries("hg_importer.cat_file")};
+  Timeseries catFiles{createTimeseries("hg_importer.cat_files")};
   Timeseries fetchTree{createTimeseries("hg_importer.fetch_tree")};
   Timeseries manifest{createTimeseries("hg_importer.manifest")};
   Timeseries manifestNodeForCommit{
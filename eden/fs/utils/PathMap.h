@@ -141,6 +141,7 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
   using Vector::max_size;
   using Vector::rbegin;
   using Vector::rend;
+  using Vector::reserve;
   using Vector::size;
 
   // Swap contents with another map.